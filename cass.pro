@@ -22,4 +22,17 @@ SUBDIRS = \
           cass_vmi \
           cass_pnccd \
           cass_machinedata \
-          cass
+          cass \
+          cass_xtcgen \
+          cass_microbench
+
+# runs cass over a synthetic run, see cass_xtcgen/benchmark.sh
+benchmark.commands = $$PWD/cass_xtcgen/benchmark.sh
+benchmark.depends  = sub-cass sub-cass_xtcgen
+QMAKE_EXTRA_TARGETS += benchmark
+
+# runs the detector kernels on canned inputs and checks their results against the golden ones,
+# new golden results are written with cass_microbench/microbench -u -g cass_microbench/golden
+microbench.commands = $$PWD/cass_microbench/microbench -g $$PWD/cass_microbench/golden
+microbench.depends  = sub-cass_microbench
+QMAKE_EXTRA_TARGETS += microbench
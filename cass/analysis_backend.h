@@ -4,6 +4,7 @@
 #define CASS_ANALYSISBACKEND_H
 
 #include "cass.h"
+#include "event_products.h"
 
 namespace cass
 {
@@ -19,6 +20,8 @@ namespace cass
         virtual void saveSettings() = 0;
 
         virtual void operator()(CASSEvent*) = 0;
+        //add the products this analysis reads for its own results, e.g. what it sums up//
+        virtual void require(Products&)const    {}
     };
 }
 
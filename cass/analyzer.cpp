@@ -5,6 +5,22 @@
 #include "vmi_analysis.h"
 #include "pnccd_analysis.h"
 #include "machine_analysis.h"
+#include "instrumentation.h"
+
+namespace
+{
+    const char *name(cass::Analyzer::Analyzers analyzer)
+    {
+        switch (analyzer)
+        {
+        case cass::Analyzer::pnCCD:         return "pnCCD";
+        case cass::Analyzer::REMI:          return "REMI";
+        case cass::Analyzer::VMI:           return "VMI";
+        case cass::Analyzer::MachineData:   return "MachineData";
+        }
+        return "unknown";
+    }
+}
 
 cass::Analyzer::Analyzer()
 {
@@ -13,12 +29,17 @@ cass::Analyzer::Analyzer()
     //    _analyzer[VMI]          = new cass::VMI::Analysis();
     _analyzer[pnCCD]        = new cass::pnCCD::Analysis();
     _analyzer[MachineData]  = new cass::MachineData::Analysis();
+    //every analyzer is a stage of its own//
+    for (std::map<Analyzers,cass::AnalysisBackend*>::iterator it=_analyzer.begin() ; it != _analyzer.end(); ++it )
+        _stages[it->first] = new Stage(std::string("analysis.") + name(it->first));
 }
 
 cass::Analyzer::~Analyzer()
 {
     for (std::map<Analyzers,cass::AnalysisBackend*>::iterator it=_analyzer.begin() ; it != _analyzer.end(); ++it )
         delete (it->second);
+    for (std::map<Analyzers,Stage*>::iterator it=_stages.begin() ; it != _stages.end(); ++it )
+        delete (it->second);
 }
 
 
@@ -27,7 +48,16 @@ void cass::Analyzer::processEvent(cass::CASSEvent* cassevent)
     //use the analyzers to analyze the event//
     //iterate through all analyzers and send the cassevent to them//
     for (std::map<Analyzers,cass::AnalysisBackend*>::iterator it=_analyzer.begin() ; it != _analyzer.end(); ++it )
+    {
+        StageTimer timer(*_stages[it->first]);
         (*(it->second))(cassevent);
+    }
+}
+
+void cass::Analyzer::require(Products &products)const
+{
+    for (std::map<Analyzers,cass::AnalysisBackend*>::const_iterator it=_analyzer.begin() ; it != _analyzer.end(); ++it )
+        it->second->require(products);
 }
 
 void cass::Analyzer::loadSettings()
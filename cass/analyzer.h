@@ -10,7 +10,9 @@
 namespace cass
 {
     class CASSEvent;
+    class Products;
     class AnalysisBackend;
+    class Stage;
 
     //todo make singleton??
 
@@ -25,6 +27,9 @@ namespace cass
         /** list of known individual analyzers */
         enum Analyzers {pnCCD, REMI, VMI, MachineData};
 
+        /** add the products that the analyzers need for their own results */
+        void require(Products&)const;
+
     public slots:
         void processEvent(cass::CASSEvent*);
         void saveSettings();
@@ -33,6 +38,7 @@ namespace cass
 
     protected:
         std::map<Analyzers, AnalysisBackend*> _analyzer;
+        std::map<Analyzers, Stage*> _stages;
     };
 }//end namespace cass
 
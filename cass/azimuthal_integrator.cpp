@@ -0,0 +1,283 @@
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+
+#include "azimuthal_integrator.h"
+
+
+cass::AzimuthalIntegratorParameter::AzimuthalIntegratorParameter(size_t detector)
+{
+  QString s;
+  beginGroup("AzimuthalIntegration");
+  beginGroup(s.setNum(static_cast<uint32_t>(detector)));
+}
+
+cass::AzimuthalIntegratorParameter::~AzimuthalIntegratorParameter()
+{
+  endGroup();
+  endGroup();
+}
+
+void cass::AzimuthalIntegratorParameter::load()
+{
+  //sync before loading//
+  sync();
+  _centerX             = value("BeamCenterX",-1.).toDouble();
+  _centerY             = value("BeamCenterY",-1.).toDouble();
+  _pixelSize           = value("PixelSize",75e-6).toDouble();
+  _distance            = value("DetectorDistance",0.5).toDouble();
+  _nbrBins             = value("NbrBins",500).toUInt();
+  _splitFactor         = value("SplitFactor",1).toUInt();
+  _wavelengthTolerance = value("WavelengthTolerance",1e-3).toDouble();
+}
+
+void cass::AzimuthalIntegratorParameter::save()
+{
+  setValue("BeamCenterX",_centerX);
+  setValue("BeamCenterY",_centerY);
+  setValue("PixelSize",_pixelSize);
+  setValue("DetectorDistance",_distance);
+  setValue("NbrBins",_nbrBins);
+  setValue("SplitFactor",_splitFactor);
+  setValue("WavelengthTolerance",_wavelengthTolerance);
+}
+
+
+
+
+
+cass::AzimuthalIntegrator::AzimuthalIntegrator(size_t detector)
+  :_param(detector),
+   _rows(0),
+   _columns(0),
+   _wavelength(0),
+   _qStep(0),
+   _valid(false)
+{
+  loadSettings();
+}
+
+void cass::AzimuthalIntegrator::loadSettings()
+{
+  _param.load();
+  //the lookup table has to be recreated with the new settings//
+  _valid = false;
+}
+
+bool cass::AzimuthalIntegrator::updateGeometry(uint16_t rows, uint16_t columns, double wavelength)
+{
+  //we can only integrate frames with a sensible wavelength and size//
+  if (!(wavelength > 0) || !rows || !columns)
+    return false;
+  //only recreate the table when the geometry changed//
+  if (!_valid ||
+      rows != _rows ||
+      columns != _columns ||
+      fabs(wavelength-_wavelength) > _param._wavelengthTolerance*_wavelength)
+  {
+    _rows       = rows;
+    _columns    = columns;
+    _wavelength = wavelength;
+    createLookupTable();
+  }
+  return _valid;
+}
+
+namespace
+{
+  //one entry of the lookup table before sorting it by bin//
+  struct LUTEntry
+  {
+    uint32_t bin;
+    uint32_t pixel;
+    float    weight;
+  };
+}
+
+void cass::AzimuthalIntegrator::createLookupTable()
+{
+  const uint32_t nbrBins  = _param._nbrBins ? _param._nbrBins : 1;
+  const uint32_t split    = _param._splitFactor ? _param._splitFactor : 1;
+  const double centerX    = (_param._centerX < 0) ? 0.5*_columns : _param._centerX;
+  const double centerY    = (_param._centerY < 0) ? 0.5*_rows    : _param._centerY;
+  const double pixelSize  = _param._pixelSize;
+  const double distance   = _param._distance;
+  const double fourPiOverLambda = 4.*M_PI/_wavelength;
+
+  //the largest q is found in one of the corners of the frame//
+  double maxR2 = 0;
+  const double cornerX[2] = {-centerX, _columns-centerX};
+  const double cornerY[2] = {-centerY, _rows-centerY};
+  for (size_t i=0;i<2;++i)
+    for (size_t j=0;j<2;++j)
+      maxR2 = std::max(maxR2, cornerX[i]*cornerX[i] + cornerY[j]*cornerY[j]);
+  const double qMax = fourPiOverLambda * sin(0.5*atan(sqrt(maxR2)*pixelSize/distance));
+  if (!(qMax > 0))
+  {
+    std::cout << "AzimuthalIntegrator: geometry results in invalid q range"<<std::endl;
+    _valid = false;
+    return;
+  }
+  _qStep = qMax / nbrBins;
+
+  //go through all (sub)pixels and find out which bin they contribute to//
+  //a pixel is split into split x split subpixels, each carrying the same weight//
+  std::vector<LUTEntry> entries;
+  entries.reserve(static_cast<size_t>(_rows)*_columns);
+  std::vector<uint32_t> binsOfPixel(split*split);
+  const float subWeight = 1.f/(split*split);
+  for (uint32_t row=0; row<_rows; ++row)
+  {
+    for (uint32_t col=0; col<_columns; ++col)
+    {
+      for (uint32_t sy=0; sy<split; ++sy)
+      {
+        const double y = (row + (sy+0.5)/split - centerY) * pixelSize;
+        for (uint32_t sx=0; sx<split; ++sx)
+        {
+          const double x = (col + (sx+0.5)/split - centerX) * pixelSize;
+          const double q = fourPiOverLambda * sin(0.5*atan(sqrt(x*x+y*y)/distance));
+          binsOfPixel[sy*split+sx] = std::min(static_cast<uint32_t>(q/_qStep), nbrBins-1);
+        }
+      }
+      //combine the subpixels that fall into the same bin to one entry//
+      std::sort(binsOfPixel.begin(),binsOfPixel.end());
+      for (size_t i=0; i<binsOfPixel.size();)
+      {
+        size_t j=i;
+        while (j<binsOfPixel.size() && binsOfPixel[j]==binsOfPixel[i]) ++j;
+        LUTEntry e;
+        e.bin    = binsOfPixel[i];
+        e.pixel  = row*_columns + col;
+        e.weight = subWeight * (j-i);
+        entries.push_back(e);
+        i=j;
+      }
+    }
+  }
+
+  //sort the entries by bin with a counting sort, within a bin the pixels stay ordered//
+  //by their index, so that the frame is read in increasing address order//
+  _binStart.assign(nbrBins+1,0);
+  for (size_t i=0; i<entries.size(); ++i)
+    ++_binStart[entries[i].bin+1];
+  for (size_t i=0; i<nbrBins; ++i)
+    _binStart[i+1] += _binStart[i];
+  _pixelIndex.resize(entries.size());
+  _pixelWeight.resize(entries.size());
+  std::vector<uint32_t> fill(_binStart.begin(),_binStart.end()-1);
+  for (size_t i=0; i<entries.size(); ++i)
+  {
+    const uint32_t pos = fill[entries[i].bin]++;
+    _pixelIndex[pos]  = entries[i].pixel;
+    _pixelWeight[pos] = entries[i].weight;
+  }
+
+  //the normalization of each bin is the inverse of the sum of its weights//
+  _normalization.assign(nbrBins,0);
+  for (size_t b=0; b<nbrBins; ++b)
+  {
+    double sum = 0;
+    for (uint32_t i=_binStart[b]; i<_binStart[b+1]; ++i)
+      sum += _pixelWeight[i];
+    _normalization[b] = (sum > 0) ? static_cast<float>(1./sum) : 0.f;
+  }
+  _profile.assign(nbrBins,0);
+  _valid = true;
+  std::cout << "AzimuthalIntegrator: created lookup table for "<<_columns<<"x"<<_rows
+            <<" frame with "<<nbrBins<<" bins up to q="<<qMax<<" 1/nm"<<std::endl;
+}
+
+const cass::AzimuthalIntegrator::profile_t& cass::AzimuthalIntegrator::integrate(const int16_t *frame)
+{
+  const size_t nbrBins = _profile.size();
+  const uint32_t *pixelIndex = _pixelIndex.empty() ? 0 : &_pixelIndex[0];
+  const float *pixelWeight   = _pixelWeight.empty() ? 0 : &_pixelWeight[0];
+  for (size_t b=0; b<nbrBins; ++b)
+  {
+    const uint32_t *idx = pixelIndex  + _binStart[b];
+    const float    *w   = pixelWeight + _binStart[b];
+    const uint32_t n    = _binStart[b+1] - _binStart[b];
+    //use four independent partial sums to break the dependency chain of the additions//
+    float s0=0, s1=0, s2=0, s3=0;
+    uint32_t i=0;
+    for (; i+4<=n; i+=4)
+    {
+      s0 += w[i  ] * frame[idx[i  ]];
+      s1 += w[i+1] * frame[idx[i+1]];
+      s2 += w[i+2] * frame[idx[i+2]];
+      s3 += w[i+3] * frame[idx[i+3]];
+    }
+    for (; i<n; ++i)
+      s0 += w[i] * frame[idx[i]];
+    _profile[b] = ((s0+s1)+(s2+s3)) * _normalization[b];
+  }
+  return _profile;
+}
+
+
+
+
+
+bool cass::RadialProfileFile::open(const std::string &filename)
+{
+  if (_fp && filename == _filename)
+    return true;
+  close();
+  //when the file does not exist yet we need to write the magic first//
+  FILE *test = fopen(filename.c_str(),"rb");
+  const bool isNew = !test;
+  if (test) fclose(test);
+  _fp = fopen(filename.c_str(),"ab");
+  if (!_fp)
+  {
+    std::cout << "RadialProfileFile: could not open \""<<filename<<"\""<<std::endl;
+    return false;
+  }
+  //write in large blocks, the records are small//
+  _buffer.resize(1<<20);
+  setvbuf(_fp,&_buffer[0],_IOFBF,_buffer.size());
+  if (isNew)
+    fwrite("CASSIBQ1",1,8,_fp);
+  _filename = filename;
+  return true;
+}
+
+void cass::RadialProfileFile::append(uint64_t eventid, uint32_t detector, const AzimuthalIntegrator& integrator)
+{
+  if (!_fp)
+    return;
+  const uint32_t nbrBins = integrator.nbrBins();
+  const float qStep      = static_cast<float>(integrator.qStep());
+  fwrite(&eventid,sizeof(eventid),1,_fp);
+  fwrite(&detector,sizeof(detector),1,_fp);
+  fwrite(&nbrBins,sizeof(nbrBins),1,_fp);
+  fwrite(&qStep,sizeof(qStep),1,_fp);
+  if (nbrBins)
+    fwrite(&integrator.profile()[0],sizeof(float),nbrBins,_fp);
+}
+
+void cass::RadialProfileFile::flush()
+{
+  if (_fp)
+    fflush(_fp);
+}
+
+void cass::RadialProfileFile::close()
+{
+  if (_fp)
+    fclose(_fp);
+  _fp = 0;
+  _filename.clear();
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
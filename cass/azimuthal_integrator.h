@@ -0,0 +1,117 @@
+#ifndef CASS_AZIMUTHALINTEGRATOR_H
+#define CASS_AZIMUTHALINTEGRATOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "cass.h"
+#include "parameter_backend.h"
+
+namespace cass
+{
+  //the settings of the azimuthal integration of one detector//
+  class CASSSHARED_EXPORT AzimuthalIntegratorParameter : public cass::ParameterBackend
+  {
+  public:
+    AzimuthalIntegratorParameter(size_t detector);
+    ~AzimuthalIntegratorParameter();
+    void load();
+    void save();
+
+  public:
+    double     _centerX;             //beam center in pixel columns, negative means frame center
+    double     _centerY;             //beam center in pixel rows, negative means frame center
+    double     _pixelSize;           //the size of one pixel in m
+    double     _distance;            //the distance between interaction region and detector in m
+    uint32_t   _nbrBins;             //the number of bins of the radial profile
+    uint32_t   _splitFactor;         //a pixel is split into splitFactor x splitFactor subpixels
+    double     _wavelengthTolerance; //relative wavelength change that requires a new lookup table
+  };
+
+
+
+  //integrates a detector frame azimuthally into bins of the momentum transfer q//
+  //the pixel to bin assignment is calculated only once for a given geometry and stored//
+  //in a sparse lookup table that is sorted by bin, so the per event work is just a//
+  //gather and sum for each bin without any writes to shared bins//
+  class CASSSHARED_EXPORT AzimuthalIntegrator
+  {
+  public:
+    typedef std::vector<float> profile_t;
+
+  public:
+    AzimuthalIntegrator(size_t detector);
+    ~AzimuthalIntegrator() {}
+
+    void loadSettings();
+    void saveSettings()                 {_param.save();}
+
+    //make sure the lookup table is valid for the frame size and the wavelength (in nm)//
+    //returns false when the geometry can not be integrated//
+    bool updateGeometry(uint16_t rows, uint16_t columns, double wavelength);
+    //integrate the frame, that must have the size given to updateGeometry//
+    const profile_t &integrate(const int16_t *frame);
+
+  public:
+    const profile_t &profile()const     {return _profile;}
+    size_t           nbrBins()const     {return _profile.size();}
+    double           qStep()const       {return _qStep;}
+
+  private:
+    void createLookupTable();
+
+  private:
+    AzimuthalIntegratorParameter _param;
+    //the geometry the lookup table was calculated for//
+    uint16_t               _rows;
+    uint16_t               _columns;
+    double                 _wavelength;
+    double                 _qStep;          //the width of one bin in 1/nm
+    bool                   _valid;
+    //the lookup table: entries of bin i are in [_binStart[i],_binStart[i+1])//
+    std::vector<uint32_t>  _binStart;
+    std::vector<uint32_t>  _pixelIndex;
+    std::vector<float>     _pixelWeight;
+    std::vector<float>     _normalization;  //1/(sum of weights) for each bin
+    profile_t              _profile;        //the result of the last integration
+  };
+
+
+
+  //writes the radial profiles of a run into one binary file//
+  //the file starts with the 8 byte magic "CASSIBQ1" followed by records of//
+  //uint64 eventid, uint32 detector, uint32 nbrBins, float qStep, float profile[nbrBins]//
+  //where bin i is centered at q = (i+0.5)*qStep in 1/nm//
+  class CASSSHARED_EXPORT RadialProfileFile
+  {
+  public:
+    RadialProfileFile():_fp(0)  {}
+    ~RadialProfileFile()        {close();}
+
+    //(re)open the file when the name differs from the currently open one//
+    bool open(const std::string &filename);
+    void append(uint64_t eventid, uint32_t detector, const AzimuthalIntegrator&);
+    //write the buffered records to disk, the file stays open//
+    void flush();
+    void close();
+
+  private:
+    FILE          *_fp;
+    std::string    _filename;
+    std::vector<char> _buffer;      //the stdio buffer for the file
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <QCoreApplication>
+#include <QStringList>
+#include <QTime>
 
 #include "cass.h"
 #include "cass_event.h"
@@ -13,7 +15,11 @@
 #include "dialog.h"
 #include "worker.h"
 #include "post_processor.h"
+#include "wavelength_appender.h"
+#include "event_filter.h"
+#include "shards.h"
 #include <unistd.h>
+#include <getopt.h>
 
 namespace cass{
 cass::CommandLineOptions globalOptions;
@@ -42,11 +48,39 @@ void parseOptions(int argc, char ** argv){
     -S: Only look at every nth frame\n\
     -G: Integrate images and display as we go\n\
     -w: Only append wavelength information to already existing files\n\
+    -W: Like -w, but only read the beam data and patch the files in batches\n\
+    -q: Append the azimuthally integrated pnCCD frames to a run file\n\
+    -e: Write the machine data and hit metrics of each event to a run table\n\
+    -p: Write the photon hits of the pnCCD frames to a run file instead of the\n\
+        frames of each event to HDF5 files\n\
+    -k: Copy the selected events to a skimmed xtc file of the run\n\
+    -r: Periodically rewrite the statistics of the processing stages to this file\n\
+    -u: Serve the statistics of the processing stages on this local socket\n\
+    -R: Interval in ms in which the statistics are exported (default 1000)\n\
+    -f: Only convert and analyze the events for which this expression is true, e.g.\n\
+        'f_11_ENRC > 0.5 && EbeamL3Energy > 13000 && damage == 0', epics values are\n\
+        given as epics[\"name\"]. -t, -T and -S are added to this expression\n\
+    -N: Split the files into this many shards, process them with as many local cass\n\
+        processes and merge their outputs when all are done\n\
+    -Z: Only process shard k of n, e.g. 2/8, the outputs get the suffix _shard2of8\n\
+    -J: Merge the outputs of this many shards of the runs in the file list\n\
+    -b: Build the events of a run from the streams of all DAQ nodes (s00, s01, ..)\n\
+        by their fiducials, the streams have to be in the file list\n\
+    --resume: Continue at the last checkpoint, they are made every Checkpoint\\Interval\n\
+        seconds (default 600) to Checkpoint\\Filename (default cass.checkpoint)\n\
+    -L: List the post processing modules. The chain of modules is taken from\n\
+        PostProcessing\\Chain in cass.ini, e.g. \"HitFinder, EventTable, HDF5Writer\",\n\
+        the options above are only used when it is not set\n\
     -h: print this text\n\
 ";
-  static char optstring[] = "x:l:sc:m:M:t:T:S:GgdDIwh";
+  static char optstring[] = "x:l:sc:m:M:t:T:S:GgdDIwWqepkr:u:R:f:N:Z:J:bLh";
+  static struct option long_options[] = {
+    {"resume", no_argument, 0, 'y'},
+    {0, 0, 0, 0}
+  };
+  QString filter;
   while(1){
-    c = getopt(argc,argv,optstring);
+    c = getopt_long(argc,argv,optstring,long_options,0);
     if(c == -1){
       break;
     }
@@ -118,6 +152,62 @@ void parseOptions(int argc, char ** argv){
     case 'w':
 	cass::globalOptions.onlyAppendWavelength = true;
       break;
+    case 'W':
+	cass::globalOptions.batchAppendWavelength = true;
+      break;
+    case 'q':
+	cass::globalOptions.integrateByQ = true;
+      break;
+    case 'e':
+	cass::globalOptions.writeEventTable = true;
+      break;
+    case 'p':
+	cass::globalOptions.writePhotonLists = true;
+      break;
+    case 'k':
+	cass::globalOptions.skimXtc = true;
+      break;
+    case 'r':
+	cass::globalOptions.statsFile = QString(optarg);
+      break;
+    case 'u':
+	cass::globalOptions.statsSocket = QString(optarg);
+      break;
+    case 'R':
+	cass::globalOptions.statsInterval = atoi(optarg);
+      break;
+    case 'f':
+	filter = optarg;
+      break;
+    case 'N':
+	cass::globalOptions.launchShards = atoi(optarg);
+      break;
+    case 'Z':
+	if(sscanf(optarg,"%d/%d",&cass::globalOptions.shard,&cass::globalOptions.nbrShards) != 2 ||
+	   cass::globalOptions.nbrShards < 1 || cass::globalOptions.shard < 0 ||
+	   cass::globalOptions.shard >= cass::globalOptions.nbrShards){
+	  printf("bad shard \"%s\", it has to be k/n with 0 <= k < n\n",optarg);
+	  exit(1);
+	}
+      break;
+    case 'J':
+	cass::globalOptions.mergeShards = atoi(optarg);
+      break;
+    case 'b':
+	cass::globalOptions.buildEvents = true;
+      break;
+    case 'y':
+	cass::globalOptions.resume = true;
+      break;
+    case 'L':
+      {
+	std::vector<std::string> modules = cass::PostProcessingRegistry::names();
+	for(size_t i=0; i<modules.size(); i++){
+	  printf("%s\n",modules[i].c_str());
+	}
+	exit(0);
+      }
+      break;
     case 'h':
       printf("%s",help_text);
       exit(0);
@@ -126,6 +216,47 @@ void parseOptions(int argc, char ** argv){
       printf ("?? getopt returned character code 0%o ??\n", c);
     }
   }
+  //the start and end time and the skip period become part of the event filter, so that the//
+  //events outside of them are rejected before the detectors are converted//
+  QStringList terms;
+  if(!filter.isEmpty()){
+    terms << QString("(") + filter + ")";
+  }
+  if(cass::globalOptions.startTime.isValid()){
+    terms << QString("timeOfDay >= %1").arg(QTime(0,0).secsTo(cass::globalOptions.startTime.time()));
+  }
+  if(cass::globalOptions.endTime.isValid()){
+    terms << QString("timeOfDay <= %1").arg(QTime(0,0).secsTo(cass::globalOptions.endTime.time()));
+  }
+  if(cass::globalOptions.skipPeriod > 1){
+    terms << QString("event % %1 == 0").arg(cass::globalOptions.skipPeriod);
+  }
+  cass::globalOptions.filterExpression = terms.join(" && ");
+  //the shards are byte ranges of single files//
+  if(cass::globalOptions.buildEvents && (cass::globalOptions.nbrShards > 1 ||
+					 cass::globalOptions.launchShards > 1)){
+    printf("the events can not be built from the streams when the files are sharded\n");
+    exit(1);
+  }
+  //every shard writes its own outputs and statistics//
+  if(cass::globalOptions.nbrShards > 1){
+    QString suffix(cass::ShardPlanner::suffix(cass::globalOptions.shard,
+					      cass::globalOptions.nbrShards).c_str());
+    cass::globalOptions.outputSuffix = suffix;
+    if(!cass::globalOptions.statsFile.isEmpty()){
+      cass::globalOptions.statsFile += suffix;
+    }
+    if(!cass::globalOptions.statsSocket.isEmpty()){
+      cass::globalOptions.statsSocket += suffix;
+    }
+  }
+  cass::EventFilter check;
+  if(!check.compile(cass::globalOptions.filterExpression.toStdString())){
+    printf("bad event filter \"%s\": %s\n",cass::globalOptions.filterExpression.toAscii().constData(),
+	   check.error().c_str());
+    printf("the variables are: %s epics[\"name\"]\n",cass::EventFilter::variables().c_str());
+    exit(1);
+  }
 }
 
 /*
@@ -182,14 +313,32 @@ int main(int argc, char **argv)
 
   parseOptions(argc,argv);
 
+  // patching existing files does not need the conversion threads
+  if(cass::globalOptions.batchAppendWavelength){
+    cass::WavelengthAppender appender;
+    appender.processFileList(filelistname);
+    return 0;
+  }
+
+  // the shards are separate processes, this one only starts them or merges their outputs
+  if(cass::globalOptions.launchShards > 1){
+    return cass::ShardLauncher::run(cass::globalOptions.launchShards,filelistname);
+  }
+  if(cass::globalOptions.mergeShards > 0){
+    cass::ShardMerger merger(cass::globalOptions.mergeShards);
+    return merger.processFileList(filelistname) ? 0 : 1;
+  }
+
   // a ringbuffer for the cassevents//
   lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize> ringbuffer;
   // create file input object //
   cass::FileInput *input(new cass::FileInput(filelistname,ringbuffer));
   // create a worker//
   cass::Worker *worker(new cass::Worker(ringbuffer));
-  // create format converter object
-  cass::Ratemeter *ratemeter(new cass::Ratemeter());
+  // the worker is checkpointed while reading the files
+  input->checkpoints(worker,cass::globalOptions.resume);
+  // create the object that exports the statistics of the processing
+  cass::Ratemeter *ratemeter(new cass::Ratemeter(ringbuffer));
   // create a dialog object
 //  cass::Window * window(new cass::Window());
 
@@ -43,6 +43,18 @@ public:
 	    useIntegrationFloor = false;
 	    nImagesToAverage = 0;
 	    onlyAppendWavelength = false;
+	    integrateByQ = false;
+	    writeEventTable = false;
+	    writePhotonLists = false;
+	    skimXtc = false;
+	    batchAppendWavelength = false;
+	    statsInterval = 1000;
+	    shard = 0;
+	    nbrShards = 1;
+	    launchShards = 0;
+	    mergeShards = 0;
+	    resume = false;
+	    buildEvents = false;
 	}
 	bool verbose;
     bool outputHitsToFile;
@@ -70,6 +82,22 @@ public:
     bool useIntegrationFloor;
     int nImagesToAverage;
   bool onlyAppendWavelength;
+  bool integrateByQ;
+  bool writeEventTable;
+  bool writePhotonLists;
+  bool skimXtc;
+  bool batchAppendWavelength;
+  QString statsFile;
+  QString statsSocket;
+  int statsInterval;
+  QString filterExpression;
+  int shard;
+  int nbrShards;
+  QString outputSuffix;
+  int launchShards;
+  int mergeShards;
+  bool resume;
+  bool buildEvents;
   
 };
 
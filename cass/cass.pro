@@ -1,5 +1,6 @@
 # Copyright (C) 2009 jk, ncoppola, lmf
 qt += core
+QT += network
 #CONFIG += static release
 CONFIG += static debug
 macx{
@@ -20,7 +21,18 @@ SOURCES +=  cass.cpp \
             ratemeter.cpp \
             dialog.cpp \
             worker.cpp \
-            post_processor.cpp
+            post_processor.cpp \
+            azimuthal_integrator.cpp \
+            event_table.cpp \
+            photon_list.cpp \
+            xtc_skimmer.cpp \
+            wavelength_appender.cpp \
+            instrumentation.cpp \
+            event_filter.cpp \
+            post_processing_modules.cpp \
+            shards.cpp \
+            checkpoint.cpp \
+            event_builder.cpp
 
 HEADERS +=  analysis_backend.h \
             analyzer.h \
@@ -36,6 +48,18 @@ HEADERS +=  analysis_backend.h \
             ringbuffer.h \
             worker.h \
             post_processor.h \
+            azimuthal_integrator.h \
+            event_table.h \
+            photon_list.h \
+            xtc_skimmer.h \
+            wavelength_appender.h \
+            instrumentation.h \
+            event_filter.h \
+            event_products.h \
+            post_processing_modules.h \
+            shards.h \
+            checkpoint.h \
+            event_builder.h \
             cass.h
 
 INCLUDEPATH +=  ./ \
@@ -11,8 +11,11 @@ cass::CASSEvent::CASSEvent():
         _remievent(new REMI::REMIEvent()),
         _vmievent(new VMI::VMIEvent()),
         _pnccdevent(new pnCCD::pnCCDEvent()),
-	_machinedataevent(new MachineData::MachineDataEvent())
+	_machinedataevent(new MachineData::MachineDataEvent()),
+        _provider(0)
 {
+    //an event that is not handed through the worker gets everything made//
+    _wanted.all();
 }
 
 cass::CASSEvent::~CASSEvent()
@@ -2,6 +2,7 @@
 #define CASSEVENT_H
 
 #include <stdint.h>
+#include "event_products.h"
 
 
 namespace cass
@@ -38,6 +39,23 @@ namespace cass
       const char * filename(){return _filename;};
       void setFilename(const char * f){_filename = f;}
 
+    public:
+      //the products that the converters and analyzers should make in their current pass//
+      const Products                  &wanted()const        {return _wanted;}
+      Products                        &wanted()             {return _wanted;}
+      //the products that have been made of this event so far//
+      const Products                  &produced()const      {return _produced;}
+      Products                        &produced()           {return _produced;}
+      //who makes the products that were not wanted when they are asked for//
+      void provider(ProductProvider *p)                     {_provider = p;}
+      //make sure that the product of the detector is there, returns false when it can't be made//
+      bool provide(Products::Product product, size_t detector=0)
+      {
+        if (_produced.has(product,detector))
+          return true;
+        return _provider && _provider->provide(*this,product,detector);
+      }
+
     public:
       REMI::REMIEvent                 &REMIEvent()          {return *_remievent;}
       VMI::VMIEvent                   &VMIEvent()           {return *_vmievent;}
@@ -50,6 +68,9 @@ namespace cass
       VMI::VMIEvent                   *_vmievent;
       pnCCD::pnCCDEvent               *_pnccdevent;
       MachineData::MachineDataEvent   *_machinedataevent;
+      Products                         _wanted;
+      Products                         _produced;
+      ProductProvider                 *_provider;
       char                             _datagrambuffer[0x1000000];
       const char * _filename;
   };
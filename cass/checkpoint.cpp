@@ -0,0 +1,194 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "checkpoint.h"
+
+
+void cass::CheckpointParameter::load()
+{
+  //sync before loading//
+  sync();
+  _interval = value("Interval",600).toInt();
+  _filename = value("Filename","cass.checkpoint").toString();
+}
+
+void cass::CheckpointParameter::save()
+{
+  setValue("Interval",_interval);
+  setValue("Filename",_filename);
+}
+
+
+
+
+
+cass::Checkpoint::Checkpoint(const std::string &filename)
+  :_filename(filename),
+   _generation(0)
+{
+}
+
+bool cass::Checkpoint::load()
+{
+  std::ifstream file(_filename.c_str());
+  if (!file.is_open())
+    return false;
+  _values.clear();
+  std::string line;
+  while (getline(file,line))
+  {
+    const size_t equal(line.find('='));
+    if (equal != std::string::npos)
+      _values[line.substr(0,equal)] = line.substr(equal+1);
+  }
+  //a checkpoint that was cut off is not used//
+  if (!has("end"))
+  {
+    std::cout << "Checkpoint: \""<<_filename<<"\" is not complete"<<std::endl;
+    _values.clear();
+    return false;
+  }
+  _generation = number("generation");
+  std::istringstream dataFiles(value("dataFiles"));
+  std::string name;
+  _committed.clear();
+  while (dataFiles >> name)
+    _committed.push_back(name);
+  return true;
+}
+
+void cass::Checkpoint::clear()
+{
+  _values.clear();
+  _dataFiles.clear();
+  ++_generation;
+}
+
+bool cass::Checkpoint::commit()
+{
+  std::string dataFiles;
+  for (size_t i=0; i<_dataFiles.size(); ++i)
+    dataFiles += (i ? " " : "") + _dataFiles[i];
+  set("generation",_generation);
+  set("dataFiles",dataFiles);
+  //the new checkpoint is complete on disk before it replaces the old one//
+  const std::string tmp(_filename + ".new");
+  FILE *fp = fopen(tmp.c_str(),"w");
+  if (!fp)
+  {
+    std::cout << "Checkpoint: could not create \""<<tmp<<"\""<<std::endl;
+    return false;
+  }
+  for (values_t::const_iterator it(_values.begin()); it != _values.end(); ++it)
+    fprintf(fp,"%s=%s\n",it->first.c_str(),it->second.c_str());
+  fprintf(fp,"end=\n");
+  const bool ok(fflush(fp) == 0 && fsync(fileno(fp)) == 0);
+  fclose(fp);
+  if (!ok || rename(tmp.c_str(),_filename.c_str()) != 0)
+  {
+    std::cout << "Checkpoint: could not write \""<<_filename<<"\""<<std::endl;
+    return false;
+  }
+  //the data files of the last checkpoint are not needed anymore//
+  for (size_t i=0; i<_committed.size(); ++i)
+    remove(_committed[i].c_str());
+  _committed = _dataFiles;
+  return true;
+}
+
+void cass::Checkpoint::set(const std::string &key, const std::string &value)
+{
+  _values[key] = value;
+}
+
+void cass::Checkpoint::set(const std::string &key, uint64_t value)
+{
+  char buffer[32];
+  sprintf(buffer,"%llu",static_cast<unsigned long long>(value));
+  _values[key] = buffer;
+}
+
+bool cass::Checkpoint::has(const std::string &key)const
+{
+  return _values.find(key) != _values.end();
+}
+
+std::string cass::Checkpoint::value(const std::string &key, const std::string &def)const
+{
+  values_t::const_iterator it(_values.find(key));
+  return it == _values.end() ? def : it->second;
+}
+
+uint64_t cass::Checkpoint::number(const std::string &key, uint64_t def)const
+{
+  values_t::const_iterator it(_values.find(key));
+  return it == _values.end() ? def : strtoull(it->second.c_str(),0,10);
+}
+
+std::string cass::Checkpoint::dataFile(const std::string &name)
+{
+  char generation[32];
+  sprintf(generation,".%llu.",static_cast<unsigned long long>(_generation));
+  const std::string filename(_filename + generation + name);
+  _dataFiles.push_back(filename);
+  return filename;
+}
+
+void cass::Checkpoint::setFile(const std::string &key, const std::string &filename)
+{
+  struct stat status;
+  set(key,filename);
+  set(key+".size",stat(filename.c_str(),&status) == 0 ? static_cast<uint64_t>(status.st_size) : 0);
+}
+
+std::string cass::Checkpoint::restoreFile(const std::string &key)const
+{
+  const std::string filename(value(key));
+  if (filename.empty())
+    return filename;
+  //what was written after the checkpoint is written again//
+  if (truncate(filename.c_str(),number(key+".size")) != 0)
+    std::cout << "Checkpoint: could not restore \""<<filename<<"\""<<std::endl;
+  return filename;
+}
+
+void cass::Checkpoint::setFiles(const std::string &key, const std::set<std::string> &filenames)
+{
+  set(key+".count",filenames.size());
+  size_t i(0);
+  for (std::set<std::string>::const_iterator it(filenames.begin()); it != filenames.end(); ++it, ++i)
+  {
+    std::ostringstream name;
+    name << key << i;
+    setFile(name.str(),*it);
+  }
+}
+
+std::set<std::string> cass::Checkpoint::restoreFiles(const std::string &key)const
+{
+  std::set<std::string> filenames;
+  const uint64_t count(number(key+".count"));
+  for (uint64_t i=0; i<count; ++i)
+  {
+    std::ostringstream name;
+    name << key << i;
+    filenames.insert(restoreFile(name.str()));
+  }
+  return filenames;
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,100 @@
+#ifndef CASS_CHECKPOINT_H
+#define CASS_CHECKPOINT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <QtCore/QString>
+
+#include "cass.h"
+#include "parameter_backend.h"
+
+namespace cass
+{
+  //the settings of the checkpoints//
+  class CASSSHARED_EXPORT CheckpointParameter : public cass::ParameterBackend
+  {
+  public:
+    CheckpointParameter()   {beginGroup("Checkpoint");}
+    ~CheckpointParameter()  {endGroup();}
+    void load();
+    void save();
+
+  public:
+    int      _interval;          //the seconds between two checkpoints, 0 for none
+    QString  _filename;          //of the checkpoint, a shard adds its suffix
+  };
+
+
+
+  //the state of the processing at one position of the input, so that a run that was killed//
+  //can continue there with --resume. The values are stored as lines key=value in the//
+  //checkpoint file, larger state goes into data files of the checkpoint. Every checkpoint is//
+  //written to a new file that replaces the old one, so there is always one complete checkpoint//
+  class CASSSHARED_EXPORT Checkpoint
+  {
+  public:
+    explicit Checkpoint(const std::string &filename);
+
+    //read the last checkpoint, false when there is none//
+    bool load();
+    //forget the values to make the next checkpoint//
+    void clear();
+    //replace the last checkpoint by this one, its data files are removed//
+    bool commit();
+    const std::string &filename()const                      {return _filename;}
+
+  public:
+    void set(const std::string &key, const std::string &value);
+    void set(const std::string &key, uint64_t value);
+    bool has(const std::string &key)const;
+    std::string value(const std::string &key, const std::string &def="")const;
+    uint64_t number(const std::string &key, uint64_t def=0)const;
+
+  public:
+    //the name of a data file of the checkpoint, e.g. for the sums of the integrated image//
+    std::string dataFile(const std::string &name);
+    //remember the size of a file that is appended to, the file has to be flushed//
+    void setFile(const std::string &key, const std::string &filename);
+    //cut the file back to the size it had at the checkpoint, returns its name//
+    std::string restoreFile(const std::string &key)const;
+    //the same for all files of an output, e.g. the run files that were written so far//
+    void setFiles(const std::string &key, const std::set<std::string> &filenames);
+    std::set<std::string> restoreFiles(const std::string &key)const;
+
+  private:
+    typedef std::map<std::string,std::string> values_t;
+    std::string               _filename;
+    uint64_t                  _generation;    //counts the checkpoints, part of the data files
+    values_t                  _values;
+    std::vector<std::string>  _dataFiles;     //of this checkpoint
+    std::vector<std::string>  _committed;     //of the last committed checkpoint
+  };
+
+
+
+  //a part of the program whose state is saved in the checkpoints//
+  class CASSSHARED_EXPORT Checkpointable
+  {
+  public:
+    virtual ~Checkpointable()                               {}
+    //add the state, called when everything that was read has been processed//
+    virtual void checkpoint(Checkpoint&)=0;
+    //continue with the state of the checkpoint, called before the processing starts//
+    virtual void resume(const Checkpoint&)=0;
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,276 @@
+#include <iostream>
+#include <algorithm>
+
+#include "event_builder.h"
+#include "file_input.h"
+#include "shards.h"
+
+
+void cass::EventBuilderParameter::load()
+{
+  //sync before loading//
+  sync();
+  _window = value("Window",2).toUInt();
+}
+
+void cass::EventBuilderParameter::save()
+{
+  setValue("Window",_window);
+}
+
+
+
+
+
+cass::EventBuilder::EventBuilder(lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize> &ringbuffer,
+                                 const bool &quit)
+  :_ringbuffer(ringbuffer),
+   _quit(quit),
+   _all(0),
+   _built(0),
+   _incomplete(0),
+   _waitStage("input.wait"),
+   _buildStage("input.build")
+{
+  _param.load();
+  //the waiting events keep their elements, one has to be left for the next event//
+  _window = std::max<uint32_t>(1,std::min<uint32_t>(_param._window,RingBufferSize-1));
+}
+
+cass::EventBuilder::~EventBuilder()
+{
+  for (size_t i=0; i<_streams.size(); ++i)
+    if (_streams[i].fp)
+      fclose(_streams[i].fp);
+}
+
+void cass::EventBuilder::runs(const std::vector<std::string> &files, std::vector<streams_t> &runs)
+{
+  runs.clear();
+  std::vector<std::string> runNames;
+  std::vector<std::vector<std::string> > streamNames;
+  for (size_t i=0; i<files.size(); ++i)
+  {
+    //e12-r0034-s01-c00.xtc is chunk c00 of the stream s01 of the run e12-r0034//
+    const std::string run(ShardMerger::runName(files[i]));
+    const size_t slash(files[i].rfind('/'));
+    const std::string base(slash == std::string::npos ? files[i] : files[i].substr(slash+1));
+    const std::string rest(base.substr(std::min(run.size(),base.size())));
+    const std::string stream(rest.substr(0,rest.find_first_of("-.",1)));
+    size_t r(0);
+    while (r < runNames.size() && runNames[r] != run)
+      ++r;
+    if (r == runNames.size())
+    {
+      runNames.push_back(run);
+      streamNames.push_back(std::vector<std::string>());
+      runs.push_back(streams_t());
+    }
+    size_t s(0);
+    while (s < streamNames[r].size() && streamNames[r][s] != stream)
+      ++s;
+    if (s == streamNames[r].size())
+    {
+      streamNames[r].push_back(stream);
+      runs[r].push_back(std::vector<std::string>());
+    }
+    runs[r][s].push_back(files[i]);
+  }
+}
+
+void cass::EventBuilder::build(const streams_t &streams)
+{
+  //every stream is one bit of the contributions//
+  const size_t nbrStreams(std::min<size_t>(streams.size(),32));
+  if (nbrStreams < streams.size())
+    std::cout << "EventBuilder: only the first 32 of "<<streams.size()<<" streams are read"<<std::endl;
+  _streams.assign(nbrStreams,Stream());
+  _all = nbrStreams < 32 ? (1u<<nbrStreams)-1 : ~0u;
+  for (size_t i=0; i<nbrStreams; ++i)
+  {
+    _streams[i].files = &streams[i];
+    _streams[i].file  = 0;
+    _streams[i].fp    = 0;
+    readHeader(_streams[i]);
+  }
+  int stream;
+  while (!_quit && (stream = oldest()) >= 0)
+  {
+    contribute(stream);
+    readHeader(_streams[stream]);
+    releaseComplete();
+  }
+  //what is still waiting lacks contributions//
+  while (!_pending.empty())
+  {
+    release(_pending.front());
+    _pending.pop_front();
+  }
+  for (size_t i=0; i<_streams.size(); ++i)
+    if (_streams[i].fp)
+      fclose(_streams[i].fp);
+  _streams.clear();
+}
+
+bool cass::EventBuilder::readHeader(Stream &stream)
+{
+  stream.valid = false;
+  while (stream.file < stream.files->size())
+  {
+    const std::string &filename((*stream.files)[stream.file]);
+    if (!stream.fp)
+    {
+      stream.fp = fopen(filename.c_str(),"rb");
+      if (!stream.fp)
+      {
+        std::cout <<"file \""<<filename<<"\" could not be opened"<<std::endl;
+        ++stream.file;
+        continue;
+      }
+      std::cout <<"building events of file \""<<filename<<"\""<<std::endl;
+    }
+    if (fread(&stream.next,sizeof(stream.next),1,stream.fp) == 1)
+    {
+      stream.valid = true;
+      return true;
+    }
+    //the next chunk of the stream//
+    fclose(stream.fp);
+    stream.fp = 0;
+    ++stream.file;
+  }
+  return false;
+}
+
+int cass::EventBuilder::oldest()const
+{
+  int oldest(-1);
+  for (size_t i=0; i<_streams.size(); ++i)
+  {
+    if (!_streams[i].valid)
+      continue;
+    const Pds::ClockTime &clock(_streams[i].next.seq.clock());
+    if (oldest < 0)
+    {
+      oldest = i;
+      continue;
+    }
+    const Pds::ClockTime &current(_streams[oldest].next.seq.clock());
+    if (clock.seconds() < current.seconds() ||
+        (clock.seconds() == current.seconds() && clock.nanoseconds() < current.nanoseconds()))
+      oldest = i;
+  }
+  return oldest;
+}
+
+void cass::EventBuilder::contribute(size_t stream)
+{
+  Stream &s(_streams[stream]);
+  const Pds::Dgram &header(s.next);
+  const uint32_t bit(1u<<stream);
+  const uint64_t start(Stage::now());
+  Key key;
+  key.service = header.seq.service();
+  if (key.service == Pds::TransitionId::L1Accept)
+  {
+    key.high = header.seq.clock().seconds();
+    key.low  = header.seq.stamp().fiducials();
+  }
+  else
+  {
+    key.high = s.ordinals[key.service]++;
+    key.low  = 0;
+  }
+
+  //the event this datagram belongs to, or a new one//
+  Pending *pending(0);
+  for (size_t i=0; i<_pending.size() && !pending; ++i)
+    if (_pending[i].key == key && !(_pending[i].contributed & bit))
+      pending = &_pending[i];
+  if (!pending)
+  {
+    //the oldest event has waited long enough//
+    if (_pending.size() >= _window)
+    {
+      release(_pending.front());
+      _pending.pop_front();
+    }
+    Pending p;
+    p.key         = key;
+    p.contributed = 0;
+    const uint64_t waitStart(Stage::now());
+    _ringbuffer.nextToFill(p.event);
+    _waitStage.record(waitStart,Stage::now());
+    //the event has the sequence of its first contribution and contains all of them//
+    Pds::Dgram &dg(*reinterpret_cast<Pds::Dgram*>(p.event->datagrambuffer()));
+    dg.seq = header.seq;
+    dg.env = header.env;
+    dg.xtc = Pds::Xtc(Pds::TypeId(Pds::TypeId::Id_Xtc,1),header.xtc.src);
+    p.event->setFilename((*s.files)[s.file].c_str());
+    _pending.push_back(p);
+    pending = &_pending.back();
+  }
+
+  //the contribution is read from the file right behind the ones that are there, one that//
+  //is not complete leaves the bit of its stream unset so that the event counts as incomplete//
+  Pds::Dgram &dg(*reinterpret_cast<Pds::Dgram*>(pending->event->datagrambuffer()));
+  const uint32_t size(header.xtc.extent);
+  if (sizeof(Pds::Dgram) + dg.xtc.extent + size > FileInput::_maxdatagramsize)
+  {
+    std::cout << "EventBuilder: the event is too large for the contribution of \""
+              <<(*s.files)[s.file]<<"\""<<std::endl;
+    fseeko(s.fp,header.xtc.sizeofPayload(),SEEK_CUR);
+    return;
+  }
+  Pds::Xtc *xtc(reinterpret_cast<Pds::Xtc*>(dg.xtc.alloc(size)));
+  *xtc = header.xtc;
+  if (fread(xtc->payload(),1,xtc->sizeofPayload(),s.fp) != static_cast<size_t>(xtc->sizeofPayload()))
+  {
+    //cut off at the end of the file//
+    dg.xtc.extent -= size;
+    return;
+  }
+  //an incomplete contribution keeps its damage in its child Xtc, on the event the iterators//
+  //would skip the contributions of all other streams//
+  const uint32_t incomplete(1u<<Pds::Damage::IncompleteContribution);
+  dg.xtc.damage.increase(header.xtc.damage.value() & ~incomplete);
+  if (header.xtc.damage.value() & incomplete)
+  {
+    dg.xtc.damage.increase(Pds::Damage::ContainsIncomplete);
+    return;
+  }
+  pending->contributed |= bit;
+  _buildStage.record(start,Stage::now(),size);
+}
+
+void cass::EventBuilder::release(Pending &pending)
+{
+  if (pending.contributed != _all)
+  {
+    Pds::Dgram &dg(*reinterpret_cast<Pds::Dgram*>(pending.event->datagrambuffer()));
+    dg.xtc.damage.increase(Pds::Damage::DroppedContribution);
+    _buildStage.drop();
+    ++_incomplete;
+  }
+  ++_built;
+  _ringbuffer.doneFilling(pending.event);
+}
+
+void cass::EventBuilder::releaseComplete()
+{
+  while (!_pending.empty() && _pending.front().contributed == _all)
+  {
+    release(_pending.front());
+    _pending.pop_front();
+  }
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,125 @@
+#ifndef CASS_EVENTBUILDER_H
+#define CASS_EVENTBUILDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include "cass.h"
+#include "ringbuffer.h"
+#include "cass_event.h"
+#include "parameter_backend.h"
+#include "instrumentation.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+namespace cass
+{
+  //the settings of the event builder//
+  class CASSSHARED_EXPORT EventBuilderParameter : public cass::ParameterBackend
+  {
+  public:
+    EventBuilderParameter()     {beginGroup("EventBuilder");}
+    ~EventBuilderParameter()    {endGroup();}
+    void load();
+    void save();
+
+  public:
+    uint32_t _window;           //the events that wait for their contributions, at most RingBufferSize-1
+  };
+
+
+
+  //builds the events of a run from the xtc streams that the DAQ nodes write (s00, s01, ..).//
+  //The streams are read side by side, always from the one whose next datagram is the oldest.//
+  //The datagrams of an event are found by the clock and the fiducial of the L1Accept, the//
+  //transitions by their order in the streams. Every event gets an element of the ringbuffer//
+  //and each contribution is read from its file right to its place in the datagram there, as//
+  //a child Xtc of the event. An event is put into the ringbuffer when all streams contributed//
+  //or when it is the oldest of more than window waiting events. The incomplete events have//
+  //the DroppedContribution damage and are counted as dropped by the input.build stage, a//
+  //contribution that is cut off or damaged as incomplete does not count as contributed//
+  class CASSSHARED_EXPORT EventBuilder
+  {
+  public:
+    EventBuilder(lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize>&, const bool &quit);
+    ~EventBuilder();
+
+    //the runs of the file list, every run is a list of streams and every stream the list of//
+    //its chunk files in the order of the file list//
+    typedef std::vector<std::vector<std::string> > streams_t;
+    static void runs(const std::vector<std::string> &files, std::vector<streams_t>&);
+
+    //build all events of the streams of one run//
+    void build(const streams_t&);
+
+    uint64_t built()const           {return _built;}
+    uint64_t incomplete()const      {return _incomplete;}
+
+  private:
+    //one stream, the header of the next datagram is read ahead//
+    struct Stream
+    {
+      const std::vector<std::string> *files;     //the chunks, the events keep their names
+      size_t                          file;      //the one that is read
+      FILE                           *fp;
+      Pds::Dgram                      next;
+      bool                            valid;     //whether next is there
+      std::map<int,uint32_t>          ordinals;  //the number of the transitions of every kind so far
+    };
+    //what the contributions of an event have in common//
+    struct Key
+    {
+      uint32_t service;
+      uint32_t high;                       //the seconds of an L1Accept, else the ordinal
+      uint32_t low;                        //the fiducial of an L1Accept
+      bool operator==(const Key &o)const  {return service==o.service && high==o.high && low==o.low;}
+    };
+    //an event that is being built//
+    struct Pending
+    {
+      Key         key;
+      CASSEvent  *event;
+      uint32_t    contributed;             //one bit for every stream
+    };
+
+  private:
+    //read the header of the next datagram of the stream, false at the end of its last file//
+    bool readHeader(Stream&);
+    //the stream whose next datagram is the oldest, -1 when all are done//
+    int oldest()const;
+    //read the payload of the next datagram of the stream into its event//
+    void contribute(size_t stream);
+    //put the event into the ringbuffer//
+    void release(Pending&);
+    //put the oldest waiting events into the ringbuffer while they are complete//
+    void releaseComplete();
+
+  private:
+    lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize>  &_ringbuffer;
+    const bool                 &_quit;
+    EventBuilderParameter       _param;
+    size_t                      _window;
+    std::vector<Stream>         _streams;
+    uint32_t                    _all;       //the bits of all streams
+    std::deque<Pending>         _pending;   //in the order the events were started
+    uint64_t                    _built;
+    uint64_t                    _incomplete;
+    Stage                       _waitStage;
+    Stage                       _buildStage;
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,421 @@
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <sstream>
+
+#include "event_filter.h"
+#include "cass_event.h"
+#include "machine_event.h"
+#include "post_processor.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+
+namespace
+{
+  enum Variables {F_11_ENRC, F_12_ENRC, F_21_ENRC, F_22_ENRC,
+                  EbeamCharge, EbeamL3Energy, EbeamLTUPosX, EbeamLTUPosY,
+                  EbeamLTUAngX, EbeamLTUAngY, EbeamPkCurrBC2,
+                  FitTime1, FitTime2, Charge1, Charge2,
+                  PhotonEnergy, HasMachineData,
+                  Time, TimeOfDay, Fiducial, Damage, EventNbr,
+                  NbrVariables};
+
+  const char *variableNames[NbrVariables] =
+    {"f_11_ENRC", "f_12_ENRC", "f_21_ENRC", "f_22_ENRC",
+     "EbeamCharge", "EbeamL3Energy", "EbeamLTUPosX", "EbeamLTUPosY",
+     "EbeamLTUAngX", "EbeamLTUAngY", "EbeamPkCurrBC2",
+     "FitTime1", "FitTime2", "Charge1", "Charge2",
+     "photonEnergy", "hasMachineData",
+     "time", "timeOfDay", "fiducial", "damage", "event"};
+
+  bool isTrue(double v)     {return v != 0 && v == v;}
+
+  double variable(size_t id, cass::CASSEvent &cassevent)
+  {
+    const cass::MachineData::MachineDataEvent &mde = cassevent.MachineDataEvent();
+    const Pds::Dgram *datagram = reinterpret_cast<const Pds::Dgram*>(cassevent.datagrambuffer());
+    switch (id)
+    {
+    case F_11_ENRC:         return mde.f_11_ENRC();
+    case F_12_ENRC:         return mde.f_12_ENRC();
+    case F_21_ENRC:         return mde.f_21_ENRC();
+    case F_22_ENRC:         return mde.f_22_ENRC();
+    case EbeamCharge:       return mde.EbeamCharge();
+    case EbeamL3Energy:     return mde.EbeamL3Energy();
+    case EbeamLTUPosX:      return mde.EbeamLTUPosX();
+    case EbeamLTUPosY:      return mde.EbeamLTUPosY();
+    case EbeamLTUAngX:      return mde.EbeamLTUAngX();
+    case EbeamLTUAngY:      return mde.EbeamLTUAngY();
+    case EbeamPkCurrBC2:    return mde.EbeamPkCurrBC2();
+    case FitTime1:          return mde.FitTime1();
+    case FitTime2:          return mde.FitTime2();
+    case Charge1:           return mde.Charge1();
+    case Charge2:           return mde.Charge2();
+    case PhotonEnergy:      return cass::PostProcessor::calculatePhotonEnergy(mde);
+    case HasMachineData:    return mde.isFilled();
+    case Time:              return datagram->seq.clock().seconds();
+    case TimeOfDay:
+    {
+      //the local time, like the start and end time given on the command line//
+      const time_t seconds = datagram->seq.clock().seconds();
+      tm local;
+      localtime_r(&seconds,&local);
+      return local.tm_hour*3600 + local.tm_min*60 + local.tm_sec;
+    }
+    case Fiducial:          return datagram->seq.stamp().fiducials();
+    case Damage:            return datagram->xtc.damage.value();
+    case EventNbr:          return cass::globalOptions.eventCounter;
+    }
+    return NAN;
+  }
+}
+
+
+namespace cass
+{
+  //recursive descent parser that writes the program of the filter while it reads the//
+  //expression. Every rule leaves its value on the stack of the program//
+  class FilterParser
+  {
+  public:
+    FilterParser(const std::string &expression, EventFilter &filter)
+      :_text(expression),_pos(0),_filter(filter),_depth(0),_maxDepth(0)     {}
+
+    bool parse()
+    {
+      if (!orExpression())
+        return false;
+      skipSpace();
+      if (_pos != _text.size())
+        return fail("unexpected \"" + _text.substr(_pos) + "\"");
+      _filter._stack.resize(_maxDepth);
+      return true;
+    }
+
+  private:
+    bool orExpression()
+    {
+      if (!andExpression())
+        return false;
+      while (accept("||"))
+      {
+        append(EventFilter::Bool);
+        const size_t jump = append(EventFilter::JumpIfTrue);
+        if (!andExpression())
+          return false;
+        append(EventFilter::Bool);
+        _filter._program[jump].arg = _filter._program.size();
+      }
+      return true;
+    }
+
+    bool andExpression()
+    {
+      if (!notExpression())
+        return false;
+      while (accept("&&"))
+      {
+        append(EventFilter::Bool);
+        const size_t jump = append(EventFilter::JumpIfFalse);
+        if (!notExpression())
+          return false;
+        append(EventFilter::Bool);
+        _filter._program[jump].arg = _filter._program.size();
+      }
+      return true;
+    }
+
+    bool notExpression()
+    {
+      if (accept("!"))
+      {
+        if (!notExpression())
+          return false;
+        append(EventFilter::Not);
+        return true;
+      }
+      return comparison();
+    }
+
+    bool comparison()
+    {
+      if (!sum())
+        return false;
+      EventFilter::Code code;
+      if      (accept("<="))  code = EventFilter::LessEqual;
+      else if (accept(">="))  code = EventFilter::GreaterEqual;
+      else if (accept("=="))  code = EventFilter::Equal;
+      else if (accept("!="))  code = EventFilter::NotEqual;
+      else if (accept("<"))   code = EventFilter::Less;
+      else if (accept(">"))   code = EventFilter::Greater;
+      else return true;
+      if (!sum())
+        return false;
+      append(code);
+      return true;
+    }
+
+    bool sum()
+    {
+      if (!product())
+        return false;
+      while (true)
+      {
+        EventFilter::Code code;
+        if      (accept("+"))   code = EventFilter::Add;
+        else if (accept("-"))   code = EventFilter::Subtract;
+        else return true;
+        if (!product())
+          return false;
+        append(code);
+      }
+    }
+
+    bool product()
+    {
+      if (!unary())
+        return false;
+      while (true)
+      {
+        EventFilter::Code code;
+        if      (accept("*"))   code = EventFilter::Multiply;
+        else if (accept("/"))   code = EventFilter::Divide;
+        else if (accept("%"))   code = EventFilter::Modulo;
+        else return true;
+        if (!unary())
+          return false;
+        append(code);
+      }
+    }
+
+    bool unary()
+    {
+      if (accept("-"))
+      {
+        if (!unary())
+          return false;
+        append(EventFilter::Negate);
+        return true;
+      }
+      if (accept("+"))
+        return unary();
+      return primary();
+    }
+
+    bool primary()
+    {
+      skipSpace();
+      if (_pos == _text.size())
+        return fail("unexpected end of the expression");
+      if (accept("("))
+      {
+        if (!orExpression())
+          return false;
+        if (!accept(")"))
+          return fail("missing \")\"");
+        return true;
+      }
+      const char c = _text[_pos];
+      if (isdigit(c) || c == '.')
+      {
+        const char *begin = _text.c_str() + _pos;
+        char *end;
+        const double value = strtod(begin,&end);
+        if (end == begin)
+          return fail("bad number at \"" + _text.substr(_pos) + "\"");
+        _pos += end - begin;
+        append(EventFilter::Constant,value);
+        return true;
+      }
+      if (isalpha(c) || c == '_')
+      {
+        const size_t begin = _pos;
+        while (_pos < _text.size() && (isalnum(_text[_pos]) || _text[_pos] == '_'))
+          ++_pos;
+        const std::string name(_text.substr(begin,_pos-begin));
+        if (name == "epics")
+          return epics();
+        for (size_t i=0; i<NbrVariables; ++i)
+          if (name == variableNames[i])
+          {
+            append(EventFilter::Variable,0,i);
+            return true;
+          }
+        return fail("unknown variable \"" + name + "\"");
+      }
+      return fail("unexpected \"" + _text.substr(_pos) + "\"");
+    }
+
+    //epics["name"]//
+    bool epics()
+    {
+      if (!accept("[") || !accept("\""))
+        return fail("expected epics[\"name\"]");
+      const size_t end = _text.find('"',_pos);
+      if (end == std::string::npos)
+        return fail("missing \" after the epics name");
+      EventFilter::Pv pv;
+      pv.name   = _text.substr(_pos,end-_pos);
+      pv.index  = 0;
+      pv.layout = 0;
+      pv.known  = false;
+      _pos = end+1;
+      if (!accept("]"))
+        return fail("missing \"]\" after the epics name");
+      _filter._pvs.push_back(pv);
+      append(EventFilter::Epics,0,_filter._pvs.size()-1);
+      return true;
+    }
+
+    //append an instruction and keep track of the depth of the stack, returns its position//
+    size_t append(EventFilter::Code code, double value=0, size_t arg=0)
+    {
+      switch (code)
+      {
+      case EventFilter::Constant:
+      case EventFilter::Variable:
+      case EventFilter::Epics:
+        ++_depth;
+        break;
+      case EventFilter::Negate:
+      case EventFilter::Not:
+      case EventFilter::Bool:
+        break;
+      default:
+        //the binary operators, and the jumps when they fall through//
+        --_depth;
+      }
+      _maxDepth = std::max(_maxDepth,_depth);
+      EventFilter::Instruction instruction;
+      instruction.code  = code;
+      instruction.value = value;
+      instruction.arg   = arg;
+      _filter._program.push_back(instruction);
+      return _filter._program.size()-1;
+    }
+
+    void skipSpace()
+    {
+      while (_pos < _text.size() && isspace(_text[_pos]))
+        ++_pos;
+    }
+
+    bool peek(const char *token)
+    {
+      skipSpace();
+      return _text.compare(_pos,strlen(token),token) == 0;
+    }
+
+    bool accept(const char *token)
+    {
+      if (!peek(token))
+        return false;
+      _pos += strlen(token);
+      return true;
+    }
+
+    bool fail(const std::string &what)
+    {
+      std::stringstream error;
+      error << what << " (at character "<<_pos+1<<")";
+      _filter._error = error.str();
+      return false;
+    }
+
+  private:
+    const std::string  &_text;
+    size_t              _pos;
+    EventFilter        &_filter;
+    size_t              _depth;
+    size_t              _maxDepth;
+  };
+}//end namespace cass
+
+
+bool cass::EventFilter::compile(const std::string &expression)
+{
+  _program.clear();
+  _pvs.clear();
+  _stack.clear();
+  _error.clear();
+  if (expression.find_first_not_of(" \t\n") == std::string::npos)
+    return true;
+  FilterParser parser(expression,*this);
+  if (!parser.parse())
+  {
+    _program.clear();
+    _pvs.clear();
+    return false;
+  }
+  return true;
+}
+
+bool cass::EventFilter::operator()(CASSEvent &cassevent)
+{
+  if (_program.empty())
+    return true;
+  double *sp = &_stack[0] - 1;    //points to the top of the stack
+  const size_t size = _program.size();
+  for (size_t pc=0; pc<size; ++pc)
+  {
+    const Instruction &instruction = _program[pc];
+    switch (instruction.code)
+    {
+    case Constant:      *++sp = instruction.value;                         break;
+    case Variable:      *++sp = variable(instruction.arg,cassevent);       break;
+    case Epics:
+    {
+      //look the name up again only when the names of the epics values changed//
+      const MachineData::EpicsSnapshot &epics = cassevent.MachineDataEvent().EpicsData();
+      Pv &pv = _pvs[instruction.arg];
+      if (!pv.known || pv.layout != epics.layout())
+      {
+        pv.index  = epics.index(pv.name);
+        pv.layout = epics.layout();
+        pv.known  = true;
+      }
+      *++sp = pv.index < epics.size() ? epics.value(pv.index) : NAN;
+      break;
+    }
+    case Negate:        *sp = -*sp;                                         break;
+    case Not:           *sp = !isTrue(*sp);                                 break;
+    case Bool:          *sp = isTrue(*sp);                                  break;
+    case Add:           --sp; *sp = sp[0] +  sp[1];                         break;
+    case Subtract:      --sp; *sp = sp[0] -  sp[1];                         break;
+    case Multiply:      --sp; *sp = sp[0] *  sp[1];                         break;
+    case Divide:        --sp; *sp = sp[0] /  sp[1];                         break;
+    case Modulo:        --sp; *sp = fmod(sp[0],sp[1]);                      break;
+    case Less:          --sp; *sp = sp[0] <  sp[1];                         break;
+    case LessEqual:     --sp; *sp = sp[0] <= sp[1];                         break;
+    case Greater:       --sp; *sp = sp[0] >  sp[1];                         break;
+    case GreaterEqual:  --sp; *sp = sp[0] >= sp[1];                         break;
+    case Equal:         --sp; *sp = sp[0] == sp[1];                         break;
+    case NotEqual:      --sp; *sp = sp[0] != sp[1];                         break;
+    //the operand of && and || is already a bool, it stays on the stack when we jump//
+    case JumpIfFalse:   if (!*sp) pc = instruction.arg-1; else --sp;        break;
+    case JumpIfTrue:    if (*sp)  pc = instruction.arg-1; else --sp;        break;
+    }
+  }
+  return isTrue(*sp);
+}
+
+std::string cass::EventFilter::variables()
+{
+  std::string names;
+  for (size_t i=0; i<NbrVariables; ++i)
+    names += std::string(i ? " " : "") + variableNames[i];
+  return names;
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,80 @@
+#ifndef CASS_EVENTFILTER_H
+#define CASS_EVENTFILTER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "cass.h"
+
+namespace cass
+{
+  class CASSEvent;
+
+  //selects events with an expression over the cheap quantities of an event: the machine data,//
+  //the epics values, the time, the fiducial and the damage of the datagram. The expression is//
+  //compiled once into the program of a small stack machine, so that it can be evaluated right//
+  //after the beamline data is converted, before the detectors are converted and analyzed.//
+  //Example: f_11_ENRC > 0.5 && epics["AMO:DIA:SHC:11:R"] < 3 && damage == 0//
+  //The operators are || && ! == != < <= > >= + - * / % and parentheses, like in C. An epics//
+  //value that is not in the stream is nan, every comparison with it is false//
+  class CASSSHARED_EXPORT EventFilter
+  {
+  public:
+    EventFilter()       {}
+
+    //compile the expression, an empty expression selects every event. Returns false and//
+    //keeps the reason when the expression can not be compiled//
+    bool compile(const std::string &expression);
+    const std::string &error()const             {return _error;}
+    bool empty()const                           {return _program.empty();}
+
+    //whether the event is selected, the datagram and the machine data have to be converted//
+    bool operator()(CASSEvent&);
+
+    //the names of the variables that can be used in an expression//
+    static std::string variables();
+
+  public:
+    enum Code {Constant, Variable, Epics,
+               Negate, Not, Bool,
+               Add, Subtract, Multiply, Divide, Modulo,
+               Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual,
+               JumpIfFalse, JumpIfTrue};
+
+    struct Instruction
+    {
+      Code    code;
+      double  value;        //the constant
+      size_t  arg;          //the variable, the epics value or the target of a jump
+    };
+
+    //an epics value used in the expression, its index is looked up again when the names change//
+    struct Pv
+    {
+      std::string name;
+      size_t      index;
+      uint32_t    layout;
+      bool        known;    //whether index belongs to layout
+    };
+
+  private:
+    friend class FilterParser;
+    std::vector<Instruction>    _program;
+    std::vector<Pv>             _pvs;
+    std::vector<double>         _stack;     //sized for the deepest point of the program
+    std::string                 _error;
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
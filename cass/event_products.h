@@ -0,0 +1,108 @@
+#ifndef CASS_EVENTPRODUCTS_H
+#define CASS_EVENTPRODUCTS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cass
+{
+  class CASSEvent;
+
+  //a set of the products that the converters and the analyzers make of an event. The post//
+  //processors declare the products they read, and only those are made for every event. The//
+  //products of the detectors that exist more than once (the pnCCDs) are kept per detector,//
+  //detectors above 31 share the last bit//
+  class Products
+  {
+  public:
+    enum Product {MachineData,      //the beamline data and the epics values
+                  pnCCDRaw,         //the raw frame of a pnCCD
+                  pnCCDFrame,       //the corrected (and rebinned) frame of a pnCCD
+                  pnCCDHits,        //the photon hits of a pnCCD
+                  REMIHits,         //the peaks of the waveforms and the detector hits
+                  VMIHits,          //the frame of the VMI camera and its impacts
+                  NbrProducts};
+    enum {AllDetectors = -1};
+
+  public:
+    Products()                                  {clear();}
+
+    void clear()
+    {
+      for (size_t i=0; i<NbrProducts; ++i)
+        _detectors[i] = 0;
+    }
+    void all()
+    {
+      for (size_t i=0; i<NbrProducts; ++i)
+        _detectors[i] = ~0u;
+    }
+
+    //add the product of the detector and the products it is made from//
+    void add(Product product, int detector=AllDetectors)
+    {
+      _detectors[product] |= bits(detector);
+      if (product == pnCCDHits)
+        add(pnCCDFrame,detector);
+      else if (product == pnCCDFrame)
+        add(pnCCDRaw,detector);
+    }
+    //remove the product of the detector, the products it is made from stay//
+    void remove(Product product, int detector=AllDetectors)
+    {
+      _detectors[product] &= ~bits(detector);
+    }
+    //remove all products that are in the other set//
+    void remove(const Products &other)
+    {
+      for (size_t i=0; i<NbrProducts; ++i)
+        _detectors[i] &= ~other._detectors[i];
+    }
+    Products &operator|=(const Products &other)
+    {
+      for (size_t i=0; i<NbrProducts; ++i)
+        _detectors[i] |= other._detectors[i];
+      return *this;
+    }
+
+    bool has(Product product, size_t detector=0)const
+    {
+      return _detectors[product] & bits(static_cast<int>(detector));
+    }
+    //whether the product is there for any of the detectors//
+    bool any(Product product)const              {return _detectors[product];}
+
+  private:
+    static uint32_t bits(int detector)
+    {
+      if (detector == AllDetectors)
+        return ~0u;
+      return 1u << (detector < 31 ? detector : 31);
+    }
+
+  private:
+    uint32_t _detectors[NbrProducts];
+  };
+
+
+  //makes products of an event that were not made because nobody declared them//
+  class ProductProvider
+  {
+  public:
+    virtual ~ProductProvider()                  {}
+    //make the product of the detector, returns whether it is there afterwards//
+    virtual bool provide(CASSEvent&, Products::Product, size_t detector) = 0;
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
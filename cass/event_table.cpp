@@ -0,0 +1,297 @@
+#include <iostream>
+
+#include "event_table.h"
+
+#if H5_VERS_MAJOR < 2
+#if H5_VERS_MINOR < 8
+#define H5Dcreate1(A,B,C,D,E) H5Dcreate(A,B,C,D,E)
+#define H5Dopen1(A,B) H5Dopen(A,B)
+#define H5Dset_extent(A,B) H5Dextend(A,B)
+#endif
+#endif
+
+
+void cass::EventTableParameter::load()
+{
+  //sync before loading//
+  sync();
+  _blockSize   = value("BlockSize",4096).toUInt();
+  _compression = value("Compression",0).toUInt();
+  _epicsPVs    = value("EpicsPVs").toStringList();
+}
+
+void cass::EventTableParameter::save()
+{
+  setValue("BlockSize",_blockSize);
+  setValue("Compression",_compression);
+  setValue("EpicsPVs",_epicsPVs);
+}
+
+
+
+
+
+cass::EventTable::EventTable()
+  :_file(-1),
+   _blockSize(0),
+   _compression(0),
+   _rowsInBlock(0),
+   _rowsWritten(0),
+   _continued(false)
+{
+}
+
+bool cass::EventTable::open(const std::string &filename, uint32_t blockSize, uint32_t compression)
+{
+  close();
+  _file = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (_file < 0)
+  {
+    std::cout << "EventTable: could not create \""<<filename<<"\""<<std::endl;
+    return false;
+  }
+  _filename    = filename;
+  _blockSize   = blockSize ? blockSize : 1;
+  _compression = compression;
+  _rowsInBlock = 0;
+  _rowsWritten = 0;
+  _continued   = false;
+  return true;
+}
+
+bool cass::EventTable::reopen(const std::string &filename, uint64_t rows, uint32_t blockSize,
+                              uint32_t compression)
+{
+  close();
+  _file = H5Fopen(filename.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+  if (_file < 0)
+  {
+    std::cout << "EventTable: could not open \""<<filename<<"\""<<std::endl;
+    return false;
+  }
+  _filename    = filename;
+  _blockSize   = blockSize ? blockSize : 1;
+  _compression = compression;
+  _rowsInBlock = 0;
+  _rowsWritten = rows;
+  _continued   = true;
+  return true;
+}
+
+size_t cass::EventTable::createColumn(const std::string &name, hid_t type, size_t size)
+{
+  //a reopened table continues the datasets that are in the file//
+  if (_continued)
+  {
+    Column c;
+    c.name    = name;
+    c.type    = type;
+    c.size    = size;
+    c.dataset = H5Dopen1(_file,name.c_str());
+    c.block.resize(_blockSize*size);
+    if (c.dataset >= 0)
+    {
+      hsize_t rows = _rowsWritten;
+      H5Dset_extent(c.dataset,&rows);
+      _columns.push_back(c);
+      return _columns.size()-1;
+    }
+  }
+  //the datasets start empty and grow by one block with every write//
+  hsize_t dims    = 0;
+  hsize_t maxdims = H5S_UNLIMITED;
+  hsize_t chunk   = _blockSize;
+  hid_t space = H5Screate_simple(1,&dims,&maxdims);
+  hid_t plist = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(plist,1,&chunk);
+  if (_compression)
+    H5Pset_deflate(plist,_compression);
+  Column c;
+  c.name    = name;
+  c.type    = type;
+  c.size    = size;
+  c.dataset = H5Dcreate1(_file,name.c_str(),type,space,plist);
+  c.block.resize(_blockSize*size);
+  H5Pclose(plist);
+  H5Sclose(space);
+  if (c.dataset < 0)
+    std::cout << "EventTable: could not create column \""<<name<<"\""<<std::endl;
+  _columns.push_back(c);
+  return _columns.size()-1;
+}
+
+void cass::EventTable::commitRow()
+{
+  if (++_rowsInBlock == _blockSize)
+    flush();
+}
+
+void cass::EventTable::flush()
+{
+  if (!isOpen() || !_rowsInBlock)
+    return;
+  hsize_t start = _rowsWritten;
+  hsize_t count = _rowsInBlock;
+  hsize_t size  = _rowsWritten + _rowsInBlock;
+  hid_t memspace = H5Screate_simple(1,&count,NULL);
+  for (size_t i=0; i<_columns.size(); ++i)
+  {
+    Column &c = _columns[i];
+    if (c.dataset < 0)
+      continue;
+    H5Dset_extent(c.dataset,&size);
+    hid_t filespace = H5Dget_space(c.dataset);
+    H5Sselect_hyperslab(filespace,H5S_SELECT_SET,&start,NULL,&count,NULL);
+    if (H5Dwrite(c.dataset,c.type,memspace,filespace,H5P_DEFAULT,&c.block[0]) < 0)
+      std::cout << "EventTable: error when writing column \""<<c.name<<"\""<<std::endl;
+    H5Sclose(filespace);
+  }
+  H5Sclose(memspace);
+  _rowsWritten += _rowsInBlock;
+  _rowsInBlock  = 0;
+  //make the file readable even when the program does not end orderly//
+  H5Fflush(_file,H5F_SCOPE_LOCAL);
+}
+
+void cass::EventTable::close()
+{
+  if (!isOpen())
+    return;
+  flush();
+  for (size_t i=0; i<_columns.size(); ++i)
+    if (_columns[i].dataset >= 0)
+      H5Dclose(_columns[i].dataset);
+  _columns.clear();
+  H5Fclose(_file);
+  _file = -1;
+  _filename.clear();
+}
+
+bool cass::EventTable::append(const std::string &filename)
+{
+  if (!isOpen())
+    return false;
+  flush();
+  hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (file < 0)
+  {
+    std::cout << "EventTable: could not open \""<<filename<<"\""<<std::endl;
+    return false;
+  }
+  //the columns are the datasets in the root group//
+  if (_columns.empty())
+  {
+    static const hid_t types[] = {H5T_NATIVE_DOUBLE, H5T_NATIVE_FLOAT, H5T_NATIVE_INT32,
+                                  H5T_NATIVE_UINT32, H5T_NATIVE_INT64, H5T_NATIVE_UINT64};
+    hsize_t nbrObjects = 0;
+    H5Gget_num_objs(file,&nbrObjects);
+    for (hsize_t i=0; i<nbrObjects; ++i)
+    {
+      char name[256];
+      H5Gget_objname_by_idx(file,i,name,sizeof(name));
+      if (H5Gget_objtype_by_idx(file,i) != H5G_DATASET)
+        continue;
+      hid_t dataset = H5Dopen1(file,name);
+      hid_t stored  = H5Dget_type(dataset);
+      for (size_t t=0; t<sizeof(types)/sizeof(types[0]); ++t)
+      {
+        if (H5Tequal(stored,types[t]) > 0)
+        {
+          createColumn(name,types[t],H5Tget_size(types[t]));
+          break;
+        }
+      }
+      H5Tclose(stored);
+      H5Dclose(dataset);
+    }
+  }
+  //every column is read as a whole and written behind the rows that are already there//
+  bool ok = true;
+  hsize_t rows = 0;
+  std::vector<char> values;
+  for (size_t i=0; i<_columns.size() && ok; ++i)
+  {
+    Column &c = _columns[i];
+    hid_t dataset = H5Dopen1(file,c.name.c_str());
+    if (dataset < 0)
+    {
+      std::cout << "EventTable: there is no column \""<<c.name<<"\" in \""<<filename<<"\""<<std::endl;
+      ok = false;
+      break;
+    }
+    hid_t space = H5Dget_space(dataset);
+    const hsize_t n = H5Sget_simple_extent_npoints(space);
+    H5Sclose(space);
+    if (i == 0)
+      rows = n;
+    ok = n == rows;
+    values.resize(n*c.size);
+    if (ok && n && H5Dread(dataset,c.type,H5S_ALL,H5S_ALL,H5P_DEFAULT,&values[0]) < 0)
+      ok = false;
+    H5Dclose(dataset);
+    if (ok && n && c.dataset >= 0)
+    {
+      hsize_t start = _rowsWritten;
+      hsize_t size  = _rowsWritten + n;
+      H5Dset_extent(c.dataset,&size);
+      hid_t memspace  = H5Screate_simple(1,&n,NULL);
+      hid_t filespace = H5Dget_space(c.dataset);
+      H5Sselect_hyperslab(filespace,H5S_SELECT_SET,&start,NULL,&n,NULL);
+      ok = H5Dwrite(c.dataset,c.type,memspace,filespace,H5P_DEFAULT,&values[0]) >= 0;
+      H5Sclose(filespace);
+      H5Sclose(memspace);
+    }
+  }
+  H5Fclose(file);
+  if (!ok)
+  {
+    std::cout << "EventTable: could not append \""<<filename<<"\""<<std::endl;
+    return false;
+  }
+  _rowsWritten += rows;
+  return true;
+}
+
+bool cass::EventTable::readColumns(const std::string &filename,
+                                   const std::vector<std::string> &names,
+                                   std::vector<std::vector<double> > &values)
+{
+  hid_t file = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (file < 0)
+  {
+    std::cout << "EventTable: could not open \""<<filename<<"\""<<std::endl;
+    return false;
+  }
+  bool ok = true;
+  values.resize(names.size());
+  for (size_t i=0; i<names.size() && ok; ++i)
+  {
+    hid_t dataset = H5Dopen1(file,names[i].c_str());
+    if (dataset < 0)
+    {
+      std::cout << "EventTable: there is no column \""<<names[i]<<"\" in \""<<filename<<"\""<<std::endl;
+      ok = false;
+      break;
+    }
+    //hdf5 converts the stored type of the column to double while reading//
+    hid_t space = H5Dget_space(dataset);
+    hsize_t rows = H5Sget_simple_extent_npoints(space);
+    values[i].resize(rows);
+    if (rows && H5Dread(dataset,H5T_NATIVE_DOUBLE,H5S_ALL,H5S_ALL,H5P_DEFAULT,&values[i][0]) < 0)
+      ok = false;
+    H5Sclose(space);
+    H5Dclose(dataset);
+  }
+  H5Fclose(file);
+  return ok;
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
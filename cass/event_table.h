@@ -0,0 +1,126 @@
+#ifndef CASS_EVENTTABLE_H
+#define CASS_EVENTTABLE_H
+
+#include <cassert>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <hdf5.h>
+#include <QtCore/QStringList>
+
+#include "cass.h"
+#include "parameter_backend.h"
+
+namespace cass
+{
+  //the settings of the per run event table//
+  class CASSSHARED_EXPORT EventTableParameter : public cass::ParameterBackend
+  {
+  public:
+    EventTableParameter()   {beginGroup("EventTable");}
+    ~EventTableParameter()  {endGroup();}
+    void load();
+    void save();
+
+  public:
+    uint32_t     _blockSize;         //number of rows that are kept in memory before writing them
+    uint32_t     _compression;       //deflate level of the columns, 0 is uncompressed
+    QStringList  _epicsPVs;          //the names of the epics pvs that should get a column
+  };
+
+
+
+  //maps the c++ type of a column to its hdf5 type//
+  template <typename T> struct H5TypeOf;
+  template <> struct H5TypeOf<double>   {static hid_t type() {return H5T_NATIVE_DOUBLE;}};
+  template <> struct H5TypeOf<float>    {static hid_t type() {return H5T_NATIVE_FLOAT;}};
+  template <> struct H5TypeOf<int32_t>  {static hid_t type() {return H5T_NATIVE_INT32;}};
+  template <> struct H5TypeOf<uint32_t> {static hid_t type() {return H5T_NATIVE_UINT32;}};
+  template <> struct H5TypeOf<int64_t>  {static hid_t type() {return H5T_NATIVE_INT64;}};
+  template <> struct H5TypeOf<uint64_t> {static hid_t type() {return H5T_NATIVE_UINT64;}};
+
+
+
+  //a columnar table with one row per event that is written to one hdf5 file per run//
+  //every column is its own chunked one dimensional dataset in the root group, so a reader//
+  //only touches the columns it asks for. Rows are collected in memory and appended to the//
+  //datasets a whole block at a time. All columns have to be added before the first row//
+  //and every column has to be set for every row//
+  class CASSSHARED_EXPORT EventTable
+  {
+  public:
+    EventTable();
+    ~EventTable()                       {close();}
+
+    //create the file, an already open table is closed first//
+    bool open(const std::string &filename, uint32_t blockSize, uint32_t compression);
+    //continue a file after its first rows, e.g. when resuming at a checkpoint. The rows behind//
+    //them are dropped, the columns are added like after open and find their datasets again//
+    bool reopen(const std::string &filename, uint64_t rows, uint32_t blockSize, uint32_t compression);
+    //add a column of type T, returns the index of the column//
+    template <typename T> size_t addColumn(const std::string &name)
+    {
+      return createColumn(name,H5TypeOf<T>::type(),sizeof(T));
+    }
+    //set the value of a column in the current row//
+    template <typename T> void set(size_t column, T value)
+    {
+      Column &c = _columns[column];
+      assert(sizeof(T) == c.size);
+      *reinterpret_cast<T*>(&c.block[_rowsInBlock*c.size]) = value;
+    }
+    //finish the current row, the block is written when it is full//
+    void commitRow();
+    //write the rows that are in memory to the file//
+    void flush();
+    void close();
+    //append all rows of another table file, e.g. of a shard of the run. An empty table gets//
+    //the columns of the file, otherwise the file needs to have the same columns//
+    bool append(const std::string &filename);
+
+  public:
+    bool               isOpen()const    {return _file >= 0;}
+    const std::string &filename()const  {return _filename;}
+    size_t             nbrColumns()const{return _columns.size();}
+    uint64_t           nbrRows()const   {return _rowsWritten + _rowsInBlock;}
+
+  public:
+    //read the given columns of a table file, the values are converted to double//
+    static bool readColumns(const std::string &filename,
+                            const std::vector<std::string> &names,
+                            std::vector<std::vector<double> > &values);
+
+  private:
+    struct Column
+    {
+      std::string       name;
+      hid_t             type;
+      size_t            size;        //size of one value in bytes
+      hid_t             dataset;
+      std::vector<char> block;       //the values of the rows in memory
+    };
+    size_t createColumn(const std::string &name, hid_t type, size_t size);
+
+  private:
+    hid_t               _file;
+    std::string         _filename;
+    uint32_t            _blockSize;
+    uint32_t            _compression;
+    uint32_t            _rowsInBlock;
+    uint64_t            _rowsWritten;
+    std::vector<Column> _columns;
+    bool                _continued;     //the columns are in the file already
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
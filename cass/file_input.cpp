@@ -8,12 +8,23 @@
 #include "file_input.h"
 #include "pdsdata/xtc/Dgram.hh"
 #include "cass_event.h"
+#include "shards.h"
+#include "event_builder.h"
 
 cass::FileInput::FileInput(const char *filelistname,lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize> &ringbuffer, QObject *parent)
        :QThread(parent),
         _ringbuffer(ringbuffer),
         _quit(false),
-        _filelistname(filelistname)
+        _filelistname(filelistname),
+        _waitStage("input.wait"),
+        _readStage("input.read"),
+        _checkpointStage("checkpoint"),
+        _state(0),
+        _checkpoint(""),
+        _interval(0),
+        _lastCheckpoint(0),
+        _resuming(false),
+        _resumeOffset(0)
 {
 }
 
@@ -21,78 +32,194 @@ cass::FileInput::~FileInput()
 {
 }
 
-void cass::FileInput::run()
+bool cass::FileInput::readFileList(const char *filelistname, std::vector<std::string> &filelist)
 {
-  //create a list where all files that should be processed are in//
-  std::vector<std::string> filelist;
-  
   //open the file with the filenames in it//
   std::ifstream filelistfile;
-  filelistfile.open(_filelistname);
+  filelistfile.open(filelistname);
+  if (!filelistfile.is_open())
+  {
+    std::cout <<"filelist \""<<filelistname<<"\" could not be opened"<<std::endl;
+    return false;
+  }
+  std::cout <<"filelist \""<<filelistname<<"\" is open"<<std::endl;
   //put the names into a list of things that we want to process//
-  if (filelistfile.is_open())
+  std::string line;
+  while (getline(filelistfile,line))
   {
-    std::cout <<"filelist \""<<_filelistname<<"\" is open"<<std::endl;
-    //go through whole file//
-    while (!filelistfile.eof())
-    {
-      //read a line and put it into the file list//
-      std::string line;
-      getline(filelistfile,line);
-      /* remove newline */
-      if(line[line.length()-1] == '\n'){
-	  line.resize(line.length()-1);
-      }
-      /* dont read newlines */
-      if(line.empty() || line[0] == '\n'){
-	  continue;
-      }
-      filelist.push_back(line);
-      std::cout <<"file \""<<line<<"\" added to processing list"<<std::endl;
+    /* dont read empty lines */
+    if(line.empty()){
+	continue;
     }
+    filelist.push_back(line);
+    std::cout <<"file \""<<line<<"\" added to processing list"<<std::endl;
+  }
+  return true;
+}
+
+void cass::FileInput::checkpoints(Checkpointable *state, bool resume)
+{
+  CheckpointParameter param;
+  param.load();
+  //every shard has its own checkpoint//
+  _checkpoint = Checkpoint(param._filename.toStdString() + globalOptions.outputSuffix.toStdString());
+  _interval = static_cast<uint64_t>(param._interval > 0 ? param._interval : 0)*1000000000ULL;
+  _lastCheckpoint = Stage::now();
+  _state = _interval ? state : 0;
+  //the position in the streams of the built events is not one file and offset//
+  if (globalOptions.buildEvents)
+  {
+    _state = 0;
+    if (resume)
+      std::cout <<"the built events can not be resumed, starting from the beginning"<<std::endl;
+    return;
+  }
+  if (!resume)
+    return;
+  if (!_checkpoint.load())
+  {
+    std::cout <<"there is no checkpoint \""<<_checkpoint.filename()<<"\", starting from the beginning"<<std::endl;
+    return;
+  }
+  _resuming = true;
+  _resumeFile = _checkpoint.value("input.file");
+  _resumeOffset = _checkpoint.number("input.offset");
+  state->resume(_checkpoint);
+  std::cout <<"resuming at \""<<_resumeFile<<"\" position "<<_resumeOffset<<std::endl;
+}
+
+void cass::FileInput::checkpoint(const std::string &filename, uint64_t offset)
+{
+  //the state is only consistent when everything that was read has been processed//
+  _ringbuffer.waitUntilProcessed();
+  StageTimer timer(_checkpointStage);
+  _checkpoint.clear();
+  _checkpoint.set("input.file",filename);
+  _checkpoint.set("input.offset",offset);
+  _state->checkpoint(_checkpoint);
+  if (_checkpoint.commit())
+    std::cout <<"checkpoint at \""<<filename<<"\" position "<<offset<<std::endl;
+  _lastCheckpoint = Stage::now();
+}
+
+bool cass::FileInput::resumeRanges(std::vector<ShardRange> &ranges)const
+{
+  for (size_t i=0; i<ranges.size(); ++i)
+  {
+    ShardRange &range(ranges[i]);
+    if (range.filename != _resumeFile || _resumeOffset < range.begin || _resumeOffset > range.end)
+      continue;
+    //the converters need the last Configure before the position again//
+    std::vector<XtcIndexEntry> entries;
+    ShardPlanner::index(range.filename,entries);
+    range.configure = ShardRange::NoConfigure;
+    for (size_t e=0; e<entries.size() && entries[e].offset < _resumeOffset; ++e)
+      if (entries[e].transition == Pds::TransitionId::Configure)
+        range.configure = entries[e].offset;
+    range.begin = _resumeOffset;
+    ranges.erase(ranges.begin(),ranges.begin()+i);
+    return true;
+  }
+  return false;
+}
+
+void cass::FileInput::run()
+{
+  //create a list where all files that should be processed are in//
+  std::vector<std::string> filelist;
+  readFileList(_filelistname,filelist);
+
+  //the streams of every run are read together and their datagrams are built into events//
+  if (cass::globalOptions.buildEvents)
+  {
+    std::vector<EventBuilder::streams_t> runs;
+    EventBuilder::runs(filelist,runs);
+    EventBuilder builder(_ringbuffer,_quit);
+    for (size_t i=0; i<runs.size() && !_quit; ++i)
+      builder.build(runs[i]);
+    std::cout << "built "<<builder.built()<<" events, "<<builder.incomplete()
+              <<" of them are incomplete"<<std::endl;
+    Statistics::instance().publishCurrentThread();
+    return;
+  }
+
+  //the parts of the files this process reads, the whole files unless it is one of several shards//
+  std::vector<ShardRange> ranges;
+  ShardPlanner::plan(filelist,cass::globalOptions.shard,cass::globalOptions.nbrShards,ranges);
+  //continue at the checkpoint//
+  if (_resuming && !resumeRanges(ranges))
+  {
+    std::cout <<"\""<<_resumeFile<<"\" of the checkpoint is not in the file list"<<std::endl;
+    Statistics::instance().publishCurrentThread();
+    return;
   }
   
   //make a pointer to a buffer//
   cass::CASSEvent *cassevent;
   //go through all files in the list//
-  for (std::vector<std::string>::iterator filelistiterator = filelist.begin();
-       filelistiterator != filelist.end();
-       ++filelistiterator)
+  for (std::vector<ShardRange>::iterator range = ranges.begin();
+       range != ranges.end();
+       ++range)
   {
     //open the file//
     std::ifstream xtcfile;
-    xtcfile.open(filelistiterator->c_str(), std::ios::binary | std::ios::in);
-    cass::globalOptions.lastFile = QString(filelistiterator->c_str());
+    xtcfile.open(range->filename.c_str(), std::ios::binary | std::ios::in);
+    cass::globalOptions.lastFile = QString(range->filename.c_str());
     //if there was such a file then we want to load it//
     if (xtcfile.is_open())
     {
-      std::cout <<"processing file \""<<filelistiterator->c_str()<<"\""<<std::endl;
-      //read until we are finished with the file//
-      while(!xtcfile.eof() && !_quit)
+      std::cout <<"processing file \""<<range->filename<<"\"";
+      if (range->end != ShardRange::EndOfFile)
+        std::cout <<" from "<<range->begin<<" to "<<range->end;
+      std::cout <<std::endl;
+      //a shard that starts in the middle of the file reads the configuration of the run first//
+      uint64_t position = range->begin;
+      bool configure = range->configure != ShardRange::NoConfigure;
+      xtcfile.seekg(configure ? range->configure : range->begin);
+      //read until we are finished with the file or the range//
+      while(!xtcfile.eof() && !_quit && (configure || position < range->end))
       {
         //retrieve a new element from the ringbuffer//
+        const uint64_t waitStart = Stage::now();
         _ringbuffer.nextToFill(cassevent);
+        const uint64_t readStart = Stage::now();
+        _waitStage.record(waitStart,readStart);
         //read the datagram from the file in the ringbuffer//
         Pds::Dgram& dg = *reinterpret_cast<Pds::Dgram*>(cassevent->datagrambuffer());
 	time_t eventTime = dg.seq.clock().seconds();
 	if(eventTime && cass::globalOptions.endTime.isValid() && 
 	   QDateTime::fromTime_t(eventTime).time() > cass::globalOptions.endTime.time()){
 	    printf("Skipping rest of file\n");
+	    Statistics::instance().publishCurrentThread();
 	    return;
 	}
         xtcfile.read(cassevent->datagrambuffer(),sizeof(dg));
         xtcfile.read(dg.xtc.payload(), dg.xtc.sizeofPayload());
-	cassevent->setFilename(filelistiterator->c_str());
+	cassevent->setFilename(range->filename.c_str());
+        const uint64_t size = sizeof(dg)+dg.xtc.sizeofPayload();
+        _readStage.record(readStart,Stage::now(),size);
         //tell the buffer that we are done//
         _ringbuffer.doneFilling(cassevent);
+        if (configure)
+        {
+          configure = false;
+          xtcfile.seekg(range->begin);
+        }
+        else
+        {
+          position += size;
+          if (_state && xtcfile.good() && Stage::now() - _lastCheckpoint > _interval)
+            checkpoint(range->filename,position);
+        }
       }
       //done reading.. close file//
       xtcfile.close();
     }
     else
-      std::cout <<"file \""<<filelistiterator->c_str()<<"\" could not be opened"<<std::endl;
+      std::cout <<"file \""<<range->filename<<"\" could not be opened"<<std::endl;
 
   }
+  Statistics::instance().publishCurrentThread();
   if (!_quit)
   std::cout << "done with all files"<<std::endl;
 }
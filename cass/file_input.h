@@ -6,13 +6,19 @@
 #include <QtCore/QObject>
 #include <QThread>
 #include <QMutex>
+#include <string>
+#include <vector>
 
 #include "cass.h"
 #include "ringbuffer.h"
 #include "cass_event.h"
+#include "instrumentation.h"
+#include "checkpoint.h"
 
 namespace cass
 {
+  struct ShardRange;
+
   class CASSSHARED_EXPORT FileInput : public QThread
   {
     Q_OBJECT;
@@ -23,13 +29,36 @@ namespace cass
 
     void run();
 
+    //the names of the xtc files in the file list, one per line//
+    static bool readFileList(const char *filelistname, std::vector<std::string>&);
+
+    //make checkpoints of the state while reading, and when resume is set continue at the//
+    //last checkpoint. Has to be called before the threads are started//
+    void checkpoints(Checkpointable *state, bool resume);
+
   public slots:
     void end();
 
+  private:
+    //write a checkpoint, offset is the position of the next datagram in the file//
+    void checkpoint(const std::string &filename, uint64_t offset);
+    //drop the ranges before the checkpoint and start at its position//
+    bool resumeRanges(std::vector<ShardRange>&)const;
+
   private:
       lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize>  &_ringbuffer;
     bool                                 _quit;
     const char                          *_filelistname;
+    Stage                                _waitStage;     //waiting for a free element of the ringbuffer
+    Stage                                _readStage;     //reading the datagram from the file
+    Stage                                _checkpointStage;
+    Checkpointable                      *_state;         //of the processing, 0 without checkpoints
+    Checkpoint                           _checkpoint;
+    uint64_t                             _interval;      //between two checkpoints in ns
+    uint64_t                             _lastCheckpoint;
+    bool                                 _resuming;
+    std::string                          _resumeFile;
+    uint64_t                             _resumeOffset;
   };
 
 }//end namespace cass
@@ -12,7 +12,9 @@
 
 
 cass::FormatConverter::FormatConverter()
+  :_filterStage("filter")
 {
+  _required.all();
     // create all the necessary individual format converters
 //  _converters[REMI]        = new cass::REMI::Converter();
 //  _converters[Pulnix]      = new cass::VMI::Converter();
@@ -20,6 +22,19 @@ cass::FormatConverter::FormatConverter()
 	_converters[pnCCD]       = new cass::pnCCD::Converter();
     }
   _converters[MachineData] = new cass::MachineData::Converter();
+
+  //the beamline data and the epics values are converted first, they decide whether the//
+  //detectors of the event need to be converted at all//
+  for (std::map<Converters, ConversionBackend *>::iterator it=_converters.begin() ; it != _converters.end(); ++it )
+    if (it->first == MachineData)
+      _beamline[it->first] = it->second;
+    else
+      _detectors[it->first] = it->second;
+
+  //the wavelength appender needs the beamline data of every event//
+  if (!globalOptions.onlyAppendWavelength &&
+      !_filter.compile(globalOptions.filterExpression.toStdString()))
+    std::cout << "FormatConverter: can not compile the event filter: "<<_filter.error()<<std::endl;
 }
 
 cass::FormatConverter::~FormatConverter()
@@ -59,9 +74,31 @@ bool cass::FormatConverter::processDatagram(cass::CASSEvent *cassevent)
 	  //set the id of the cassevent//
 	  cassevent->id() = bunchId;
       }
+      //nothing of this datagram is made yet, only the products that are required will be//
+      cassevent->produced().clear();
+      cassevent->wanted() = _required;
+
       //iterate through the datagram and find the wanted information//
-      XtcIterator iter(&(datagram->xtc),_converters,cassevent,0);
-      iter.iterate();
+      if (datagram->seq.service() == Pds::TransitionId::Configure || _filter.empty())
+      {
+        XtcIterator iter(&(datagram->xtc),_converters,cassevent,0);
+        iter.iterate();
+      }
+      else
+      {
+        XtcIterator beamline(&(datagram->xtc),_beamline,cassevent,0);
+        beamline.iterate();
+        //the events that are not wanted are neither converted nor analyzed any further//
+        {
+          StageTimer timer(_filterStage);
+          if (!_filter(*cassevent))
+          {
+            _filterStage.drop();
+            return false;
+          }
+        }
+        convertDetectors(cassevent);
+      }
       
       //when the datagram was an event then emit the new CASSEvent//
       retval = true;
@@ -70,6 +107,13 @@ bool cass::FormatConverter::processDatagram(cass::CASSEvent *cassevent)
   return retval;
 }
 
+void cass::FormatConverter::convertDetectors(cass::CASSEvent *cassevent)
+{
+  Pds::Dgram *datagram = reinterpret_cast<Pds::Dgram*>(cassevent->datagrambuffer());
+  XtcIterator iter(&(datagram->xtc),_detectors,cassevent,0);
+  iter.iterate();
+}
+
 
 
 
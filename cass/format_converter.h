@@ -8,6 +8,8 @@
 #include <QtCore/QObject>
 #include "cass.h"
 #include "cass_event.h"
+#include "event_filter.h"
+#include "instrumentation.h"
 
 namespace Pds
 {
@@ -26,10 +28,21 @@ namespace cass
 
     public:
       enum Converters {pnCCD, REMI, Pulnix,MachineData};
+      //returns whether the datagram should be analyzed. Events that the filter rejects are//
+      //not analyzed, and only their beamline data is converted//
       bool processDatagram(cass::CASSEvent*);
+      //the products that are made of every event, the beamline data is always converted//
+      void require(const Products &products)      {_required = products;}
+      //convert the detectors of the event again, for the products it wants now//
+      void convertDetectors(cass::CASSEvent*);
 
     private:
       std::map<Converters, ConversionBackend*>    _converters;
+      std::map<Converters, ConversionBackend*>    _beamline;      //the converters the filter needs
+      std::map<Converters, ConversionBackend*>    _detectors;     //all other converters
+      EventFilter                                 _filter;
+      Products                                    _required;
+      Stage                                       _filterStage;
   };
 
 }//end namespace cass
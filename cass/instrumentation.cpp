@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <QThread>
+#include <QMutexLocker>
+
+#include "instrumentation.h"
+
+
+void cass::LatencyHistogram::clear()
+{
+  memset(_counts,0,sizeof(_counts));
+  _count = 0;
+  _sum   = 0;
+  _max   = 0;
+}
+
+void cass::LatencyHistogram::merge(const LatencyHistogram &other)
+{
+  for (size_t i=0; i<NbrBuckets; ++i)
+    _counts[i] += other._counts[i];
+  _count += other._count;
+  _sum   += other._sum;
+  _max    = std::max(_max,other._max);
+}
+
+uint64_t cass::LatencyHistogram::upperEdge(size_t bucket)
+{
+  if (bucket < 2*SubBuckets)
+    return bucket;
+  const int shift = bucket/SubBuckets - 1;
+  const uint64_t sub = bucket - shift*SubBuckets;
+  return ((sub+1)<<shift) - 1;
+}
+
+uint64_t cass::LatencyHistogram::percentile(double p)const
+{
+  if (!_count)
+    return 0;
+  //the rank of the value we are looking for, counted from 1//
+  const uint64_t rank = std::max<uint64_t>(1,static_cast<uint64_t>(p*_count + 0.5));
+  uint64_t seen = 0;
+  for (size_t i=0; i<NbrBuckets; ++i)
+  {
+    seen += _counts[i];
+    if (seen >= rank)
+      return std::min(upperEdge(i),_max);
+  }
+  return _max;
+}
+
+
+
+
+
+cass::Stage::Stage(const std::string &name)
+  :_name(name),
+   _bytes(0),
+   _dropped(0),
+   _lastPublish(0),
+   _owner(0)
+{
+  _id = Statistics::instance().add(this);
+}
+
+cass::Stage::~Stage()
+{
+  Statistics::instance().remove(this);
+}
+
+void cass::Stage::publish(uint64_t now)
+{
+  _lastPublish = now;
+  Statistics::instance().store(this);
+}
+
+uint64_t cass::Stage::now()
+{
+#ifdef CLOCK_MONOTONIC
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return static_cast<uint64_t>(ts.tv_sec)*1000000000 + ts.tv_nsec;
+#else
+  timeval tv;
+  gettimeofday(&tv,0);
+  return static_cast<uint64_t>(tv.tv_sec)*1000000000 + static_cast<uint64_t>(tv.tv_usec)*1000;
+#endif
+}
+
+
+
+
+
+cass::Statistics &cass::Statistics::instance()
+{
+  static Statistics statistics;
+  return statistics;
+}
+
+namespace
+{
+  //copy the statistics of the stage, the mutex of the registry has to be locked//
+  void copy(const cass::Stage &stage, cass::Statistics::Copy &c)
+  {
+    c.name    = stage.name();
+    c.latency = stage.latency();
+    c.bytes   = stage.bytes();
+    c.dropped = stage.dropped();
+  }
+}
+
+int cass::Statistics::add(Stage *stage)
+{
+  QMutexLocker lock(&_mutex);
+  _stages.push_back(stage);
+  _copies[_nextId].name = stage->name();
+  return _nextId++;
+}
+
+void cass::Statistics::remove(Stage *stage)
+{
+  QMutexLocker lock(&_mutex);
+  //keep the final statistics of the stage//
+  copy(*stage,_copies[stage->_id]);
+  _stages.erase(std::remove(_stages.begin(),_stages.end(),stage),_stages.end());
+}
+
+void cass::Statistics::store(Stage *stage)
+{
+  QMutexLocker lock(&_mutex);
+  stage->_owner = QThread::currentThread();
+  copy(*stage,_copies[stage->_id]);
+}
+
+void cass::Statistics::publishCurrentThread()
+{
+  QMutexLocker lock(&_mutex);
+  QThread *current = QThread::currentThread();
+  for (size_t i=0; i<_stages.size(); ++i)
+    if (_stages[i]->_owner == current)
+      copy(*_stages[i],_copies[_stages[i]->_id]);
+}
+
+void cass::Statistics::gauge(const std::string &name, double value)
+{
+  QMutexLocker lock(&_mutex);
+  _gauges[name] = value;
+}
+
+void cass::Statistics::snapshot(summaries_t &summaries, std::map<std::string,double> &gauges)
+{
+  QMutexLocker lock(&_mutex);
+  summaries.clear();
+  for (std::map<int,Copy>::const_iterator it=_copies.begin(); it!=_copies.end(); ++it)
+  {
+    Summary &s = summaries[it->second.name];
+    s.latency.merge(it->second.latency);
+    s.bytes   += it->second.bytes;
+    s.dropped += it->second.dropped;
+  }
+  gauges = _gauges;
+}
+
+std::string cass::Statistics::report(double elapsed)
+{
+  summaries_t summaries;
+  std::map<std::string,double> gauges;
+  snapshot(summaries,gauges);
+  //the report is only created by the thread that exports it, so _last needs no lock//
+  std::ostringstream out;
+  out << std::fixed;
+  out << "# stage events events/s MB MB/s dropped mean[us] p50[us] p90[us] p99[us] p99.9[us] max[us]"
+      << std::endl;
+  for (summaries_t::const_iterator it=summaries.begin(); it!=summaries.end(); ++it)
+  {
+    const Summary &s    = it->second;
+    const Summary &last = _last[it->first];
+    const uint64_t events = s.latency.count();
+    const double eventRate = elapsed > 0 ? (events - last.latency.count())/elapsed : 0;
+    const double byteRate  = elapsed > 0 ? (s.bytes - last.bytes)/elapsed : 0;
+    out << it->first
+        << " " << events
+        << " " << std::setprecision(1) << eventRate
+        << " " << std::setprecision(3) << s.bytes*1e-6
+        << " " << std::setprecision(3) << byteRate*1e-6
+        << " " << s.dropped
+        << std::setprecision(1)
+        << " " << s.latency.mean()*1e-3
+        << " " << s.latency.percentile(0.5)*1e-3
+        << " " << s.latency.percentile(0.9)*1e-3
+        << " " << s.latency.percentile(0.99)*1e-3
+        << " " << s.latency.percentile(0.999)*1e-3
+        << " " << s.latency.max()*1e-3
+        << std::endl;
+  }
+  out << "# gauge value" << std::endl;
+  for (std::map<std::string,double>::const_iterator it=gauges.begin(); it!=gauges.end(); ++it)
+    out << it->first << " " << std::setprecision(2) << it->second << std::endl;
+  _last = summaries;
+  return out.str();
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,192 @@
+#ifndef CASS_INSTRUMENTATION_H
+#define CASS_INSTRUMENTATION_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <QMutex>
+
+#include "cass.h"
+
+class QThread;
+
+namespace cass
+{
+  //latency histogram with logarithmic buckets that are divided into linear sub buckets, like//
+  //HdrHistogram. The values are nanoseconds, values below 2*SubBuckets are exact, above that//
+  //every bucket has a relative width of 1/SubBuckets. Values above 2^MaxBits are clamped//
+  class CASSSHARED_EXPORT LatencyHistogram
+  {
+  public:
+    enum {SubBucketBits = 5,
+          SubBuckets    = 1<<SubBucketBits,
+          MaxBits       = 40,
+          NbrBuckets    = (MaxBits-SubBucketBits+2)*SubBuckets};
+
+  public:
+    LatencyHistogram()      {clear();}
+
+    void clear();
+    void record(uint64_t value)
+    {
+      if (value >> MaxBits)
+        value = (static_cast<uint64_t>(1)<<MaxBits) - 1;
+      ++_counts[bucket(value)];
+      ++_count;
+      _sum += value;
+      if (value > _max) _max = value;
+    }
+    void merge(const LatencyHistogram&);
+
+    uint64_t count()const   {return _count;}
+    uint64_t max()const     {return _max;}
+    double   mean()const    {return _count ? static_cast<double>(_sum)/_count : 0;}
+    //the value below which the fraction p of all recorded values are, the upper edge of the bucket//
+    uint64_t percentile(double p)const;
+
+  public:
+    static size_t bucket(uint64_t value)
+    {
+      if (value < 2*SubBuckets)
+        return value;
+      const int shift = (63-__builtin_clzll(value)) - SubBucketBits;
+      return shift*SubBuckets + (value>>shift);
+    }
+    static uint64_t upperEdge(size_t bucket);
+
+  private:
+    uint64_t _counts[NbrBuckets];
+    uint64_t _count;
+    uint64_t _sum;
+    uint64_t _max;
+  };
+
+
+  //the statistics of one stage of the processing. A stage is only ever recorded by one//
+  //thread, so recording needs no locks. The thread hands a copy of the statistics to the//
+  //Statistics registry once per publish interval, several stages with the same name//
+  //(e.g. recorded by different threads) are merged when the statistics are reported//
+  class CASSSHARED_EXPORT Stage
+  {
+  public:
+    explicit Stage(const std::string &name);
+    ~Stage();
+
+    //record one event that entered the stage at start and left it at end//
+    void record(uint64_t start, uint64_t end, uint64_t bytes=0)
+    {
+      _latency.record(end-start);
+      _bytes += bytes;
+      if (end - _lastPublish > PublishInterval)
+        publish(end);
+    }
+    //count an event that was lost in this stage//
+    void drop()                                 {++_dropped;}
+
+    const std::string &name()const              {return _name;}
+    const LatencyHistogram &latency()const      {return _latency;}
+    uint64_t bytes()const                       {return _bytes;}
+    uint64_t dropped()const                     {return _dropped;}
+
+    //hand a copy to the Statistics registry, must be called by the recording thread//
+    void publish(uint64_t now);
+
+  public:
+    //monotonic time in nanoseconds//
+    static uint64_t now();
+    static const uint64_t PublishInterval = 250000000;
+
+  private:
+    Stage(const Stage&);
+    Stage &operator=(const Stage&);
+
+  private:
+    friend class Statistics;
+    std::string         _name;
+    LatencyHistogram    _latency;
+    uint64_t            _bytes;
+    uint64_t            _dropped;
+    uint64_t            _lastPublish;
+    int                 _id;            //the key of the copy in the registry
+    QThread            *_owner;         //the thread that records, known after the first publish
+  };
+
+
+  //times the scope it lives in and records it to the stage//
+  class StageTimer
+  {
+  public:
+    explicit StageTimer(Stage &stage, uint64_t bytes=0)
+      :_stage(stage),_bytes(bytes),_start(Stage::now())     {}
+    ~StageTimer()                                           {_stage.record(_start,Stage::now(),_bytes);}
+    void bytes(uint64_t bytes)                              {_bytes = bytes;}
+
+  private:
+    Stage      &_stage;
+    uint64_t    _bytes;
+    uint64_t    _start;
+  };
+
+
+  //the registry of the published copies of all stages and of the gauges, e.g. the occupancy//
+  //of the ringbuffer. Creates the report that the Ratemeter exports//
+  class CASSSHARED_EXPORT Statistics
+  {
+  public:
+    //the merged statistics of all stages with the same name//
+    struct Summary
+    {
+      Summary():bytes(0),dropped(0)    {}
+      LatencyHistogram latency;
+      uint64_t         bytes;
+      uint64_t         dropped;
+    };
+    typedef std::map<std::string,Summary> summaries_t;
+
+    //the published copy of one stage//
+    struct Copy : public Summary
+    {
+      std::string name;
+    };
+
+  public:
+    static Statistics &instance();
+
+    //publish all stages that are recorded by the calling thread, call before it finishes//
+    void publishCurrentThread();
+    void gauge(const std::string &name, double value);
+
+    //the merged stages and the gauges//
+    void snapshot(summaries_t&, std::map<std::string,double>&);
+    //a plain text report with the rates since the last report, elapsed is in seconds//
+    std::string report(double elapsed);
+
+  private:
+    Statistics():_nextId(0)     {}
+    friend class Stage;
+    int  add(Stage*);
+    void remove(Stage*);
+    void store(Stage*);
+
+  private:
+    QMutex                          _mutex;
+    int                             _nextId;
+    std::vector<Stage*>             _stages;    //the living stages
+    std::map<int,Copy>              _copies;    //the last published copy of every stage
+    std::map<std::string,double>    _gauges;
+    summaries_t                     _last;      //the summaries at the last report
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
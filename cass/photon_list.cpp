@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <iostream>
+
+#include "photon_list.h"
+
+
+void cass::PhotonListParameter::load()
+{
+  //sync before loading//
+  sync();
+  _maxOccupancy = value("MaxOccupancy",0.05).toDouble();
+}
+
+void cass::PhotonListParameter::save()
+{
+  setValue("MaxOccupancy",_maxOccupancy);
+}
+
+
+
+
+
+namespace
+{
+  //open a file for appending with a large stdio buffer, returns the size it already has//
+  FILE *openForAppend(const std::string &filename, std::vector<char> &buffer, uint64_t &size)
+  {
+    FILE *fp = fopen(filename.c_str(),"ab");
+    if (!fp)
+    {
+      std::cout << "PhotonListFile: could not open \""<<filename<<"\""<<std::endl;
+      return 0;
+    }
+    fseek(fp,0,SEEK_END);
+    size = ftell(fp);
+    buffer.resize(1<<20);
+    setvbuf(fp,&buffer[0],_IOFBF,buffer.size());
+    return fp;
+  }
+}
+
+bool cass::PhotonListFile::open(const std::string &name)
+{
+  if (_data && name == _name)
+    return true;
+  close();
+  uint64_t indexSize;
+  _data  = openForAppend(name+".bin",_dataBuffer,_offset);
+  _index = openForAppend(name+".idx",_indexBuffer,indexSize);
+  if (!_data || !_index)
+  {
+    close();
+    return false;
+  }
+  //a new data file needs the magic first//
+  if (_offset == 0)
+  {
+    fwrite("CASSPHL1",1,8,_data);
+    _offset = 8;
+  }
+  _name = name;
+  return true;
+}
+
+void cass::PhotonListFile::append(uint64_t eventid, uint32_t detector, const pnCCD::pnCCDDetector &det)
+{
+  if (!_data)
+    return;
+  const uint16_t rows    = det.rows();
+  const uint16_t columns = det.columns();
+  const pnCCD::pnCCDDetector::photonHits_t &hits = det.nonrecombined();
+  const size_t nbrPixels = static_cast<size_t>(rows)*columns;
+  //store the frame dense when there are so many hits that the list gets too large//
+  const bool dense = nbrPixels &&
+                     det.correctedFrame().size() == nbrPixels &&
+                     hits.size() > _param._maxOccupancy*nbrPixels;
+  const uint32_t format = dense ? Dense : Sparse;
+  if (!dense)
+  {
+    //the hits are in the pixels of the detector, the records in the ones of the rebinned//
+    //frame. The pixels that did not fill a whole bin are not in the frame//
+    const uint32_t rebin = (columns && det.originalcolumns() > columns) ? det.originalcolumns()/columns : 1;
+    _hits.clear();
+    _hits.reserve(hits.size());
+    for (size_t i=0; i<hits.size(); ++i)
+    {
+      PhotonListHit hit;
+      hit.x      = hits[i].x() / rebin;
+      hit.y      = hits[i].y() / rebin;
+      hit.energy = hits[i].energy();
+      if (hit.x < columns && hit.y < rows)
+        _hits.push_back(hit);
+    }
+  }
+  const uint32_t count  = dense ? nbrPixels : _hits.size();
+
+  //the index entry points to the start of the record//
+  fwrite(&eventid,sizeof(eventid),1,_index);
+  fwrite(&detector,sizeof(detector),1,_index);
+  fwrite(&format,sizeof(format),1,_index);
+  fwrite(&_offset,sizeof(_offset),1,_index);
+
+  fwrite(&eventid,sizeof(eventid),1,_data);
+  fwrite(&detector,sizeof(detector),1,_data);
+  fwrite(&rows,sizeof(rows),1,_data);
+  fwrite(&columns,sizeof(columns),1,_data);
+  fwrite(&format,sizeof(format),1,_data);
+  fwrite(&count,sizeof(count),1,_data);
+  _offset += 24;
+  if (dense)
+  {
+    fwrite(&det.correctedFrame()[0],sizeof(int16_t),count,_data);
+    _offset += count*sizeof(int16_t);
+  }
+  else if (count)
+  {
+    fwrite(&_hits[0],sizeof(PhotonListHit),count,_data);
+    _offset += count*sizeof(PhotonListHit);
+  }
+}
+
+void cass::PhotonListFile::flush()
+{
+  if (_data)
+    fflush(_data);
+  if (_index)
+    fflush(_index);
+}
+
+void cass::PhotonListFile::close()
+{
+  if (_data)
+    fclose(_data);
+  if (_index)
+    fclose(_index);
+  _data  = 0;
+  _index = 0;
+  _name.clear();
+}
+
+
+
+
+
+namespace
+{
+  bool lessEntry(const cass::PhotonListReader::IndexEntry &a, const cass::PhotonListReader::IndexEntry &b)
+  {
+    return (a.eventid < b.eventid) || (a.eventid == b.eventid && a.detector < b.detector);
+  }
+}
+
+bool cass::PhotonListReader::open(const std::string &name)
+{
+  close();
+  _data = fopen((name+".bin").c_str(),"rb");
+  char magic[8];
+  if (!_data || fread(magic,1,8,_data) != 8 || std::string(magic,8) != "CASSPHL1")
+  {
+    std::cout << "PhotonListReader: \""<<name<<".bin\" is not a photon list file"<<std::endl;
+    close();
+    return false;
+  }
+  FILE *index = fopen((name+".idx").c_str(),"rb");
+  if (!index)
+  {
+    std::cout << "PhotonListReader: could not open \""<<name<<".idx\""<<std::endl;
+    close();
+    return false;
+  }
+  IndexEntry e;
+  while (fread(&e.eventid,sizeof(e.eventid),1,index) == 1 &&
+         fread(&e.detector,sizeof(e.detector),1,index) == 1 &&
+         fread(&e.format,sizeof(e.format),1,index) == 1 &&
+         fread(&e.offset,sizeof(e.offset),1,index) == 1)
+    _entries.push_back(e);
+  fclose(index);
+  std::stable_sort(_entries.begin(),_entries.end(),lessEntry);
+  return true;
+}
+
+void cass::PhotonListReader::close()
+{
+  if (_data)
+    fclose(_data);
+  _data = 0;
+  _entries.clear();
+}
+
+const cass::PhotonListReader::IndexEntry *cass::PhotonListReader::find(uint64_t eventid, uint32_t detector)const
+{
+  IndexEntry key;
+  key.eventid  = eventid;
+  key.detector = detector;
+  std::vector<IndexEntry>::const_iterator it =
+      std::lower_bound(_entries.begin(),_entries.end(),key,lessEntry);
+  if (it == _entries.end() || it->eventid != eventid || it->detector != detector)
+    return 0;
+  return &(*it);
+}
+
+bool cass::PhotonListReader::read(const IndexEntry &entry, Frame &frame)
+{
+  if (!_data || fseek(_data,entry.offset,SEEK_SET))
+    return false;
+  uint32_t count;
+  if (fread(&frame.eventid,sizeof(frame.eventid),1,_data) != 1 ||
+      fread(&frame.detector,sizeof(frame.detector),1,_data) != 1 ||
+      fread(&frame.rows,sizeof(frame.rows),1,_data) != 1 ||
+      fread(&frame.columns,sizeof(frame.columns),1,_data) != 1 ||
+      fread(&frame.format,sizeof(frame.format),1,_data) != 1 ||
+      fread(&count,sizeof(count),1,_data) != 1)
+    return false;
+  frame.hits.clear();
+  frame.pixels.clear();
+  if (frame.format == PhotonListFile::Dense)
+  {
+    frame.pixels.resize(count);
+    return !count || fread(&frame.pixels[0],sizeof(int16_t),count,_data) == count;
+  }
+  frame.hits.resize(count);
+  return !count || fread(&frame.hits[0],sizeof(Hit),count,_data) == count;
+}
+
+void cass::PhotonListReader::rasterize(const Frame &frame, std::vector<float> &image)
+{
+  const size_t nbrPixels = static_cast<size_t>(frame.rows)*frame.columns;
+  if (image.size() != nbrPixels)
+    image.assign(nbrPixels,0);
+  if (frame.format == PhotonListFile::Dense)
+  {
+    for (size_t i=0; i<frame.pixels.size() && i<nbrPixels; ++i)
+      image[i] += frame.pixels[i];
+    return;
+  }
+  for (size_t i=0; i<frame.hits.size(); ++i)
+  {
+    const Hit &h = frame.hits[i];
+    if (h.x < frame.columns && h.y < frame.rows)
+      image[static_cast<size_t>(h.y)*frame.columns + h.x] += h.energy;
+  }
+}
+
+double cass::PhotonListReader::integrate(const Frame &frame)
+{
+  double sum = 0;
+  if (frame.format == PhotonListFile::Dense)
+    for (size_t i=0; i<frame.pixels.size(); ++i)
+      sum += frame.pixels[i];
+  else
+    for (size_t i=0; i<frame.hits.size(); ++i)
+      sum += frame.hits[i].energy;
+  return sum;
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,138 @@
+#ifndef CASS_PHOTONLIST_H
+#define CASS_PHOTONLIST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "cass.h"
+#include "parameter_backend.h"
+#include "pnccd_detector.h"
+
+namespace cass
+{
+  //the settings of the photon list output//
+  class CASSSHARED_EXPORT PhotonListParameter : public cass::ParameterBackend
+  {
+  public:
+    PhotonListParameter()   {beginGroup("PhotonList");}
+    ~PhotonListParameter()  {endGroup();}
+    void load();
+    void save();
+
+  public:
+    double   _maxOccupancy;         //fraction of pixels with hits above which the frame is stored dense
+  };
+
+
+
+  //one photon hit as it is stored in the file//
+  struct PhotonListHit
+  {
+    uint16_t x;
+    uint16_t y;
+    float    energy;
+  };
+
+
+
+  //writes the pnCCD frames of a run as lists of photon hits//
+  //the file <name>.bin starts with the 8 byte magic "CASSPHL1" followed by one record//
+  //per frame: uint64 eventid, uint32 detector, uint16 rows, uint16 columns, uint32 format,//
+  //uint32 count and then either count hits of uint16 x (column), uint16 y (row), float//
+  //energy (format 0, sparse) or the rows*columns int16 pixels of the frame (format 1, dense).//
+  //rows and columns are the ones of the rebinned frame and so are the pixels of the hits//
+  //The sidecar <name>.idx contains uint64 eventid, uint32 detector, uint32 format and the//
+  //uint64 offset of the record in the .bin file for every record//
+  class CASSSHARED_EXPORT PhotonListFile
+  {
+  public:
+    enum Format {Sparse=0, Dense=1};
+
+  public:
+    PhotonListFile():_data(0),_index(0),_offset(0)  {loadSettings();}
+    ~PhotonListFile()                               {close();}
+
+    void loadSettings()                 {_param.load();}
+    //(re)open the files, name is without extension//
+    bool open(const std::string &name);
+    //stores the hits or, when there are too many, the corrected frame of the detector//
+    void append(uint64_t eventid, uint32_t detector, const pnCCD::pnCCDDetector&);
+    //write the buffered records to disk, the files stay open//
+    void flush();
+    void close();
+
+  private:
+    PhotonListParameter  _param;
+    FILE                *_data;
+    FILE                *_index;
+    uint64_t             _offset;       //the position of the next record in the data file
+    std::string          _name;
+    std::vector<PhotonListHit> _hits;   //the hits of the frame that is written
+    std::vector<char>    _dataBuffer;   //the stdio buffers of the files
+    std::vector<char>    _indexBuffer;
+  };
+
+
+
+  //reads the files written by PhotonListFile//
+  class CASSSHARED_EXPORT PhotonListReader
+  {
+  public:
+    struct IndexEntry
+    {
+      uint64_t eventid;
+      uint32_t detector;
+      uint32_t format;
+      uint64_t offset;
+    };
+    typedef PhotonListHit Hit;
+    //one frame of one event, either the hits or the dense pixels are filled//
+    struct Frame
+    {
+      uint64_t             eventid;
+      uint32_t             detector;
+      uint16_t             rows;
+      uint16_t             columns;
+      uint32_t             format;
+      std::vector<Hit>     hits;
+      std::vector<int16_t> pixels;
+    };
+
+  public:
+    PhotonListReader():_data(0)     {}
+    ~PhotonListReader()             {close();}
+
+    //open name.bin and load the index name.idx//
+    bool open(const std::string &name);
+    void close();
+    const std::vector<IndexEntry> &index()const {return _entries;}
+    //find the index entry of a frame, returns 0 when it is not in the file//
+    const IndexEntry *find(uint64_t eventid, uint32_t detector)const;
+    //read the frame the entry points to//
+    bool read(const IndexEntry&, Frame&);
+
+  public:
+    //add the frame to a dense image of rows*columns values//
+    static void rasterize(const Frame&, std::vector<float> &image);
+    //the sum of all hit energies, or of all pixels for a dense frame//
+    static double integrate(const Frame&);
+
+  private:
+    FILE                    *_data;
+    std::vector<IndexEntry>  _entries;   //sorted by eventid and detector
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
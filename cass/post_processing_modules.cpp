@@ -0,0 +1,309 @@
+#include <iostream>
+#include <algorithm>
+#include <QtCore/QSettings>
+#include <QtCore/QFileInfo>
+
+#include "post_processing_modules.h"
+#include "cass_event.h"
+#include "pnccd_event.h"
+
+
+void cass::PostProcessingParameter::load()
+{
+  //sync before loading//
+  sync();
+  _chain          = value("Chain").toStringList();
+  _parallel       = value("Parallel",false).toBool();
+  _flushInterval  = value("FlushInterval",-1).toInt();
+  _reloadInterval = value("ReloadInterval",100).toInt();
+}
+
+void cass::PostProcessingParameter::save()
+{
+  setValue("Chain",_chain);
+  setValue("Parallel",_parallel);
+  setValue("FlushInterval",_flushInterval);
+  setValue("ReloadInterval",_reloadInterval);
+}
+
+
+
+
+
+cass::PostProcessingModule::PostProcessingModule(const std::string &name, const std::string &stage)
+  :_name(name),
+   _stage(stage),
+   _written(0)
+{
+}
+
+
+
+
+
+cass::PostProcessingRegistry::factories_t &cass::PostProcessingRegistry::factories()
+{
+  //made when first used, so that the modules can register themselves during the static initialization//
+  static factories_t factories;
+  return factories;
+}
+
+void cass::PostProcessingRegistry::add(const std::string &name, factory_t factory)
+{
+  factories()[name] = factory;
+}
+
+cass::PostProcessingModule *cass::PostProcessingRegistry::create(const std::string &name, PostProcessor &pp)
+{
+  factories_t::const_iterator it(factories().find(name));
+  return it == factories().end() ? 0 : it->second(pp);
+}
+
+std::vector<std::string> cass::PostProcessingRegistry::names()
+{
+  std::vector<std::string> names;
+  for (factories_t::const_iterator it(factories().begin()); it != factories().end(); ++it)
+    names.push_back(it->first);
+  return names;
+}
+
+
+
+
+
+cass::PostProcessingChain::PostProcessingChain(PostProcessor &pp)
+  :_pp(pp),
+   _flushInterval(0),
+   _events(0),
+   _unchecked(0)
+{
+}
+
+cass::PostProcessingChain::~PostProcessingChain()
+{
+  for (size_t i=0; i<_modules.size(); ++i)
+    delete _modules[i];
+}
+
+void cass::PostProcessingChain::configure(const QStringList &commandLine)
+{
+  _commandLine = commandLine;
+  _param.load();
+  const QStringList &chain(_param._chain.isEmpty() ? commandLine : _param._chain);
+  //the modules that stay in the chain are taken over with their open files//
+  std::vector<PostProcessingModule*> previous(_modules);
+  _modules.clear();
+  _selectors.clear();
+  _outputs.clear();
+  QSettings settings("./cass.ini",QSettings::IniFormat);
+  settings.beginGroup("cass");
+  std::string names;
+  for (int i=0; i<chain.size(); ++i)
+  {
+    const QString name(chain[i].trimmed());
+    if (name.isEmpty())
+      continue;
+    PostProcessingModule *module(0);
+    for (size_t j=0; j<previous.size() && !module; ++j)
+    {
+      if (previous[j] && previous[j]->name() == name.toStdString())
+      {
+        module = previous[j];
+        previous[j] = 0;
+      }
+    }
+    if (!module)
+      module = PostProcessingRegistry::create(name.toStdString(),_pp);
+    if (!module)
+    {
+      std::cout << "PostProcessingChain: there is no module \""<<name.toStdString()<<"\""<<std::endl;
+      continue;
+    }
+    settings.beginGroup(name);
+    module->load(settings);
+    settings.endGroup();
+    _modules.push_back(module);
+    if (module->isSelector())
+      _selectors.push_back(module);
+    else
+      _outputs.push_back(module);
+    names += " " + module->name();
+  }
+  std::cout << "PostProcessingChain:"<<names<<(_param._parallel ? " (parallel)" : "")<<std::endl;
+  //the modules that were removed write what they have//
+  for (size_t j=0; j<previous.size(); ++j)
+  {
+    if (previous[j])
+    {
+      previous[j]->finish();
+      delete previous[j];
+    }
+  }
+  _running.resize(_outputs.size());
+  _start.resize(_outputs.size());
+  _end.resize(_outputs.size());
+  _flushInterval = _param._flushInterval;
+  if (_flushInterval < 0)
+    _flushInterval = chain.contains("Integrator") ? 10 : 0;
+  _modified = QFileInfo("./cass.ini").lastModified();
+  _events = 0;
+  _unchecked = 0;
+}
+
+bool cass::PostProcessingChain::settingsChanged()const
+{
+  return QFileInfo("./cass.ini").lastModified() != _modified;
+}
+
+void cass::PostProcessingChain::discard(Products &products)
+{
+  for (int i=0; i<2; ++i)
+  {
+    if (globalOptions.discardCCD[i])
+    {
+      products.remove(Products::pnCCDRaw,i);
+      products.remove(Products::pnCCDFrame,i);
+      products.remove(Products::pnCCDHits,i);
+    }
+  }
+}
+
+void cass::PostProcessingChain::require(Products &products)const
+{
+  Products required;
+  for (size_t i=0; i<_modules.size(); ++i)
+    _modules[i]->require(required);
+  discard(required);
+  products |= required;
+}
+
+void cass::PostProcessingChain::provide(CASSEvent &cassevent, const Products &needed)
+{
+  const size_t nbrCCDs(std::min<size_t>(cassevent.pnCCDEvent().detectors().size(),32));
+  for (size_t p=0; p<Products::NbrProducts; ++p)
+  {
+    const Products::Product product(static_cast<Products::Product>(p));
+    if (!needed.any(product))
+      continue;
+    const bool perCCD(product == Products::pnCCDRaw ||
+                      product == Products::pnCCDFrame ||
+                      product == Products::pnCCDHits);
+    const size_t nbrDetectors(perCCD ? nbrCCDs : 1);
+    for (size_t det=0; det<nbrDetectors; ++det)
+      if (needed.has(product,det))
+        cassevent.provide(product,det);
+  }
+}
+
+void cass::PostProcessingChain::run(size_t output, CASSEvent &cassevent, bool selected)
+{
+  PostProcessingModule &module(*_outputs[output]);
+  module.written(0);
+  _start[output] = Stage::now();
+  if (module.usesHDF5())
+  {
+#pragma omp critical(hdf5)
+    module.process(cassevent,selected);
+  }
+  else
+    module.process(cassevent,selected);
+  _end[output] = Stage::now();
+}
+
+void cass::PostProcessingChain::process(CASSEvent &cassevent)
+{
+  //look whether the chain was changed in cass.ini//
+  if (_param._reloadInterval > 0 && ++_unchecked >= _param._reloadInterval)
+  {
+    _unchecked = 0;
+    if (settingsChanged())
+    {
+      std::cout << "PostProcessingChain: cass.ini changed, making the chain again"<<std::endl;
+      configure(_commandLine);
+    }
+  }
+
+  //the selectors decide one after the other//
+  bool selected(true);
+  for (size_t i=0; i<_selectors.size() && selected; ++i)
+  {
+    StageTimer timer(_selectors[i]->stage());
+    selected = _selectors[i]->select(cassevent);
+  }
+
+  //the outputs that work on this event//
+  size_t nbrRunning(0);
+  Products needed;
+  for (size_t i=0; i<_outputs.size(); ++i)
+  {
+    _running[i] = selected || !_outputs[i]->onlySelected();
+    if (_running[i])
+    {
+      _outputs[i]->require(needed);
+      ++nbrRunning;
+    }
+  }
+  if (_param._parallel && nbrRunning > 1)
+  {
+    //the converters and analyzers can not be called from more than one thread, so everything//
+    //the outputs read is made before they start//
+    discard(needed);
+    provide(cassevent,needed);
+    const int nbrOutputs(static_cast<int>(_outputs.size()));
+#pragma omp parallel for schedule(dynamic,1)
+    for (int i=0; i<nbrOutputs; ++i)
+      if (_running[i])
+        run(i,cassevent,selected);
+  }
+  else
+  {
+    for (size_t i=0; i<_outputs.size(); ++i)
+      if (_running[i])
+        run(i,cassevent,selected);
+  }
+  //the stages are only recorded by this thread//
+  for (size_t i=0; i<_outputs.size(); ++i)
+    if (_running[i])
+      _outputs[i]->stage().record(_start[i],_end[i],_outputs[i]->written());
+
+  if (_flushInterval > 0 && ++_events >= _flushInterval)
+  {
+    _events = 0;
+    flush();
+  }
+}
+
+void cass::PostProcessingChain::flush()
+{
+  for (size_t i=0; i<_modules.size(); ++i)
+    _modules[i]->flush();
+}
+
+void cass::PostProcessingChain::finish()
+{
+  for (size_t i=0; i<_modules.size(); ++i)
+    _modules[i]->finish();
+}
+
+void cass::PostProcessingChain::checkpoint(Checkpoint &checkpoint)
+{
+  flush();
+  for (size_t i=0; i<_modules.size(); ++i)
+    _modules[i]->checkpoint(checkpoint);
+}
+
+void cass::PostProcessingChain::resume(const Checkpoint &checkpoint)
+{
+  for (size_t i=0; i<_modules.size(); ++i)
+    _modules[i]->resume(checkpoint);
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
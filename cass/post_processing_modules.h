@@ -0,0 +1,175 @@
+#ifndef CASS_POSTPROCESSINGMODULES_H
+#define CASS_POSTPROCESSINGMODULES_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <QtCore/QStringList>
+#include <QtCore/QDateTime>
+
+#include "cass.h"
+#include "parameter_backend.h"
+#include "instrumentation.h"
+#include "event_products.h"
+#include "checkpoint.h"
+
+class QSettings;
+
+namespace cass
+{
+  class CASSEvent;
+  class PostProcessor;
+
+  //the settings of the post processing chain. The modules have their own groups that are named//
+  //like the modules, e.g. [cass] EventTable\BlockSize=4096//
+  class CASSSHARED_EXPORT PostProcessingParameter : public cass::ParameterBackend
+  {
+  public:
+    PostProcessingParameter()   {beginGroup("PostProcessing");}
+    ~PostProcessingParameter()  {endGroup();}
+    void load();
+    void save();
+
+  public:
+    QStringList  _chain;             //the modules in the order they run, empty for the command line
+    bool         _parallel;          //whether the outputs run in parallel on the same event
+    int          _flushInterval;     //the events between two flushes of the outputs, 0 only at the
+                                     //end, -1 every 10 events when the Integrator runs
+    int          _reloadInterval;    //the events between two looks whether cass.ini changed, 0 never
+  };
+
+
+
+  //one step of the post processing, e.g. the hit finder or one of the outputs. A module is//
+  //either a selector, which decides whether the event is selected, or an output, which writes//
+  //the event. The selectors run one after the other before the outputs//
+  class CASSSHARED_EXPORT PostProcessingModule
+  {
+  public:
+    //stage is the name of the statistics of the time spent in the module//
+    PostProcessingModule(const std::string &name, const std::string &stage);
+    virtual ~PostProcessingModule()                         {}
+
+    const std::string &name()const                          {return _name;}
+    Stage &stage()                                          {return _stage;}
+
+    //read the settings, the group of the module is already entered//
+    virtual void load(QSettings&)                           {}
+    //add the products of the events that the module reads//
+    virtual void require(Products&)const                    {}
+    virtual bool isSelector()const                          {return false;}
+    //whether the event is selected, only called for the selectors//
+    virtual bool select(CASSEvent&)                         {return true;}
+    //whether the module only sees the selected events//
+    virtual bool onlySelected()const                        {return true;}
+    //work on the event, selected tells whether all selectors selected it//
+    virtual void process(CASSEvent&, bool /*selected*/)     {}
+    //write what is kept in memory to the files//
+    virtual void flush()                                    {}
+    //called once when the module is done, after the last event or when it is removed from the chain//
+    virtual void finish()                                   {flush();}
+    //add the state and the positions of the files to the checkpoint, the files are flushed. The//
+    //keys start with the name of the module//
+    virtual void checkpoint(Checkpoint&)                    {}
+    //continue the files and the state of the checkpoint, called before the first event//
+    virtual void resume(const Checkpoint&)                  {}
+    //whether the module writes hdf5 files, the hdf5 library is not thread safe so these never//
+    //run at the same time//
+    virtual bool usesHDF5()const                            {return false;}
+
+    //the bytes written for the current event, for the statistics//
+    uint64_t written()const                                 {return _written;}
+    void written(uint64_t bytes)                            {_written = bytes;}
+
+  private:
+    std::string _name;
+    Stage       _stage;
+    uint64_t    _written;
+  };
+
+
+
+  //the modules that can be put into the chain by their name//
+  class CASSSHARED_EXPORT PostProcessingRegistry
+  {
+  public:
+    typedef PostProcessingModule *(*factory_t)(PostProcessor&);
+
+    static void add(const std::string &name, factory_t);
+    //create the module, 0 when there is none with this name//
+    static PostProcessingModule *create(const std::string &name, PostProcessor&);
+    static std::vector<std::string> names();
+
+    //registers the module T, which has a constructor taking the PostProcessor, when it is made//
+    template <class T> struct Registrar
+    {
+      explicit Registrar(const char *name)                  {add(name,&make);}
+      static PostProcessingModule *make(PostProcessor &pp)  {return new T(pp);}
+    };
+
+  private:
+    typedef std::map<std::string,factory_t> factories_t;
+    static factories_t &factories();
+  };
+
+
+
+  //the modules of the post processing in the order they run. The chain is made from the settings//
+  //in cass.ini, or from the command line options when there is no chain in the settings. When//
+  //cass.ini changes while running the chain is made again, the modules that are still in it//
+  //keep their state. The products the new modules read are made when they ask for them//
+  class CASSSHARED_EXPORT PostProcessingChain
+  {
+  public:
+    explicit PostProcessingChain(PostProcessor&);
+    ~PostProcessingChain();
+
+    //(re)make the chain, the command line chain is used when the settings have none//
+    void configure(const QStringList &commandLine);
+    void require(Products&)const;
+    //run the selectors and then the outputs on the event//
+    void process(CASSEvent&);
+    void flush();
+    void finish();
+    void checkpoint(Checkpoint&);
+    void resume(const Checkpoint&);
+    bool empty()const                                       {return _modules.empty();}
+
+  private:
+    //whether cass.ini was modified since the chain was made//
+    bool settingsChanged()const;
+    //remove the products of the discarded pnCCDs//
+    static void discard(Products&);
+    //make the products of the detectors that the outputs will read//
+    void provide(CASSEvent&, const Products&);
+    void run(size_t output, CASSEvent&, bool selected);
+
+  private:
+    PostProcessor                      &_pp;
+    QStringList                         _commandLine;
+    PostProcessingParameter             _param;
+    std::vector<PostProcessingModule*>  _modules;
+    std::vector<PostProcessingModule*>  _selectors;
+    std::vector<PostProcessingModule*>  _outputs;
+    std::vector<char>                   _running;   //whether the outputs work on the current event
+    std::vector<uint64_t>               _start;     //when the outputs started and ended on the event
+    std::vector<uint64_t>               _end;
+    QDateTime                           _modified;  //of cass.ini when the chain was made
+    int                                 _flushInterval;
+    int                                 _events;    //since the last flush
+    int                                 _unchecked; //events since the last look at cass.ini
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -14,12 +14,14 @@
 #include "machine_event.h"
 #include "remi_event.h"
 #include "vmi_event.h"
+#include "shards.h"
 #include "pdsdata/xtc/Dgram.hh"
 #include <time.h>
 #include <hdf5.h>
 #include <string.h>
 #include <math.h>
 #include <stdlib.h>
+#include <algorithm>
 #include <QFileInfo>
 #include <QtGui/QLabel>
 #include <QtGui>
@@ -104,6 +106,30 @@ int16_t postProcess_filter(cass::CASSEvent &) {
 		return(result);
 }
 
+/*
+ *	The run part of the xtc filename, e.g. e12-r0034 for e12-r0034-s00-c00.xtc,
+ *	so that the run files collect the events of all streams and chunks
+ */
+static QString runName(cass::CASSEvent &cassevent) {
+  const char *filename = cassevent.filename() ? cassevent.filename() : "";
+  /* the same rule the shard merger uses to find the run files */
+  QString base = QString::fromStdString(cass::ShardMerger::runName(filename));
+  /* a shard writes its own run files, which are merged at the end */
+  return base + cass::globalOptions.outputSuffix;
+}
+
+/*
+ *	Whether the product of a pnCCD is there for the outputs. The discarded
+ *	CCDs are never made, the others are made now if nobody declared them.
+ */
+static bool frameThere(cass::CASSEvent &cassevent, int frame,
+		       cass::Products::Product product = cass::Products::pnCCDFrame) {
+  if(frame < 2 && cass::globalOptions.discardCCD[frame]){
+    return false;
+  }
+  return cassevent.provide(product,frame);
+}
+
 /*
  *	export current pnCCD frames to HDF5 file
  */
@@ -170,6 +196,10 @@ void postProcess_writeHDF5(cass::CASSEvent &cassevent) {
   // Save each pnCCD frame in the XTC data set
   int skipped = 0;
   for(int i=0; i<nframes; i++) {
+    if(!frameThere(cassevent,i)){
+      skipped++;
+      continue;
+    }
     int rows = cassevent.pnCCDEvent().detectors()[i].rows();
     int columns = cassevent.pnCCDEvent().detectors()[i].columns();
     if(!rows || !columns){
@@ -227,6 +257,10 @@ void postProcess_writeHDF5(cass::CASSEvent &cassevent) {
   for(int i=0; i<nframes; i++) {
     char fieldname[100]; 
     int ccd_index = i-skipped;
+    if(!frameThere(cassevent,i)){
+      skipped++;
+      continue;
+    }
     int rows = cassevent.pnCCDEvent().detectors()[i].rows();
     int columns = cassevent.pnCCDEvent().detectors()[i].columns();
     
@@ -260,13 +294,13 @@ void postProcess_writeHDF5(cass::CASSEvent &cassevent) {
     H5Dclose(dataset_id);
     
     sprintf(fieldname,"/pnCCD/pnCCD%i/row_binning",ccd_index);
-    int16_t rbin = cassevent.pnCCDEvent().detectors()[0].originalrows()/cassevent.pnCCDEvent().detectors()[i].rows();
+    int16_t rbin = cassevent.pnCCDEvent().detectors()[i].originalrows()/cassevent.pnCCDEvent().detectors()[i].rows();
     dataset_id = H5Dcreate1(hdf_fileID, fieldname, H5T_NATIVE_SHORT, dataspace_id, H5P_DEFAULT);
     H5Dwrite(dataset_id, H5T_NATIVE_SHORT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &rbin);
     H5Dclose(dataset_id);
     
     sprintf(fieldname,"/pnCCD/pnCCD%i/column_binning",ccd_index);
-    int16_t cbin = cassevent.pnCCDEvent().detectors()[0].originalcolumns()/cassevent.pnCCDEvent().detectors()[i].columns();
+    int16_t cbin = cassevent.pnCCDEvent().detectors()[i].originalcolumns()/cassevent.pnCCDEvent().detectors()[i].columns();
     dataset_id = H5Dcreate1(hdf_fileID, fieldname, H5T_NATIVE_SHORT, dataspace_id, H5P_DEFAULT);
     H5Dwrite(dataset_id, H5T_NATIVE_SHORT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &cbin);
     H5Dclose(dataset_id);
@@ -419,54 +453,65 @@ void cass::PostProcessor::postProcess(cass::CASSEvent &cassevent)
     appendWavelength(cassevent);
     return;
   }
-  Pds::Dgram *datagram = reinterpret_cast<Pds::Dgram*>(cassevent.datagrambuffer());
-  time_t eventTime = datagram->seq.clock().seconds();
-  if(cass::globalOptions.startTime.isValid()){
-    //    printf("Start Time %s\n",cass::globalOptions.startTime.toString().toAscii().constData());
-    //    printf("Event Time %s\n",QDateTime::fromTime_t(eventTime).toString().toAscii().constData());
-    //    printf("startTime valid\n");
-  }
-  if(cass::globalOptions.endTime.isValid()){
-    //    printf("%s\n",cass::globalOptions.endTime.toString().toAscii().constData());
-    //    printf("endTime valid\n");
-  }
-  if(cass::globalOptions.startTime.isValid() && 
-     QDateTime::fromTime_t(eventTime).time() < cass::globalOptions.startTime.time()){
-    //      printf("Skipping frame before startTime at postProcess\n");
-    return;
-  }
-  if(cass::globalOptions.endTime.isValid() && 
-     QDateTime::fromTime_t(eventTime).time() > cass::globalOptions.endTime.time()){
-    //    printf("Skipping frame after endTime at postProcess\n");
-    return;
-  }
-
-  if(cass::globalOptions.eventCounter % cass::globalOptions.skipPeriod != 0){
-    //      printf("Skipping frame not in the beggining of period\n");
-      return;
-  }
-
+  //the start and end time and the skip period are part of the event filter, the events//
+  //outside of them are not converted and do not get here//
   postProcess_printinfo(cassevent);
   
   calculateWavelength(cassevent);
 
-  if(cass::globalOptions.outputAllEvents || isGoodImage(cassevent)){	  
-    //	  integrateByQ(cassevent);
-    //	  extractEnergy(cassevent);
-    if(cass::globalOptions.justIntegrateImages == false){
-      postProcess_writeHDF5(cassevent);
-    }
-    if(cass::globalOptions.justIntegrateImages == true ||
-       cass::globalOptions.alsoIntegrateImages){
-      addToIntegratedImage(cassevent);
-      if(cass::globalOptions.eventCounter % 10 == 0){
-	finishProcessing();
-      }
-    }
-  }
+  /* the hit finder selects the events, then the outputs write them */
+  _chain.process(cassevent);
   printf("\n");
 }
 
+/*
+ *	The modules that the command line options ask for, in the order they
+ *	always ran. The event table also gets the events that are not selected,
+ *	the photon lists of -p are written instead of the HDF5 frames.
+ */
+QStringList cass::PostProcessor::commandLineChain()
+{
+  QStringList chain;
+  if(!globalOptions.outputAllEvents){
+    chain << "HitFinder";
+  }
+  if(globalOptions.writeEventTable){
+    chain << "EventTable";
+  }
+  if(globalOptions.integrateByQ){
+    chain << "RadialProfile";
+  }
+  if(globalOptions.writePhotonLists){
+    chain << "PhotonList";
+  }
+  if(globalOptions.skimXtc){
+    chain << "Skimmer";
+  }
+  if(globalOptions.justIntegrateImages == false &&
+     globalOptions.writePhotonLists == false){
+    chain << "HDF5Writer";
+  }
+  if(globalOptions.justIntegrateImages == true ||
+     globalOptions.alsoIntegrateImages){
+    chain << "Integrator";
+  }
+  return chain;
+}
+
+/*
+ *	The products of the events that the modules of the chain read, only these
+ *	are converted and analyzed. The frames of the discarded CCDs are not even
+ *	descrambled.
+ */
+void cass::PostProcessor::require(cass::Products &products)const
+{
+  products.add(Products::MachineData);
+  if(globalOptions.onlyAppendWavelength){
+    return;
+  }
+  _chain.require(products);
+}
+
 void cass::PostProcessor::appendWavelength(cass::CASSEvent &cassevent){
   double wavelength = calculateWavelength(cassevent);
 
@@ -509,6 +554,10 @@ void cass::PostProcessor::appendWavelength(cass::CASSEvent &cassevent){
 
 
 double cass::PostProcessor::calculatePhotonEnergyWithoutLossCorrection(cass::CASSEvent &cassevent){
+  return calculatePhotonEnergyWithoutLossCorrection(cassevent.MachineDataEvent());
+}
+
+double cass::PostProcessor::calculatePhotonEnergyWithoutLossCorrection(const cass::MachineData::MachineDataEvent &mde){
   /* 
      Calculate the resonant photon energy (without any energy loss corrections)
      Use the simple expression in e.g. Ayvazyan, V. et al. (2005). This expression requires
@@ -517,7 +566,7 @@ double cass::PostProcessor::calculatePhotonEnergyWithoutLossCorrection(cass::CAS
      3) undulator K (~3.5 at the LCLS)
   */
   
-  const double   ebEnergy = cassevent.MachineDataEvent().EbeamL3Energy();
+  const double   ebEnergy = mde.EbeamL3Energy();
   if(!ebEnergy){
     return NAN;
   }
@@ -531,38 +580,40 @@ double cass::PostProcessor::calculatePhotonEnergyWithoutLossCorrection(cass::CAS
   return resonantPhotonEnergy;
 }
 
-bool cass::PostProcessor::isGoodImage(cass::CASSEvent &cassevent){
+bool cass::HitFinderModule::select(cass::CASSEvent &cassevent){
   bool good = true;
   long long integral;
-  if(cass::globalOptions.useIntegrationThreshold){
-    integral = integrateImage(cassevent,cass::globalOptions.justIntegrateImagesThreshold);    
+  if(_useThreshold){
+    integral = integrateImage(cassevent,_threshold);
   }else{
     integral = integrateImage(cassevent);
   }
   if(integral <= 0){
     return false;
   }
-  if(cass::globalOptions.useIntegrationThreshold && integral <
-     cass::globalOptions.useIntegrationThreshold*3){
+  if(_useThreshold && integral < _useThreshold*3){
     /* don't accept image with just a couple of high pixels*/
     return false;
   }
 
   double stdDev = stdDevImage(cassevent,integral);
-  if(stdDev < sqrt(1000)){
+  if(stdDev < _minStdDev){
     return false;
   }
-  if(cass::globalOptions.outputHitsToFile && good){
+  if(!_hitsFile.isEmpty() && good){
     Pds::Dgram *datagram = reinterpret_cast<Pds::Dgram*>(cassevent.datagrambuffer());
     long long int bunchId = datagram->seq.clock().seconds();
     bunchId = (bunchId<<32) + static_cast<uint32_t>(datagram->seq.stamp().fiducials()<<8);
-    FILE * fp = fopen(cass::globalOptions.hitsOutputFile.toAscii().constData(),"a");
-    fprintf(fp,"%llu\n",bunchId);
+    FILE * fp = fopen(_hitsFile.toAscii().constData(),"a");
+    if(fp){
+      fprintf(fp,"%llu\n",bunchId);
+      fclose(fp);
+    }
   }
   return good;
 }
 
-long long cass::PostProcessor::integrateImage(cass::CASSEvent &cassevent, float threshold){
+long long cass::HitFinderModule::integrateImage(cass::CASSEvent &cassevent, float threshold){
   Pds::Dgram *datagram = reinterpret_cast<Pds::Dgram*>(cassevent.datagrambuffer());
   time_t eventTime = datagram->seq.clock().seconds();
   //		time_t eventTimeNs = datagram->seq.clock().nanoseconds();
@@ -578,7 +629,7 @@ long long cass::PostProcessor::integrateImage(cass::CASSEvent &cassevent, float
   long long ret = 0;
   int nframes = cassevent.pnCCDEvent().detectors().size();
   for(int frame=0; frame<nframes; frame++) {
-    if(cass::globalOptions.discardCCD[frame]){
+    if(!frameThere(cassevent,frame)){
       continue;
     }
     int rows = cassevent.pnCCDEvent().detectors()[frame].rows();
@@ -604,7 +655,7 @@ long long cass::PostProcessor::integrateImage(cass::CASSEvent &cassevent, float
 }
 
 
-double cass::PostProcessor::stdDevImage(cass::CASSEvent &cassevent,long long integral){
+double cass::HitFinderModule::stdDevImage(cass::CASSEvent &cassevent,long long integral){
   Pds::Dgram *datagram = reinterpret_cast<Pds::Dgram*>(cassevent.datagrambuffer());
   time_t eventTime = datagram->seq.clock().seconds();
   //		time_t eventTimeNs = datagram->seq.clock().nanoseconds();
@@ -621,7 +672,7 @@ double cass::PostProcessor::stdDevImage(cass::CASSEvent &cassevent,long long int
   int nframes = cassevent.pnCCDEvent().detectors().size();
   int totalSize = 0;
   for(int frame=0; frame<nframes; frame++) {
-    if(cass::globalOptions.discardCCD[frame]){
+    if(!frameThere(cassevent,frame)){
       continue;
     }
     int rows = cassevent.pnCCDEvent().detectors()[frame].rows();
@@ -637,7 +688,7 @@ double cass::PostProcessor::stdDevImage(cass::CASSEvent &cassevent,long long int
   }
   double average = (double)integral/totalSize;
   for(int frame=0; frame<nframes; frame++) {
-    if(cass::globalOptions.discardCCD[frame]){
+    if(!frameThere(cassevent,frame)){
       continue;
     }
     int rows = cassevent.pnCCDEvent().detectors()[frame].rows();
@@ -663,85 +714,383 @@ double cass::PostProcessor::stdDevImage(cass::CASSEvent &cassevent,long long int
   return ret; 
 }
 
-void cass::PostProcessor::integrateByQ(cass::CASSEvent &cassevent)
+void cass::RadialProfileModule::process(cass::CASSEvent &cassevent, bool)
 {
   int nframes = cassevent.pnCCDEvent().detectors().size();
   if (nframes == 0) {
-    printf("No pnCCD frames in this event:  skipping HDF5 write step...\n");
+    printf("No pnCCD frames in this event:  skipping integration by q...\n");
     return;
   }
-  printf("Processing %s\n",cassevent.filename());
+  double wavelength = PostProcessor::calculateWavelength(cassevent);
+  char outfile[1024];
+  sprintf(outfile,"%s_I_by_Q.bin",runName(cassevent).toAscii().constData());
+  /* a run file that was started after the checkpoint is written anew */
+  if(_files.insert(outfile).second && _resumed){
+    remove(outfile);
+  }
+  if(!_radialProfiles.open(outfile)){
+    return;
+  }
+  /* make sure there is an integrator for every frame */
+  while((int)_integrators.size() < nframes){
+    _integrators.push_back(new AzimuthalIntegrator(_integrators.size()));
+  }
   for(int frame=0; frame<nframes; frame++) {
+    if(!frameThere(cassevent,frame)){
+      continue;
+    }
     int rows = cassevent.pnCCDEvent().detectors()[frame].rows();
     int columns = cassevent.pnCCDEvent().detectors()[frame].columns();
-    int16_t *data = &cassevent.pnCCDEvent().detectors()[frame].correctedFrame()[0];
-    int max_q = (int)(ceil(sqrt(rows/2.0*rows/2.0+columns/2.0*columns/2.0)));
-    int nbins = max_q;
-    float * bins = new float[nbins];
-    float * bin_distance = new float[nbins];
-    int * bin_members = new int[nbins];
-
-    for(int i = 0;i<nbins;i++){
-      bin_members[i] = 0;
-      bins[i] = 0;
-      bin_distance[i] = (float)max_q*i/nbins;
+    if(!rows || !columns || cassevent.pnCCDEvent().detectors()[frame].correctedFrame().empty()){
+      continue;
     }
-    int i = 0;
-    for(int x = 0;x<columns;x++){
-      for(int y = 0;y<rows;y++){
-	float rel_x = x-columns/2.0;
-	float rel_y = y-rows/2.0;
-	int bin = (int)(nbins*sqrt(rel_x*rel_x+rel_y*rel_y)/max_q);
-	bin_members[bin]++;
-	bins[bin] += data[i];
-	i++;
-      }
+    /* the lookup table is only recalculated when the geometry changes */
+    if(!_integrators[frame]->updateGeometry(rows,columns,wavelength)){
+      continue;
     }
-    for(int i = 0;i<nbins;i++){
-      if(bin_members[i]){
-	bins[i] /= bin_members[i];
-      }
-    }    
-    appendIntegratedByQ(cassevent,bin_distance,bins,nbins,frame);
+    _integrators[frame]->integrate(&cassevent.pnCCDEvent().detectors()[frame].correctedFrame()[0]);
+    _radialProfiles.append(cassevent.id(),frame,*_integrators[frame]);
   }
 }
 
-void cass::PostProcessor::appendIntegratedByQ(cass::CASSEvent &cassevent,float * x, float * y,int n, int frame){
-  Pds::Dgram *datagram = reinterpret_cast<Pds::Dgram*>(cassevent.datagrambuffer());
-  time_t eventTime = datagram->seq.clock().seconds();
-  int32_t eventFiducial = datagram->seq.stamp().fiducials();
-  char outfile[1024];
-  sprintf(outfile,"%s_I_by_Q.csv",QFileInfo(cassevent.filename()).baseName().toAscii().constData());
-  FILE * fp = fopen(outfile,"a");
-  for(int i = 0;i<n;i++){
-    fprintf(fp,"%u,%d,%d,%f,%f\n",(unsigned int)eventTime,eventFiducial,frame,x[i],y[i]);
-  }  
-  fclose(fp);
+void cass::PhotonListModule::process(cass::CASSEvent &cassevent, bool)
+{
+  int nframes = cassevent.pnCCDEvent().detectors().size();
+  if (nframes == 0) {
+    return;
+  }
+  std::string name = runName(cassevent).toStdString() + "_photons";
+  /* a run file that was started after the checkpoint is written anew */
+  if(_files.insert(name).second && _resumed){
+    remove((name + ".bin").c_str());
+    remove((name + ".idx").c_str());
+  }
+  if(!_photonLists.open(name)){
+    return;
+  }
+  for(int frame=0; frame<nframes; frame++) {
+    if(!frameThere(cassevent,frame,cass::Products::pnCCDHits)){
+      continue;
+    }
+    _photonLists.append(cassevent.id(),frame,cassevent.pnCCDEvent().detectors()[frame]);
+  }
 }
 
-void cass::PostProcessor::extractEnergy(cass::CASSEvent &cassevent){
-  //  int nframes = cassevent.pnCCDEvent().detectors().size();
-  char outfile[1024];
-  sprintf(outfile,"%s_energy.csv",QFileInfo(cassevent.filename()).baseName().toAscii().constData());
-  //sprintf(outfile,"dummy_energy.csv");
+/*
+ *	The columns of the event table, they have to be filled in the same order
+ *	by process
+ */
+void cass::EventTableModule::createColumns(size_t nbrFrames){
+  _eventTable.addColumn<uint64_t>("casseventID");
+  _eventTable.addColumn<uint32_t>("machineTime");
+  _eventTable.addColumn<int32_t>("fiducial");
+  _eventTable.addColumn<int32_t>("selected");
+  _eventTable.addColumn<double>("f_11_ENRC");
+  _eventTable.addColumn<double>("f_12_ENRC");
+  _eventTable.addColumn<double>("f_21_ENRC");
+  _eventTable.addColumn<double>("f_22_ENRC");
+  _eventTable.addColumn<double>("EbeamCharge");
+  _eventTable.addColumn<double>("EbeamL3Energy");
+  _eventTable.addColumn<double>("EbeamLTUPosX");
+  _eventTable.addColumn<double>("EbeamLTUPosY");
+  _eventTable.addColumn<double>("EbeamLTUAngX");
+  _eventTable.addColumn<double>("EbeamLTUAngY");
+  _eventTable.addColumn<double>("EbeamPkCurrBC2");
+  _eventTable.addColumn<double>("FitTime1");
+  _eventTable.addColumn<double>("FitTime2");
+  _eventTable.addColumn<double>("Charge1");
+  _eventTable.addColumn<double>("Charge2");
+  _eventTable.addColumn<double>("energy");
+  _eventTable.addColumn<double>("photon_energy_eV");
+  _eventTable.addColumn<double>("photon_energy_eV_no_energy_loss_correction");
+  _eventTable.addColumn<double>("photon_wavelength_nm");
+  /* the hit metrics of the pnCCDs that are in the first event of the run */
+  _nbrTableFrames = nbrFrames;
+  for(size_t i=0; i<_nbrTableFrames; i++){
+    char name[100];
+    sprintf(name,"pnCCD%i_integral",(int)i);
+    _eventTable.addColumn<int32_t>(name);
+    sprintf(name,"pnCCD%i_photonHits",(int)i);
+    _eventTable.addColumn<uint32_t>(name);
+  }
+  for(int i=0; i<_eventTableParam._epicsPVs.size(); i++){
+    _eventTable.addColumn<double>(_eventTableParam._epicsPVs[i].toStdString());
+  }
+  _epicsIndex.clear();
+}
 
-  FILE * fp = fopen(outfile,"a");
+void cass::EventTableModule::process(cass::CASSEvent &cassevent, bool selected){
+  /* one table for each run, events without filename belong to the current run */
+  if(cassevent.filename() && cassevent.filename()[0] != 0){
+    std::string outfile = runName(cassevent).toStdString() + "_table.h5";
+    if(outfile != _eventTable.filename()){
+      if(!_eventTable.open(outfile,_eventTableParam._blockSize,_eventTableParam._compression)){
+        return;
+      }
+      createColumns(cassevent.pnCCDEvent().detectors().size());
+    }
+  }
+  if(!_eventTable.isOpen()){
+    return;
+  }
   Pds::Dgram *datagram = reinterpret_cast<Pds::Dgram*>(cassevent.datagrambuffer());
-  printf("processing %d\n",datagram->seq.stamp().fiducials());
-
-  time_t eventTime = datagram->seq.clock().seconds();
-  int32_t eventFiducial = datagram->seq.stamp().fiducials();
-  double f11 = cassevent.MachineDataEvent().f_11_ENRC();
-  double f12 = cassevent.MachineDataEvent().f_12_ENRC();
-  double f21 = cassevent.MachineDataEvent().f_21_ENRC();
-  double f22 = cassevent.MachineDataEvent().f_22_ENRC();
-  fprintf(fp,"%u %d %f %f %f %f\n",(unsigned int)eventTime,eventFiducial,f11,f12,f21,f22);
-  fclose(fp);
+  const cass::MachineData::MachineDataEvent &mde = cassevent.MachineDataEvent();
+  const double photonEnergy = PostProcessor::calculatePhotonEnergy(cassevent);
+  size_t col = 0;
+  _eventTable.set<uint64_t>(col++,cassevent.id());
+  _eventTable.set<uint32_t>(col++,datagram->seq.clock().seconds());
+  _eventTable.set<int32_t>(col++,datagram->seq.stamp().fiducials());
+  _eventTable.set<int32_t>(col++,selected);
+  _eventTable.set<double>(col++,mde.f_11_ENRC());
+  _eventTable.set<double>(col++,mde.f_12_ENRC());
+  _eventTable.set<double>(col++,mde.f_21_ENRC());
+  _eventTable.set<double>(col++,mde.f_22_ENRC());
+  _eventTable.set<double>(col++,mde.EbeamCharge());
+  _eventTable.set<double>(col++,mde.EbeamL3Energy());
+  _eventTable.set<double>(col++,mde.EbeamLTUPosX());
+  _eventTable.set<double>(col++,mde.EbeamLTUPosY());
+  _eventTable.set<double>(col++,mde.EbeamLTUAngX());
+  _eventTable.set<double>(col++,mde.EbeamLTUAngY());
+  _eventTable.set<double>(col++,mde.EbeamPkCurrBC2());
+  _eventTable.set<double>(col++,mde.FitTime1());
+  _eventTable.set<double>(col++,mde.FitTime2());
+  _eventTable.set<double>(col++,mde.Charge1());
+  _eventTable.set<double>(col++,mde.Charge2());
+  _eventTable.set<double>(col++,mde.energy());
+  _eventTable.set<double>(col++,photonEnergy);
+  _eventTable.set<double>(col++,PostProcessor::calculatePhotonEnergyWithoutLossCorrection(cassevent));
+  _eventTable.set<double>(col++,photonEnergy ? 1239.8/photonEnergy : -1);
+  const size_t nframes = cassevent.pnCCDEvent().detectors().size();
+  for(size_t i=0; i<_nbrTableFrames; i++){
+    const bool there = i < nframes && frameThere(cassevent,i,cass::Products::pnCCDHits);
+    _eventTable.set<int32_t>(col++,there ? cassevent.pnCCDEvent().detectors()[i].integral() : 0);
+    _eventTable.set<uint32_t>(col++,there ? cassevent.pnCCDEvent().detectors()[i].nonrecombined().size() : 0);
+  }
+  const cass::MachineData::EpicsSnapshot &epics = mde.EpicsData();
+  if(_epicsIndex.size() != static_cast<size_t>(_eventTableParam._epicsPVs.size()) ||
+     _epicsLayout != epics.layout()){
+    _epicsIndex.resize(_eventTableParam._epicsPVs.size());
+    for(size_t i=0; i<_epicsIndex.size(); i++){
+      _epicsIndex[i] = epics.index(_eventTableParam._epicsPVs[i].toStdString());
+    }
+    _epicsLayout = epics.layout();
+  }
+  for(size_t i=0; i<_epicsIndex.size(); i++){
+    /* pvs that are not in this event are marked as not a number */
+    const size_t idx = _epicsIndex[i];
+    _eventTable.set<double>(col++,idx < epics.size() ? epics.value(idx) : NAN);
+  }
+  _eventTable.commitRow();
 }
 					      
 
 namespace cass{
-  void PostProcessor::addToIntegratedImage(CASSEvent &cassevent){
+  /* the modules that can be put into the chain */
+  namespace{
+    PostProcessingRegistry::Registrar<HitFinderModule> hitFinder("HitFinder");
+    PostProcessingRegistry::Registrar<EventTableModule> eventTable("EventTable");
+    PostProcessingRegistry::Registrar<RadialProfileModule> radialProfile("RadialProfile");
+    PostProcessingRegistry::Registrar<PhotonListModule> photonList("PhotonList");
+    PostProcessingRegistry::Registrar<SkimmerModule> skimmer("Skimmer");
+    PostProcessingRegistry::Registrar<HDF5WriterModule> hdf5Writer("HDF5Writer");
+    PostProcessingRegistry::Registrar<IntegratorModule> integrator("Integrator");
+  }
+
+  HitFinderModule::HitFinderModule(PostProcessor&)
+    :PostProcessingModule("HitFinder","hitfinding"),
+     _useThreshold(false),
+     _threshold(0),
+     _minStdDev(sqrt(1000)),
+     _hitsFile()
+  {
+  }
+
+  /* the command line options are the defaults of the settings */
+  void HitFinderModule::load(QSettings &settings){
+    _useThreshold = settings.value("UseThreshold",globalOptions.useIntegrationThreshold).toBool();
+    _threshold = settings.value("Threshold",globalOptions.justIntegrateImagesThreshold).toDouble();
+    _minStdDev = settings.value("MinStdDev",sqrt(1000)).toDouble();
+    _hitsFile = settings.value("HitsFile",globalOptions.outputHitsToFile ?
+			       globalOptions.hitsOutputFile : QString()).toString();
+    if(!_hitsFile.isEmpty()){
+      _hitsFile += globalOptions.outputSuffix;
+    }
+  }
+
+  /* the hits file is appended to, so it only needs its size */
+  void HitFinderModule::checkpoint(Checkpoint &checkpoint){
+    if(!_hitsFile.isEmpty()){
+      checkpoint.setFile("HitFinder.hits",_hitsFile.toStdString());
+    }
+  }
+
+  void HitFinderModule::resume(const Checkpoint &checkpoint){
+    if(!_hitsFile.isEmpty()){
+      checkpoint.restoreFile("HitFinder.hits");
+    }
+  }
+
+  void HitFinderModule::require(Products &products)const{
+    products.add(Products::pnCCDFrame);
+  }
+
+  EventTableModule::EventTableModule(PostProcessor&)
+    :PostProcessingModule("EventTable","output.eventtable"),
+     _nbrTableFrames(0),
+     _epicsLayout(0)
+  {
+  }
+
+  /* the settings are the ones of the EventTable group of cass.ini, which is
+     the group of this module */
+  void EventTableModule::load(QSettings&){
+    _eventTableParam.load();
+    _epicsIndex.clear();
+  }
+
+  /* the rows of the table that were written are kept, the columns find their
+     datasets in the file again */
+  void EventTableModule::checkpoint(Checkpoint &checkpoint){
+    if(_eventTable.isOpen()){
+      checkpoint.set("EventTable.file",_eventTable.filename());
+      checkpoint.set("EventTable.rows",_eventTable.nbrRows());
+      checkpoint.set("EventTable.frames",_nbrTableFrames);
+    }
+  }
+
+  void EventTableModule::resume(const Checkpoint &checkpoint){
+    if(!checkpoint.has("EventTable.file")){
+      return;
+    }
+    if(_eventTable.reopen(checkpoint.value("EventTable.file"),checkpoint.number("EventTable.rows"),
+			  _eventTableParam._blockSize,_eventTableParam._compression)){
+      createColumns(checkpoint.number("EventTable.frames"));
+    }
+  }
+
+  void EventTableModule::require(Products &products)const{
+    products.add(Products::MachineData);
+    products.add(Products::pnCCDHits);
+  }
+
+  RadialProfileModule::RadialProfileModule(PostProcessor&)
+    :PostProcessingModule("RadialProfile","output.radialprofiles"),
+     _resumed(false)
+  {
+  }
+
+  RadialProfileModule::~RadialProfileModule(){
+    for(size_t i = 0;i<_integrators.size();i++){
+      delete _integrators[i];
+    }
+  }
+
+  void RadialProfileModule::checkpoint(Checkpoint &checkpoint){
+    checkpoint.setFiles("RadialProfile.file",_files);
+  }
+
+  void RadialProfileModule::resume(const Checkpoint &checkpoint){
+    _files = checkpoint.restoreFiles("RadialProfile.file");
+    _resumed = true;
+  }
+
+  void RadialProfileModule::require(Products &products)const{
+    products.add(Products::pnCCDFrame);
+  }
+
+  PhotonListModule::PhotonListModule(PostProcessor&)
+    :PostProcessingModule("PhotonList","output.photonlists"),
+     _resumed(false)
+  {
+  }
+
+  void PhotonListModule::checkpoint(Checkpoint &checkpoint){
+    std::set<std::string> bin, idx;
+    for(std::set<std::string>::const_iterator it = _files.begin(); it != _files.end(); ++it){
+      bin.insert(*it + ".bin");
+      idx.insert(*it + ".idx");
+    }
+    checkpoint.setFiles("PhotonList.bin",bin);
+    checkpoint.setFiles("PhotonList.idx",idx);
+  }
+
+  void PhotonListModule::resume(const Checkpoint &checkpoint){
+    std::set<std::string> bin = checkpoint.restoreFiles("PhotonList.bin");
+    checkpoint.restoreFiles("PhotonList.idx");
+    for(std::set<std::string>::const_iterator it = bin.begin(); it != bin.end(); ++it){
+      _files.insert(it->substr(0,it->size()-4));
+    }
+    _resumed = true;
+  }
+
+  void PhotonListModule::require(Products &products)const{
+    products.add(Products::pnCCDHits);
+  }
+
+  SkimmerModule::SkimmerModule(PostProcessor&)
+    :PostProcessingModule("Skimmer","output.skim"),
+     _suffix("_skim")
+  {
+  }
+
+  void SkimmerModule::load(QSettings &settings){
+    _suffix = settings.value("Suffix","_skim").toString().toStdString();
+  }
+
+  /* the configuration of the run goes into every skimmed file, the events
+     only when they are selected */
+  void SkimmerModule::process(CASSEvent &cassevent, bool selected){
+    Pds::Dgram *datagram = reinterpret_cast<Pds::Dgram*>(cassevent.datagrambuffer());
+    if(datagram->seq.service() == Pds::TransitionId::Configure){
+      _skimmer.configure(runName(cassevent).toStdString() + _suffix,*datagram);
+    }else if(selected && datagram->seq.service() == Pds::TransitionId::L1Accept){
+      _skimmer.append(runName(cassevent).toStdString() + _suffix,cassevent.id(),*datagram);
+      written(sizeof(*datagram)+datagram->xtc.sizeofPayload());
+    }
+  }
+
+  /* the skimmed file of the current run is continued, the ones of the next
+     runs are created anyway */
+  void SkimmerModule::checkpoint(Checkpoint &checkpoint){
+    if(!_skimmer.name().empty()){
+      checkpoint.setFile("Skimmer.xtc",_skimmer.name() + ".xtc");
+      checkpoint.setFile("Skimmer.idx",_skimmer.name() + ".idx");
+    }
+  }
+
+  void SkimmerModule::resume(const Checkpoint &checkpoint){
+    std::string xtc = checkpoint.restoreFile("Skimmer.xtc");
+    checkpoint.restoreFile("Skimmer.idx");
+    if(!xtc.empty()){
+      _skimmer.resume(xtc.substr(0,xtc.size()-4));
+    }
+  }
+
+  HDF5WriterModule::HDF5WriterModule(PostProcessor&)
+    :PostProcessingModule("HDF5Writer","output.hdf5")
+  {
+  }
+
+  void HDF5WriterModule::require(Products &products)const{
+    products.add(Products::pnCCDFrame);
+  }
+
+  void HDF5WriterModule::process(CASSEvent &cassevent, bool){
+    postProcess_writeHDF5(cassevent);
+  }
+
+  IntegratorModule::IntegratorModule(PostProcessor &pp)
+    :PostProcessingModule("Integrator","output.integratedimage"),
+     integratedImage(pp.integratedImage),
+     firstIntegratedImage(true)
+  {
+  }
+
+  void IntegratorModule::require(Products &products)const{
+    products.add(Products::pnCCDFrame);
+  }
+
+  void IntegratorModule::process(CASSEvent &cassevent, bool){
     int nframes = cassevent.pnCCDEvent().detectors().size();
     if(nframes == 0){
       /* this is not really a pnCCD event */
@@ -750,15 +1099,48 @@ namespace cass{
     if(firstIntegratedImage){
       firstIntegratedImage = false;
       integratedImage = HDRImage(cassevent);
-    }else{
-      integratedImage.addToImage(cassevent);
     }
+    integratedImage.addToImage(cassevent);
   }
 
-  PostProcessor::PostProcessor()   
+  /* a shard keeps the sums of its events, the merge adds them up and writes
+     the integrated image of all shards */
+  void IntegratorModule::finish(){
+    if(globalOptions.outputSuffix.isEmpty() || firstIntegratedImage){
+      return;
+    }
+    ImageSums sums;
+    integratedImage.sums(sums);
+    sums.write("integrated" + globalOptions.outputSuffix.toStdString() + ".sum");
+  }
+
+  void IntegratorModule::checkpoint(Checkpoint &checkpoint){
+    if(firstIntegratedImage){
+      return;
+    }
+    ImageSums sums;
+    integratedImage.sums(sums);
+    std::string filename = checkpoint.dataFile("integrated.sum");
+    if(sums.write(filename)){
+      checkpoint.set("Integrator.sums",filename);
+    }
+  }
+
+  void IntegratorModule::resume(const Checkpoint &checkpoint){
+    ImageSums sums;
+    if(checkpoint.has("Integrator.sums") && sums.read(checkpoint.value("Integrator.sums"))){
+      integratedImage.restore(sums);
+      firstIntegratedImage = false;
+    }
+  }
+
+  PostProcessor::PostProcessor()
+    :_chain(*this)
   {
     printf("Post_processor creator called here\n");
-    firstIntegratedImage = true;
+    if(!globalOptions.onlyAppendWavelength){
+      _chain.configure(commandLineChain());
+    }
   }
 
   HDRImage::HDRImage(){
@@ -798,6 +1180,9 @@ namespace cass{
       printf("Number of frames doesn't match!\n");
     }
     for(int i=0; i<nframes; i++) {
+	if(!frameThere(cassevent,i)){
+	  continue;
+	}
 	int rows = cassevent.pnCCDEvent().detectors()[i].rows();
 	int columns = cassevent.pnCCDEvent().detectors()[i].columns();
 	if(rows != m_rows[i]){
@@ -832,6 +1217,36 @@ namespace cass{
     }
 
   }
+  void HDRImage::sums(ImageSums &sums)const{
+    sums.frames().resize(m_nframes);
+    for(int i=0; i<m_nframes; i++) {
+      ImageSums::Frame &frame = sums.frames()[i];
+      frame.rows = m_rows[i];
+      frame.columns = m_columns[i];
+      int size = m_rows[i]*m_columns[i];
+      frame.sum.assign(m_data[i],m_data[i]+size);
+      frame.count.assign(m_nImagesAdded[i],m_nImagesAdded[i]+size);
+    }
+  }
+
+  void HDRImage::restore(const ImageSums &sums){
+    m_nframes = sums.frames().size();
+    m_rows.clear();
+    m_columns.clear();
+    m_data.clear();
+    m_nImagesAdded.clear();
+    for(int i=0; i<m_nframes; i++) {
+      const ImageSums::Frame &frame = sums.frames()[i];
+      int size = frame.rows*frame.columns;
+      m_rows.append(frame.rows);
+      m_columns.append(frame.columns);
+      m_data.append(new double[size ? size : 1]);
+      m_nImagesAdded.append(new int[size ? size : 1]);
+      std::copy(frame.sum.begin(),frame.sum.end(),m_data.last());
+      std::copy(frame.count.begin(),frame.count.end(),m_nImagesAdded.last());
+    }
+  }
+
   void HDRImage::outputImage(const char * filename){
     hid_t 	hdf_fileID;
     hid_t 	dataspace_id;
@@ -1098,13 +1513,17 @@ namespace cass{
    It uses Rick K. code at psexport:/reg/neh/home/rkirian/ana2 
 */
 double cass::PostProcessor::calculatePhotonEnergy(cass::CASSEvent &cassevent){
+  return calculatePhotonEnergy(cassevent.MachineDataEvent());
+}
+
+double cass::PostProcessor::calculatePhotonEnergy(const cass::MachineData::MachineDataEvent &mde){
   /*
    * Get electron beam parameters from beamline data
    */     
 
-  //double fEbeamCharge = cassevent.MachineDataEvent().EbeamCharge();    // in nC
-  double fEbeamL3Energy = cassevent.MachineDataEvent().EbeamL3Energy();  // in MeV 
-  double fEbeamPkCurrBC2 = cassevent.MachineDataEvent().EbeamPkCurrBC2(); // in Amps
+  //double fEbeamCharge = mde.EbeamCharge();    // in nC
+  double fEbeamL3Energy = mde.EbeamL3Energy();  // in MeV 
+  double fEbeamPkCurrBC2 = mde.EbeamPkCurrBC2(); // in Amps
 
   /*
    * calculate the resonant photon energy
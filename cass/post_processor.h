@@ -3,7 +3,16 @@
 
 #include "cass.h"
 #include "cass_event.h"
+#include "azimuthal_integrator.h"
+#include "event_table.h"
+#include "photon_list.h"
+#include "xtc_skimmer.h"
+#include "instrumentation.h"
+#include "post_processing_modules.h"
+#include "shards.h"
 #include <stdio.h>
+#include <vector>
+#include <set>
 #include <QList>
 #include <QFileInfo>
 #include <QtGui/QLabel>
@@ -11,6 +20,10 @@
 namespace cass
 {
   class CASSEvent;
+  namespace MachineData
+  {
+    class MachineDataEvent;
+  }
 
 
   class HDRImage
@@ -33,6 +46,10 @@ namespace cass
     ~HDRImage();
     void addToImage(CASSEvent &cassevent); 
       void outputImage(const char * filename);
+      /* the sums and counts of the pixels, which the shards of a run can add up */
+      void sums(ImageSums &sums)const;
+      /* continue with the sums and counts of a checkpoint */
+      void restore(const ImageSums &sums);
       QImage toQImage(int frame,double maxModifier,double minModifier,int log);
   private:
       HDRImage::sp_rgb colormap_rgb_from_value(double value, int colormap);
@@ -46,6 +63,138 @@ namespace cass
     QList<int*> m_nImagesAdded;
   };
 
+  /*
+   *	The modules of the post processing, they are put into the chain by the
+   *	names they are registered with, see post_processing_modules.h
+   */
+
+  /* selects the events with enough signal on the pnCCDs */
+  class HitFinderModule : public PostProcessingModule
+  {
+  public:
+    HitFinderModule(PostProcessor&);
+    void load(QSettings&);
+    void require(Products&)const;
+    bool isSelector()const {return true;}
+    bool select(CASSEvent&);
+    void checkpoint(Checkpoint&);
+    void resume(const Checkpoint&);
+  private:
+    long long integrateImage(cass::CASSEvent &cassevent,float threshold = 0);
+    double stdDevImage(cass::CASSEvent &cassevent,long long integral);
+    bool _useThreshold;
+    float _threshold;
+    double _minStdDev;
+    /* the file the bunch ids of the hits are appended to, empty for none */
+    QString _hitsFile;
+  };
+
+  /* the per run table of the scalar values of each event */
+  class EventTableModule : public PostProcessingModule
+  {
+  public:
+    EventTableModule(PostProcessor&);
+    void load(QSettings&);
+    void require(Products&)const;
+    bool onlySelected()const {return false;}
+    void process(CASSEvent&, bool selected);
+    void flush() {_eventTable.flush();}
+    bool usesHDF5()const {return true;}
+    void checkpoint(Checkpoint&);
+    void resume(const Checkpoint&);
+  private:
+    void createColumns(size_t nbrFrames);
+    EventTableParameter _eventTableParam;
+    EventTable _eventTable;
+    size_t _nbrTableFrames;
+    /* where the epics pvs of the table are in the epics snapshots of the events, they are
+       looked up by name only when the epics configuration changes */
+    std::vector<size_t> _epicsIndex;
+    uint32_t _epicsLayout;
+  };
+
+  /* the azimuthally integrated pnCCD frames */
+  class RadialProfileModule : public PostProcessingModule
+  {
+  public:
+    RadialProfileModule(PostProcessor&);
+    ~RadialProfileModule();
+    void require(Products&)const;
+    void process(CASSEvent&, bool selected);
+    void flush() {_radialProfiles.flush();}
+    void finish() {_radialProfiles.close();}
+    void checkpoint(Checkpoint&);
+    void resume(const Checkpoint&);
+  private:
+    /* one azimuthal integrator for each pnCCD and the run file they write to */
+    std::vector<AzimuthalIntegrator*> _integrators;
+    RadialProfileFile _radialProfiles;
+    /* the run files that were written, after resuming the others are written anew */
+    std::set<std::string> _files;
+    bool _resumed;
+  };
+
+  /* the photon hits of the pnCCDs */
+  class PhotonListModule : public PostProcessingModule
+  {
+  public:
+    PhotonListModule(PostProcessor&);
+    void require(Products&)const;
+    void process(CASSEvent&, bool selected);
+    void flush() {_photonLists.flush();}
+    void finish() {_photonLists.close();}
+    void checkpoint(Checkpoint&);
+    void resume(const Checkpoint&);
+  private:
+    PhotonListFile _photonLists;
+    /* the run files that were written, after resuming the others are written anew */
+    std::set<std::string> _files;
+    bool _resumed;
+  };
+
+  /* the xtc file with only the selected events */
+  class SkimmerModule : public PostProcessingModule
+  {
+  public:
+    SkimmerModule(PostProcessor&);
+    void load(QSettings&);
+    bool onlySelected()const {return false;}
+    void process(CASSEvent&, bool selected);
+    void flush() {_skimmer.flush();}
+    void checkpoint(Checkpoint&);
+    void resume(const Checkpoint&);
+  private:
+    XtcSkimmer _skimmer;
+    /* appended to the run name to make the name of the skimmed file */
+    std::string _suffix;
+  };
+
+  /* one hdf5 file with the pnCCD frames for each event */
+  class HDF5WriterModule : public PostProcessingModule
+  {
+  public:
+    HDF5WriterModule(PostProcessor&);
+    void require(Products&)const;
+    void process(CASSEvent&, bool selected);
+    bool usesHDF5()const {return true;}
+  };
+
+  /* adds the pnCCD frames to the integrated image of the post processor */
+  class IntegratorModule : public PostProcessingModule
+  {
+  public:
+    IntegratorModule(PostProcessor&);
+    void require(Products&)const;
+    void process(CASSEvent&, bool selected);
+    void finish();
+    void checkpoint(Checkpoint&);
+    void resume(const Checkpoint&);
+  private:
+    HDRImage &integratedImage;
+    bool firstIntegratedImage;
+  };
+
+
   class PostProcessor
   {
     public:
@@ -57,10 +206,20 @@ namespace cass
     public:
 	static double calculateWavelength(cass::CASSEvent &cassevent);
 	static double calculatePhotonEnergyWithoutLossCorrection(cass::CASSEvent &cassevent);
+	static double calculatePhotonEnergyWithoutLossCorrection(const cass::MachineData::MachineDataEvent &mde);
 	static double calculatePhotonEnergy(cass::CASSEvent &cassevent);
+	static double calculatePhotonEnergy(const cass::MachineData::MachineDataEvent &mde);
+	/* the modules that the command line options ask for, used when there is
+	   no chain in cass.ini */
+	static QStringList commandLineChain();
       void postProcess(CASSEvent&);
-      void integrateByQ(CASSEvent&);
+      //add the products of the events that the modules of the chain read//
+      void require(Products&)const;
+      /* the state of the modules for the checkpoints */
+      void checkpoint(Checkpoint &checkpoint) {_chain.checkpoint(checkpoint);}
+      void resume(const Checkpoint &checkpoint) {_chain.resume(checkpoint);}
       void finishProcessing(){
+	  _chain.finish();
 	  //char outfile[1024];
 	  //sprintf(outfile,"%s_integrated.h5",
 		//  QFileInfo(cass::globalOptions.lastFile).baseName().toAscii().constData());
@@ -70,16 +229,11 @@ namespace cass
       HDRImage integratedImage;
 
   private:
-      void appendIntegratedByQ(CASSEvent &cassevent,float * x, float * y,int n,int frame);
-      void extractEnergy(CASSEvent &cassevent);
-      long long  integrateImage(cass::CASSEvent &cassevent,float threshold = 0);
-      double stdDevImage(cass::CASSEvent &cassevent,long long integral);
-      bool isGoodImage(cass::CASSEvent &cassevent);
-      void addToIntegratedImage(cass::CASSEvent &cassevent);
-      bool firstIntegratedImage;
       void appendWavelength(cass::CASSEvent &cassevent);
       QWidget * integrationDisplay;
       QLabel * labelDisplay;
+      /* the hit finder and the outputs */
+      PostProcessingChain _chain;
   };
 }
 
@@ -1,27 +1,80 @@
 #include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <QtCore/QTimer>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
 
 #include "ratemeter.h"
+#include "instrumentation.h"
 
-cass::Ratemeter::Ratemeter():
-        QObject(),
-        counter(0)
+cass::Ratemeter::Ratemeter(lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize> &ringbuffer, QObject *parent):
+        QObject(parent),
+        _ringbuffer(ringbuffer),
+        _timer(new QTimer(this)),
+        _server(0),
+        _lastUpdate(Stage::now()),
+        _start(_lastUpdate)
 {
-    time = new QTime();
-    time->start();
+    if (!globalOptions.statsSocket.isEmpty())
+    {
+        _server = new QLocalServer(this);
+        //a socket left over from a crashed run would prevent listening//
+        QLocalServer::removeServer(globalOptions.statsSocket);
+        if (_server->listen(globalOptions.statsSocket))
+            connect(_server,SIGNAL(newConnection()),this,SLOT(newConnection()));
+        else
+            std::cout <<"Ratemeter: could not listen on \""<<globalOptions.statsSocket.toStdString()<<"\""<<std::endl;
+    }
+    connect(_timer,SIGNAL(timeout()),this,SLOT(update()));
+    if (!globalOptions.statsFile.isEmpty() || _server)
+        _timer->start(globalOptions.statsInterval);
 }
 
 cass::Ratemeter::~Ratemeter()
 {
-    delete time;
+    //the final statistics, all threads have published theirs when they finished//
+    if (!globalOptions.statsFile.isEmpty())
+        update();
+}
+
+void cass::Ratemeter::update()
+{
+    const uint64_t now = Stage::now();
+    Statistics &statistics(Statistics::instance());
+    statistics.gauge("ringbuffer.occupancy",_ringbuffer.occupancy());
+    statistics.gauge("ringbuffer.capacity",cass::RingBufferSize);
+    statistics.gauge("ringbuffer.dropped",_ringbuffer.dropped());
+    rusage usage;
+    getrusage(RUSAGE_SELF,&usage);
+    statistics.gauge("process.maxrss[MB]",usage.ru_maxrss/1024.);
+    statistics.gauge("process.elapsed[s]",(now-_start)*1e-9);
+    _report = statistics.report((now-_lastUpdate)*1e-9);
+    _lastUpdate = now;
+    if (globalOptions.statsFile.isEmpty())
+        return;
+    //readers must never see a half written file//
+    const std::string filename(globalOptions.statsFile.toStdString());
+    const std::string tmpname(filename + ".tmp");
+    std::ofstream file(tmpname.c_str());
+    file << _report;
+    file.close();
+    if (!file || rename(tmpname.c_str(),filename.c_str()))
+        std::cout <<"Ratemeter: could not write \""<<filename<<"\""<<std::endl;
 }
 
-void cass::Ratemeter::nextEvent()
+void cass::Ratemeter::newConnection()
 {
-    ++counter;
-    if (counter%10 == 0)
+    if (_report.empty())
+        update();
+    while (QLocalSocket *socket = _server->nextPendingConnection())
     {
-//       std::cout<< "it took  "<< time->elapsed() <<" ms to analyze 10 events"<<std::endl;
-//       counter = 0;
-       time->restart();
+        std::string response("HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n\r\n");
+        response += _report;
+        socket->write(response.c_str(),response.size());
+        connect(socket,SIGNAL(disconnected()),socket,SLOT(deleteLater()));
+        //closes once everything is written//
+        socket->disconnectFromServer();
     }
 }
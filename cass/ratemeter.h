@@ -1,25 +1,43 @@
 #ifndef CASS_RATEMETER_H
 #define CASS_RATEMETER_H
 
+#include <string>
 #include <QtCore/QObject>
-#include <QtCore/QTime>
+
+#include "cass.h"
+#include "ringbuffer.h"
+#include "cass_event.h"
+
+class QTimer;
+class QLocalServer;
 
 namespace cass
 {
+    //exports the statistics of the processing stages periodically. The ringbuffer occupancy//
+    //and drop count are sampled as gauges, then the report is rewritten to the stats file//
+    //(-r) and served to everybody that connects to the local socket (-u), as a http response//
+    //so that e.g. "curl --unix-socket <path> http://cass/" works//
     class Ratemeter : public QObject
     {
         Q_OBJECT;
 
     public:
-        Ratemeter();
+        Ratemeter(lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize>&, QObject *parent=0);
         ~Ratemeter();
 
     public slots:
-        void nextEvent();
+        void update();
+
+    private slots:
+        void newConnection();
 
     private:
-        QTime* time;
-        size_t counter;
+        lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize>  &_ringbuffer;
+        QTimer         *_timer;
+        QLocalServer   *_server;
+        uint64_t        _lastUpdate;
+        uint64_t        _start;
+        std::string     _report;
     };
 }
 
@@ -65,7 +65,8 @@ namespace lmf
       : _behaviour(blocking),
         _buffer(cap,Element()),
         _nextToProcess(_buffer.begin()),
-        _nextToFill(_buffer.begin())
+        _nextToFill(_buffer.begin()),
+        _dropped(0)
     {
       //create the elements in the ringbuffer//
       for (size_t i=0; i<_buffer.size(); ++i)
@@ -239,6 +240,9 @@ namespace lmf
         }
       }
       //nun haben wir eins gefunden//
+      //ein gefuelltes element, das noch nicht bearbeitet wurde, geht verloren//
+      if (_nextToFill->gefuellt)
+        ++_dropped;
       //setze die eigenschaften und weise den pointer zu//
       _nextToFill->inBearbeitung = true;
       element = _nextToFill->element;
@@ -273,6 +277,36 @@ namespace lmf
       _processcondition.wakeOne();
     }
 
+    //the number of elements that are filled and wait for or are in processing//
+    size_t occupancy()
+    {
+      QMutexLocker lock(&_mutex);
+      size_t filled(0);
+      for (size_t i=0; i<_buffer.size(); ++i)
+        if (_buffer[i].gefuellt)
+          ++filled;
+      return filled;
+    }
+
+    //wait until all filled elements have been processed, only for the blocking behaviour//
+    void waitUntilProcessed()
+    {
+      QMutexLocker lock(&_mutex);
+      for (size_t i=0; i<_buffer.size(); ++i)
+      {
+        //doneProcessing wakes us for every element//
+        while (_buffer[i].gefuellt || _buffer[i].inBearbeitung)
+          _fillcondition.wait(lock.mutex());
+      }
+    }
+
+    //the number of filled elements that were overwritten before they were processed//
+    size_t dropped()
+    {
+      QMutexLocker lock(&_mutex);
+      return _dropped;
+    }
+
 
 
   private:
@@ -283,6 +317,7 @@ namespace lmf
     buffer_t          _buffer;            // der Container
     iterator_t        _nextToProcess;     // Iterator des naechsten zu bearbeitenden elements
     iterator_t        _nextToFill;        // Iterator des naechsten zu fuellenden elements
+    size_t            _dropped;           // anzahl der ueberschriebenen, nicht bearbeiteten elemente
   };
 }
 #endif
@@ -0,0 +1,585 @@
+#include <iostream>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <hdf5.h>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QProcess>
+#include <QtCore/QStringList>
+
+#include "shards.h"
+#include "file_input.h"
+#include "event_table.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+#if H5_VERS_MAJOR < 2
+#if H5_VERS_MINOR < 8
+#define H5Dcreate1(A,B,C,D,E) H5Dcreate(A,B,C,D,E)
+#define H5Gcreate1(A,B,C) H5Gcreate(A,B,C)
+#define H5Lcreate_soft(A,B,C,D,E) 0
+#endif
+#endif
+
+
+namespace
+{
+  //copy the rest of the file from its current position//
+  bool copyRest(FILE *from, FILE *to)
+  {
+    std::vector<char> buffer(1<<20);
+    size_t n;
+    while ((n = fread(&buffer[0],1,buffer.size(),from)) > 0)
+      if (fwrite(&buffer[0],1,n,to) != n)
+        return false;
+    return !ferror(from);
+  }
+
+  bool exists(const std::string &filename)
+  {
+    FILE *fp = fopen(filename.c_str(),"rb");
+    if (fp)
+      fclose(fp);
+    return fp;
+  }
+}
+
+
+
+bool cass::ShardPlanner::index(const std::string &filename, std::vector<XtcIndexEntry> &entries)
+{
+  entries.clear();
+  FILE *fp = fopen(filename.c_str(),"rb");
+  if (!fp)
+  {
+    std::cout << "ShardPlanner: could not open \""<<filename<<"\""<<std::endl;
+    return false;
+  }
+  fseeko(fp,0,SEEK_END);
+  const off_t filesize = ftello(fp);
+  off_t pos = 0;
+  Pds::Dgram dg;
+  while (fseeko(fp,pos,SEEK_SET) == 0 && fread(&dg,sizeof(dg),1,fp) == 1)
+  {
+    XtcIndexEntry entry;
+    entry.offset     = pos;
+    entry.size       = sizeof(dg) + dg.xtc.sizeofPayload();
+    entry.transition = dg.seq.service();
+    //a datagram that is cut off at the end of the file is not read by the input either//
+    if (pos + static_cast<off_t>(entry.size) > filesize)
+      break;
+    entries.push_back(entry);
+    pos += entry.size;
+  }
+  fclose(fp);
+  return true;
+}
+
+bool cass::ShardPlanner::plan(const std::vector<std::string> &files, uint32_t shard, uint32_t nbrShards,
+                              std::vector<ShardRange> &ranges)
+{
+  ranges.clear();
+  if (nbrShards <= 1)
+  {
+    whole(files,ranges);
+    return true;
+  }
+  if (shard >= nbrShards)
+    return false;
+  //the files that can not be read are left out by every shard, like by the input//
+  std::vector<std::vector<XtcIndexEntry> > indices(files.size());
+  uint64_t total(0);
+  for (size_t f=0; f<files.size(); ++f)
+  {
+    index(files[f],indices[f]);
+    for (size_t i=0; i<indices[f].size(); ++i)
+      if (indices[f][i].transition == Pds::TransitionId::L1Accept)
+        total += indices[f][i].size;
+  }
+  //the shard gets the events that start in its part of all event bytes//
+  const uint64_t first(total/nbrShards*shard + total%nbrShards*shard/nbrShards);
+  const uint64_t last(total/nbrShards*(shard+1) + total%nbrShards*(shard+1)/nbrShards);
+  uint64_t position(0);
+  for (size_t f=0; f<files.size(); ++f)
+  {
+    ShardRange range;
+    range.filename  = files[f];
+    range.configure = ShardRange::NoConfigure;
+    range.begin     = 0;
+    range.end       = 0;
+    bool inRange(false);
+    for (size_t i=0; i<indices[f].size(); ++i)
+    {
+      const XtcIndexEntry &entry(indices[f][i]);
+      //the last Configure before the range is read first, later ones are part of the range//
+      if (entry.transition == Pds::TransitionId::Configure && !inRange)
+        range.configure = entry.offset;
+      if (entry.transition != Pds::TransitionId::L1Accept)
+        continue;
+      const bool mine(first <= position && position < last);
+      position += entry.size;
+      if (!mine)
+        continue;
+      if (!inRange)
+      {
+        range.begin = entry.offset;
+        inRange = true;
+      }
+      range.end = entry.offset + entry.size;
+    }
+    if (inRange)
+      ranges.push_back(range);
+  }
+  return true;
+}
+
+void cass::ShardPlanner::whole(const std::vector<std::string> &files, std::vector<ShardRange> &ranges)
+{
+  ranges.clear();
+  for (size_t f=0; f<files.size(); ++f)
+  {
+    ShardRange range;
+    range.filename  = files[f];
+    range.configure = ShardRange::NoConfigure;
+    range.begin     = 0;
+    range.end       = ShardRange::EndOfFile;
+    ranges.push_back(range);
+  }
+}
+
+std::string cass::ShardPlanner::suffix(uint32_t shard, uint32_t nbrShards)
+{
+  char buffer[64];
+  sprintf(buffer,"_shard%uof%u",shard,nbrShards);
+  return buffer;
+}
+
+
+
+
+
+bool cass::ImageSums::write(const std::string &filename)const
+{
+  FILE *fp = fopen(filename.c_str(),"wb");
+  if (!fp)
+  {
+    std::cout << "ImageSums: could not create \""<<filename<<"\""<<std::endl;
+    return false;
+  }
+  const uint32_t nbrFrames = _frames.size();
+  fwrite("CASSSUM1",1,8,fp);
+  fwrite(&nbrFrames,sizeof(nbrFrames),1,fp);
+  for (size_t i=0; i<_frames.size(); ++i)
+  {
+    const Frame &frame(_frames[i]);
+    fwrite(&frame.rows,sizeof(frame.rows),1,fp);
+    fwrite(&frame.columns,sizeof(frame.columns),1,fp);
+    if (!frame.sum.empty())
+    {
+      fwrite(&frame.sum[0],sizeof(double),frame.sum.size(),fp);
+      fwrite(&frame.count[0],sizeof(int32_t),frame.count.size(),fp);
+    }
+  }
+  const bool ok = !ferror(fp);
+  fclose(fp);
+  return ok;
+}
+
+bool cass::ImageSums::read(const std::string &filename)
+{
+  _frames.clear();
+  FILE *fp = fopen(filename.c_str(),"rb");
+  char magic[8];
+  uint32_t nbrFrames;
+  if (!fp || fread(magic,1,8,fp) != 8 || std::string(magic,8) != "CASSSUM1" ||
+      fread(&nbrFrames,sizeof(nbrFrames),1,fp) != 1)
+  {
+    std::cout << "ImageSums: \""<<filename<<"\" is not a file of image sums"<<std::endl;
+    if (fp) fclose(fp);
+    return false;
+  }
+  bool ok(true);
+  _frames.resize(nbrFrames);
+  for (size_t i=0; i<_frames.size() && ok; ++i)
+  {
+    Frame &frame(_frames[i]);
+    ok = fread(&frame.rows,sizeof(frame.rows),1,fp) == 1 &&
+         fread(&frame.columns,sizeof(frame.columns),1,fp) == 1;
+    if (!ok)
+      break;
+    const size_t size = static_cast<size_t>(frame.rows)*frame.columns;
+    frame.sum.resize(size);
+    frame.count.resize(size);
+    ok = !size || (fread(&frame.sum[0],sizeof(double),size,fp) == size &&
+                   fread(&frame.count[0],sizeof(int32_t),size,fp) == size);
+  }
+  fclose(fp);
+  if (!ok)
+    std::cout << "ImageSums: \""<<filename<<"\" is cut off"<<std::endl;
+  return ok;
+}
+
+bool cass::ImageSums::add(const ImageSums &other)
+{
+  if (_frames.empty())
+  {
+    _frames = other._frames;
+    return true;
+  }
+  if (other._frames.size() != _frames.size())
+    return false;
+  for (size_t i=0; i<_frames.size(); ++i)
+    if (_frames[i].rows != other._frames[i].rows || _frames[i].columns != other._frames[i].columns)
+      return false;
+  for (size_t i=0; i<_frames.size(); ++i)
+  {
+    Frame &frame(_frames[i]);
+    const Frame &o(other._frames[i]);
+    for (size_t j=0; j<frame.sum.size(); ++j)
+    {
+      frame.sum[j]   += o.sum[j];
+      frame.count[j] += o.count[j];
+    }
+  }
+  return true;
+}
+
+bool cass::ImageSums::writeHDF5(const std::string &filename)const
+{
+  hid_t file = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (file < 0)
+  {
+    std::cout << "ImageSums: could not create \""<<filename<<"\""<<std::endl;
+    return false;
+  }
+  hid_t group = H5Gcreate1(file,"data",0);
+  bool ok(true);
+  int written(0);
+  for (size_t i=0; i<_frames.size(); ++i)
+  {
+    const Frame &frame(_frames[i]);
+    if (!frame.rows || !frame.columns)
+      continue;
+    hsize_t dims[2] = {frame.rows, frame.columns};
+    hid_t space = H5Screate_simple(2,dims,NULL);
+    char name[100];
+    sprintf(name,"/data/data%i",written);
+    hid_t dataset = H5Dcreate1(file,name,H5T_NATIVE_DOUBLE,space,H5P_DEFAULT);
+    ok = ok && H5Dwrite(dataset,H5T_NATIVE_DOUBLE,H5S_ALL,H5S_ALL,H5P_DEFAULT,&frame.sum[0]) >= 0;
+    H5Dclose(dataset);
+    sprintf(name,"/data/count%i",written);
+    dataset = H5Dcreate1(file,name,H5T_NATIVE_INT32,space,H5P_DEFAULT);
+    ok = ok && H5Dwrite(dataset,H5T_NATIVE_INT32,H5S_ALL,H5S_ALL,H5P_DEFAULT,&frame.count[0]) >= 0;
+    H5Dclose(dataset);
+    H5Sclose(space);
+    ++written;
+  }
+  hsize_t one = 1;
+  hid_t space = H5Screate_simple(1,&one,NULL);
+  hid_t dataset = H5Dcreate1(file,"/data/nframes",H5T_NATIVE_INT32,space,H5P_DEFAULT);
+  H5Dwrite(dataset,H5T_NATIVE_INT,H5S_ALL,H5S_ALL,H5P_DEFAULT,&written);
+  H5Dclose(dataset);
+  H5Sclose(space);
+  if (written)
+    H5Lcreate_soft("/data/data0",file,"/data/data",0,0);
+  H5Gclose(group);
+  H5Fclose(file);
+  if (!ok)
+    std::cout << "ImageSums: error when writing \""<<filename<<"\""<<std::endl;
+  return ok;
+}
+
+
+
+
+
+int cass::ShardLauncher::run(uint32_t nbrShards, const char *filelistname)
+{
+  //the shards get our options without the one that starts them//
+  const QStringList arguments(QCoreApplication::arguments());
+  QStringList options;
+  for (int i=1; i<arguments.size(); ++i)
+  {
+    if (arguments[i] == "-N")
+      ++i;
+    else if (!arguments[i].startsWith("-N"))
+      options << arguments[i];
+  }
+  std::vector<QProcess*> shards(nbrShards);
+  for (uint32_t k=0; k<nbrShards; ++k)
+  {
+    shards[k] = new QProcess();
+    shards[k]->setProcessChannelMode(QProcess::MergedChannels);
+    shards[k]->setStandardOutputFile(QString("cass%1.log").arg(ShardPlanner::suffix(k,nbrShards).c_str()));
+    shards[k]->start(QCoreApplication::applicationFilePath(),
+                     QStringList(options) << "-Z" << QString("%1/%2").arg(k).arg(nbrShards));
+    std::cout << "ShardLauncher: started shard "<<k<<" of "<<nbrShards<<std::endl;
+  }
+  bool ok(true);
+  for (uint32_t k=0; k<nbrShards; ++k)
+  {
+    shards[k]->waitForFinished(-1);
+    if (shards[k]->exitStatus() != QProcess::NormalExit || shards[k]->exitCode() != 0)
+    {
+      std::cout << "ShardLauncher: shard "<<k<<" failed, see cass"
+                <<ShardPlanner::suffix(k,nbrShards)<<".log"<<std::endl;
+      ok = false;
+    }
+    delete shards[k];
+  }
+  if (!ok)
+  {
+    std::cout << "ShardLauncher: not all shards finished, the outputs are not merged"<<std::endl;
+    return 1;
+  }
+  return ShardMerger(nbrShards).processFileList(filelistname) ? 0 : 1;
+}
+
+
+
+
+
+std::string cass::ShardMerger::runName(const std::string &xtcfilename)
+{
+  //like QFileInfo::baseName, the name without the path up to the first dot//
+  const size_t slash(xtcfilename.rfind('/'));
+  std::string base(slash == std::string::npos ? xtcfilename : xtcfilename.substr(slash+1));
+  base = base.substr(0,base.find('.'));
+  //the run is in front of the stream and chunk, so all of them go to the same run files//
+  const size_t stream(base.find("-s"));
+  return (stream != std::string::npos && stream > 0) ? base.substr(0,stream) : base;
+}
+
+std::vector<std::string> cass::ShardMerger::shardFiles(const std::string &run, const std::string &rest)const
+{
+  std::vector<std::string> files;
+  for (uint32_t k=0; k<_nbrShards; ++k)
+  {
+    const std::string name(run + ShardPlanner::suffix(k,_nbrShards) + rest);
+    if (exists(name))
+      files.push_back(name);
+  }
+  return files;
+}
+
+bool cass::ShardMerger::processFileList(const char *filelistname)
+{
+  std::vector<std::string> files;
+  if (!FileInput::readFileList(filelistname,files))
+    return false;
+  //every run once, in the order of the file list//
+  std::vector<std::string> runs;
+  for (size_t i=0; i<files.size(); ++i)
+  {
+    const std::string run(runName(files[i]));
+    if (std::find(runs.begin(),runs.end(),run) == runs.end())
+      runs.push_back(run);
+  }
+  bool ok(true);
+  for (size_t i=0; i<runs.size(); ++i)
+    ok = mergeRun(runs[i]) && ok;
+  ok = mergeImageSums() && ok;
+  if (globalOptions.outputHitsToFile)
+    ok = mergeHits(globalOptions.hitsOutputFile.toStdString()) && ok;
+  std::cout << "ShardMerger: "<<(ok ? "merged" : "could not merge all")<<" outputs of "
+            <<_nbrShards<<" shards"<<std::endl;
+  return ok;
+}
+
+bool cass::ShardMerger::mergeRun(const std::string &run)
+{
+  bool ok(true);
+  ok = mergeTables(run) && ok;
+  ok = mergeRadialProfiles(run) && ok;
+  ok = mergePhotonLists(run) && ok;
+  ok = mergeSkims(run) && ok;
+  return ok;
+}
+
+bool cass::ShardMerger::mergeTables(const std::string &run)
+{
+  const std::vector<std::string> files(shardFiles(run,"_table.h5"));
+  if (files.empty())
+    return true;
+  EventTableParameter param;
+  param.load();
+  EventTable table;
+  if (!table.open(run + "_table.h5",param._blockSize,param._compression))
+    return false;
+  bool ok(true);
+  for (size_t i=0; i<files.size() && ok; ++i)
+    ok = table.append(files[i]);
+  table.close();
+  std::cout << "ShardMerger: "<<run<<"_table.h5 from "<<files.size()<<" shards"<<std::endl;
+  return ok;
+}
+
+bool cass::ShardMerger::mergeRadialProfiles(const std::string &run)
+{
+  const std::vector<std::string> files(shardFiles(run,"_I_by_Q.bin"));
+  if (files.empty())
+    return true;
+  FILE *out = fopen((run + "_I_by_Q.bin").c_str(),"wb");
+  if (!out)
+    return false;
+  bool ok = fwrite("CASSIBQ1",1,8,out) == 8;
+  for (size_t i=0; i<files.size() && ok; ++i)
+  {
+    //the records of every shard follow its magic//
+    FILE *in = fopen(files[i].c_str(),"rb");
+    char magic[8];
+    ok = in && fread(magic,1,8,in) == 8 && std::string(magic,8) == "CASSIBQ1" && copyRest(in,out);
+    if (in) fclose(in);
+    if (!ok)
+      std::cout << "ShardMerger: could not read \""<<files[i]<<"\""<<std::endl;
+  }
+  fclose(out);
+  return ok;
+}
+
+bool cass::ShardMerger::mergePhotonLists(const std::string &run)
+{
+  const std::vector<std::string> files(shardFiles(run,"_photons.bin"));
+  if (files.empty())
+    return true;
+  FILE *data  = fopen((run + "_photons.bin").c_str(),"wb");
+  FILE *index = fopen((run + "_photons.idx").c_str(),"wb");
+  bool ok = data && index && fwrite("CASSPHL1",1,8,data) == 8;
+  uint64_t offset(8);
+  for (size_t i=0; i<files.size() && ok; ++i)
+  {
+    //the records are copied as they are, the offsets in the index are moved by the size of//
+    //the records of the shards before//
+    const std::string name(files[i].substr(0,files[i].size()-4));
+    FILE *in    = fopen((name + ".bin").c_str(),"rb");
+    FILE *inIdx = fopen((name + ".idx").c_str(),"rb");
+    char magic[8];
+    ok = in && inIdx && fread(magic,1,8,in) == 8 && std::string(magic,8) == "CASSPHL1" &&
+         copyRest(in,data);
+    uint64_t eventid, pos;
+    uint32_t detector, format;
+    while (ok &&
+           fread(&eventid,sizeof(eventid),1,inIdx) == 1 &&
+           fread(&detector,sizeof(detector),1,inIdx) == 1 &&
+           fread(&format,sizeof(format),1,inIdx) == 1 &&
+           fread(&pos,sizeof(pos),1,inIdx) == 1)
+    {
+      pos += offset - 8;
+      fwrite(&eventid,sizeof(eventid),1,index);
+      fwrite(&detector,sizeof(detector),1,index);
+      fwrite(&format,sizeof(format),1,index);
+      fwrite(&pos,sizeof(pos),1,index);
+    }
+    if (in) fclose(in);
+    if (inIdx) fclose(inIdx);
+    if (!ok)
+      std::cout << "ShardMerger: could not read \""<<name<<"\""<<std::endl;
+    offset = ftello(data);
+  }
+  if (data) fclose(data);
+  if (index) fclose(index);
+  return ok;
+}
+
+bool cass::ShardMerger::mergeSkims(const std::string &run)
+{
+  const std::vector<std::string> files(shardFiles(run,"_skim.xtc"));
+  if (files.empty())
+    return true;
+  FILE *xtc   = fopen((run + "_skim.xtc").c_str(),"wb");
+  FILE *index = fopen((run + "_skim.idx").c_str(),"wb");
+  bool ok = xtc && index;
+  uint64_t offset(0);
+  std::vector<char> configure;
+  std::vector<char> datagram;
+  for (size_t i=0; i<files.size() && ok; ++i)
+  {
+    const std::string name(files[i].substr(0,files[i].size()-4));
+    FILE *in    = fopen((name + ".xtc").c_str(),"rb");
+    FILE *inIdx = fopen((name + ".idx").c_str(),"rb");
+    ok = in && inIdx;
+    uint64_t eventid, pos;
+    uint32_t size, transition;
+    bool first(true);
+    while (ok &&
+           fread(&eventid,sizeof(eventid),1,inIdx) == 1 &&
+           fread(&pos,sizeof(pos),1,inIdx) == 1 &&
+           fread(&size,sizeof(size),1,inIdx) == 1 &&
+           fread(&transition,sizeof(transition),1,inIdx) == 1)
+    {
+      datagram.resize(size);
+      ok = fseeko(in,pos,SEEK_SET) == 0 && fread(&datagram[0],1,size,in) == size;
+      if (!ok)
+        break;
+      //every shard starts with the Configure it read, one process has it only once//
+      if (transition == Pds::TransitionId::Configure)
+      {
+        const bool again(first && datagram == configure);
+        configure = datagram;
+        first = false;
+        if (again)
+          continue;
+      }
+      first = false;
+      fwrite(&eventid,sizeof(eventid),1,index);
+      fwrite(&offset,sizeof(offset),1,index);
+      fwrite(&size,sizeof(size),1,index);
+      fwrite(&transition,sizeof(transition),1,index);
+      ok = fwrite(&datagram[0],1,size,xtc) == size;
+      offset += size;
+    }
+    if (in) fclose(in);
+    if (inIdx) fclose(inIdx);
+    if (!ok)
+      std::cout << "ShardMerger: could not read \""<<name<<"\""<<std::endl;
+  }
+  if (xtc) fclose(xtc);
+  if (index) fclose(index);
+  return ok;
+}
+
+bool cass::ShardMerger::mergeImageSums()
+{
+  const std::vector<std::string> files(shardFiles("integrated",".sum"));
+  if (files.empty())
+    return true;
+  ImageSums sums;
+  for (size_t i=0; i<files.size(); ++i)
+  {
+    ImageSums shard;
+    if (!shard.read(files[i]))
+      return false;
+    if (!sums.add(shard))
+    {
+      std::cout << "ShardMerger: the frames in \""<<files[i]<<"\" have another size"<<std::endl;
+      return false;
+    }
+  }
+  return sums.write("integrated.sum") && sums.writeHDF5("integrated.h5");
+}
+
+bool cass::ShardMerger::mergeHits(const std::string &hitsfile)
+{
+  const std::vector<std::string> files(shardFiles(hitsfile,""));
+  if (files.empty())
+    return true;
+  FILE *out = fopen(hitsfile.c_str(),"wb");
+  bool ok(out);
+  for (size_t i=0; i<files.size() && ok; ++i)
+  {
+    FILE *in = fopen(files[i].c_str(),"rb");
+    ok = in && copyRest(in,out);
+    if (in) fclose(in);
+  }
+  if (out) fclose(out);
+  return ok;
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
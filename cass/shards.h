@@ -0,0 +1,145 @@
+#ifndef CASS_SHARDS_H
+#define CASS_SHARDS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "cass.h"
+
+namespace cass
+{
+  //the position of one datagram in an xtc file//
+  struct XtcIndexEntry
+  {
+    uint64_t offset;
+    uint32_t size;            //of the datagram including its payload
+    uint32_t transition;
+  };
+
+
+
+  //the part of an xtc file that one shard reads: the Configure datagram at configure, which//
+  //the converters need first, followed by all datagrams in [begin,end)//
+  struct ShardRange
+  {
+    static const uint64_t NoConfigure = ~0ULL;
+    static const uint64_t EndOfFile   = ~0ULL;
+    std::string filename;
+    uint64_t    configure;
+    uint64_t    begin;
+    uint64_t    end;
+  };
+
+
+
+  //splits the files of the file list into shards that are processed by independent cass//
+  //processes. The L1Accept datagrams of all files are split in the order of the file list into//
+  //nbrShards contiguous parts of about the same number of bytes, so every process that gets the//
+  //same file list makes the same plan without talking to the others. Concatenating the outputs//
+  //of the shards in their order gives the outputs that one process would have written//
+  class CASSSHARED_EXPORT ShardPlanner
+  {
+  public:
+    //the datagrams of the file, only their headers are read//
+    static bool index(const std::string &filename, std::vector<XtcIndexEntry>&);
+    //the ranges of the files that shard (counted from 0) reads//
+    static bool plan(const std::vector<std::string> &files, uint32_t shard, uint32_t nbrShards,
+                     std::vector<ShardRange>&);
+    //the ranges when there is only one shard: the whole files//
+    static void whole(const std::vector<std::string> &files, std::vector<ShardRange>&);
+    //what is appended to the run name of the outputs of the shard, e.g. _shard2of8//
+    static std::string suffix(uint32_t shard, uint32_t nbrShards);
+  };
+
+
+
+  //the sums of the pixel values and the number of values that were added of the integrated//
+  //pnCCD images. Unlike averages these can be added up over the shards of a run. The file//
+  //starts with the 8 byte magic "CASSSUM1" and uint32 nbrFrames, followed by uint32 rows,//
+  //uint32 columns, double sum[rows*columns] and int32 count[rows*columns] for every frame//
+  class CASSSHARED_EXPORT ImageSums
+  {
+  public:
+    struct Frame
+    {
+      uint32_t              rows;
+      uint32_t              columns;
+      std::vector<double>   sum;
+      std::vector<int32_t>  count;
+    };
+
+  public:
+    std::vector<Frame> &frames()                {return _frames;}
+    const std::vector<Frame> &frames()const    {return _frames;}
+
+    bool write(const std::string &filename)const;
+    bool read(const std::string &filename);
+    //add the sums of the other shard, the frames have to have the same size//
+    bool add(const ImageSums&);
+    //write the sums like HDRImage::outputImage, plus the counts in /data/count%i//
+    bool writeHDF5(const std::string &filename)const;
+
+  private:
+    std::vector<Frame> _frames;
+  };
+
+
+
+  //starts the shards as local processes with the same options and merges their outputs when//
+  //all of them are done. On several machines every machine runs its shards with -Z and one of//
+  //them merges with -J when all are done//
+  class CASSSHARED_EXPORT ShardLauncher
+  {
+  public:
+    //the shards get the options of this process, returns the exit code of the launcher//
+    static int run(uint32_t nbrShards, const char *filelistname);
+  };
+
+
+
+  //combines the outputs of the shards of the runs in the file list into the outputs that one//
+  //process would have written: the event tables, the radial profiles, the photon lists, the//
+  //skimmed xtc files, the sums of the integrated image and the hits file. The merged outputs//
+  //are written anew, the outputs of the shards are kept//
+  class CASSSHARED_EXPORT ShardMerger
+  {
+  public:
+    explicit ShardMerger(uint32_t nbrShards):_nbrShards(nbrShards)  {}
+
+    //merge the outputs of all runs that are in the file list, returns false on errors//
+    bool processFileList(const char *filelistname);
+    bool mergeRun(const std::string &run);
+
+  public:
+    //the run an xtc file belongs to, e.g. e12-r0034 for /data/e12-r0034-s00-c00.xtc//
+    static std::string runName(const std::string &xtcfilename);
+
+  private:
+    //the names of the shard outputs that exist, name is the output without the shard suffix//
+    //and is split into the run and the rest//
+    std::vector<std::string> shardFiles(const std::string &run, const std::string &rest)const;
+    bool mergeTables(const std::string &run);
+    bool mergeRadialProfiles(const std::string &run);
+    bool mergePhotonLists(const std::string &run);
+    bool mergeSkims(const std::string &run);
+    //the integrated image is not per run, it adds up all events of the file list//
+    bool mergeImageSums();
+    bool mergeHits(const std::string &hitsfile);
+
+  private:
+    uint32_t _nbrShards;
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
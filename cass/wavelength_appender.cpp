@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <stdlib.h>
+#include <hdf5.h>
+#include <QFile>
+#include <QFileInfo>
+
+#include "wavelength_appender.h"
+#include "post_processor.h"
+#include "machine_event.h"
+#include "pdsdata/xtc/Dgram.hh"
+#include "pdsdata/bld/bldData.hh"
+
+#if H5_VERS_MAJOR < 2
+#if H5_VERS_MINOR < 8
+#define H5Dcreate1(A,B,C,D,E) H5Dcreate(A,B,C,D,E)
+#define H5Dopen1(A,B) H5Dopen(A,B)
+#define H5Gcreate1(A,B,C) H5Gcreate(A,B,C)
+#define H5Lexists(A,B,C) (H5Gget_objinfo(A,B,0,0) >= 0)
+#endif
+#endif
+
+
+namespace
+{
+  //the hdf5 file that was written for an event and the values to append to it//
+  struct Target
+  {
+    std::string filename;
+    double      photonEnergy;
+    double      photonEnergyNoLossCorrection;
+    double      wavelength;
+  };
+
+  //write a scalar double, an existing dataset is overwritten//
+  void writeScalar(hid_t file, const char *name, double value)
+  {
+    hid_t dataset;
+    if (H5Lexists(file,name,H5P_DEFAULT) > 0)
+      dataset = H5Dopen1(file,name);
+    else
+    {
+      hsize_t dims = 1;
+      hid_t space = H5Screate_simple(1,&dims,NULL);
+      dataset = H5Dcreate1(file,name,H5T_NATIVE_DOUBLE,space,H5P_DEFAULT);
+      H5Sclose(space);
+    }
+    if (dataset < 0)
+      return;
+    H5Dwrite(dataset,H5T_NATIVE_DOUBLE,H5S_ALL,H5S_ALL,H5P_DEFAULT,&value);
+    H5Dclose(dataset);
+  }
+
+  //open the file once and write all values//
+  bool patch(const Target &t)
+  {
+    hid_t file = H5Fopen(t.filename.c_str(),H5F_ACC_RDWR,H5P_DEFAULT);
+    if (file < 0)
+      return false;
+    if (H5Lexists(file,"/LCLS",H5P_DEFAULT) <= 0)
+      H5Gclose(H5Gcreate1(file,"/LCLS",0));
+    const double wavelength_nm = t.photonEnergy ? 1239.8/t.photonEnergy : -1;
+    writeScalar(file,"/LCLS/wavelength",t.wavelength);
+    writeScalar(file,"/LCLS/photon_energy_eV",t.photonEnergy);
+    writeScalar(file,"/LCLS/photon_energy_eV_no_energy_loss_correction",t.photonEnergyNoLossCorrection);
+    writeScalar(file,"/LCLS/photon_wavelength_nm",wavelength_nm);
+    writeScalar(file,"/LCLS/photon_wavelength_A",wavelength_nm > 0 ? 10*wavelength_nm : -1);
+    H5Fclose(file);
+    return true;
+  }
+}
+
+bool cass::WavelengthAppender::scan(const std::string &xtcfilename, std::vector<BeamRecord> &records)
+{
+  FILE *fp = fopen(xtcfilename.c_str(),"rb");
+  if (!fp)
+  {
+    std::cout << "WavelengthAppender: could not open \""<<xtcfilename<<"\""<<std::endl;
+    return false;
+  }
+  Pds::Dgram dg;
+  while (fread(&dg,sizeof(dg),1,fp) == 1)
+  {
+    off_t pos       = ftello(fp);
+    const off_t end = pos + dg.xtc.sizeofPayload();
+    if (dg.seq.service() != Pds::TransitionId::L1Accept)
+    {
+      fseeko(fp,end,SEEK_SET);
+      continue;
+    }
+    BeamRecord record;
+    record.seconds        = dg.seq.clock().seconds();
+    record.fiducial       = dg.seq.stamp().fiducials();
+    record.ebeamL3Energy  = 0;
+    record.ebeamPkCurrBC2 = 0;
+    //walk the xtc headers, the children of a container directly follow its header//
+    //so we step into containers and jump over everything else//
+    while (pos < end)
+    {
+      Pds::Xtc xtc;
+      if (fseeko(fp,pos,SEEK_SET) || fread(&xtc,sizeof(xtc),1,fp) != 1 || xtc.extent < sizeof(xtc))
+      {
+        pos = end;
+        break;
+      }
+      if (xtc.contains.id() == Pds::TypeId::Id_Xtc)
+      {
+        pos += sizeof(xtc);
+        continue;
+      }
+      if (xtc.contains.id() == Pds::TypeId::Id_EBeam && !xtc.damage.value())
+      {
+        Pds::BldDataEBeam beam;
+        memset(&beam,0,sizeof(beam));
+        const size_t size = std::min(static_cast<size_t>(xtc.sizeofPayload()),sizeof(beam));
+        if (fread(&beam,1,size,fp) == size)
+        {
+          record.ebeamL3Energy  = beam.fEbeamL3Energy;
+          record.ebeamPkCurrBC2 = beam.fEbeamPkCurrBC2;
+        }
+      }
+      pos += xtc.extent;
+    }
+    records.push_back(record);
+    fseeko(fp,end,SEEK_SET);
+  }
+  fclose(fp);
+  return true;
+}
+
+size_t cass::WavelengthAppender::processFile(const std::string &xtcfilename)
+{
+  std::vector<BeamRecord> records;
+  if (!scan(xtcfilename,records))
+    return 0;
+
+  //find the files that were written for the events, the run part of the name is taken//
+  //from the xtc filename like in postProcess_writeHDF5. Files written by older versions//
+  //have no run part in the name. localtime is not thread safe, so this is done serially//
+  char run[6] = {0,0,0,0,0,0};
+  const QString base = QFileInfo(xtcfilename.c_str()).baseName();
+  if (base.length() > 4)
+    strncpy(run,base.toAscii().constData()+4,5);
+  std::vector<Target> targets;
+  targets.reserve(records.size());
+  setenv("TZ","US/Pacific",1);
+  for (size_t i=0; i<records.size(); ++i)
+  {
+    char date[80], daytime[80], name[1024];
+    time_t eventTime = records[i].seconds;
+    struct tm *timeinfo = localtime(&eventTime);
+    strftime(date,80,"%Y_%b%d",timeinfo);
+    strftime(daytime,80,"%H%M%S",timeinfo);
+    sprintf(name,"LCLS_%s_%s_%s_%i_pnCCD.h5",date,run,daytime,records[i].fiducial);
+    if (!QFile::exists(name))
+    {
+      sprintf(name,"LCLS_%s_%s_%i_pnCCD.h5",date,daytime,records[i].fiducial);
+      if (!QFile::exists(name))
+        continue;
+    }
+    MachineData::MachineDataEvent mde;
+    mde.EbeamL3Energy()  = records[i].ebeamL3Energy;
+    mde.EbeamPkCurrBC2() = records[i].ebeamPkCurrBC2;
+    Target t;
+    t.filename                     = name;
+    t.photonEnergy                 = PostProcessor::calculatePhotonEnergy(mde);
+    t.photonEnergyNoLossCorrection = PostProcessor::calculatePhotonEnergyWithoutLossCorrection(mde);
+    t.wavelength                   = t.photonEnergy ? 1398.8/t.photonEnergy : -1;
+    targets.push_back(t);
+  }
+  unsetenv("TZ");
+
+  //hdf5 may only be used from several threads when it was built thread safe//
+  hbool_t threadsafe = 0;
+#if H5_VERS_MAJOR > 1 || H5_VERS_MINOR > 8 || (H5_VERS_MINOR == 8 && H5_VERS_RELEASE >= 16)
+  H5is_library_threadsafe(&threadsafe);
+#endif
+  const int nbrTargets = targets.size();
+  size_t patched = 0;
+#pragma omp parallel for schedule(dynamic,16) reduction(+:patched) if(threadsafe)
+  for (int i=0; i<nbrTargets; ++i)
+    if (patch(targets[i]))
+      ++patched;
+  std::cout << "WavelengthAppender: \""<<xtcfilename<<"\" has "<<records.size()<<" events, "
+            <<patched<<" of "<<targets.size()<<" hdf5 files were patched"<<std::endl;
+  return patched;
+}
+
+void cass::WavelengthAppender::processFileList(const char *filelistname)
+{
+  std::ifstream filelistfile(filelistname);
+  if (!filelistfile.is_open())
+  {
+    std::cout << "WavelengthAppender: could not open filelist \""<<filelistname<<"\""<<std::endl;
+    return;
+  }
+  std::string line;
+  while (getline(filelistfile,line))
+  {
+    if (line.empty())
+      continue;
+    processFile(line);
+  }
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,54 @@
+#ifndef CASS_WAVELENGTHAPPENDER_H
+#define CASS_WAVELENGTHAPPENDER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "cass.h"
+
+namespace cass
+{
+  //appends the photon energy and wavelength to the already existing per event hdf5 files//
+  //of a run without running the whole conversion. Of every xtc file only the datagram and//
+  //xtc headers are read, all contributions but the beamline data of the electron beam are//
+  //skipped. The values of a whole file are calculated first, then every hdf5 file is//
+  //opened only once to write all values, in parallel when hdf5 is thread safe//
+  class CASSSHARED_EXPORT WavelengthAppender
+  {
+  public:
+    //the electron beam data of one event//
+    struct BeamRecord
+    {
+      uint32_t seconds;
+      int32_t  fiducial;
+      double   ebeamL3Energy;
+      double   ebeamPkCurrBC2;
+    };
+
+  public:
+    WavelengthAppender()    {}
+    ~WavelengthAppender()   {}
+
+    //process all xtc files that are listed in the file//
+    void processFileList(const char *filelistname);
+    //process one xtc file, returns the number of hdf5 files that were patched//
+    size_t processFile(const std::string &xtcfilename);
+
+  public:
+    //extract the electron beam data of all events in the xtc file//
+    static bool scan(const std::string &xtcfilename, std::vector<BeamRecord>&);
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -2,6 +2,7 @@
 #include "analyzer.h"
 #include "format_converter.h"
 #include "post_processor.h"
+#include "pdsdata/xtc/Dgram.hh"
 
 cass::Worker::Worker(lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize> &ringbuffer, QObject *parent)
   :QThread(parent),
@@ -9,8 +10,16 @@ cass::Worker::Worker(lmf::RingBuffer<cass::CASSEvent,cass::RingBufferSize> &ring
     _analyzer(new cass::Analyzer()),
     _converter(new cass::FormatConverter()),
     _postprocessor(new cass::PostProcessor()),
-    _quit(false)
+    _quit(false),
+    _convertStage("convert"),
+    _eventStage("event"),
+    _provideStage("provide")
 {
+  //only what the post processor and the analyzers read is made of every event//
+  Products required;
+  _postprocessor->require(required);
+  _analyzer->require(required);
+  _converter->require(required);
 }
 
 cass::Worker::~Worker()
@@ -30,9 +39,14 @@ void cass::Worker::run()
     //when the cassevent has been set work on it//
     if (cassevent)
     {
+      const uint64_t start = Stage::now();
+      Pds::Dgram *datagram = reinterpret_cast<Pds::Dgram*>(cassevent->datagrambuffer());
+      cassevent->provider(this);
+
       //convert the datagrambuffer to something useful//
       //this will tell us whether this transition should be analyzed further//
       bool shouldBeAnalyzed  = _converter->processDatagram(cassevent);
+      _convertStage.record(start,Stage::now());
 
       //when the formatconverter told us, then analyze the cassevent//
       if (shouldBeAnalyzed) _analyzer->processEvent(cassevent);
@@ -42,15 +56,46 @@ void cass::Worker::run()
       /* always post process */
       //       _postprocessor->postProcess(*cassevent);
 
+      _eventStage.record(start,Stage::now(),sizeof(*datagram)+datagram->xtc.sizeofPayload());
+
       //we are done, so tell the ringbuffer//
-      _ringbuffer.doneProcessing(cassevent);
+      //the event is counted before, a checkpoint can be made as soon as it is done//
       cass::globalOptions.eventCounter++;
+      _ringbuffer.doneProcessing(cassevent);
     }
   }
   _postprocessor->finishProcessing();
+  Statistics::instance().publishCurrentThread();
   std::cout <<"worker is closing down"<<std::endl;
 }
 
+bool cass::Worker::provide(CASSEvent &cassevent, Products::Product product, size_t detector)
+{
+  StageTimer timer(_provideStage);
+  //convert and analyze again, but only for what is missing//
+  const Products before(cassevent.wanted());
+  Products missing;
+  missing.add(product,static_cast<int>(detector));
+  missing.remove(cassevent.produced());
+  cassevent.wanted() = missing;
+  _converter->convertDetectors(&cassevent);
+  _analyzer->processEvent(&cassevent);
+  cassevent.wanted() = before;
+  return cassevent.produced().has(product,detector);
+}
+
+void cass::Worker::checkpoint(Checkpoint &checkpoint)
+{
+  checkpoint.set("events",static_cast<uint64_t>(cass::globalOptions.eventCounter));
+  _postprocessor->checkpoint(checkpoint);
+}
+
+void cass::Worker::resume(const Checkpoint &checkpoint)
+{
+  cass::globalOptions.eventCounter = checkpoint.number("events");
+  _postprocessor->resume(checkpoint);
+}
+
 void cass::Worker::end()
 {
   std::cout << "worker got signal to close"<<std::endl;
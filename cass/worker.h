@@ -9,6 +9,8 @@
 #include "cass.h"
 #include "ringbuffer.h"
 #include "cass_event.h"
+#include "instrumentation.h"
+#include "checkpoint.h"
 
 
 namespace cass
@@ -16,7 +18,7 @@ namespace cass
   class Analyzer;
   class FormatConverter;
   class PostProcessor;
-  class CASSSHARED_EXPORT Worker : public QThread
+  class CASSSHARED_EXPORT Worker : public QThread, public ProductProvider, public Checkpointable
   {
     Q_OBJECT;
     public:
@@ -24,6 +26,11 @@ namespace cass
       ~Worker();
 
       void run();
+      //makes the products the post processor asks for that nobody declared//
+      bool provide(CASSEvent&, Products::Product, size_t detector);
+      //the number of events and the state of the post processing//
+      void checkpoint(Checkpoint&);
+      void resume(const Checkpoint&);
       PostProcessor                       *_postprocessor;
 
     public slots:
@@ -34,6 +41,9 @@ namespace cass
       Analyzer                            *_analyzer;
       FormatConverter                     *_converter;
       bool                                 _quit;
+      Stage                                _convertStage;  //iterating the xtc and converting it
+      Stage                                _eventStage;    //the whole processing of a datagram
+      Stage                                _provideStage;  //making products on demand
   };
 }
 
@@ -0,0 +1,145 @@
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+
+#include "xtc_skimmer.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+
+namespace
+{
+  //the size of the datagram including its payload, like it is read from the file//
+  size_t datagramSize(const Pds::Dgram &dg)
+  {
+    return sizeof(Pds::Dgram) + dg.xtc.sizeofPayload();
+  }
+}
+
+void cass::XtcSkimmer::configure(const std::string &name, const Pds::Dgram &dg)
+{
+  const char *begin = reinterpret_cast<const char*>(&dg);
+  //after resuming the Configure of the run is read again, but it is in the file already//
+  const bool known = _resumed && _configure.size() == datagramSize(dg) &&
+                     std::equal(_configure.begin(),_configure.end(),begin);
+  _resumed = false;
+  _configure.assign(begin, begin + datagramSize(dg));
+  if (_xtc && name == _name && !known)
+    write(0,dg);
+}
+
+void cass::XtcSkimmer::append(const std::string &name, uint64_t eventid, const Pds::Dgram &dg)
+{
+  if (!open(name))
+    return;
+  write(eventid,dg);
+}
+
+bool cass::XtcSkimmer::open(const std::string &name)
+{
+  if (_xtc && name == _name)
+    return true;
+  close();
+  _xtc   = fopen((name+".xtc").c_str(),"wb");
+  _index = fopen((name+".idx").c_str(),"wb");
+  if (!_xtc || !_index)
+  {
+    std::cout << "XtcSkimmer: could not create \""<<name<<".xtc\""<<std::endl;
+    close();
+    return false;
+  }
+  //the datagrams are written in large blocks//
+  _xtcBuffer.resize(1<<24);
+  _indexBuffer.resize(1<<16);
+  setvbuf(_xtc,&_xtcBuffer[0],_IOFBF,_xtcBuffer.size());
+  setvbuf(_index,&_indexBuffer[0],_IOFBF,_indexBuffer.size());
+  _name   = name;
+  _offset = 0;
+  //a reader needs the configuration before the first event//
+  if (!_configure.empty())
+    write(0,*reinterpret_cast<const Pds::Dgram*>(&_configure[0]));
+  else
+    std::cout << "XtcSkimmer: \""<<name<<".xtc\" starts without Configure transition"<<std::endl;
+  return true;
+}
+
+void cass::XtcSkimmer::write(uint64_t eventid, const Pds::Dgram &dg)
+{
+  const uint32_t size       = datagramSize(dg);
+  const uint32_t transition = dg.seq.service();
+  fwrite(&eventid,sizeof(eventid),1,_index);
+  fwrite(&_offset,sizeof(_offset),1,_index);
+  fwrite(&size,sizeof(size),1,_index);
+  fwrite(&transition,sizeof(transition),1,_index);
+  if (fwrite(&dg,1,size,_xtc) != size)
+    std::cout << "XtcSkimmer: error when writing to \""<<_name<<".xtc\""<<std::endl;
+  _offset += size;
+}
+
+void cass::XtcSkimmer::flush()
+{
+  if (_xtc)
+    fflush(_xtc);
+  if (_index)
+    fflush(_index);
+}
+
+bool cass::XtcSkimmer::resume(const std::string &name)
+{
+  close();
+  //the configuration the file starts with//
+  FILE *fp = fopen((name+".xtc").c_str(),"rb");
+  Pds::Dgram dg;
+  if (!fp || fread(&dg,sizeof(dg),1,fp) != 1)
+  {
+    std::cout << "XtcSkimmer: could not continue \""<<name<<".xtc\""<<std::endl;
+    if (fp) fclose(fp);
+    return false;
+  }
+  _configure.resize(datagramSize(dg));
+  memcpy(&_configure[0],&dg,sizeof(dg));
+  const bool ok = fread(&_configure[sizeof(dg)],1,_configure.size()-sizeof(dg),fp) ==
+                  _configure.size()-sizeof(dg);
+  fclose(fp);
+  if (!ok)
+  {
+    _configure.clear();
+    return false;
+  }
+  _xtc   = fopen((name+".xtc").c_str(),"ab");
+  _index = fopen((name+".idx").c_str(),"ab");
+  if (!_xtc || !_index)
+  {
+    close();
+    return false;
+  }
+  _xtcBuffer.resize(1<<24);
+  _indexBuffer.resize(1<<16);
+  setvbuf(_xtc,&_xtcBuffer[0],_IOFBF,_xtcBuffer.size());
+  setvbuf(_index,&_indexBuffer[0],_IOFBF,_indexBuffer.size());
+  fseeko(_xtc,0,SEEK_END);
+  _offset  = ftello(_xtc);
+  _name    = name;
+  _resumed = true;
+  return true;
+}
+
+void cass::XtcSkimmer::close()
+{
+  if (_xtc)
+    fclose(_xtc);
+  if (_index)
+    fclose(_index);
+  _xtc   = 0;
+  _index = 0;
+  _name.clear();
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,69 @@
+#ifndef CASS_XTCSKIMMER_H
+#define CASS_XTCSKIMMER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "cass.h"
+
+namespace Pds
+{
+  class Dgram;
+}
+
+namespace cass
+{
+  //writes a valid xtc stream that contains the Configure transition and only the//
+  //selected L1Accept datagrams of a run, copied verbatim from the datagrambuffer.//
+  //The sidecar <name>.idx contains for every datagram in <name>.xtc the uint64 eventid,//
+  //the uint64 offset, the uint32 size and the uint32 transition id//
+  class CASSSHARED_EXPORT XtcSkimmer
+  {
+  public:
+    XtcSkimmer():_xtc(0),_index(0),_offset(0),_resumed(false)  {}
+    ~XtcSkimmer()                               {close();}
+
+    //remember the Configure datagram, it is written first into every file of the run//
+    //and right away when the file of the run is already open//
+    void configure(const std::string &name, const Pds::Dgram&);
+    //append a L1Accept datagram to the file of the run//
+    void append(const std::string &name, uint64_t eventid, const Pds::Dgram&);
+    //write the buffered datagrams to disk//
+    void flush();
+    void close();
+    //continue the files of the run after their end, e.g. when resuming at a checkpoint. The//
+    //Configure at their start is not written again when it is the next one//
+    bool resume(const std::string &name);
+    //of the files that are open, empty when none is//
+    const std::string &name()const      {return _name;}
+
+  private:
+    //(re)open the files when name differs from the currently open ones//
+    bool open(const std::string &name);
+    void write(uint64_t eventid, const Pds::Dgram&);
+
+  private:
+    FILE               *_xtc;
+    FILE               *_index;
+    uint64_t            _offset;        //the position of the next datagram in the xtc file
+    std::string         _name;
+    std::vector<char>   _configure;     //copy of the last Configure datagram
+    bool                _resumed;       //the next Configure may be the one in the file
+    std::vector<char>   _xtcBuffer;     //the stdio buffers of the files
+    std::vector<char>   _indexBuffer;
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
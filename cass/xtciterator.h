@@ -32,18 +32,18 @@ namespace cass
                 iterate(xtc);
             }
             else{ //otherwise check which format converter is responsible for this xtc//
-	      //check whether datagram is damaged//
+	      //check whether datagram is damaged, only the converters that read it care, so that//
+	      //the datagram is reported once when it is iterated with several sets of converters//
 	      uint32_t damage = xtc->damage.value();
-	      if (!damage)
+	      for (std::map<FormatConverter::Converters,ConversionBackend*>::iterator it=_converters.begin() ; it != _converters.end(); ++it )
 		{
-		  for (std::map<FormatConverter::Converters,ConversionBackend*>::iterator it=_converters.begin() ; it != _converters.end(); ++it )
-		    {
-		      if( it->second->handlesType(xtc->contains.id()))
-			(*(it->second))(xtc,_cassevent);
-		    }
+		  if( !it->second->handlesType(xtc->contains.id()))
+		    continue;
+		  if (!damage)
+		    (*(it->second))(xtc,_cassevent);
+		  else
+		    std::cout <<std::hex<<Pds::TypeId::name(xtc->contains.id())<< " is damaged: 0x" <<xtc->damage.value()<<std::dec<<std::endl;
 		}
-	      else
-		std::cout <<std::hex<<Pds::TypeId::name(xtc->contains.id())<< " is damaged: 0x" <<xtc->damage.value()<<std::dec<<std::endl;
 	      
 	    }
             return Continue;
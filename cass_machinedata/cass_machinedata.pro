@@ -11,6 +11,7 @@ VERSION = 0.0.1
 SOURCES += machine_analysis.cpp \
            machine_converter.cpp \
            ./classes/event/machine_event.cpp \
+           ./classes/event/epics_snapshot.cpp \
 
 
 HEADERS += ../cass/analysis_backend.h \
@@ -20,6 +21,7 @@ HEADERS += ../cass/analysis_backend.h \
            machine_converter.h \
            cass_machine.h \
            ./classes/event/machine_event.h \
+           ./classes/event/epics_snapshot.h \
 
 INCLUDEPATH += ../LCLS \
                ../cass \
@@ -0,0 +1,44 @@
+#include "epics_snapshot.h"
+
+
+const size_t cass::MachineData::EpicsSnapshot::npos;
+
+size_t cass::MachineData::EpicsNames::add(const std::string &name)
+{
+    index_t::const_iterator it = _index.find(name);
+    if (it != _index.end())
+        return it->second;
+    _names.push_back(name);
+    return _index[name] = _names.size()-1;
+}
+
+size_t cass::MachineData::EpicsSnapshot::index(const std::string &name)const
+{
+    EpicsNames::index_t::const_iterator it = _names->index().find(name);
+    return it != _names->index().end() ? it->second : npos;
+}
+
+bool cass::MachineData::EpicsSnapshot::find(const std::string &name, double &value)const
+{
+    const size_t i = index(name);
+    if (i == npos)
+        return false;
+    value = _values[i];
+    return true;
+}
+
+size_t cass::MachineData::EpicsSnapshot::add(const std::string &name)
+{
+    //the names may be shared with other snapshots, which must not see the new name//
+    _names.detach();
+    const size_t i = _names->add(name);
+    if (i >= _values.size())
+        _values.resize(i+1,0.);
+    return i;
+}
+
+const cass::MachineData::EpicsSnapshot &cass::MachineData::EpicsSnapshot::empty()
+{
+    static const EpicsSnapshot emptySnapshot;
+    return emptySnapshot;
+}
@@ -0,0 +1,83 @@
+#ifndef _EPICSSNAPSHOT_H_
+#define _EPICSSNAPSHOT_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <QtCore/QSharedData>
+#include <QtCore/QExplicitlySharedDataPointer>
+
+
+namespace cass
+{
+    namespace MachineData
+    {
+        //the names of the epics values, the elements of an array are named "name[i]"//
+        //they only change with a configure transition//
+        class EpicsNames : public QSharedData
+        {
+        public:
+            typedef std::map<std::string,size_t> index_t;
+
+        public:
+            const std::vector<std::string> &names()const    {return _names;}
+            const index_t                  &index()const    {return _index;}
+            //the index of the name, adds it when it is not there yet//
+            size_t add(const std::string &name);
+
+        private:
+            std::vector<std::string> _names;    //the name of every value
+            index_t                  _index;    //the index of the value of every name
+        };
+
+
+
+        //the values of all epics variables at one moment. The converter keeps the latest//
+        //snapshot and the events just point to it, so an event costs a reference count only.//
+        //When a new value arrives while events still use the snapshot, the converter gets//
+        //its own copy first (copy on write)//
+        class EpicsSnapshot : public QSharedData
+        {
+        public:
+            EpicsSnapshot():_names(new EpicsNames),_version(0),_layout(0)   {}
+
+        public:
+            static const size_t npos = static_cast<size_t>(-1);
+
+        public:
+            size_t                          size()const         {return _values.size();}
+            double                          value(size_t i)const{return _values[i];}
+            const std::vector<double>      &values()const       {return _values;}
+            std::vector<double>            &values()            {return _values;}
+            const std::string              &name(size_t i)const {return _names->names()[i];}
+            //counts the updates of the values//
+            uint64_t                        version()const      {return _version;}
+            uint64_t                       &version()           {return _version;}
+            //changes whenever the names change, indices found with index() stay valid//
+            //as long as the layout stays the same//
+            uint32_t                        layout()const       {return _layout;}
+            uint32_t                       &layout()            {return _layout;}
+
+        public:
+            //the index of the value with the name, npos when there is none//
+            size_t index(const std::string &name)const;
+            //get the value with the name, returns false when there is none//
+            bool find(const std::string &name, double &value)const;
+            //the index of the name, a new value of 0 is added when it is not there yet//
+            size_t add(const std::string &name);
+
+        public:
+            //the snapshot of events that have no epics data//
+            static const EpicsSnapshot &empty();
+
+        private:
+            QExplicitlySharedDataPointer<EpicsNames> _names;    //shared by all snapshots of a configuration
+            std::vector<double>                       _values;  //the values, in the order of the names
+            uint64_t                                  _version;
+            uint32_t                                  _layout;
+        };
+    }//end namespace machinedata
+}//end namespace cass
+
+#endif
@@ -1,8 +1,7 @@
 #ifndef _MACHINEDATAEVENT_H_
 #define _MACHINEDATAEVENT_H_
 
-#include <map>
-#include <string>
+#include "epics_snapshot.h"
 
 
 
@@ -35,7 +34,7 @@ namespace cass
 
             ~MachineDataEvent(){}
         public:
-            typedef std::map<std::string,double> EpicsDataMap;
+            typedef QExplicitlySharedDataPointer<EpicsSnapshot> EpicsSnapshotPtr;
 
         public:
             bool  isFilled()const       {return _isFilled;}
@@ -89,8 +88,8 @@ namespace cass
             double Charge2()const      {return _Charge2;}
             double& Charge2()          {return _Charge2;}
 
-            const EpicsDataMap& EpicsData()const {return _epicsdata;}
-            EpicsDataMap& EpicsData() {return _epicsdata;}
+            const EpicsSnapshot& EpicsData()const {return _epicsdata ? *_epicsdata : EpicsSnapshot::empty();}
+            EpicsSnapshotPtr& EpicsDataPtr() {return _epicsdata;}
 
         private:
             bool   _isFilled;       //! flag telling whether this event has been filled
@@ -114,7 +113,7 @@ namespace cass
             double _Charge2;        //cavity property in pico-columbs
 
             //epics data//
-            EpicsDataMap _epicsdata;//a map containing all epics data in the xtc stream
+            EpicsSnapshotPtr _epicsdata;//the latest values of all epics data in the xtc stream, shared with the converter
 
             //data that gets calculated in Analysis//
             double _energy;         //the calculated puls energy
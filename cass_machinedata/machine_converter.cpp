@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 #include <string.h>
@@ -16,12 +17,13 @@
 #define CASETOVAL(timetype,valtype) case timetype: {			\
     const Pds::EpicsPvTime<valtype>& p = static_cast<const Pds::EpicsPvTime<valtype>&>(epicsData); \
     const Pds::EpicsDbrTools::DbrTypeFromInt<valtype>::TDbr* value = &p.value;	\
-    for(int i=0; i<epicsData.iNumElements; i++) \
-        it++->second = *value++;\
+    for(int i=0; i<nbrElements; i++) \
+        *it++ = *value++;\
     break; }
 
 
 cass::MachineData::Converter::Converter()
+    :_epics(new EpicsSnapshot)
 {
     _types.push_back(Pds::TypeId::Id_FEEGasDetEnergy);
     _types.push_back(Pds::TypeId::Id_EBeam);
@@ -29,6 +31,39 @@ cass::MachineData::Converter::Converter()
     _types.push_back(Pds::TypeId::Id_Epics);
 }
 
+void cass::MachineData::Converter::addPv(int pvId, const std::string &name, int nbrElements)
+{
+    //events that still point to the current snapshot keep the old names//
+    _epics.detach();
+    EpicsSnapshot &snapshot = *_epics;
+    const size_t nbrBefore = snapshot.size();
+    nbrElements = std::max(nbrElements,1);
+    //if this epics variable is an array we want an entry for each entry in the array//
+    //with the index in brackets. They have to be next to each other, so when the variable//
+    //was there before with a different size, it gets new entries//
+    size_t first = snapshot.index(nbrElements > 1 ? name + "[0]" : name);
+    if (nbrElements > 1)
+    {
+        std::stringstream lastname;
+        lastname << name << "[" << nbrElements-1 << "]";
+        if (first == EpicsSnapshot::npos || snapshot.index(lastname.str()) != first+nbrElements-1)
+            first = EpicsSnapshot::npos;
+    }
+    if (first == EpicsSnapshot::npos)
+    {
+        first = snapshot.size();
+        for (int i=0;i<nbrElements;++i)
+        {
+            std::stringstream entryname;
+            entryname << name << "[" << i << "]";
+            snapshot.add(nbrElements > 1 ? entryname.str() : name);
+        }
+    }
+    _pvs[pvId] = std::make_pair(first,static_cast<size_t>(nbrElements));
+    if (snapshot.size() != nbrBefore)
+        ++snapshot.layout();
+}
+
 void cass::MachineData::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEvent* cassevent)
 {
     //during a configure transition we don't get a cassevent, so we should extract the machineevent//
@@ -38,7 +73,7 @@ void cass::MachineData::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEve
     {
         machinedataevent = &cassevent->MachineDataEvent();
         machinedataevent->isFilled() = true;
-        machinedataevent->EpicsData() = _storedevent.EpicsData();
+        cassevent->produced().add(cass::Products::MachineData);
     }
 
     switch (xtc->contains.id())
@@ -83,54 +118,30 @@ void cass::MachineData::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEve
             {
                 const Pds::EpicsPvCtrlHeader& ctrl = static_cast<const Pds::EpicsPvCtrlHeader&>(epicsData);
 //                std::cout << "epics control with id "<<ctrl.iPvId<<" and name "<< ctrl.sPvName<<" is added to index map"<<std::endl;
-                //record what name the pvId has, this help later to find the name, which is the index of map in machineevent//
-                _index2name[ctrl.iPvId] = ctrl.sPvName;
-                //now we need to create the map which we will fill later with real values//
-                //if this epics variable is an array we want an entry in the map for each entry in the array//
-                if (ctrl.iNumElements > 1)
-                {
-                    std::cout << "ctrl is bigger than 1"<<std::endl;
-                    //go through all entries of the array//
-                    //create an entry in the map with the the index in brackets//
-                    //and initialize it with 0//
-                    for (int i=0;i<ctrl.iNumElements;++i)
-                    {
-                        std::stringstream entryname;
-                        entryname << ctrl.sPvName << "[" << i << "]";
-                        _storedevent.EpicsData()[entryname.str()] = 0.;
-//                        std::cout << "add "<<entryname.str() << " to machinedatamap"<<std::endl;
-                    }
-                }
-                //otherwise we just add the name to the map and initialze it with 0//
-                else
-                {
-                    _storedevent.EpicsData()[ctrl.sPvName] = 0.;
-//                    std::cout << "add "<<ctrl.sPvName << " to machinedatamap"<<std::endl;
-                }
+                //record where the values of the pvId are, the names are only needed by the users//
+                //of the events//
+                addPv(ctrl.iPvId,ctrl.sPvName,ctrl.iNumElements);
             }
             //time is the actual data, that will be send down the xtc with 1 Hz
             else if(dbr_type_is_TIME(epicsData.iDbrType))
             {
-                //now we need to find the variable name in the map//
-                //therefore we look up the name in the indexmap//
-                std::string name = _index2name[epicsData.iPvId];
-//                std::cout <<"found id "<<epicsData.iPvId<<" lookup in the indexmap revealed the name "<<name<<std::endl;
-                //if it is an array we added the braces with the array index before,
-                //so we need to add it also now before trying to find the name in the map//
-                if (epicsData.iNumElements > 1)
-                    name.append("[0]");
-//                std::cout << "now the name is "<<name<<std::endl;
-                //try to find the the name in the map//
-                //this returns an iterator to the first entry we found//
-                //if it was an array we can then use the iterator to the next values//
-                MachineDataEvent::EpicsDataMap::iterator it = _storedevent.EpicsData().find(name);
-                //if the name is not in the map//
+                //find where the values of the variable are//
+                PvMap::const_iterator pv = _pvs.find(epicsData.iPvId);
+                //if the variable was not in the configuration//
                 //then output an erromessage//
-                if (it == _storedevent.EpicsData().end())
+                if (pv == _pvs.end())
                     std::cerr << "epics variable with id "<<epicsData.iPvId<<" was not defined"<<std::endl;
-                //otherwise extract the epicsData and write it into the map
+                //otherwise extract the epicsData and write it into the snapshot, which is copied//
+                //first when events still point to it. The event of this datagram points to it//
+                //after its first variable, it lets go so that the snapshot is copied only once//
                 else
                 {
+                    if (cassevent && machinedataevent->EpicsDataPtr().data() == _epics.data())
+                        machinedataevent->EpicsDataPtr() = MachineDataEvent::EpicsSnapshotPtr();
+                    _epics.detach();
+                    ++_epics->version();
+                    std::vector<double>::iterator it = _epics->values().begin() + pv->second.first;
+                    const int nbrElements = std::min<int>(epicsData.iNumElements,pv->second.second);
                     switch(epicsData.iDbrType)
                     {
                         CASETOVAL(DBR_TIME_SHORT ,DBR_SHORT)
@@ -147,8 +158,8 @@ void cass::MachineData::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEve
 
         default: break;
     }
-    //copy the epics values in the storedevent to the machineevent
+    //let the machineevent point to the latest epics values
     if (cassevent)
-        machinedataevent->EpicsData() = _storedevent.EpicsData();
+        machinedataevent->EpicsDataPtr() = _epics;
 
 }
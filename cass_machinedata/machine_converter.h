@@ -20,9 +20,15 @@ namespace cass
             void operator()(const Pds::Xtc*, cass::CASSEvent*);
 
         private:
-            typedef std::map<int,std::string> IndexMap;
-            IndexMap            _index2name;
-            MachineDataEvent    _storedevent;
+            //add the epics variable, an array gets one value for every element//
+            void addPv(int pvId, const std::string &name, int nbrElements);
+
+        private:
+            //where the values of an epics variable are in the snapshot: the index of the//
+            //first value and the number of values//
+            typedef std::map<int,std::pair<size_t,size_t> > PvMap;
+            PvMap                                   _pvs;
+            MachineDataEvent::EpicsSnapshotPtr      _epics;     //the latest values of all epics variables
 
 
         };
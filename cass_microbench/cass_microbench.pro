@@ -0,0 +1,50 @@
+CONFIG += console
+CONFIG -= app_bundle
+QT -= gui
+TEMPLATE = app
+TARGET = microbench
+VERSION = 0.0.1
+
+
+SOURCES += microbench.cpp \
+           pnccd_kernels.cpp \
+           remi_kernels.cpp \
+           vmi_kernels.cpp \
+           output_kernels.cpp \
+           ../cass/photon_list.cpp \
+
+HEADERS += microbench.h \
+           ../cass_xtcgen/xtc_generator.h \
+           ../cass/photon_list.h \
+
+INCLUDEPATH += ../LCLS \
+               ../cass \
+               ../cass_xtcgen \
+               ../cass_remi \
+               ../cass_remi/classes/event \
+               ../cass_remi/classes/event/channel \
+               ../cass_remi/classes/event/peak \
+               ../cass_remi/classes/event/detector \
+               ../cass_remi/classes/detektorhitsorter \
+               ../cass_remi/classes/waveformanalyzer \
+               ../cass_vmi \
+               ../cass_vmi/classes/event \
+               ../cass_pnccd \
+               ../cass_pnccd/classes/event/pnccd_detector \
+               ../cass_pnccd/pnccd_lib \
+
+LIBS += -L../cass_remi -lcass_remi \
+        -L../cass_pnccd -lcass_pnccd \
+        -L../cass_vmi -lcass_vmi \
+
+TARGETDEPS += ../cass_remi/libcass_remi.a \
+              ../cass_pnccd/libcass_pnccd.a \
+              ../cass_vmi/libcass_vmi.a \
+
+
+
+
+INSTALLBASE    = /usr/local/cass
+bin.path       = $$INSTALLBASE/bin
+bin.files      = microbench
+INSTALLS      += bin
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "microbench.h"
+
+
+namespace
+{
+  const char help_text[] =
+    "usage: microbench [options] [kernel ...]\n\
+    Runs the kernels whose names start with one of the given names (default all) on canned\n\
+    inputs, prints the statistics of the run times and compares the results to the golden ones\n\
+    \n\
+    -n: Number of timed runs of every kernel (default 20)\n\
+    -w: Number of runs before the timed ones (default 2)\n\
+    -g: Directory of the golden results (default golden)\n\
+    -u: write the results as the new golden results instead of comparing them\n\
+    -l: list the kernels\n\
+    -h: print this text\n\
+";
+
+  //monotonic time in nanoseconds//
+  uint64_t now()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return static_cast<uint64_t>(ts.tv_sec)*1000000000 + ts.tv_nsec;
+  }
+
+  std::string goldenFile(const std::string &dir, const cass::MicroBench::Kernel &kernel)
+  {
+    return dir + "/" + kernel.golden() + ".txt";
+  }
+
+  //the golden result is a text file with one value per line after a header line//
+  bool readGolden(const std::string &filename, std::vector<double> &values)
+  {
+    std::ifstream in(filename.c_str());
+    if (!in)
+      return false;
+    values.clear();
+    std::string line;
+    while (std::getline(in,line))
+    {
+      if (line.empty() || line[0] == '#')
+        continue;
+      values.push_back(strtod(line.c_str(),0));
+    }
+    return true;
+  }
+
+  bool writeGolden(const std::string &filename, const cass::MicroBench::Kernel &kernel,
+                   const std::vector<double> &values)
+  {
+    //write to a temporary file first, so that a failed write leaves the old result//
+    const std::string tmp = filename + ".tmp";
+    FILE *out = fopen(tmp.c_str(),"w");
+    if (!out)
+      return false;
+    fprintf(out,"# %s %lu\n",kernel.golden().c_str(),static_cast<unsigned long>(values.size()));
+    for (size_t i=0; i<values.size(); ++i)
+      fprintf(out,"%.17g\n",values[i]);
+    const bool ok = !ferror(out);
+    if (fclose(out) || !ok || rename(tmp.c_str(),filename.c_str()))
+    {
+      remove(tmp.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  //compare the result to the golden one, returns whether it is within the tolerances and//
+  //describes the outcome in status//
+  bool compare(const cass::MicroBench::Kernel &kernel, const std::vector<double> &result,
+               const std::vector<double> &golden, std::string &status)
+  {
+    std::ostringstream s;
+    if (result.size() != golden.size())
+    {
+      s << "FAILED: " << result.size() << " values instead of " << golden.size();
+      status = s.str();
+      return false;
+    }
+    bool exact = true;
+    size_t nbrBad = 0;
+    size_t firstBad = 0;
+    double maxDeviation = 0;
+    for (size_t i=0; i<result.size(); ++i)
+    {
+      //nan is only equal to nan//
+      if (result[i] == golden[i] || (result[i] != result[i] && golden[i] != golden[i]))
+        continue;
+      exact = false;
+      const double deviation = fabs(result[i]-golden[i]);
+      maxDeviation = std::max(maxDeviation,deviation);
+      if (!(deviation <= kernel.absTolerance() + kernel.relTolerance()*fabs(golden[i])))
+        if (!nbrBad++)
+          firstBad = i;
+    }
+    if (nbrBad)
+      s << "FAILED: " << nbrBad << " values differ, first is value " << firstBad
+        << " (" << std::setprecision(17) << result[firstBad] << " instead of " << golden[firstBad] << ")";
+    else if (exact)
+      s << "exact";
+    else
+      s << "ok, max deviation " << std::setprecision(3) << maxDeviation;
+    status = s.str();
+    return !nbrBad;
+  }
+
+  bool selected(const std::string &name, const std::vector<std::string> &selection)
+  {
+    if (selection.empty())
+      return true;
+    for (size_t i=0; i<selection.size(); ++i)
+      if (name.compare(0,selection[i].size(),selection[i]) == 0)
+        return true;
+    return false;
+  }
+}
+
+
+
+int main(int argc, char **argv)
+{
+  int nbrRuns = 20;
+  int nbrWarmups = 2;
+  std::string goldenDir("golden");
+  bool update = false;
+  bool list = false;
+  int c;
+  while ((c = getopt(argc,argv,"n:w:g:ulh")) != -1)
+  {
+    switch(c)
+    {
+    case 'n': nbrRuns    = std::max(1,atoi(optarg)); break;
+    case 'w': nbrWarmups = std::max(0,atoi(optarg)); break;
+    case 'g': goldenDir  = optarg; break;
+    case 'u': update     = true; break;
+    case 'l': list       = true; break;
+    case 'h':
+      printf("%s",help_text);
+      return 0;
+    default:
+      printf("%s",help_text);
+      return 1;
+    }
+  }
+  std::vector<std::string> selection(argv+optind,argv+argc);
+
+  cass::MicroBench::kernels_t kernels;
+  cass::MicroBench::addPnCCDKernels(kernels);
+  cass::MicroBench::addREMIKernels(kernels);
+  cass::MicroBench::addVMIKernels(kernels);
+  cass::MicroBench::addOutputKernels(kernels);
+
+  if (list)
+  {
+    for (size_t i=0; i<kernels.size(); ++i)
+      std::cout << kernels[i]->name() << std::endl;
+    return 0;
+  }
+
+  bool ok = true;
+  std::cout << std::fixed;
+  std::cout << "# kernel runs min[us] median[us] mean[us] p90[us] max[us] result" << std::endl;
+  for (size_t k=0; k<kernels.size(); ++k)
+  {
+    cass::MicroBench::Kernel &kernel = *kernels[k];
+    if (!selected(kernel.name(),selection))
+      continue;
+    kernel.setup();
+    for (int i=0; i<nbrWarmups; ++i)
+    {
+      kernel.reset();
+      kernel.run();
+    }
+    std::vector<double> times(nbrRuns);
+    for (int i=0; i<nbrRuns; ++i)
+    {
+      kernel.reset();
+      const uint64_t start = now();
+      kernel.run();
+      times[i] = (now()-start)*1e-3;
+    }
+    std::vector<double> sorted(times);
+    std::sort(sorted.begin(),sorted.end());
+    double sum = 0;
+    for (size_t i=0; i<sorted.size(); ++i)
+      sum += sorted[i];
+
+    std::vector<double> result;
+    kernel.result(result);
+    std::string status;
+    if (update)
+    {
+      if (writeGolden(goldenFile(goldenDir,kernel),kernel,result))
+        status = "written";
+      else
+      {
+        status = "FAILED: could not write " + goldenFile(goldenDir,kernel);
+        ok = false;
+      }
+    }
+    else
+    {
+      std::vector<double> golden;
+      if (!readGolden(goldenFile(goldenDir,kernel),golden))
+      {
+        status = "FAILED: no golden result " + goldenFile(goldenDir,kernel);
+        ok = false;
+      }
+      else if (!compare(kernel,result,golden,status))
+        ok = false;
+    }
+
+    std::cout << kernel.name()
+              << " " << nbrRuns
+              << std::setprecision(1)
+              << " " << sorted.front()
+              << " " << sorted[sorted.size()/2]
+              << " " << sum/sorted.size()
+              << " " << sorted[std::min(sorted.size()-1,static_cast<size_t>(0.9*sorted.size()))]
+              << " " << sorted.back()
+              << " " << status
+              << std::endl;
+  }
+  for (size_t k=0; k<kernels.size(); ++k)
+    delete kernels[k];
+  return ok ? 0 : 1;
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,87 @@
+#ifndef CASS_MICROBENCH_H
+#define CASS_MICROBENCH_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace cass
+{
+  namespace MicroBench
+  {
+    //one kernel of the analysis together with its canned input. The harness calls setup() once,//
+    //then reset() and run() for every repetition, only run() is timed. The result of the last//
+    //run is compared to the golden result, values agree when they differ by less than//
+    //absTolerance + relTolerance*|golden|//
+    class Kernel
+    {
+    public:
+      Kernel(const std::string &name, double absTolerance=0, double relTolerance=0)
+        :_name(name),_golden(name),_absTolerance(absTolerance),_relTolerance(relTolerance)  {}
+      virtual ~Kernel()     {}
+
+      //create the canned input//
+      virtual void setup() = 0;
+      //bring the kernel back to the state before run()//
+      virtual void reset()  {}
+      //the work that is timed//
+      virtual void run() = 0;
+      //the numbers that are compared to the golden result//
+      virtual void result(std::vector<double>&) = 0;
+
+    public:
+      const std::string &name()const    {return _name;}
+      //the name of the golden result, kernels that have to give the same result share it//
+      const std::string &golden()const  {return _golden;}
+      double absTolerance()const        {return _absTolerance;}
+      double relTolerance()const        {return _relTolerance;}
+
+    protected:
+      std::string _name;
+      std::string _golden;
+      double      _absTolerance;
+      double      _relTolerance;
+    };
+
+    typedef std::vector<Kernel*> kernels_t;
+
+    //the kernels of the detectors//
+    void addPnCCDKernels(kernels_t&);
+    void addREMIKernels(kernels_t&);
+    void addVMIKernels(kernels_t&);
+    //the kernels of the outputs//
+    void addOutputKernels(kernels_t&);
+
+    //a short result for a large frame: the sums of tile x tile pixels and a checksum that//
+    //depends on the position of every pixel//
+    template <typename T>
+    void summarize(const T *frame, size_t columns, size_t rows, size_t tile, std::vector<double> &result)
+    {
+      const size_t tileColumns = (columns+tile-1)/tile;
+      const size_t tileRows    = (rows+tile-1)/tile;
+      const size_t first       = result.size();
+      result.resize(first + tileColumns*tileRows + 1,0);
+      double checksum = 0;
+      for (size_t row=0; row<rows; ++row)
+        for (size_t col=0; col<columns; ++col)
+        {
+          const double value = frame[row*columns+col];
+          result[first + (row/tile)*tileColumns + col/tile] += value;
+          checksum += value * ((row*columns+col)%65521 + 1);
+        }
+      result.back() = checksum;
+    }
+  }//end namespace MicroBench
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "microbench.h"
+#include "xtc_generator.h"
+#include "photon_list.h"
+
+
+namespace
+{
+  //the pnCCD frames have 1024x1024 pixels//
+  const uint16_t pixels = 1024;
+
+  //writes the photon hits of a rebinned frame to a photon list and reads them back. The result//
+  //is the difference between the frame read back and the hits summed up in the rebinned//
+  //pixels, so the golden result is all zero//
+  class PhotonListRoundTrip : public cass::MicroBench::Kernel
+  {
+  public:
+    PhotonListRoundTrip(const std::string &name, uint32_t rebin)
+      :cass::MicroBench::Kernel(name,1e-3),_rebin(rebin)  {}
+    void setup()
+    {
+      const char *tmp = getenv("TMPDIR");
+      _filename = std::string(tmp ? tmp : "/tmp") + "/microbench_" + _name;
+      //as the analysis leaves them: the hits in detector pixels, the frame rebinned//
+      _detector.originalrows()    = pixels;
+      _detector.originalcolumns() = pixels;
+      _detector.rows()    = pixels / _rebin;
+      _detector.columns() = pixels / _rebin;
+      _detector.correctedFrame().assign(static_cast<size_t>(_detector.rows())*_detector.columns(),0);
+      _expected.assign(_detector.correctedFrame().size(),0);
+      cass::XtcGenerator::Random random(28);
+      _detector.nonrecombined().resize(2000);
+      for (size_t i=0; i<_detector.nonrecombined().size(); ++i)
+      {
+        cass::pnCCD::PhotonHit &hit = _detector.nonrecombined()[i];
+        hit.x()         = static_cast<uint16_t>(random.uniform()*pixels);
+        hit.y()         = static_cast<uint16_t>(random.uniform()*pixels);
+        hit.amplitude() = 0;
+        hit.energy()    = static_cast<float>(100 + 900*random.uniform());
+        _expected[(hit.y()/_rebin)*_detector.columns() + hit.x()/_rebin] += hit.energy();
+      }
+    }
+    void reset()
+    {
+      remove((_filename + ".bin").c_str());
+      remove((_filename + ".idx").c_str());
+    }
+    void run()
+    {
+      cass::PhotonListFile file;
+      file.open(_filename);
+      file.append(1,0,_detector);
+      file.close();
+      cass::PhotonListReader reader;
+      _image.clear();
+      _frame = cass::PhotonListReader::Frame();
+      const cass::PhotonListReader::IndexEntry *entry;
+      if (reader.open(_filename) && (entry = reader.find(1,0)) && reader.read(*entry,_frame))
+        cass::PhotonListReader::rasterize(_frame,_image);
+    }
+    void result(std::vector<double> &result)
+    {
+      result.push_back(static_cast<double>(_frame.rows)    - _detector.rows());
+      result.push_back(static_cast<double>(_frame.columns) - _detector.columns());
+      result.push_back(_frame.format);
+      result.push_back(static_cast<double>(_frame.hits.size()) - _detector.nonrecombined().size());
+      std::vector<float> difference(_expected);
+      for (size_t i=0; i<difference.size() && i<_image.size(); ++i)
+        difference[i] = _image[i] - _expected[i];
+      cass::MicroBench::summarize(&difference[0],_detector.columns(),_detector.rows(),16,result);
+      reset();
+    }
+  private:
+    uint32_t                          _rebin;
+    std::string                       _filename;
+    cass::pnCCD::pnCCDDetector        _detector;
+    std::vector<float>                _expected;
+    std::vector<float>                _image;
+    cass::PhotonListReader::Frame     _frame;
+  };
+}
+
+
+void cass::MicroBench::addOutputKernels(kernels_t &kernels)
+{
+  kernels.push_back(new PhotonListRoundTrip("photonlist.rebin.1",1));
+  kernels.push_back(new PhotonListRoundTrip("photonlist.rebin.4",4));
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
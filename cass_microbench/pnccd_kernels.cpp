@@ -0,0 +1,175 @@
+#include <cmath>
+#include <algorithm>
+
+#include "microbench.h"
+#include "xtc_generator.h"
+#include "pix_event_data.h"
+#include "pixel_rearr_set.C"
+#include "frame_rebin.h"
+
+
+namespace
+{
+  //the raw frames are 1024x1024 pixels that the analysis sees as 512 lines of 2048 channels//
+  const int nbrChannels = 2048;
+  const int nbrLines    = 512;
+
+  //a frame with its dark calibration: pixels with an offset and noise, a common mode that//
+  //changes from line to line, a few bad pixels and photon hits on 0.2% of the pixels//
+  struct CannedFrame
+  {
+    std::vector<staDataType> stats;
+    std::vector<char>        badmap;
+    std::vector<int16_t>     raw;
+  };
+
+  CannedFrame &cannedFrame()
+  {
+    static CannedFrame frame;
+    if (!frame.raw.empty())
+      return frame;
+    const size_t nbrPixels = nbrChannels*nbrLines;
+    cass::XtcGenerator::Random random(44);
+    frame.stats.resize(nbrPixels);
+    frame.badmap.resize(nbrPixels);
+    frame.raw.resize(nbrPixels);
+    for (size_t i=0; i<nbrPixels; ++i)
+    {
+      const double mean = floor(1000 + 50*random.gaussian() + 0.5);
+      staDataType &s = frame.stats[i];
+      s.sum    = 0;
+      s.sumSq  = 0;
+      s.count  = 0;
+      s.offset = mean + 100;
+      s.mean   = static_cast<pxType>(mean);
+      s.sigma  = 3 + 2*random.uniform();
+      frame.badmap[i] = random.uniform() < 0.001;
+    }
+    for (int line=0; line<nbrLines; ++line)
+    {
+      const double commonMode = 80 + 40*random.uniform();
+      for (int channel=0; channel<nbrChannels; ++channel)
+      {
+        const size_t i = line*nbrChannels + channel;
+        double value = frame.stats[i].mean + commonMode + frame.stats[i].sigma*random.gaussian();
+        if (random.uniform() < 0.002)
+          value += 200 + 400*random.uniform();
+        frame.raw[i] = static_cast<int16_t>(std::max(0.,std::min(16383.,floor(value + 0.5))));
+      }
+    }
+    return frame;
+  }
+
+
+  //the offset correction and photon finding of a frame by the Xonline library//
+  class AnalyzeFrame : public cass::MicroBench::Kernel
+  {
+  public:
+    AnalyzeFrame(const std::string &name, PixEventData::FRMANL_MODE mode)
+      :cass::MicroBench::Kernel(name),_mode(mode)   {}
+    void setup()
+    {
+      CannedFrame &frame = cannedFrame();
+      _signals.assign(frame.raw.size(),0);
+      _analysis.setFramePixStatMap(&frame.stats[0],nbrChannels,nbrLines);
+      _analysis.setFrameBadPixMap(&frame.badmap[0],nbrChannels,nbrLines);
+      _analysis.setPixSignalBfrAddr(&_signals[0],nbrChannels,nbrLines);
+      _analysis.setFrmAnalysisMode(_mode);
+      _buffer.frH.index   = 1;
+      _buffer.frH.tv_sec  = 1;
+      _buffer.frH.tv_usec = 1;
+      _buffer.px          = &frame.raw[0];
+    }
+    //the frame can only be analyzed once after it has been set//
+    void reset()    {_analysis.setCurrentFrame(&_buffer,nbrChannels,nbrLines);}
+    void run()      {_analysis.analyzeCurrentFrame();}
+    void result(std::vector<double> &result)
+    {
+      cass::MicroBench::summarize(&_signals[0],nbrChannels,nbrLines,32,result);
+      int nbrEvents = 0;
+      const eventType *events = _analysis.getCorrectedFrameEvents(nbrEvents);
+      result.push_back(nbrEvents);
+      for (int i=0; i<nbrEvents; ++i)
+      {
+        result.push_back(events[i].x);
+        result.push_back(events[i].y);
+        result.push_back(events[i].q);
+        result.push_back(events[i].value);
+        result.push_back(events[i].corrval);
+      }
+    }
+  private:
+    PixEventData::FRMANL_MODE _mode;
+    PixEventData              _analysis;
+    shmBfrType                _buffer;
+    std::vector<pxType>       _signals;
+  };
+
+
+  //putting the four segments of the frame to where they are on the detector//
+  class RearrangePixels : public cass::MicroBench::Kernel
+  {
+  public:
+    RearrangePixels():cass::MicroBench::Kernel("pnccd.rearrange")    {}
+    void setup()
+    {
+      //the geometry of the two CFEL pnCCD modules, like pnCCDFrameAnalysis//
+      _rearrangement.setTotalArraySizes(2048,512,1024,1024);
+      _rearrangement.addPixelRearrgmnt(512,512,    0,0,   512,  0,   -1, 1);
+      _rearrangement.addPixelRearrgmnt(512,512,  512,0,     0,  0,    1,-1);
+      _rearrangement.addPixelRearrgmnt(512,512, 1024,0,     0,512,    1,-1);
+      _rearrangement.addPixelRearrgmnt(512,512, 1536,0,   512,512,   -1, 1);
+      _rearrangement.initPixRearrSet();
+      _frame = cannedFrame().raw;
+      _rearranged.assign(_frame.size(),0);
+    }
+    void run()      {_rearrangement.rearrangeAllPixels(&_frame[0],&_rearranged[0]);}
+    void result(std::vector<double> &result)
+    {
+      cass::MicroBench::summarize(&_rearranged[0],1024,1024,32,result);
+    }
+  private:
+    PixelRearrSet<int16_t,int16_t> _rearrangement;
+    std::vector<int16_t>           _frame;
+    std::vector<int16_t>           _rearranged;
+  };
+
+
+  //summing up factor x factor pixels of a frame//
+  class Rebin : public cass::MicroBench::Kernel
+  {
+  public:
+    Rebin(const std::string &name, uint32_t factor)
+      :cass::MicroBench::Kernel(name),_factor(factor)   {}
+    void setup()    {_frame = cannedFrame().raw;}
+    void run()      {cass::pnCCD::rebin(_frame,1024,1024,_factor,_rebinned);}
+    void result(std::vector<double> &result)
+    {
+      cass::MicroBench::summarize(&_rebinned[0],1024/_factor,1024/_factor,32/_factor,result);
+    }
+  private:
+    uint32_t             _factor;
+    std::vector<int16_t> _frame;
+    std::vector<int16_t> _rebinned;
+  };
+}
+
+
+void cass::MicroBench::addPnCCDKernels(kernels_t &kernels)
+{
+  kernels.push_back(new AnalyzeFrame("pnccd.analyzeframe",PixEventData::NOCMMD_NOEVT));
+  kernels.push_back(new AnalyzeFrame("pnccd.analyzeframe.events",PixEventData::CMMD_EVT));
+  kernels.push_back(new RearrangePixels());
+  kernels.push_back(new Rebin("pnccd.rebin.2",2));
+  kernels.push_back(new Rebin("pnccd.rebin.4",4));
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,284 @@
+#include <cmath>
+#include <algorithm>
+
+#include "microbench.h"
+#include "xtc_generator.h"
+#include "remi_event.h"
+#include "cfd.h"
+#include "com.h"
+#include "helperfunctionsforstdc.h"
+#include "detektorhitsorter_simple.h"
+
+
+namespace
+{
+  const double sampleInterval = 1e-9;       //in s
+
+  //busy channels: 20000 samples of 10 bit with a noise of 2 counts and 150 negative pulses//
+  //of 100 to 400 counts and a sigma of 2 samples each. The gain is 1 mV per count//
+  const std::vector<cass::REMI::Channel> &cannedChannels()
+  {
+    static std::vector<cass::REMI::Channel> channels;
+    if (!channels.empty())
+      return channels;
+    const size_t nbrSamples = 20000;
+    cass::XtcGenerator::Random random(36);
+    channels.resize(4);
+    for (size_t ic=0; ic<channels.size(); ++ic)
+    {
+      cass::REMI::Channel &c = channels[ic];
+      c.channelNbr()  = ic;
+      c.horpos()      = 0;
+      c.fullscale()   = 1024;
+      c.offset()      = 0;
+      c.gain()        = 1;
+      c.threshold()   = 20;
+      c.delay()       = 5;
+      c.fraction()    = 0.6;
+      c.walk()        = 0;
+      std::vector<double> waveform(nbrSamples);
+      for (size_t i=0; i<nbrSamples; ++i)
+        waveform[i] = 2*random.gaussian();
+      for (int p=0; p<150; ++p)
+      {
+        const double position  = 10 + random.uniform()*(nbrSamples-20);
+        const double amplitude = 100 + 300*random.uniform();
+        const int center = static_cast<int>(position);
+        for (int i=std::max(0,center-8); i<std::min<int>(nbrSamples,center+9); ++i)
+          waveform[i] -= amplitude*exp(-0.5*(i-position)*(i-position)/4.);
+      }
+      c.waveform().resize(nbrSamples);
+      for (size_t i=0; i<nbrSamples; ++i)
+        c.waveform()[i] = static_cast<int16_t>(std::max(-512.,std::min(511.,floor(waveform[i]+0.5))));
+      c.useWaveform();
+    }
+    return channels;
+  }
+
+  void addPeak(const cass::REMI::Peak &p, std::vector<double> &result)
+  {
+    result.push_back(p.time());
+    result.push_back(p.polarity());
+    result.push_back(p.startpos());
+    result.push_back(p.stoppos());
+    result.push_back(p.maxpos());
+    result.push_back(p.maximum());
+    result.push_back(p.fwhm());
+    result.push_back(p.integral());
+    result.push_back(p.com());
+  }
+
+
+  //finding the peaks in the waveforms and characterizing them//
+  class FindPeaks : public cass::MicroBench::Kernel
+  {
+  public:
+    FindPeaks(const std::string &name, cass::REMI::WaveformAnalyzer::WaveformAnalyzerTypes type)
+      :cass::MicroBench::Kernel(name,1e-6,1e-9),_type(type),_analyzer(0)    {}
+    ~FindPeaks()    {delete _analyzer;}
+    void setup()
+    {
+      _channels = cannedChannels();
+      delete _analyzer;
+      if (_type == cass::REMI::WaveformAnalyzer::CFD16Bit)
+        _analyzer = new cass::REMI::CFD16Bit();
+      else
+        _analyzer = new cass::REMI::CoM16Bit();
+    }
+    void reset()
+    {
+      for (size_t ic=0; ic<_channels.size(); ++ic)
+        _channels[ic].peaks().clear();
+    }
+    void run()
+    {
+      for (size_t ic=0; ic<_channels.size(); ++ic)
+        _analyzer->analyze(_channels[ic],sampleInterval);
+    }
+    void result(std::vector<double> &result)
+    {
+      for (size_t ic=0; ic<_channels.size(); ++ic)
+      {
+        const cass::REMI::Channel::peaks_t &peaks = _channels[ic].peaks();
+        result.push_back(peaks.size());
+        for (size_t i=0; i<peaks.size(); ++i)
+          addPeak(peaks[i],result);
+      }
+    }
+  private:
+    cass::REMI::WaveformAnalyzer::WaveformAnalyzerTypes _type;
+    cass::REMI::WaveformAnalyzer        *_analyzer;
+    std::vector<cass::REMI::Channel>     _channels;
+  };
+
+
+  //the maximum, fwhm, integral and center of mass of the peaks that the CFD found, either//
+  //with characterize() in one pass or with the separate helpers that each scan the peak//
+  class CharacterizePeaks : public cass::MicroBench::Kernel
+  {
+  public:
+    CharacterizePeaks(const std::string &name, bool separate)
+      :cass::MicroBench::Kernel(name,1e-6,1e-9),_separate(separate)    {}
+    void setup()
+    {
+      _channels = cannedChannels();
+      cass::REMI::CFD16Bit cfd;
+      for (size_t ic=0; ic<_channels.size(); ++ic)
+        cfd.analyze(_channels[ic],sampleInterval);
+    }
+    void run()
+    {
+      for (size_t ic=0; ic<_channels.size(); ++ic)
+      {
+        cass::REMI::Channel &c = _channels[ic];
+        for (size_t i=0; i<c.peaks().size(); ++i)
+        {
+          cass::REMI::Peak &p = c.peaks()[i];
+          if (_separate)
+          {
+            cass::REMI::maximum<short>(c,p);
+            cass::REMI::fwhm<short>(c,p);
+            cass::REMI::CoM<short>(c,p,sampleInterval);
+          }
+          else
+            cass::REMI::characterize<short>(c,p,sampleInterval);
+        }
+      }
+    }
+    void result(std::vector<double> &result)
+    {
+      for (size_t ic=0; ic<_channels.size(); ++ic)
+      {
+        const cass::REMI::Channel::peaks_t &peaks = _channels[ic].peaks();
+        result.push_back(peaks.size());
+        for (size_t i=0; i<peaks.size(); ++i)
+          addPeak(peaks[i],result);
+      }
+    }
+  private:
+    bool                                 _separate;
+    std::vector<cass::REMI::Channel>     _channels;
+  };
+
+
+  bool earlier(const cass::REMI::Peak &a, const cass::REMI::Peak &b)
+  {
+    return a.time() < b.time();
+  }
+
+  //sorting the peaks of a quad anode into hits: 500 hits within 20 us whose signals are//
+  //jittered by 0.1 ns, together with 10% additional noise peaks on every signal//
+  class SortHits : public cass::MicroBench::Kernel
+  {
+  public:
+    SortHits():cass::MicroBench::Kernel("remi.sort.simple",1e-9,1e-12)   {}
+    void setup()
+    {
+      cass::REMI::Detector &d = _detector;
+      d.runtime()     = 150;
+      d.mcpRadius()   = 66;
+      d.isHexAnode()  = false;
+      d.u().tsLow()   = 98;
+      d.u().tsHigh()  = 102;
+      d.u().sf()      = 0.5;
+      d.v().tsLow()   = 98;
+      d.v().tsHigh()  = 102;
+      d.v().sf()      = 0.5;
+      cass::REMI::Signal *signals[5] = {&d.mcp(),&d.u().one(),&d.u().two(),&d.v().one(),&d.v().two()};
+      for (size_t i=0; i<5; ++i)
+      {
+        signals[i]->chanNbr()  = i;
+        signals[i]->polarity() = cass::REMI::Peak::Negative;
+        signals[i]->trLow()    = 0;
+        signals[i]->trHigh()   = 30000;
+      }
+
+      cass::XtcGenerator::Random random(43);
+      _event.channels().resize(5);
+      std::vector<cass::REMI::Peak> peaks[5];
+      for (int h=0; h<500; ++h)
+      {
+        double x,y;
+        do
+        {
+          x = (2*random.uniform()-1)*60;
+          y = (2*random.uniform()-1)*60;
+        } while (x*x+y*y > 60*60);
+        const double mcp = 20000*random.uniform();
+        const double times[5] = {mcp,
+                                 mcp + 0.5*(100 + x/d.u().sf()),
+                                 mcp + 0.5*(100 - x/d.u().sf()),
+                                 mcp + 0.5*(100 + y/d.v().sf()),
+                                 mcp + 0.5*(100 - y/d.v().sf())};
+        for (size_t i=0; i<5; ++i)
+        {
+          cass::REMI::Peak p;
+          p.time()     = times[i] + 0.1*random.gaussian();
+          p.polarity() = cass::REMI::Peak::Negative;
+          peaks[i].push_back(p);
+        }
+      }
+      for (size_t i=0; i<5; ++i)
+      {
+        for (int n=0; n<50; ++n)
+        {
+          cass::REMI::Peak p;
+          p.time()     = 20200*random.uniform();
+          p.polarity() = cass::REMI::Peak::Negative;
+          peaks[i].push_back(p);
+        }
+        std::sort(peaks[i].begin(),peaks[i].end(),earlier);
+        _event.channels()[i].peaks() = peaks[i];
+      }
+    }
+    void reset()
+    {
+      cass::REMI::Detector &d = _detector;
+      cass::REMI::Signal *signals[5] = {&d.mcp(),&d.u().one(),&d.u().two(),&d.v().one(),&d.v().two()};
+      for (size_t i=0; i<5; ++i)
+      {
+        signals[i]->peaks().clear();
+        cass::REMI::Channel::peaks_t &peaks = _event.channels()[i].peaks();
+        for (size_t j=0; j<peaks.size(); ++j)
+          peaks[j].isUsed() = false;
+      }
+      d.hits().clear();
+    }
+    void run()      {_sorter.sort(_event,_detector);}
+    void result(std::vector<double> &result)
+    {
+      const cass::REMI::Detector::dethits_t &hits = _detector.hits();
+      result.push_back(hits.size());
+      for (size_t i=0; i<hits.size(); ++i)
+      {
+        result.push_back(hits[i].x());
+        result.push_back(hits[i].y());
+        result.push_back(hits[i].t());
+      }
+    }
+  private:
+    cass::REMI::REMIEvent               _event;
+    cass::REMI::Detector                _detector;
+    cass::REMI::DetectorHitSorterSimple _sorter;
+  };
+}
+
+
+void cass::MicroBench::addREMIKernels(kernels_t &kernels)
+{
+  kernels.push_back(new FindPeaks("remi.cfd16",cass::REMI::WaveformAnalyzer::CFD16Bit));
+  kernels.push_back(new FindPeaks("remi.com16",cass::REMI::WaveformAnalyzer::CoM16Bit));
+  kernels.push_back(new CharacterizePeaks("remi.characterize",false));
+  kernels.push_back(new CharacterizePeaks("remi.characterize.separate",true));
+  kernels.push_back(new SortHits());
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,193 @@
+#include <cmath>
+#include <algorithm>
+#include <stdlib.h>
+
+#include "microbench.h"
+#include "xtc_generator.h"
+#include "blob_finder.h"
+#include "hit_accumulator.h"
+#include "pbasex.h"
+
+
+namespace
+{
+  const size_t columns = 1024;
+  const size_t rows    = 1024;
+
+  //a point on a ring around the center of the frame, the angle to the polarisation along the//
+  //columns is distributed like 1 + beta2 P2(cos theta) with beta2 = 1.5//
+  void ringPoint(cass::XtcGenerator::Random &random, double &x, double &y)
+  {
+    const double beta2 = 1.5;
+    double theta, weight;
+    do
+    {
+      theta = 2*M_PI*random.uniform();
+      const double c = cos(theta);
+      weight = 1 + beta2*0.5*(3*c*c-1);
+    } while (random.uniform()*(1+beta2) > weight);
+    const double r = 256 + 3*random.gaussian();
+    x = 0.5*columns + r*sin(theta);
+    y = 0.5*rows    + r*cos(theta);
+  }
+
+  //a camera frame with a baseline of 32, noise and 500 spots of 5x5 pixels on the ring//
+  const std::vector<uint16_t> &cannedFrame()
+  {
+    static std::vector<uint16_t> frame;
+    if (!frame.empty())
+      return frame;
+    cass::XtcGenerator::Random random(39);
+    frame.resize(columns*rows);
+    for (size_t i=0; i<frame.size(); ++i)
+      frame[i] = static_cast<uint16_t>(std::max(0.,floor(32 + 2*random.gaussian() + 0.5)));
+    for (int s=0; s<500; ++s)
+    {
+      double x,y;
+      ringPoint(random,x,y);
+      const double amplitude = 200 + 600*random.uniform();
+      for (int iy=static_cast<int>(y)-2; iy<=static_cast<int>(y)+2; ++iy)
+        for (int ix=static_cast<int>(x)-2; ix<=static_cast<int>(x)+2; ++ix)
+        {
+          const double d2 = (ix-x)*(ix-x) + (iy-y)*(iy-y);
+          uint16_t &pixel = frame[iy*columns+ix];
+          pixel = static_cast<uint16_t>(std::min(4095.,pixel + floor(amplitude*exp(-d2/(2*1.2*1.2)))));
+        }
+    }
+    return frame;
+  }
+
+  //the centroids of many frames: 200000 hits on the ring//
+  const cass::VMI::VMIEvent::centroids_t &cannedCentroids()
+  {
+    static cass::VMI::VMIEvent::centroids_t centroids;
+    if (!centroids.empty())
+      return centroids;
+    cass::XtcGenerator::Random random(40);
+    centroids.resize(200000);
+    for (size_t i=0; i<centroids.size(); ++i)
+    {
+      double x,y;
+      ringPoint(random,x,y);
+      centroids[i] = cass::VMI::Centroid(x,y,1000,9);
+    }
+    return centroids;
+  }
+
+
+  //finding the blobs of the hits in a frame and their centroids//
+  class FindBlobs : public cass::MicroBench::Kernel
+  {
+  public:
+    FindBlobs(const std::string &name, uint32_t nbrThreads)
+      :cass::MicroBench::Kernel(name,0,0),_nbrThreads(nbrThreads)
+    {
+      //the blobs have to be the same whatever the number of threads is//
+      _golden = "vmi.blobs";
+    }
+    void setup()    {cannedFrame();}
+    void run()      {_finder(&cannedFrame()[0],columns,rows,100,1,1000,_nbrThreads,_centroids);}
+    void result(std::vector<double> &result)
+    {
+      result.push_back(_centroids.size());
+      for (size_t i=0; i<_centroids.size(); ++i)
+      {
+        result.push_back(_centroids[i].x);
+        result.push_back(_centroids[i].y);
+        result.push_back(_centroids[i].integral);
+        result.push_back(_centroids[i].size);
+      }
+    }
+  private:
+    uint32_t                            _nbrThreads;
+    cass::VMI::BlobFinder               _finder;
+    cass::VMI::VMIEvent::centroids_t    _centroids;
+  };
+
+
+  //summing up the centroids into an image with 2x2 bins per pixel//
+  class AccumulateHits : public cass::MicroBench::Kernel
+  {
+  public:
+    AccumulateHits(const std::string &name, uint32_t nbrThreads)
+      :cass::MicroBench::Kernel(name,0,0),_nbrThreads(nbrThreads)
+    {
+      _golden = "vmi.accumulate";
+    }
+    void setup()
+    {
+      _accumulator.configure(columns,rows,2,_nbrThreads);
+      cannedCentroids();
+    }
+    void reset()    {_accumulator.clear();}
+    void run()
+    {
+      _accumulator.add(cannedCentroids(),_nbrThreads);
+      _accumulator.merge();
+    }
+    void result(std::vector<double> &result)
+    {
+      result.push_back(_accumulator.nbrHits());
+      cass::MicroBench::summarize(&_accumulator.image()[0],_accumulator.columns(),_accumulator.rows(),
+                                  64,result);
+    }
+  private:
+    uint32_t                   _nbrThreads;
+    cass::VMI::HitAccumulator  _accumulator;
+  };
+
+
+  //the pBasex inversion of the accumulated image, the basis is taken from the cache//
+  //directory when it was calculated before//
+  class Invert : public cass::MicroBench::Kernel
+  {
+  public:
+    Invert():cass::MicroBench::Kernel("vmi.pbasex",1e-3,1e-4)    {}
+    void setup()
+    {
+      cass::VMI::PBasex::Geometry geometry;
+      geometry.radialBins     = 128;
+      geometry.angularBins    = 64;
+      geometry.radialBasis    = 64;
+      geometry.maxOrder       = 4;
+      geometry.radius         = 400;
+      geometry.regularization = 1e-4;
+      const char *tmp = getenv("TMPDIR");
+      _pbasex.setup(geometry,tmp ? tmp : "/tmp");
+      cass::VMI::HitAccumulator accumulator;
+      accumulator.configure(columns,rows,2,1);
+      accumulator.add(cannedCentroids(),1);
+      accumulator.merge();
+      _image = accumulator.image();
+    }
+    void run()      {_pbasex.invert(_image,2*columns,2*rows,0.5*columns,0.5*rows,2);}
+    void result(std::vector<double> &result)
+    {
+      result.insert(result.end(),_pbasex.radialDistribution().begin(),_pbasex.radialDistribution().end());
+      result.insert(result.end(),_pbasex.anisotropy().begin(),_pbasex.anisotropy().end());
+    }
+  private:
+    cass::VMI::PBasex       _pbasex;
+    std::vector<uint32_t>   _image;
+  };
+}
+
+
+void cass::MicroBench::addVMIKernels(kernels_t &kernels)
+{
+  kernels.push_back(new FindBlobs("vmi.blobs",1));
+  kernels.push_back(new FindBlobs("vmi.blobs.threads",4));
+  kernels.push_back(new AccumulateHits("vmi.accumulate",1));
+  kernels.push_back(new AccumulateHits("vmi.accumulate.threads",4));
+  kernels.push_back(new Invert());
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
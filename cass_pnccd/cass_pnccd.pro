@@ -11,6 +11,7 @@ OBJECTS_DIR = ./obj
 
 
 SOURCES += pnccd_analysis.cpp \
+           frame_rebin.cpp \
            pnccd_converter.cpp \
            ./classes/event/pnccd_event.cpp \
            ./pnccd_lib/frame_data.C \
@@ -23,6 +24,7 @@ HEADERS += ../cass/analysis_backend.h \
            ../cass/parameter_backend.h \
            ../cass/conversion_backend.h \
            pnccd_analysis.h \
+           frame_rebin.h \
            pnccd_converter.h \
            cass_pnccd.h \
            ./classes/event/pnccd_event.h \
@@ -0,0 +1,32 @@
+// Copyright (C) 2009 jk, lmf
+#include "frame_rebin.h"
+
+
+void cass::pnCCD::rebin(const std::vector<int16_t> &frame, size_t rows, size_t columns,
+                        uint32_t factor, std::vector<int16_t> &rebinned)
+{
+  //get the new dimensions//
+  const size_t newRows = rows / factor;
+  const size_t newCols = columns / factor;
+  //initialize the rebinned frame with 0//
+  rebinned.assign(newRows * newCols,0);
+  //go through the frame row by row and add every pixel to its bin//
+  for (size_t iRow=0; iRow<newRows*factor; ++iRow)
+  {
+    const int16_t *pixel = &frame[iRow*columns];
+    int16_t *bin = &rebinned[(iRow/factor)*newCols];
+    for (size_t iCol=0; iCol<newCols; ++iCol, ++bin)
+      for (size_t iReb=0; iReb<factor; ++iReb, ++pixel)
+        *bin += *pixel;
+  }
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
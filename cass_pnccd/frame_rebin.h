@@ -0,0 +1,32 @@
+// Copyright (C) 2009 jk, lmf
+
+#ifndef PNCCDFRAMEREBIN_H
+#define PNCCDFRAMEREBIN_H
+
+#include <stdint.h>
+#include <vector>
+#include "cass_pnccd.h"
+
+namespace cass
+{
+  namespace pnCCD
+  {
+    //sum factor x factor pixels of the frame of rows x columns pixels into one pixel of//
+    //rebinned, which then has rows/factor x columns/factor pixels. Like the frame the sums//
+    //are 16 bit values//
+    void CASS_PNCCDSHARED_EXPORT rebin(const std::vector<int16_t> &frame, size_t rows, size_t columns,
+                                       uint32_t factor, std::vector<int16_t> &rebinned);
+  } // end of scope of namespace pnCCD
+} // end of scope of namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -5,6 +5,7 @@
 #include "pnccd_event.h"
 #include "cass_event.h"
 #include "pnccd_analysis_lib.h"
+#include "frame_rebin.h"
 #include "pdsdata/xtc/Dgram.hh"
 
 #include <vector>
@@ -88,34 +89,6 @@ void cass::pnCCD::Analysis::operator ()(cass::CASSEvent* cassevent)
 {
   //extract a reference to the pnccdevent in cassevent//
   cass::pnCCD::pnCCDEvent &pnccdevent = cassevent->pnCCDEvent();
-  //clear the event//
-  for (size_t i=0; i<pnccdevent.detectors().size();++i)
-  {
-    pnccdevent.detectors()[i].recombined().clear();
-    pnccdevent.detectors()[i].nonrecombined().clear();
-    pnccdevent.detectors()[i].calibrated()=false;
-  }
-
-  Pds::Dgram *datagram = reinterpret_cast<Pds::Dgram*>(cassevent->datagrambuffer());
-  time_t eventTime = datagram->seq.clock().seconds();
- 
- /* return if we're not interested in this time */
-  if(cass::globalOptions.startTime.isValid() && 
-     QDateTime::fromTime_t(eventTime).time() < cass::globalOptions.startTime.time()){
-//      printf("Skipping frame before startTime\n");
-    return;
-  }
-  if(cass::globalOptions.endTime.isValid() && 
-     QDateTime::fromTime_t(eventTime).time() > cass::globalOptions.endTime.time()){
-//      printf("Skipping frame after endTime\n");
-    return;
-  }
-
-  if(cass::globalOptions.eventCounter % cass::globalOptions.skipPeriod != 0){
-//      printf("Skipping frame not in the beggining of period\n");
-      return;
-  }
-
 
   //check if we have enough rebin parameters and darkframe names for the amount of detectors//
   //increase it if necessary
@@ -149,8 +122,18 @@ void cass::pnCCD::Analysis::operator ()(cass::CASSEvent* cassevent)
   //go through all detectors//
   for (size_t iDet=0; iDet<pnccdevent.detectors().size();++iDet)
   {
+    //only the frames that are wanted and not made yet, the frames of the others may still//
+    //be the ones of an earlier event//
+    if (!cassevent->wanted().has(cass::Products::pnCCDFrame,iDet) ||
+        cassevent->produced().has(cass::Products::pnCCDFrame,iDet) ||
+        !cassevent->produced().has(cass::Products::pnCCDRaw,iDet))
+      continue;
     //retrieve a reference to the detector we are working on right now//
     cass::pnCCD::pnCCDDetector &det = pnccdevent.detectors()[iDet];
+    //clear the results of the last event//
+    det.recombined().clear();
+    det.nonrecombined().clear();
+    det.calibrated()=false;
     //retrieve a reference to the corrected frame of the detector//
     cass::pnCCD::pnCCDDetector::frame_t &cf = det.correctedFrame();
     //retrieve a reference to the raw frame of the detector//
@@ -228,59 +211,17 @@ void cass::pnCCD::Analysis::operator ()(cass::CASSEvent* cassevent)
         _param._rebinfactors[iDet] = static_cast<uint32_t>(pow(2. , res_tes ));
         saveSettings();
       }
-      //get the new dimensions//
-      const size_t newRows = nRows / _param._rebinfactors[iDet];
-      const size_t newCols = nCols / _param._rebinfactors[iDet];
       //set the new dimensions in the detector//
-      det.rows()    = newRows;
-      det.columns() = newCols;
-      //resize the temporary container to fit the rebinned image
-      //initialize it with 0
-      _tmp.assign(newRows * newCols,0);
-      //go through the whole frame//
-      //and do the magic work//
-      for(size_t iCol=0; iCol<newCols ;++iCol)
-      {
-        for(size_t iRow=0; iRow<newRows ;iRow++)
-        {
-          /* the following works only for rebin=2
-          _tmp[iCol*newCols+iRow]=  // actually is newRows
-              cf[iCol    *nCols+ iRow   ]+
-              cf[iCol    *nCols+(iRow+1)]+
-              cf[(iCol+1)*nCols+ iRow   ]+
-              cf[(iCol+1)*nCols+(iRow+1)];*/
-
-          for(size_t iReby=0;iReby<_param._rebinfactors[iDet];iReby++)
-          {
-            for(size_t iRebx=0;iRebx<_param._rebinfactors[iDet];iRebx++)
-            {
-              _tmp[iCol+newCols*iRow]+=
-                  cf[(iCol*_param._rebinfactors[iDet] +iReby ) +nCols*(iRow*_param._rebinfactors[iDet] +iRebx)  ];
-            }
-          }
-        }
-      }
-
-      /*//another way//
-        for (size_t iIdx=0; iIdx<cf.size() ;++iIdx)
-        {
-          //calculate the row and column of the current Index//
-          const size_t row = iIdx / nCols;
-          const size_t col = iIdx % nCols;
-          //calculate the index of the rebinned frame//
-          const size_t newRow = row / _param._rebinfactors[iDet];
-          const size_t newCol = col / _param._rebinfactors[iDet];
-          //calculate the index in the rebinned frame//
-          //that newRow and newCol belongs to//
-          const size_t newIndex = newRow*newCols + newCol;
-          //add this index value to the newIndex value//
-          _tmp[newIndex] += cf[iIdx];
-
-        }*/
+      det.rows()    = nRows / _param._rebinfactors[iDet];
+      det.columns() = nCols / _param._rebinfactors[iDet];
+      //sum up the pixels into the temporary frame//
+      rebin(cf,nRows,nCols,_param._rebinfactors[iDet],_tmp);
 
       //copy the temporary frame to the right place
       cf.assign(_tmp.begin(), _tmp.end());
     }
+    //the photon hits are found together with the corrected frame//
+    cassevent->produced().add(cass::Products::pnCCDHits,iDet);
   }
 }
 
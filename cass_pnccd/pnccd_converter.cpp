@@ -61,6 +61,11 @@ void cass::pnCCD::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEvent* ca
         pnccdevent.detectors().resize(detectorId+1);
       //std::cout<< detectorId << " " << pnccdevent.detectors().size()<<std::endl;
 
+      //the frames that nobody reads are not descrambled//
+      if (!cassevent->wanted().has(cass::Products::pnCCDRaw,detectorId) ||
+          cassevent->produced().has(cass::Products::pnCCDRaw,detectorId))
+        break;
+
       //only run this if we have a config for this detector
       if (_pnccdConfig.size() >= detectorId && _pnccdConfig[detectorId])
       {
@@ -119,6 +124,7 @@ void cass::pnCCD::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEvent* ca
         }
 //        std::cout<<det.rows() << " " <<  det.columns() << " " << det.originalrows() << " " <<det.originalcolumns()<< std::endl;
 //        std::cout<<detectorId << " " <<  det.rawFrame().size() << " " << det.correctedFrame().size()<< std::endl;
+        cassevent->produced().add(cass::Products::pnCCDRaw,detectorId);
       }
     }
     break;
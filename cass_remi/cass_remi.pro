@@ -22,6 +22,9 @@ SOURCES += remi_analysis.cpp \
            ./classes/detektorhitsorter/detektorhitsorter.cpp \
            ./classes/detektorhitsorter/detektorhitsorter_quad.cpp \
            ./classes/detektorhitsorter/detektorhitsorter_simple.cpp \
+           ./classes/detektorhitsorter/detektorhitsorter_window.cpp \
+           ./classes/detektorhitsorter/detektorhitsorter_achim.cpp \
+           ./classes/detektorhitsorter/delayline_correction.cpp \
 
 HEADERS += ../cass/analysis_backend.h \
            ../cass/parameter_backend.h \
@@ -40,6 +43,9 @@ HEADERS += ../cass/analysis_backend.h \
            ./classes/detektorhitsorter/detektorhitsorter.h \
            ./classes/detektorhitsorter/detektorhitsorter_quad.h \
            ./classes/detektorhitsorter/detektorhitsorter_simple.h \
+           ./classes/detektorhitsorter/detektorhitsorter_window.h \
+           ./classes/detektorhitsorter/detektorhitsorter_achim.h \
+           ./classes/detektorhitsorter/delayline_correction.h \
 
 INCLUDEPATH += ../LCLS \
                ../cass \
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdint.h>
+
+#include "delayline_correction.h"
+
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DelaylineCorrection::init(size_t tsBins, double tsRange, size_t posBins, double posRange)
+{
+    _tsBins   = tsBins;
+    _tsRange  = tsRange;
+    _posBins  = posBins;
+    _posRange = posRange;
+    for (size_t l=0;l<NbrLayers;++l)
+        _tsOffset[l].assign(_tsBins,0.f);
+    _wScale.assign(_posBins*_posBins,1.f);
+    findMaxOffsets();
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DelaylineCorrection::findMaxOffsets()
+{
+    for (size_t l=0;l<NbrLayers;++l)
+    {
+        _tsMaxOffset[l] = 0;
+        for (size_t i=0;i<_tsOffset[l].size();++i)
+            _tsMaxOffset[l] = std::max(_tsMaxOffset[l],fabs(static_cast<double>(_tsOffset[l][i])));
+    }
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+//the file starts with "CASSDLC1", then uint32 tsBins, double tsRange, uint32 posBins, double posRange//
+//followed by the float tables of the u, v and w timesum and the w scalefactor table//
+bool cass::REMI::DelaylineCorrection::load(const std::string &filename)
+{
+    FILE *fp = fopen(filename.c_str(),"rb");
+    if (!fp)
+    {
+        std::cout << "DelaylineCorrection: could not open \""<<filename<<"\""<<std::endl;
+        return false;
+    }
+    char magic[8];
+    uint32_t tsBins=0, posBins=0;
+    double tsRange=0, posRange=0;
+    bool ok = fread(magic,1,8,fp) == 8 && !strncmp(magic,"CASSDLC1",8) &&
+              fread(&tsBins,sizeof(tsBins),1,fp) == 1 && fread(&tsRange,sizeof(tsRange),1,fp) == 1 &&
+              fread(&posBins,sizeof(posBins),1,fp) == 1 && fread(&posRange,sizeof(posRange),1,fp) == 1;
+    if (ok)
+    {
+        init(tsBins,tsRange,posBins,posRange);
+        for (size_t l=0;l<NbrLayers && ok;++l)
+            ok = !_tsBins || fread(&_tsOffset[l][0],sizeof(float),_tsBins,fp) == _tsBins;
+        ok = ok && (_wScale.empty() || fread(&_wScale[0],sizeof(float),_wScale.size(),fp) == _wScale.size());
+    }
+    fclose(fp);
+    if (!ok)
+    {
+        std::cout << "DelaylineCorrection: \""<<filename<<"\" is not a correction table file"<<std::endl;
+        init(0,0,0,0);
+        return false;
+    }
+    findMaxOffsets();
+    return true;
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+bool cass::REMI::DelaylineCorrection::save(const std::string &filename)const
+{
+    //write to a temporary file first, so that a reader never sees a half written file//
+    const std::string tmpname = filename + ".tmp";
+    FILE *fp = fopen(tmpname.c_str(),"wb");
+    if (!fp)
+    {
+        std::cout << "DelaylineCorrection: could not create \""<<tmpname<<"\""<<std::endl;
+        return false;
+    }
+    const uint32_t tsBins = _tsBins, posBins = _posBins;
+    fwrite("CASSDLC1",1,8,fp);
+    fwrite(&tsBins,sizeof(tsBins),1,fp);
+    fwrite(&_tsRange,sizeof(_tsRange),1,fp);
+    fwrite(&posBins,sizeof(posBins),1,fp);
+    fwrite(&_posRange,sizeof(_posRange),1,fp);
+    for (size_t l=0;l<NbrLayers;++l)
+        if (_tsBins)
+            fwrite(&_tsOffset[l][0],sizeof(float),_tsBins,fp);
+    if (!_wScale.empty())
+        fwrite(&_wScale[0],sizeof(float),_wScale.size(),fp);
+    const bool ok = !ferror(fp);
+    fclose(fp);
+    return ok && !rename(tmpname.c_str(),filename.c_str());
+}
+
+
+
+
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DelaylineCalibration::init(const DelaylineCorrection &c)
+{
+    _binning.init(c.tsBins(),c.tsRange(),c.posBins(),c.posRange());
+    for (size_t l=0;l<DelaylineCorrection::NbrLayers;++l)
+    {
+        _tsSum[l].assign(c.tsBins(),0.);
+        _tsCount[l].assign(c.tsBins(),0);
+    }
+    _wSumEM.assign(c.posBins()*c.posBins(),0.);
+    _wSumMM.assign(c.posBins()*c.posBins(),0.);
+    _wCount.assign(c.posBins()*c.posBins(),0);
+    _nbrFilled = 0;
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DelaylineCalibration::fillTimesum(DelaylineCorrection::Layer l, double raw, double offset)
+{
+    if (!_binning._tsBins) return;
+    const size_t b = DelaylineCorrection::bin(raw,_binning._tsRange,_binning._tsBins);
+    _tsSum[l][b]   += offset;
+    _tsCount[l][b] += 1;
+    ++_nbrFilled;
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DelaylineCalibration::fillW(double x, double y, double expected, double measured)
+{
+    if (!_binning._posBins) return;
+    const size_t nbrBins = _binning._posBins;
+    const size_t b = DelaylineCorrection::bin(y,_binning._posRange,nbrBins)*nbrBins +
+                     DelaylineCorrection::bin(x,_binning._posRange,nbrBins);
+    _wSumEM[b] += expected*measured;
+    _wSumMM[b] += measured*measured;
+    _wCount[b] += 1;
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DelaylineCalibration::build(DelaylineCorrection &c, size_t minEntries)const
+{
+    c.init(_binning._tsBins,_binning._tsRange,_binning._posBins,_binning._posRange);
+    //the timesum of a bin is the mean of what was filled//
+    for (size_t l=0;l<DelaylineCorrection::NbrLayers;++l)
+        for (size_t i=0;i<_tsSum[l].size();++i)
+            if (_tsCount[l][i] && _tsCount[l][i] >= minEntries)
+                c._tsOffset[l][i] = _tsSum[l][i] / _tsCount[l][i];
+    //the scalefactor correction of a bin is the least squares factor that turns measured into expected//
+    for (size_t i=0;i<_wCount.size();++i)
+        if (_wCount[i] && _wCount[i] >= minEntries && _wSumMM[i] > 0)
+            c._wScale[i] = _wSumEM[i] / _wSumMM[i];
+    c.findMaxOffsets();
+}
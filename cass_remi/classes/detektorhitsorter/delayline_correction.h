@@ -0,0 +1,104 @@
+#ifndef __DelaylineCorrection_H_
+#define __DelaylineCorrection_H_
+
+#include <string>
+#include <vector>
+
+namespace cass
+{
+    namespace REMI
+    {
+        //______________________position dependent corrections of a delayline anode______________________
+        //the timesum of a layer depends on where along the layer the hit was, it is tabulated over the//
+        //raw layer position t1-t2 (ns). The scalefactor of the w layer of a hexanode depends on the//
+        //position on the detector, it is tabulated over x and y (mm). All tables are flat arrays//
+        class DelaylineCorrection
+        {
+        public:
+            enum Layer {U=0, V, W, NbrLayers};
+
+        public:
+            DelaylineCorrection():_tsBins(0),_tsRange(0),_posBins(0),_posRange(0)   {}
+
+            //tables that do not correct anything//
+            void init(size_t tsBins, double tsRange, size_t posBins, double posRange);
+            bool load(const std::string &filename);
+            bool save(const std::string &filename)const;
+            bool isEmpty()const                     {return _tsBins == 0;}
+
+        public:
+            //the timesum of the layer for the raw position t1-t2, nominal when not corrected//
+            double timesum(Layer l, double raw, double nominal)const
+            {
+                if (!_tsBins) return nominal;
+                return nominal + _tsOffset[l][bin(raw,_tsRange,_tsBins)];
+            }
+            //how much the timesum of the layer differs from the nominal one at most//
+            double maxTimesumOffset(Layer l)const   {return _tsMaxOffset[l];}
+            //the factor that corrects the scalefactor of the w layer at x,y//
+            double wScale(double x, double y)const
+            {
+                if (!_posBins) return 1.;
+                return _wScale[bin(y,_posRange,_posBins)*_posBins + bin(x,_posRange,_posBins)];
+            }
+
+        public:
+            size_t tsBins()const                    {return _tsBins;}
+            double tsRange()const                   {return _tsRange;}
+            size_t posBins()const                   {return _posBins;}
+            double posRange()const                  {return _posRange;}
+
+        private:
+            friend class DelaylineCalibration;
+            //the bin of value in a table that goes from -range to range//
+            static size_t bin(double value, double range, size_t nbrBins)
+            {
+                const double b = (value + range) / (2.*range) * nbrBins;
+                if (!(b > 0)) return 0;
+                return (b >= nbrBins) ? nbrBins-1 : static_cast<size_t>(b);
+            }
+            void findMaxOffsets();
+
+        private:
+            size_t              _tsBins;                    //the number of bins of the timesum tables
+            double              _tsRange;                   //the tables go from -range to range in ns
+            std::vector<float>  _tsOffset[NbrLayers];       //the timesum of the bin minus the nominal timesum
+            double              _tsMaxOffset[NbrLayers];    //the largest absolute offset of the layer
+            size_t              _posBins;                   //the number of bins in x and in y
+            double              _posRange;                  //the table goes from -range to range in mm
+            std::vector<float>  _wScale;                    //the scalefactor correction of the w layer
+        };
+
+
+
+        //______________________creates the correction tables from the hits of a run______________________
+        //every hit that had all signals adds its timesums and for a hexanode the w position that the u//
+        //and v layer predict. The sums are kept, so the tables can be created at any time//
+        class DelaylineCalibration
+        {
+        public:
+            DelaylineCalibration():_nbrFilled(0)    {}
+
+            //use the binning of the tables//
+            void init(const DelaylineCorrection&);
+            //the timesum of a layer minus the nominal timesum at raw position t1-t2//
+            void fillTimesum(DelaylineCorrection::Layer, double raw, double offset);
+            //the w position that u and v predict and the one that was measured at x,y//
+            void fillW(double x, double y, double expected, double measured);
+            //create the tables, bins with less than minEntries entries are not corrected//
+            void build(DelaylineCorrection&, size_t minEntries)const;
+            size_t nbrFilled()const                 {return _nbrFilled;}
+
+        private:
+            DelaylineCorrection _binning;
+            std::vector<double> _tsSum[DelaylineCorrection::NbrLayers];
+            std::vector<size_t> _tsCount[DelaylineCorrection::NbrLayers];
+            std::vector<double> _wSumEM;                    //sum of expected*measured
+            std::vector<double> _wSumMM;                    //sum of measured*measured
+            std::vector<size_t> _wCount;
+            size_t              _nbrFilled;
+        };
+    }//end namespace remi
+}//end namespace cass
+
+#endif
@@ -19,7 +19,7 @@ namespace cass
             virtual ~DetectorHitSorter() {}
             virtual void sort(REMIEvent&, Detector&)=0;
         public:
-            enum SorterTypes {kDoNothing=0, Simple, Achim};
+            enum SorterTypes {kDoNothing=0, Simple, Achim, Window};
         protected:
             void extractPeaksForSignal(std::vector<Channel>&, Signal&);
         };
@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <QtCore/QMutexLocker>
+
+#include "detektorhitsorter_achim.h"
+#include "detector.h"
+#include "remi_event.h"
+#include "channel.h"
+
+
+namespace
+{
+    const size_t kTimesumBins   = 256;      //bins of new timesum tables over the runtime
+    const size_t kPositionBins  = 64;       //bins in x and y of new scalefactor tables over the mcp
+    const size_t kMinEntries    = 10;       //bins with less entries are not corrected
+    const size_t kWriteEvery    = 10000;    //write the tables after this many new calibration entries
+    const size_t kMaxCandidates = 16;       //the best candidates of a layer that are combined
+    const double kMissingPenalty= 2.;       //added to the score for every missing signal
+    const double kSqrt3         = 1.7320508075688772;
+
+    typedef cass::REMI::DetectorHitSorterAchim Sorter;
+
+    //complete pairs first, then the ones closer to the timesum//
+    bool betterCandidate(const Sorter::Candidate &a, const Sorter::Candidate &b)
+    {
+        if (a.missing != b.missing) return a.missing < b.missing;
+        return fabs(a.dev) < fabs(b.dev);
+    }
+
+    //find the pairs of the layer that fit to the mcp time m//
+    void findCandidates(const Sorter::Layer &l, const double m, const double runtime,
+                        const cass::REMI::DelaylineCorrection &corr, const bool allowMissing,
+                        std::vector<Sorter::Candidate> &cands)
+    {
+        cands.clear();
+        const double maxOff = corr.maxTimesumOffset(l.id);
+        //--an anode end can only be in the runtime window around the mcp--//
+        const double wLow   = m + 0.5*(l.ts - runtime - maxOff);
+        const double wHigh  = m + 0.5*(l.ts + runtime + maxOff);
+        size_t f1,l1,f2,l2;
+        l.one->range(wLow,wHigh,f1,l1);
+        l.two->range(wLow,wHigh,f2,l2);
+        std::vector<char> matched(l2-f2,0);
+        for (size_t i1=f1;i1<l1;++i1)
+        {
+            if (l.one->used[i1]) continue;
+            const double t1 = l.one->time[i1];
+            //--the timesum tells where the other end has to be--//
+            size_t a,b;
+            l.two->range(std::max(wLow, l.ts - l.half - maxOff + 2.*m - t1),
+                         std::min(wHigh,l.ts + l.half + maxOff + 2.*m - t1), a, b);
+            bool partner = false;
+            for (size_t i2=a;i2<b;++i2)
+            {
+                if (l.two->used[i2]) continue;
+                const double t2  = l.two->time[i2];
+                const double raw = t1-t2;
+                const double dev = t1+t2-2.*m - corr.timesum(l.id,raw,l.ts);
+                if (fabs(dev) >= l.half) continue;
+                Sorter::Candidate c = {i1, i2, raw, (raw+l.offset)*l.sf, dev/l.half, 0};
+                cands.push_back(c);
+                matched[i2-f2] = 1;
+                partner = true;
+            }
+            //--the other end is missing, reconstruct it with the timesum--//
+            if (!partner && allowMissing)
+            {
+                const double raw = 2.*t1 - 2.*m - corr.timesum(l.id,2.*t1 - 2.*m - l.ts,l.ts);
+                if (fabs(raw) > runtime) continue;
+                Sorter::Candidate c = {i1, Sorter::npos, raw, (raw+l.offset)*l.sf, 0., 1};
+                cands.push_back(c);
+            }
+        }
+        if (allowMissing)
+        {
+            for (size_t i2=f2;i2<l2;++i2)
+            {
+                if (l.two->used[i2] || matched[i2-f2]) continue;
+                const double t2  = l.two->time[i2];
+                const double raw = 2.*m - 2.*t2 + corr.timesum(l.id,2.*m - 2.*t2 + l.ts,l.ts);
+                if (fabs(raw) > runtime) continue;
+                Sorter::Candidate c = {Sorter::npos, i2, raw, (raw+l.offset)*l.sf, 0., 1};
+                cands.push_back(c);
+            }
+        }
+        if (cands.size() > kMaxCandidates)
+        {
+            std::partial_sort(cands.begin(),cands.begin()+kMaxCandidates,cands.end(),betterCandidate);
+            cands.resize(kMaxCandidates);
+        }
+    }
+
+    //mark the peaks of the candidate as used//
+    void use(const Sorter::Layer &l, const Sorter::Candidate &c)
+    {
+        if (c.one != Sorter::npos) l.one->used[c.one] = 1;
+        if (c.two != Sorter::npos) l.two->used[c.two] = 1;
+    }
+
+    //the best combination of the layer candidates for one mcp time//
+    struct Combination
+    {
+        Combination():score(std::numeric_limits<double>::max())  {}
+        double  score;
+        double  x, y;
+        int     method;
+        int     idx[3];         //the candidate of each layer, -1 when the layer is not used
+        double  xuv, yuv;       //the position from u and v, for the calibration
+        double  wMeasured;      //the w position before the correction
+    };
+
+    //what a hit adds to the calibration//
+    struct TimesumEntry {cass::REMI::DelaylineCorrection::Layer l; double raw; double offset;};
+    struct WEntry {double x; double y; double expected; double measured;};
+}
+
+//****************************************The Class Implementation*******************************************************
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DetectorHitSorterAchim::Layer::set(DelaylineCorrection::Layer i, const AnodeLayer &a,
+                                                   SortedSignal &s1, SortedSignal &s2, double off)
+{
+    id      = i;
+    one     = &s1;
+    two     = &s2;
+    ts      = a.ts();
+    half    = 0.5*(a.tsHigh()-a.tsLow());
+    sf      = a.sf();
+    offset  = off;
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+cass::REMI::DetectorHitSorterAchim::~DetectorHitSorterAchim()
+{
+    for (std::map<std::string,Tables*>::iterator it=_tables.begin();it!=_tables.end();++it)
+    {
+        Tables &t = *it->second;
+        if (t.calibrate && !t.filename.empty() && t.calibration.nbrFilled() > t.written)
+        {
+            DelaylineCorrection c;
+            t.calibration.build(c,kMinEntries);
+            c.save(t.filename);
+        }
+        delete it->second;
+    }
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+cass::REMI::DetectorHitSorterAchim::Tables &cass::REMI::DetectorHitSorterAchim::tables(const Detector &d)
+{
+    QMutexLocker lock(&_mutex);
+    std::map<std::string,Tables*>::iterator it = _tables.find(d.name());
+    if (it != _tables.end())
+        return *it->second;
+    Tables *t = new Tables();
+    t->filename  = d.correctionFile();
+    t->calibrate = d.calibrate();
+    //without tables nothing is corrected//
+    if (t->filename.empty() || !t->correction.load(t->filename))
+        t->correction.init(kTimesumBins,d.runtime(),kPositionBins,d.mcpRadius());
+    t->calibration.init(t->correction);
+    _tables[d.name()] = t;
+    return *t;
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DetectorHitSorterAchim::sort(cass::REMI::REMIEvent& e, cass::REMI::Detector& d)
+{
+    //extract the peaks for the signals of the detector from the channels//
+    extractPeaksForSignal(e.channels(),d.mcp());
+    extractPeaksForSignal(e.channels(),d.u().one());
+    extractPeaksForSignal(e.channels(),d.u().two());
+    extractPeaksForSignal(e.channels(),d.v().one());
+    extractPeaksForSignal(e.channels(),d.v().two());
+    if (d.isHexAnode())
+    {
+        extractPeaksForSignal(e.channels(),d.w().one());
+        extractPeaksForSignal(e.channels(),d.w().two());
+    }
+
+    //now sort these peaks for the layers timesum//
+    sortForTimesum(d,tables(d));
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DetectorHitSorterAchim::sortForTimesum(cass::REMI::Detector &d, Tables &t)
+{
+    const DelaylineCorrection &corr = t.correction;
+    const double runtime    = d.runtime();
+    const double radius2    = d.mcpRadius()*d.mcpRadius();
+    const double tolerance  = d.layerTolerance();
+    const bool isHex        = d.isHexAnode();
+    const size_t nbrLayers  = isHex ? 3 : 2;
+
+    //--the peaks of all signals in flat arrays--//
+    SortedSignal mcp,u1,u2,v1,v2,w1,w2;
+    mcp.fill(d.mcp());
+    u1.fill(d.u().one());
+    u2.fill(d.u().two());
+    v1.fill(d.v().one());
+    v2.fill(d.v().two());
+    if (isHex)
+    {
+        w1.fill(d.w().one());
+        w2.fill(d.w().two());
+    }
+    Layer layers[3];
+    layers[0].set(DelaylineCorrection::U,d.u(),u1,u2,0.);
+    layers[1].set(DelaylineCorrection::V,d.v(),v1,v2,0.);
+    layers[2].set(DelaylineCorrection::W,d.w(),w1,w2,d.wLayerOffset());
+
+    //--what the calibration gets from this event--//
+    std::vector<TimesumEntry> tsEntries;
+    std::vector<WEntry> wEntries;
+
+    std::vector<Candidate> cands[3];
+    for (size_t iMcp=0;iMcp<mcp.time.size();++iMcp)
+    {
+        const double m = mcp.time[iMcp];
+        for (size_t l=0;l<nbrLayers;++l)
+            findCandidates(layers[l],m,runtime,corr,true,cands[l]);
+
+        //--try all combinations of the layers, a hexanode may miss one layer--//
+        Combination best;
+        const int first = isHex ? -1 : 0;
+        for (int iu=first;iu<static_cast<int>(cands[0].size());++iu)
+        for (int iv=first;iv<static_cast<int>(cands[1].size());++iv)
+        for (int iw=-1;iw<(isHex ? static_cast<int>(cands[2].size()) : 0);++iw)
+        {
+            const Candidate *cu = iu<0 ? 0 : &cands[0][iu];
+            const Candidate *cv = iv<0 ? 0 : &cands[1][iv];
+            const Candidate *cw = iw<0 ? 0 : &cands[2][iw];
+            const int missingEnds   = (cu ? cu->missing : 0) + (cv ? cv->missing : 0) + (cw ? cw->missing : 0);
+            const int missingLayers = isHex ? (!cu + !cv + !cw) : 0;
+            //--only one signal may be missing--//
+            if (missingEnds + missingLayers > 1) continue;
+            double score = kMissingPenalty*(missingEnds + missingLayers) +
+                           (cu ? fabs(cu->dev) : 0) + (cv ? fabs(cv->dev) : 0) + (cw ? fabs(cw->dev) : 0);
+            if (!(score < best.score)) continue;
+
+            Combination c;
+            c.xuv = c.yuv = 0;
+            c.wMeasured = 0;
+            if (!isHex)
+            {
+                c.x = cu->pos;
+                c.y = cv->pos;
+            }
+            else
+            {
+                const double u = cu ? cu->pos : 0;
+                const double v = cv ? cv->pos : 0;
+                double w = cw ? cw->pos : 0;
+                c.wMeasured = w;
+                //--the w layer is corrected where u and v say the hit is--//
+                if (cu && cv)
+                {
+                    c.xuv = u;
+                    c.yuv = (u-v)/kSqrt3;
+                    w *= corr.wScale(c.xuv,c.yuv);
+                }
+                //--the convention of the other sorters: x=u and y=(u-v)/sqrt(3), so v and w are--//
+                //--twice the projection of the position on their layer and 2u = v + w--//
+                if (cu && cv && cw)
+                {
+                    //--the three layer pairs have to agree--//
+                    const double diff = fabs(u - 0.5*(v + w));
+                    if (diff > tolerance) continue;
+                    score += diff/tolerance;
+                    c.x = (2.*u + 0.5*(v + w))/3.;
+                    c.y = ((u-v) + (w-u) + 0.5*(w-v))/(3.*kSqrt3);
+                }
+                else if (cu && cv)
+                {
+                    c.x = u;
+                    c.y = (u-v)/kSqrt3;
+                }
+                else if (cu && cw)
+                {
+                    c.x = u;
+                    c.y = (w-u)/kSqrt3;
+                }
+                else
+                {
+                    c.x = 0.5*(v + w);
+                    c.y = 0.5*(w-v)/kSqrt3;
+                }
+            }
+            if (c.x*c.x + c.y*c.y >= radius2) continue;
+            if (!(score < best.score)) continue;
+            c.score   = score;
+            c.method  = (missingEnds ? AnodeEnd : 0) | (missingLayers ? HexLayer : 0);
+            c.idx[0]  = iu;
+            c.idx[1]  = iv;
+            c.idx[2]  = iw;
+            best = c;
+        }
+        if (best.score == std::numeric_limits<double>::max())
+            continue;
+
+        //add a DetektorHit to the Detektor
+        d.hits().push_back(cass::REMI::DetectorHit(best.x,best.y,m,best.method));
+        //remember that these peaks have already been used//
+        mcp.used[iMcp] = 1;
+        for (size_t l=0;l<nbrLayers;++l)
+            if (best.idx[l] >= 0)
+                use(layers[l],cands[l][best.idx[l]]);
+
+        //--hits with all signals calibrate the tables--//
+        if (t.calibrate && best.method == 0)
+        {
+            for (size_t l=0;l<nbrLayers;++l)
+            {
+                const Candidate &c = cands[l][best.idx[l]];
+                const TimesumEntry e = {layers[l].id, c.raw,
+                                        layers[l].one->time[c.one] + layers[l].two->time[c.two] - 2.*m - layers[l].ts};
+                tsEntries.push_back(e);
+            }
+            if (isHex)
+            {
+                const WEntry e = {best.xuv, best.yuv, 2.*cands[0][best.idx[0]].pos - cands[1][best.idx[1]].pos, best.wMeasured};
+                wEntries.push_back(e);
+            }
+        }
+    }
+
+    //--the mcp signal is missing: u and v have complete pairs that agree on the mcp time--//
+    for (size_t iU1=0;iU1<u1.time.size();++iU1)
+    {
+        if (u1.used[iU1]) continue;
+        const double tu1 = u1.time[iU1];
+        size_t a,b;
+        u2.range(tu1 - runtime, tu1 + runtime, a, b);
+        bool found = false;
+        for (size_t iU2=a;iU2<b && !found;++iU2)
+        {
+            if (u2.used[iU2]) continue;
+            const double tu2 = u2.time[iU2];
+            const double raw = tu1-tu2;
+            const double m   = 0.5*(tu1 + tu2 - corr.timesum(DelaylineCorrection::U,raw,layers[0].ts));
+            const double u   = raw*layers[0].sf;
+            findCandidates(layers[1],m,runtime,corr,false,cands[1]);
+            std::sort(cands[1].begin(),cands[1].end(),betterCandidate);
+            for (size_t iv=0;iv<cands[1].size();++iv)
+            {
+                const double v = cands[1][iv].pos;
+                const double x = u;
+                const double y = isHex ? (u-v)/kSqrt3 : v;
+                if (x*x + y*y >= radius2) continue;
+                d.hits().push_back(cass::REMI::DetectorHit(x,y,m,Mcp));
+                u1.used[iU1] = u2.used[iU2] = 1;
+                use(layers[1],cands[1][iv]);
+                found = true;
+                break;
+            }
+        }
+    }
+
+    //--tell the peaks whether they are part of a hit--//
+    SortedSignal *sigs[7] = {&mcp,&u1,&u2,&v1,&v2,&w1,&w2};
+    for (size_t i=0;i<7;++i)
+        for (size_t j=0;j<sigs[i]->peak.size();++j)
+            sigs[i]->peak[j]->isUsed() = sigs[i]->used[j];
+
+    //--add to the calibration and write the tables every now and then, the hits are still//
+    //--corrected with the tables that were loaded, the new ones are used at the next start--//
+    if (t.calibrate && (!tsEntries.empty() || !wEntries.empty()))
+    {
+        QMutexLocker lock(&_mutex);
+        for (size_t i=0;i<tsEntries.size();++i)
+            t.calibration.fillTimesum(tsEntries[i].l,tsEntries[i].raw,tsEntries[i].offset);
+        for (size_t i=0;i<wEntries.size();++i)
+            t.calibration.fillW(wEntries[i].x,wEntries[i].y,wEntries[i].expected,wEntries[i].measured);
+        if (!t.filename.empty() && t.calibration.nbrFilled() >= t.written + kWriteEvery)
+        {
+            DelaylineCorrection c;
+            t.calibration.build(c,kMinEntries);
+            if (c.save(t.filename))
+                t.written = t.calibration.nbrFilled();
+        }
+    }
+}
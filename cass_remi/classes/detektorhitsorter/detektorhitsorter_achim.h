@@ -0,0 +1,84 @@
+#ifndef __DetektorHitSorterAchim_H_
+#define __DetektorHitSorterAchim_H_
+
+#include <map>
+#include <string>
+#include <QtCore/QMutex>
+
+#include "detektorhitsorter_quad.h"
+#include "delayline_correction.h"
+
+namespace cass
+{
+    namespace REMI
+    {
+        class AnodeLayer;
+
+        //______________________MyDetektorHitSorter Achim Version______________________
+        //reconstruction for quad and hex delayline anodes. The timesums are corrected with the position//
+        //dependent tables of the detector, hits where one anode end, one layer of a hexanode or the mcp//
+        //signal is missing are recovered with the timesum. A hexanode has the positions of the other//
+        //sorters, x=u and y=(u-v)/sqrt(3). When the detector should be calibrated, the hits that had all//
+        //signals are used to create the tables, which are written to the file of the detector every now//
+        //and then. They are only written out, the hits of the run are corrected with the tables that//
+        //were loaded when the detector was seen first//
+        class DetectorHitSorterAchim : public DetectorHitSorterQuad
+        {
+        public:
+            DetectorHitSorterAchim()    {}
+            ~DetectorHitSorterAchim();
+            void sort(REMIEvent&, Detector&);
+
+        public:
+            //what was missing when the hit was reconstructed, combined in DetectorHit::method()//
+            enum Recovered {AnodeEnd=1, HexLayer=2, Mcp=4};
+
+        public:
+            //one layer of the anode with the peaks of its ends//
+            struct Layer
+            {
+                DelaylineCorrection::Layer  id;
+                SortedSignal               *one;
+                SortedSignal               *two;
+                double                      ts;         //the nominal timesum
+                double                      half;       //half the width of the timesum window
+                double                      sf;         //the scalefactor
+                double                      offset;     //the offset of the raw position
+                void set(DelaylineCorrection::Layer, const AnodeLayer&, SortedSignal&, SortedSignal&, double offset);
+            };
+            //a pair of peaks of a layer that fulfil the timesum, one of them may be reconstructed//
+            struct Candidate
+            {
+                size_t  one;        //index of the peak at end one, npos when reconstructed
+                size_t  two;        //index of the peak at end two, npos when reconstructed
+                double  raw;        //t1-t2 in ns
+                double  pos;        //the position along the layer in mm
+                double  dev;        //deviation from the corrected timesum in units of half the window
+                int     missing;    //1 when one end was reconstructed
+            };
+            static const size_t npos = static_cast<size_t>(-1);
+
+        private:
+            //the tables and the calibration of one detector//
+            struct Tables
+            {
+                Tables():written(0),calibrate(false)    {}
+                DelaylineCorrection     correction;
+                DelaylineCalibration    calibration;
+                size_t                  written;
+                bool                    calibrate;
+                std::string             filename;
+            };
+            //the tables of the detector, they are created when the detector is seen first//
+            Tables &tables(const Detector&);
+            void sortForTimesum(Detector&, Tables&);
+
+        private:
+            std::map<std::string,Tables*>   _tables;
+            QMutex                          _mutex;
+        };
+
+    }//end namespace remi
+}//end namespace cass
+
+#endif
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <utility>
+
 #include "detektorhitsorter_quad.h"
+#include "detector.h"
 
 
 
@@ -24,3 +28,34 @@ void cass::REMI::DetectorHitSorterQuad::FillHistosBeforeShift(const cass::REMI::
     //	rm.fill2d(fHiOff+kDetRaw_mm  ,u_mm,v_mm);
     //}
 }
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DetectorHitSorterQuad::SortedSignal::fill(const cass::REMI::Signal &s)
+{
+    //the peaks are found in time order, so sorting is usually not needed//
+    std::vector<std::pair<double,Peak*> > peaks(s.peaks().size());
+    for (size_t i=0;i<peaks.size();++i)
+        peaks[i] = std::make_pair(s.peaks()[i]->time(),s.peaks()[i]);
+    bool sorted = true;
+    for (size_t i=1;i<peaks.size() && sorted;++i)
+        sorted = !(peaks[i].first < peaks[i-1].first);
+    if (!sorted)
+        std::stable_sort(peaks.begin(),peaks.end());
+    time.resize(peaks.size());
+    peak.resize(peaks.size());
+    used.resize(peaks.size());
+    for (size_t i=0;i<peaks.size();++i)
+    {
+        time[i] = peaks[i].first;
+        peak[i] = peaks[i].second;
+        //a detector that shares the channel may have used the peak already//
+        used[i] = peaks[i].second->isUsed();
+    }
+}
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DetectorHitSorterQuad::SortedSignal::range(const double low, const double high, size_t &first, size_t &last)const
+{
+    first = std::lower_bound(time.begin(),time.end(),low) - time.begin();
+    last  = std::upper_bound(time.begin()+first,time.end(),high) - time.begin();
+}
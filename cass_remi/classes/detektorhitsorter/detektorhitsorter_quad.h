@@ -1,12 +1,15 @@
 #ifndef __DetektorHitSorterQuad_H_
 #define __DetektorHitSorterQuad_H_
 
+#include <vector>
 #include "detektorhitsorter.h"
 
 namespace cass
 {
     namespace REMI
     {
+        class Peak;
+
         class DetectorHitSorterQuad : public DetectorHitSorter
         {
         public:
@@ -15,6 +18,18 @@ namespace cass
         public:
             virtual void sort(REMIEvent&, Detector&)=0;
 
+        public:
+            //the peaks of one signal in time order with the times in a contiguous array//
+            struct SortedSignal
+            {
+                std::vector<double>  time;
+                std::vector<Peak*>   peak;
+                std::vector<char>    used;
+                void fill(const Signal&);
+                //the first and one past the last index with a time in [low,high]//
+                void range(const double low, const double high, size_t &first, size_t &last)const;
+            };
+
         protected:
             void FillHistosBeforeShift(const Detector&);
         };
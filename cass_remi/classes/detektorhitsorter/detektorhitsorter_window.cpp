@@ -0,0 +1,113 @@
+#include <algorithm>
+
+#include "detektorhitsorter_window.h"
+#include "detector.h"
+#include "remi_event.h"
+#include "channel.h"
+
+
+//****************************************The Class Implementation*******************************************************
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DetectorHitSorterWindow::sort(cass::REMI::REMIEvent& e, cass::REMI::Detector& d)
+{
+    //extract the peaks for the signals of the detector from the channels//
+    extractPeaksForSignal(e.channels(),d.mcp());
+    extractPeaksForSignal(e.channels(),d.u().one());
+    extractPeaksForSignal(e.channels(),d.u().two());
+    extractPeaksForSignal(e.channels(),d.v().one());
+    extractPeaksForSignal(e.channels(),d.v().two());
+
+    //now sort these peaks for the layers timesum//
+    sortForTimesum(d);
+}
+
+
+//___________________________________________________________________________________________________________________________________________________________
+void cass::REMI::DetectorHitSorterWindow::sortForTimesum(cass::REMI::Detector &d)
+{
+    //--calculate the timesum from the given lower and upper boundries for it--//
+    const double tsx        = d.u().ts();
+    const double tsy        = d.v().ts();
+    const double runttime   = d.runtime();
+    const double tsxLow     = d.u().tsLow();
+    const double tsxHigh    = d.u().tsHigh();
+    const double tsyLow     = d.v().tsLow();
+    const double tsyHigh    = d.v().tsHigh();
+    const double radius2    = d.mcpRadius()*d.mcpRadius();
+    const double sfu        = d.u().sf();
+    const double sfv        = d.v().sf();
+    const bool isHex        = d.isHexAnode();
+
+    SortedSignal mcp,x1,x2,y1,y2;
+    mcp.fill(d.mcp());
+    x1.fill(d.u().one());
+    x2.fill(d.u().two());
+    y1.fill(d.v().one());
+    y2.fill(d.v().two());
+
+    for (size_t iMcp=0;iMcp<mcp.time.size();++iMcp)
+    {
+        if (mcp.used[iMcp]) continue;
+        const double m = mcp.time[iMcp];
+        //--an anode end can only be in the runtime window around the mcp--//
+        //-- |2*x - 2*mcp - ts| <= runtime--//
+        size_t iX1min,iX1max,iY1min,iY1max;
+        x1.range(m + 0.5*(tsx-runttime), m + 0.5*(tsx+runttime), iX1min, iX1max);
+        y1.range(m + 0.5*(tsy-runttime), m + 0.5*(tsy+runttime), iY1min, iY1max);
+        bool found = false;
+        for (size_t iX1=iX1min;iX1<iX1max && !found;++iX1)
+        {
+            if (x1.used[iX1]) continue;
+            //--the timesum tells where the other end has to be--//
+            //-- tsxLow < x1+x2-2*mcp < tsxHigh--//
+            const double tx1 = x1.time[iX1];
+            size_t iX2min,iX2max;
+            x2.range(std::max(m + 0.5*(tsx-runttime), tsxLow  + 2.*m - tx1),
+                     std::min(m + 0.5*(tsx+runttime), tsxHigh + 2.*m - tx1), iX2min, iX2max);
+            for (size_t iX2=iX2min;iX2<iX2max && !found;++iX2)
+            {
+                if (x2.used[iX2]) continue;
+                const double tx2  = x2.time[iX2];
+                const double sumx = tx1+tx2 - 2.*m;
+                if (!(sumx > tsxLow && sumx < tsxHigh)) continue;
+                const double x_mm = (tx1-tx2) * sfu;
+                //--outside of the mcp already with the x component--//
+                if (x_mm*x_mm >= radius2) continue;
+                for (size_t iY1=iY1min;iY1<iY1max && !found;++iY1)
+                {
+                    if (y1.used[iY1]) continue;
+                    const double ty1 = y1.time[iY1];
+                    size_t iY2min,iY2max;
+                    y2.range(std::max(m + 0.5*(tsy-runttime), tsyLow  + 2.*m - ty1),
+                             std::min(m + 0.5*(tsy+runttime), tsyHigh + 2.*m - ty1), iY2min, iY2max);
+                    for (size_t iY2=iY2min;iY2<iY2max;++iY2)
+                    {
+                        if (y2.used[iY2]) continue;
+                        const double ty2  = y2.time[iY2];
+                        const double sumy = ty1+ty2 - 2.*m;
+                        if (!(sumy > tsyLow && sumy < tsyHigh)) continue;
+
+                        //calc pos and check wether the hit is inside the radius of the MCP//
+                        const double y_mm = (isHex)? 0.57735026918962576 * (x_mm -(ty1-ty2) * sfv) : (ty1-ty2) * sfv;
+                        if (x_mm*x_mm + y_mm*y_mm >= radius2) continue;
+
+                        //add a DetektorHit to the Detektor
+                        d.hits().push_back(cass::REMI::DetectorHit(x_mm,y_mm,m));
+
+                        //remember that these peaks have already been used//
+                        mcp.used[iMcp] = x1.used[iX1] = x2.used[iX2] = y1.used[iY1] = y2.used[iY2] = 1;
+                        found = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    //--tell the peaks that are part of a hit, the flags of other detectors stay--//
+    SortedSignal *sigs[5] = {&mcp,&x1,&x2,&y1,&y2};
+    for (size_t i=0;i<5;++i)
+        for (size_t j=0;j<sigs[i]->peak.size();++j)
+            if (sigs[i]->used[j])
+                sigs[i]->peak[j]->isUsed() = true;
+}
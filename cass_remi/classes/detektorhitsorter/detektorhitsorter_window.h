@@ -0,0 +1,28 @@
+#ifndef __DetektorHitSorterWindow_H_
+#define __DetektorHitSorterWindow_H_
+
+#include "detektorhitsorter_quad.h"
+
+namespace cass
+{
+    namespace REMI
+    {
+        //______________________MyDetektorHitSorter Sorted Window Version______________________
+        //like the simple version it takes for every mcp peak the first combination of anode peaks//
+        //that fits the timesums and the mcp, so it finds at most one hit per mcp peak. Instead of//
+        //trying all combinations of the anode peaks in the runtime window of the mcp peak, the//
+        //partner of an anode peak is searched with the timesum in the time ordered peaks of the//
+        //other end. Peaks that other detectors used already are skipped//
+        class DetectorHitSorterWindow : public DetectorHitSorterQuad
+        {
+        public:
+            void sort(REMIEvent&, Detector&);
+
+        private:
+            void sortForTimesum(Detector&);
+        };
+
+    }//end namespace remi
+}//end namespace cass
+
+#endif
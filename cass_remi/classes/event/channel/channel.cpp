@@ -1 +1,102 @@
+#include <algorithm>
+#include <cstdlib>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "channel.h"
+
+cass::REMI::Channel::Channel(const Channel &rhs)
+  :_data(0),_nbrSamples(0),_zeroSuppressed(false)
+{
+  *this = rhs;
+}
+
+cass::REMI::Channel &cass::REMI::Channel::operator=(const Channel &rhs)
+{
+  _waveform   = rhs._waveform;
+  _horpos     = rhs._horpos;
+  _fullscale  = rhs._fullscale;
+  _offset     = rhs._offset;
+  _gain       = rhs._gain;
+  _chNbr      = rhs._chNbr;
+  _threshold  = rhs._threshold;
+  _delay      = rhs._delay;
+  _fraction   = rhs._fraction;
+  _walk       = rhs._walk;
+  _type       = rhs._type;
+  _peaks      = rhs._peaks;
+  _zeroSuppressed = rhs._zeroSuppressed;
+  _segments       = rhs._segments;
+  _segmentSamples = rhs._segmentSamples;
+  //when rhs looks at its own buffer, we have to look at our copy of it//
+  if (rhs._data && !rhs._waveform.empty() && rhs._data == &rhs._waveform[0])
+    useWaveform();
+  else
+    setData(rhs._data,rhs._nbrSamples);
+  return *this;
+}
+
+namespace
+{
+  //whether the sample is outside the noise//
+  inline bool outside(int16_t sample, int32_t baseline, int32_t threshold)
+  {
+    return abs(static_cast<int32_t>(sample) - baseline) > threshold;
+  }
+
+  //the index of the first sample from i on that is outside the noise, n if there is none//
+  size_t nextOutside(const int16_t *d, size_t i, size_t n, int32_t baseline, int32_t threshold)
+  {
+#ifdef __SSE2__
+    //most of the waveform is noise, so look at 8 samples at once until one of them is outside//
+    //the differences saturate, which is fine since the threshold is at most 32767//
+    const __m128i base = _mm_set1_epi16(static_cast<int16_t>(std::max(-32768,std::min(32767,baseline))));
+    const __m128i thr  = _mm_set1_epi16(static_cast<int16_t>(std::max(0,std::min(32767,threshold))));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i+8 <= n; i+=8)
+    {
+      const __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d+i));
+      const __m128i diff = _mm_subs_epi16(v,base);
+      const __m128i dist = _mm_max_epi16(diff,_mm_subs_epi16(zero,diff));
+      if (_mm_movemask_epi8(_mm_cmpgt_epi16(dist,thr)))
+        break;
+    }
+#endif
+    for (; i<n; ++i)
+      if (outside(d[i],baseline,threshold))
+        return i;
+    return n;
+  }
+}
+
+void cass::REMI::Channel::zeroSuppress(int32_t baseline, int32_t threshold, size_t padding)
+{
+  clearSegments();
+  _zeroSuppressed = true;
+  const int16_t *d = _data;
+  const size_t   n = d ? _nbrSamples : 0;
+  size_t i = 0;
+  while ((i = nextOutside(d,i,n,baseline,threshold)) < n)
+  {
+    //extend the segment until there is a gap of more than 2*padding samples in the noise//
+    size_t last = i;
+    for (size_t j=i+1; j<n && j-last <= 2*padding; ++j)
+      if (outside(d[j],baseline,threshold))
+        last = j;
+    Segment s;
+    s.start  = i > padding ? i-padding : 0;
+    s.offset = _segmentSamples.size();
+    s.length = std::min(n,last+padding+1) - s.start;
+    _segmentSamples.insert(_segmentSamples.end(),d+s.start,d+s.start+s.length);
+    _segments.push_back(s);
+    i = s.start + s.length;
+  }
+}
+
+void cass::REMI::Channel::clearSegments()
+{
+  _zeroSuppressed = false;
+  _segments.clear();
+  _segmentSamples.clear();
+}
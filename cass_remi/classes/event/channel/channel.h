@@ -15,12 +15,22 @@ namespace cass
     class Channel
     {
       public:
-        Channel():_type(0)  {}
+        Channel():_data(0),_nbrSamples(0),_type(0),_zeroSuppressed(false)  {}
+        Channel(const Channel&);
+        Channel &operator=(const Channel&);
         ~Channel() {}
 
       public:
         typedef std::vector<int16_t> waveform_t;
         typedef std::vector<Peak> peaks_t;
+        //a part of the waveform that is outside the noise//
+        struct Segment
+        {
+          uint32_t  start;                   //the index of the first sample in the waveform
+          uint32_t  offset;                  //the index of the first sample in segmentSamples()
+          uint32_t  length;                  //the number of samples
+        };
+        typedef std::vector<Segment> segments_t;
 
       public:
         peaks_t             &peaks()            {return _peaks;}
@@ -38,6 +48,31 @@ namespace cass
         const waveform_t    &waveform()const    {return _waveform;}
         waveform_t          &waveform()         {return _waveform;}
 
+      public:
+        //the samples that should be analyzed, they are either in the datagram or in waveform()//
+        const int16_t       *data()const        {return _data;}
+        size_t               nbrSamples()const  {return _nbrSamples;}
+        //look at samples owned by someone else, they must stay valid while the event is analyzed//
+        void                 setData(const int16_t *d, size_t n)    {_data = d; _nbrSamples = n;}
+        //look at the samples in waveform()//
+        void                 useWaveform()
+        {
+          _data       = _waveform.empty() ? 0 : &_waveform[0];
+          _nbrSamples = _waveform.size();
+        }
+
+      public:
+        //the zero suppressed waveform, only the segments are kept, back to back in one buffer//
+        bool                 isZeroSuppressed()const    {return _zeroSuppressed;}
+        const segments_t    &segments()const            {return _segments;}
+        const waveform_t    &segmentSamples()const      {return _segmentSamples;}
+        //copy the parts of data() that are more than threshold away from the baseline (in adc//
+        //bytes) together with padding samples on both sides into the segments. Parts that are//
+        //less than 2*padding samples apart end up in the same segment//
+        void                 zeroSuppress(int32_t baseline, int32_t threshold, size_t padding);
+        //forget the segments, the buffers keep their space for the next event//
+        void                 clearSegments();
+
       public:
         size_t               channelNbr()const  {return _chNbr;}
         size_t              &channelNbr()       {return _chNbr;}
@@ -54,7 +89,9 @@ namespace cass
 
       private:
         //values extracted from the acqiris//
-        waveform_t  _waveform;               //the waveform
+        waveform_t  _waveform;               //buffer for the waveform when it can't be used in place
+        const int16_t *_data;                //the samples of the waveform
+        size_t      _nbrSamples;             //the number of samples of the waveform
         double      _horpos;                 //Horizontal position of first data point with respect to the trigger
         int16_t     _fullscale;              //the fullscale for this channel (in mV)
         int16_t     _offset;                 //the offset for this channel (in mV)
@@ -71,6 +108,11 @@ namespace cass
 
         //there are the results of the analysis of the waveform//
         peaks_t     _peaks;                  //Container storing the found peaks
+
+        //the zero suppressed waveform//
+        bool        _zeroSuppressed;         //whether the segments hold the waveform
+        segments_t  _segments;               //where the parts of the waveform are
+        waveform_t  _segmentSamples;         //the samples of all segments
     };
   }//end namespace remi
 }//end namespace cass
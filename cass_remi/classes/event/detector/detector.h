@@ -86,9 +86,9 @@ namespace cass
     class DetectorHit
     {
       public:
-            DetectorHit(double x, double y, double t):
-              fX_mm(x), fY_mm(y), fTime(t)        {}
-            DetectorHit()  {}
+            DetectorHit(double x, double y, double t, int32_t method=0):
+              fX_mm(x), fY_mm(y), fTime(t), fMethod(method)  {}
+            DetectorHit():fMethod(0)  {}
             ~DetectorHit() {}
 
 
@@ -99,12 +99,15 @@ namespace cass
         double &y()         {return fY_mm;}
         double  t()const    {return fTime;}
         double &t()         {return fTime;}
+        int32_t  method()const  {return fMethod;}
+        int32_t &method()       {return fMethod;}
 
       private:
 
         double  fX_mm;      //the x component of the detector in mm
         double  fY_mm;      //the y component of the detector in mm
         double  fTime;      //the mcp time of this hit on the detector
+        int32_t fMethod;    //how the hit was reconstructed, 0 means all signals were there
     };
 
 
@@ -154,6 +157,12 @@ namespace cass
         bool                &isHexAnode()           {return _isHex;}
         int32_t              sorterType()const      {return _sorterType;}
         int32_t             &sorterType()           {return _sorterType;}
+        const std::string   &correctionFile()const  {return _correctionFile;}
+        std::string         &correctionFile()       {return _correctionFile;}
+        bool                 calibrate()const       {return _calibrate;}
+        bool                &calibrate()            {return _calibrate;}
+        double               layerTolerance()const  {return _layerTolerance;}
+        double              &layerTolerance()       {return _layerTolerance;}
 
       private:
             //variables that the sorters need to find detectorhits, given by the user
@@ -169,6 +178,9 @@ namespace cass
         double               _deadAnode;            //the Deadtime between to Signals on the Layers
         bool                 _isHex;                //flag telling wether this is a Hexanode Detektor
         int32_t              _sorterType;           //flag telling which Method to sort the times is used 0=Simple Sorting, 1=Achims Sorting
+        std::string          _correctionFile;       //the file with the timesum and scalefactor correction tables
+        bool                 _calibrate;            //flag telling wether the correction tables should be created from the data
+        double               _layerTolerance;       //how far the positions of the layer pairs of a hexanode may differ in mm
 
         //output of the analysis (sorting) of the peaks
         dethits_t            _hits;                 //Container storing the refrences to the DetektorHits of this Detektor
@@ -13,7 +13,9 @@ namespace cass
     class Peak
     {
       public:
-        Peak()  {}
+        Peak():_time(0),_cfd(0),_com(0),_polarity(Bad),_slope(0),_maxpos(0),_maximum(0),
+               _height(0),_heightAbziehen(0),_fwhm(0),_width(0),_posHalfLeft(0),_posHalfRight(0),
+               _integral(0),_startpos(0),_stoppos(0),_used(false)  {}
         ~Peak() {}
 
       public:
@@ -17,7 +17,8 @@ namespace cass
       public:
             REMIEvent():
               _isFilled(false),
-            _isConfigured(false)  {}
+            _isConfigured(false),
+            _configVersion(0)  {}
             ~REMIEvent()    {}
 
       public:
@@ -37,6 +38,8 @@ namespace cass
         bool               &isFilled()              {return _isFilled;}
         bool                isConfigured()const     {return _isConfigured;}
         bool               &isConfigured()          {return _isConfigured;}
+        uint32_t            configVersion()const    {return _configVersion;}
+        uint32_t           &configVersion()         {return _configVersion;}
 
       public:
         double              sampleInterval()const   {return _sampleInterval;}
@@ -46,6 +49,7 @@ namespace cass
         //status flags//
         bool                _isFilled;              //! flag to tell whether the event has been filled
         bool                _isConfigured;          //! flag to tell whether the event has been initalized with configv1
+        uint32_t            _configVersion;         //! counts the configurations, to know when the event is outdated
 
         //containers for acqiris and delayline data//
         channels_t          _channels;              //Container for all Channels
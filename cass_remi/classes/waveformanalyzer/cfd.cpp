@@ -3,31 +3,43 @@
 #include "cfd.h"
 #include "helperfunctionsforstdc.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-//________________________________Implematation of Constant Fraction Method______________________________________________________
-//________________this will be a thread that is waiting for Pulses to be added to a queue________________________________________
-template <typename T>
-void cfd(cass::REMI::Channel &c, const double SampleInterval)
-{
-    const double sampleInterval = SampleInterval*1e9;    //convert the s to ns
-    //now extract information from the Channel
-    const double horpos     = c.horpos()*1.e9;
-    const double vGain      = c.gain();
-    const int32_t vOff      = static_cast<int32_t>(c.offset() / vGain);       //mV -> ADC Bytes
-
-    const int32_t idxToFiPoint = 0;
-    const cass::REMI::Channel::waveform_t Data = c.waveform();
-    const size_t wLength    = c.waveform().size();
-
-    //--get the right cfd settings--//
-    const int32_t delay     = static_cast<int32_t>(c.delay() / sampleInterval); //ns -> sampleinterval units
-    const double walk       = c.walk() / vGain;                                 //mV -> ADC Bytes
-    const double threshold  = c.threshold() / vGain;                            //mV -> ADC Bytes
-    const double fraction   = c.fraction();
 
-    //--go through the waveform--//
-    for (size_t i=delay+1; i<wLength-2;++i)
+namespace
+{
+    //the values of the channel that are needed to evaluate the CF signal//
+    struct CFDParameters
+    {
+        const int16_t *Data;
+        int32_t vOff;
+        int32_t delay;
+        double walk;
+        double threshold;
+        double fraction;
+        double horpos;
+        double sampleInterval;      //in ns
+        double SampleInterval;      //in s
+    };
+
+    //check whether the CF signal crosses the walk between i and i+1, when it does//
+    //refine the position of the crossing and add the peak to the channel//
+    template <typename T>
+    void checkCrossing(cass::REMI::Channel &c, const CFDParameters &cp, const size_t i)
     {
+        const int16_t *Data     = cp.Data;
+        const int32_t vOff      = cp.vOff;
+        const int32_t delay     = cp.delay;
+        const double walk       = cp.walk;
+        const double threshold  = cp.threshold;
+        const double fraction   = cp.fraction;
+        const double horpos     = cp.horpos;
+        const double sampleInterval = cp.sampleInterval;
+        const double SampleInterval = cp.SampleInterval;
+        const int32_t idxToFiPoint = 0;
+
         const double fx  = Data[i] - static_cast<double>(vOff);         //the original Point at i
         const double fxd = Data[i-delay] - static_cast<double>(vOff);   //the delayed Point    at i
         const double fsx = -fx*fraction + fxd;                          //the calculated CFPoint at i
@@ -37,98 +49,163 @@ void cfd(cass::REMI::Channel &c, const double SampleInterval)
         const double fsx_1 = -fx_1*fraction + fxd_1;                       //calculated CFPoint at i+1
 
         //check wether the criteria for a Peak are fullfilled
-        if (((fsx-walk) * (fsx_1-walk)) <= 0 ) //one point above one below the walk
-        if (fabs(fx) > threshold)              //original point above the threshold
+        if (((fsx-walk) * (fsx_1-walk)) > 0 ) //one point above one below the walk
+            return;
+        if (fabs(fx) <= threshold)             //original point above the threshold
+            return;
+        //--it could be that the first criteria is 0 because  --//
+        //--one of the Constant Fraction Signal Points or both--//
+        //--are exactly where the walk is                     --//
+        if (fabs(fsx-fsx_1) < 1e-8)    //both points are on the walk
         {
-            //--it could be that the first criteria is 0 because  --//
-            //--one of the Constant Fraction Signal Points or both--//
-            //--are exactly where the walk is                     --//
-            if (fabs(fsx-fsx_1) < 1e-8)    //both points are on the walk
-            {
-                //--go to next loop until at least one is over or under the walk--//
-                continue;
-            }
-            else if ((fsx-walk) == 0)        //only first is on walk
-            {
-                //--Only the fist is on the walk, this is what we want--//
-                //--so:do nothing--//
-            }
-            else if ((fsx_1-walk) == 0)        //only second is on walk
-            {
-                //--we want that the first point will be on the walk,--//
-                //--so in the next loop this point will be the first.--//
-                continue;
-            }
-            //does the peak have the right polarity?//
-            //if two pulses are close together then the cfsignal goes through the walk//
-            //three times, where only two crossings are good. So we need to check for//
-            //the one where it is not good//
-            if (fsx     > fsx_1)   //neg polarity
-            if (Data[i] > vOff)    //but pos Puls .. skip
-                continue;
-            if (fsx     < fsx_1)   //pos polarity
-            if (Data[i] < vOff)    //but neg Puls .. skip
-                continue;
-
-
-            //--later we need two more points, create them here--//
-            const double fx_m1 = Data[i-1] - static_cast<double>(vOff);        //the original Point at i-1
-            const double fxd_m1 = Data[i-1-delay] - static_cast<double>(vOff); //the delayed Point    at i-1
-            const double fsx_m1 = -fx_m1*fraction + fxd_m1;                    //the calculated CFPoint at i-1
-
-            const double fx_2 = Data[i+2] - static_cast<double>(vOff);         //original Point at i+2
-            const double fxd_2 = Data[i+2-delay] - static_cast<double>(vOff);  //delayed Point at i+2
-            const double fsx_2 = -fx_2*fraction + fxd_2;                       //calculated CFPoint at i+2
-
-
-            //--find x with a linear interpolation between the two points--//
-            const double m = fsx_1-fsx;                    //(fsx-fsx_1)/(i-(i+1));
-            const double xLin = i + (walk - fsx)/m;        //PSF fx = (x - i)*m + cfs[i]
-
-            //--make a linear regression to find the slope of the leading edge--//
-            double mslope,cslope;
-            const double xslope[3] = {i-delay,i+1-delay,i+2-delay};
-            const double yslope[3] = {fxd,fxd_1,fxd_2};
-            cass::REMI::linearRegression<T>(3,xslope,yslope,mslope,cslope);
-
-            //--find x with a cubic polynomial interpolation between four points--//
-            //--do this with the Newtons interpolation Polynomial--//
-            const double x[4] = {i-1,i,i+1,i+2};          //x vector
-            const double y[4] = {fsx_m1,fsx,fsx_1,fsx_2}; //y vector
-            double coeff[4] = {0,0,0,0};                  //Newton coeff vector
-            cass::REMI::createNewtonPolynomial<T>(x,y,coeff);
-
-            //--numericaly solve the Newton Polynomial--//
-            //--give the lineare approach for x as Start Value--//
-            const double xPoly = cass::REMI::findXForGivenY<T>(x,coeff,walk,xLin);
-            const double pos = xPoly + static_cast<double>(idxToFiPoint) + horpos;
-
-            //--create a new peak--//
-            cass::REMI::Peak p;
-
-            //add the info//
-            p.cfd()     = pos*sampleInterval;
-            p.time()    = pos*sampleInterval;
-            if (fsx > fsx_1) p.polarity()            = cass::REMI::Peak::Negative;       //Peak has Neg Pol
-            if (fsx < fsx_1) p.polarity()            = cass::REMI::Peak::Positive;       //Peak has Pos Pol
-            if (fabs(fsx-fsx_1) < 1e-8) p.polarity() = cass::REMI::Peak::Bad;            //Peak has Bad Pol
-
-            //--start and stop of the puls--//
-            cass::REMI::startstop<T>(c,p,SampleInterval);
-
-            //--height of peak--//
-            cass::REMI::maximum<T>(c,p);
-
-            //--width & fwhm of peak--//
-            cass::REMI::fwhm<T>(c,p);
-
-            //--the com and integral--//
-            cass::REMI::CoM<T>(c,p,SampleInterval);
-
-            //--add peak to channel--//
-            c.peaks().push_back(p);
+            //--go to next loop until at least one is over or under the walk--//
+            return;
         }
+        else if ((fsx-walk) == 0)        //only first is on walk
+        {
+            //--Only the fist is on the walk, this is what we want--//
+            //--so:do nothing--//
+        }
+        else if ((fsx_1-walk) == 0)        //only second is on walk
+        {
+            //--we want that the first point will be on the walk,--//
+            //--so in the next loop this point will be the first.--//
+            return;
+        }
+        //does the peak have the right polarity?//
+        //if two pulses are close together then the cfsignal goes through the walk//
+        //three times, where only two crossings are good. So we need to check for//
+        //the one where it is not good//
+        if (fsx     > fsx_1)   //neg polarity
+        if (Data[i] > vOff)    //but pos Puls .. skip
+            return;
+        if (fsx     < fsx_1)   //pos polarity
+        if (Data[i] < vOff)    //but neg Puls .. skip
+            return;
+
+
+        //--later we need two more points, create them here--//
+        const double fx_m1 = Data[i-1] - static_cast<double>(vOff);        //the original Point at i-1
+        const double fxd_m1 = Data[i-1-delay] - static_cast<double>(vOff); //the delayed Point    at i-1
+        const double fsx_m1 = -fx_m1*fraction + fxd_m1;                    //the calculated CFPoint at i-1
+
+        const double fx_2 = Data[i+2] - static_cast<double>(vOff);         //original Point at i+2
+        const double fxd_2 = Data[i+2-delay] - static_cast<double>(vOff);  //delayed Point at i+2
+        const double fsx_2 = -fx_2*fraction + fxd_2;                       //calculated CFPoint at i+2
+
+
+        //--find x with a linear interpolation between the two points--//
+        const double m = fsx_1-fsx;                    //(fsx-fsx_1)/(i-(i+1));
+        const double xLin = i + (walk - fsx)/m;        //PSF fx = (x - i)*m + cfs[i]
+
+        //--make a linear regression to find the slope of the leading edge--//
+        double mslope,cslope;
+        const double xslope[3] = {i-delay,i+1-delay,i+2-delay};
+        const double yslope[3] = {fxd,fxd_1,fxd_2};
+        cass::REMI::linearRegression<T>(3,xslope,yslope,mslope,cslope);
+
+        //--find x with a cubic polynomial interpolation between four points--//
+        //--do this with the Newtons interpolation Polynomial--//
+        const double x[4] = {i-1,i,i+1,i+2};          //x vector
+        const double y[4] = {fsx_m1,fsx,fsx_1,fsx_2}; //y vector
+        double coeff[4] = {0,0,0,0};                  //Newton coeff vector
+        cass::REMI::createNewtonPolynomial<T>(x,y,coeff);
+
+        //--solve the Newton Polynomial--//
+        //--give the lineare approach for x as Start Value--//
+        const double xPoly = cass::REMI::solveNewtonPolynomial<T>(x,coeff,walk,xLin);
+        const double pos = xPoly + static_cast<double>(idxToFiPoint) + horpos;
+
+        //--create a new peak--//
+        cass::REMI::Peak p;
+
+        //add the info//
+        p.cfd()     = pos*sampleInterval;
+        p.time()    = pos*sampleInterval;
+        if (fsx > fsx_1) p.polarity()            = cass::REMI::Peak::Negative;       //Peak has Neg Pol
+        if (fsx < fsx_1) p.polarity()            = cass::REMI::Peak::Positive;       //Peak has Pos Pol
+        if (fabs(fsx-fsx_1) < 1e-8) p.polarity() = cass::REMI::Peak::Bad;            //Peak has Bad Pol
+
+        //--start and stop of the puls--//
+        cass::REMI::startstop<T>(c,p,SampleInterval);
+
+        //--height, width, fwhm, com and integral of peak--//
+        cass::REMI::characterize<T>(c,p,SampleInterval);
+
+        //--add peak to channel--//
+        c.peaks().push_back(p);
+    }
+
+#ifdef __SSE2__
+    //convert 4 samples to float//
+    inline __m128 load4(const int16_t *p)
+    {
+        const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+        return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v,v),16));
+    }
+#endif
+}
+
+//________________________________Implematation of Constant Fraction Method______________________________________________________
+//________________this will be a thread that is waiting for Pulses to be added to a queue________________________________________
+template <typename T>
+void cfd(cass::REMI::Channel &c, const double SampleInterval)
+{
+    CFDParameters cp;
+    cp.SampleInterval   = SampleInterval;
+    cp.sampleInterval   = SampleInterval*1e9;    //convert the s to ns
+    //now extract information from the Channel
+    cp.horpos           = c.horpos()*1.e9;
+    const double vGain  = c.gain();
+    cp.vOff             = static_cast<int32_t>(c.offset() / vGain);       //mV -> ADC Bytes
+
+    cp.Data             = c.data();
+    const size_t wLength    = c.nbrSamples();
+
+    //--get the right cfd settings--//
+    cp.delay            = static_cast<int32_t>(c.delay() / cp.sampleInterval); //ns -> sampleinterval units
+    cp.walk             = c.walk() / vGain;                                 //mV -> ADC Bytes
+    cp.threshold        = c.threshold() / vGain;                            //mV -> ADC Bytes
+    cp.fraction         = c.fraction();
+
+    if (!cp.Data || cp.delay < 0 || wLength < static_cast<size_t>(cp.delay) + 4)
+        return;
+
+    //--go through the waveform--//
+    size_t i = cp.delay+1;
+    const size_t end = wLength-2;
+#ifdef __SSE2__
+    //most of the waveform is baseline, so the CF signal is calculated for 4 points at//
+    //once in single precision and only the points where it might cross the walk above//
+    //the threshold are checked exactly. The tolerance covers the rounding of the single//
+    //precision so that no crossing that the exact check would find is lost//
+    const float tol = 1e-5f * (65536.f*(1.f+static_cast<float>(fabs(cp.fraction))) + static_cast<float>(fabs(cp.walk)));
+    const __m128 off        = _mm_set1_ps(static_cast<float>(cp.vOff));
+    const __m128 frac       = _mm_set1_ps(static_cast<float>(cp.fraction));
+    const __m128 walk       = _mm_set1_ps(static_cast<float>(cp.walk));
+    const __m128 ptol       = _mm_set1_ps(tol);
+    const __m128 ntol       = _mm_set1_ps(-tol);
+    const __m128 thresh     = _mm_set1_ps(static_cast<float>(cp.threshold) - tol);
+    const __m128 absmask    = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    for (; i+4<=end; i+=4)
+    {
+        const int16_t *d  = cp.Data+i;
+        const int16_t *dd = cp.Data+i-cp.delay;
+        const __m128 fx     = _mm_sub_ps(load4(d),off);
+        const __m128 fsx    = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(load4(dd),off),_mm_mul_ps(fx,frac)),walk);
+        const __m128 fx_1   = _mm_sub_ps(load4(d+1),off);
+        const __m128 fsx_1  = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(load4(dd+1),off),_mm_mul_ps(fx_1,frac)),walk);
+        const __m128 cross  = _mm_and_ps(_mm_cmple_ps(_mm_min_ps(fsx,fsx_1),ptol),
+                                         _mm_cmpge_ps(_mm_max_ps(fsx,fsx_1),ntol));
+        const __m128 above  = _mm_cmpge_ps(_mm_and_ps(fx,absmask),thresh);
+        int mask = _mm_movemask_ps(_mm_and_ps(cross,above));
+        for (size_t k=i; mask; mask>>=1, ++k)
+            if (mask & 1)
+                checkCrossing<T>(c,cp,k);
     }
+#endif
+    for (; i<end; ++i)
+        checkCrossing<T>(c,cp,i);
 }
 
 //########################## 8 Bit Version ###########################################################################
@@ -10,9 +10,9 @@ template <typename T>
 void com(cass::REMI::Channel& c, const double SampleInterval)
 {
     //extract info from the event//
-    const cass::REMI::Channel::waveform_t Data = c.waveform();
+    const int16_t *Data     = c.data();
     const int32_t vOffset   = static_cast<int32_t>(c.offset() / c.gain());    //mV -> ADC Bytes
-    const size_t wLength    = c.waveform().size();
+    const size_t wLength    = c.nbrSamples();
     const double threshold  = c.threshold() / c.gain();    //mV -> ADC Bytes
 //    std::cout << "in waveformanalyzer threshold of channel "<<c.channelNbr()<<" is "<<c.threshold()<<std::endl;
 
@@ -37,14 +37,8 @@ void com(cass::REMI::Channel& c, const double SampleInterval)
                 p.startpos() = startpos;
                 p.stoppos()  = i-1;
 
-                //--height stuff--//
-                cass::REMI::maximum<T>(c,p);
-
-                //--fwhm stuff--//
-                cass::REMI::fwhm<T>(c,p);
-
-                //--center of mass stuff--//
-                cass::REMI::CoM<T>(c,p,SampleInterval);
+                //--height, fwhm and center of mass stuff--//
+                cass::REMI::characterize<T>(c,p,SampleInterval);
 
                 //--Time is the Center of Mass--//
                 p.time()= p.com();
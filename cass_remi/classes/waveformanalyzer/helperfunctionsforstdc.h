@@ -1,9 +1,11 @@
 #ifndef __helperfunctions_h__
 #define __helperfunctions_h__
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "remi_event.h"
 #include "channel.h"
@@ -186,6 +188,160 @@ namespace cass
             return ((Up.x() + Low.x())*0.5);
         }
 
+        //_________________________________solve the Newton Polynomial analytically_______________________________________________________
+        template <typename T>
+        double solveNewtonPolynomial(const double * x, const double * coeff, const double Y, const double Start)
+        {
+            //**the Newton Polynomial is a cubic, written in t = X-x1 it is A t^3 + B t^2 + C t + D   **//
+            //**its roots are found with the trigonometric / Cardano formulas. The root between x1    **//
+            //**and x2 that is closest to the start value is returned. When there is none, because    **//
+            //**the polynomial is (almost) degenerated, the numerical approximation is used          **//
+            const double a = x[0]-x[1];
+            const double b = x[2]-x[1];
+            const double A = coeff[3];
+            const double B = coeff[2] - coeff[3]*(a+b);
+            const double C = coeff[1] - coeff[2]*a + coeff[3]*a*b;
+            const double D = coeff[0] - coeff[1]*a - Y;
+
+            double roots[3];
+            size_t nbrRoots = 0;
+            const double scale = fabs(B) + fabs(C) + fabs(D);
+            if (fabs(A) > 1e-9*scale)
+            {
+                //--depressed cubic t = s - B/(3A): s^3 + P s + Q = 0--//
+                const double bA = B/A, cA = C/A, dA = D/A;
+                const double shift = bA/3.;
+                const double P = cA - bA*bA/3.;
+                const double Q = 2.*bA*bA*bA/27. - bA*cA/3. + dA;
+                const double disc = Q*Q/4. + P*P*P/27.;
+                if (disc > 0)
+                {
+                    const double sq = sqrt(disc);
+                    roots[nbrRoots++] = cbrt(-Q/2.+sq) + cbrt(-Q/2.-sq) - shift;
+                }
+                else if (P < 0)
+                {
+                    const double r   = 2.*sqrt(-P/3.);
+                    const double arg = std::max(-1.,std::min(1.,3.*Q/(P*r)));
+                    const double phi = acos(arg)/3.;
+                    for (int k=0;k<3;++k)
+                        roots[nbrRoots++] = r*cos(phi - 2.*M_PI*k/3.) - shift;
+                }
+                else
+                    roots[nbrRoots++] = -shift;
+            }
+            else if (fabs(B) > 1e-9*scale)
+            {
+                const double disc = C*C - 4.*B*D;
+                if (disc >= 0)
+                {
+                    //--numerically stable form of the quadratic formula--//
+                    const double q = -0.5*(C + (C<0 ? -sqrt(disc) : sqrt(disc)));
+                    roots[nbrRoots++] = q/B;
+                    if (q != 0) roots[nbrRoots++] = D/q;
+                }
+            }
+            else if (C != 0)
+                roots[nbrRoots++] = -D/C;
+
+            //--take the root that is between x1 and x2 and closest to the start value--//
+            const double eps = 1e-9*fabs(b);
+            double best = 0;
+            bool found = false;
+            for (size_t i=0;i<nbrRoots;++i)
+            {
+                if (roots[i] < -eps || roots[i] > b+eps) continue;
+                const double X = x[1] + std::max(0.,std::min(b,roots[i]));
+                if (!found || fabs(X-Start) < fabs(best-Start))
+                    best = X;
+                found = true;
+            }
+            return found ? best : findXForGivenY<T>(x,coeff,Y,Start);
+        }
+
+        //_________________________________slope and offset of a line through 4 equally spaced points____________________________________
+        //the closed form of linearRegression for the points (x0+k, y[k]) with k = 0..3//
+        inline void linearRegression4(const double x0, const double y[], double &m, double &c)
+        {
+            m = (-3.*y[0] - y[1] + y[2] + 3.*y[3]) / 10.;
+            c = 0.25*(y[0]+y[1]+y[2]+y[3]) - m*(x0+1.5);
+        }
+
+        //_________________________________all parameters of a pulse in one go_____________________________________________________________
+        //the start and stop of the pulse have to be known. In one pass from start to stop the//
+        //maximum, the integral and the center of mass are found, the fwhm is then found from the//
+        //maximum position outwards. It gives the same results as maximum, fwhm and CoM//
+        template <typename T>
+        void characterize(const Channel &c, Peak &p, const double SampleInterval)
+        {
+            const int16_t *Data         = c.data();
+            const int32_t wLength       = c.nbrSamples();
+            const double vGain          = c.gain();
+            const int32_t maxOff        = c.offset();                   //maximum() uses the offset like this
+            const int32_t vOff          = static_cast<int32_t>(c.offset() / vGain);  //mV -> adc bytes
+            const int32_t threshold     = c.threshold();
+            const double horpos         = c.horpos()*1.e9;              //s -> ns
+            const double sampleInterval = SampleInterval*1e9;           //s -> ns
+            const int32_t start         = p.startpos();
+            const int32_t stop          = std::min(static_cast<int32_t>(p.stoppos()),wLength-1);
+
+            //--maximum, integral and weight in one pass--//
+            int32_t maximum = 0;
+            int32_t maxpos  = 0;
+            int64_t integral= 0;
+            int64_t wichtung= 0;
+            for (int32_t i=start; i<=stop; ++i)
+            {
+                const int32_t m = abs(Data[i]-maxOff);
+                if (m > maximum)
+                {
+                    maximum = m;
+                    maxpos  = i;
+                }
+                const int32_t v = abs(Data[i]-vOff) - threshold;
+                integral += v;
+                wichtung += static_cast<int64_t>(v)*i;
+            }
+            p.maxpos()  = maxpos;
+            p.maximum() = maximum;
+            p.height()  = static_cast<double>(maximum) * vGain;        //this will set the height in mV
+            p.integral()= integral;
+            p.com()     = (static_cast<double>(wichtung)/integral + horpos)*sampleInterval;
+
+            //--fwhm: find the points where the pulse drops below half of the maximum--//
+            const double HalfMax = 0.5*maximum;
+            int32_t fwhm_l = 0;
+            int32_t fwhm_r = 0;
+            for (int32_t i=maxpos; i>=0; --i)
+                if (abs(Data[i]-vOff) < HalfMax)
+                {
+                    fwhm_l = i+1;
+                    break;
+                }
+            for (int32_t i=maxpos; i<wLength; ++i)
+                if (abs(Data[i]-vOff) < HalfMax)
+                {
+                    fwhm_r = i-1;
+                    break;
+                }
+            //--the lines through the edges need two points on each side--//
+            if (fwhm_l < 2 || !fwhm_r || fwhm_r+2 >= wLength)
+                return;
+            double ly[4], ry[4];
+            for (int32_t k=0;k<4;++k)
+            {
+                ly[k] = abs(Data[fwhm_l-2+k]-vOff);
+                ry[k] = abs(Data[fwhm_r-1+k]-vOff);
+            }
+            double mLeft,cLeft,mRight,cRight;
+            linearRegression4(fwhm_l-2,ly,mLeft,cLeft);
+            linearRegression4(fwhm_r-1,ry,mRight,cRight);
+
+            //y = m*x+c => x = (y-c)/m;
+            p.fwhm()  = (HalfMax-cRight)/mRight - (HalfMax-cLeft)/mLeft;
+            p.width() = p.stoppos() - p.startpos();
+        }
+
         //_______extract full width at half maximum________________________________________________________________________________________
         template <typename T>
         void fwhm(const Channel &c, Peak &p)
@@ -193,8 +349,8 @@ namespace cass
             //get information from the channel//
 
             const int32_t vOff   = static_cast<int32_t>(c.offset() / c.gain());        //mV -> adc bytes
-            const Channel::waveform_t Data  = c.waveform();
-            const size_t wLength = c.waveform().size();
+            const int16_t *Data  = c.data();
+            const size_t wLength = c.nbrSamples();
 
             //--get peak fwhm--//
             size_t fwhm_l        = 0;
@@ -282,7 +438,7 @@ namespace cass
         void CoM(const Channel &c, Peak &p, const double SampleInterval)
         {
             //get informations from the event and the channel//
-            const Channel::waveform_t Data  = c.waveform();
+            const int16_t *Data  = c.data();
             const int32_t vOff          = static_cast<int32_t>(c.offset() / c.gain());
             const int32_t threshold     = c.threshold();
             const double horpos         = c.horpos()*1.e9;          //s -> ns
@@ -310,10 +466,10 @@ namespace cass
         void startstop(const Channel &c, Peak &p, const double SampleInterval)
         {
             //--this function will find the start and the stop of the peak--//
-            const Channel::waveform_t Data = c.waveform();
+            const int16_t *Data = c.data();
             const int32_t vOff      = static_cast<int32_t>(c.offset()/c.gain());
             const int32_t threshold = c.threshold();
-            const int32_t wLength   = c.waveform().size();
+            const int32_t wLength   = c.nbrSamples();
             const double sampInt    = SampleInterval*1e9;
             const double horpos     = c.horpos()*1e9;
 
@@ -343,7 +499,7 @@ namespace cass
         void maximum(const Channel &c, Peak &p)
         {
             //--this function will find the maximum of the peak and its position--//
-            const Channel::waveform_t Data = c.waveform();
+            const int16_t *Data = c.data();
             const int32_t vOff   = c.offset();
             const size_t start   = p.startpos();
             const size_t stop    = p.stoppos();
@@ -1,9 +1,14 @@
+#include <algorithm>
+#include <set>
+
 #include "remi_analysis.h"
 #include "remi_event.h"
 #include "cass_event.h"
 #include "com.h"
 #include "cfd.h"
 #include "detektorhitsorter_simple.h"
+#include "detektorhitsorter_window.h"
+#include "detektorhitsorter_achim.h"
 
 void loadSignalParameter(cass::REMI::Signal& s, const char * groupName, cass::REMI::Parameter* p)
 {
@@ -53,6 +58,10 @@ void cass::REMI::Parameter::load()
   QString s;
   //sync before loading//
   sync();
+  _nbrThreads       = value("NbrAnalysisThreads",1).toUInt();
+  _peaksPerChannel  = value("PeaksPerChannel",64).toUInt();
+  _zeroSuppression  = value("ZeroSuppression",false).toBool();
+  _zeroSuppressionPadding = value("ZeroSuppressionPadding",16).toUInt();
   //the channel parameters//
   beginGroup("ChannelContainer");
   //delete the previous channel parameters//
@@ -91,6 +100,9 @@ void cass::REMI::Parameter::load()
     _detectors[i].sorterType()    = value("SortingMethod",DetectorHitSorter::Simple).toInt();
     _detectors[i].isHexAnode()    = value("isHex",true).toBool();
     _detectors[i].name()          = value("Name","IonDetector").toString().toStdString();
+    _detectors[i].correctionFile()= value("CorrectionFile","").toString().toStdString();
+    _detectors[i].calibrate()     = value("Calibrate",false).toBool();
+    _detectors[i].layerTolerance()= value("LayerTolerance",2.).toDouble();
     loadSignalParameter(_detectors[i].mcp(),"McpSignal",this);
     loadAnodeParameter(_detectors[i].u(),"ULayer",this);
     loadAnodeParameter(_detectors[i].v(),"VLayer",this);
@@ -106,6 +118,10 @@ void cass::REMI::Parameter::save()
 {
   //string for the container index//
   QString s;
+  setValue("NbrAnalysisThreads",_nbrThreads);
+  setValue("PeaksPerChannel",_peaksPerChannel);
+  setValue("ZeroSuppression",_zeroSuppression);
+  setValue("ZeroSuppressionPadding",_zeroSuppressionPadding);
   //the channel parameters//
   beginGroup("ChannelContainer");
   setValue("size",static_cast<uint32_t>(_channelParameters.size()));
@@ -136,6 +152,9 @@ void cass::REMI::Parameter::save()
     setValue("SortingMethod",_detectors[i].sorterType());
     setValue("isHex",_detectors[i].isHexAnode());
     setValue("Name",_detectors[i].name().c_str());
+    setValue("CorrectionFile",_detectors[i].correctionFile().c_str());
+    setValue("Calibrate",_detectors[i].calibrate());
+    setValue("LayerTolerance",_detectors[i].layerTolerance());
     saveSignalParameter(_detectors[i].mcp(),"McpSignal",this);
     saveAnodeParameter(_detectors[i].u(),"ULayer",this);
     saveAnodeParameter(_detectors[i].v(),"VLayer",this);
@@ -165,20 +184,93 @@ cass::REMI::Analysis::Analysis()
 
   //create the map with the DetectorHitSorter//
   _sorter[DetectorHitSorter::Simple] = new cass::REMI::DetectorHitSorterSimple();
+  _sorter[DetectorHitSorter::Window] = new cass::REMI::DetectorHitSorterWindow();
+  _sorter[DetectorHitSorter::Achim]  = new cass::REMI::DetectorHitSorterAchim();
 
   //load the settings//
   loadSettings();
 }
 
 
+cass::REMI::Analysis::~Analysis()
+{
+  for (waveformanalyzers_t::iterator it=_waveformanalyzer.begin();it!=_waveformanalyzer.end();++it)
+    delete it->second;
+  //the sorters may still have to write their calibration//
+  for (dethitsorter_t::iterator it=_sorter.begin();it!=_sorter.end();++it)
+    delete it->second;
+}
+
+
 void cass::REMI::Analysis::loadSettings()
 {
   //we need to fill the parameters with some life first//
   _parameter.load();
 }
 
+bool cass::REMI::Analysis::detectorsIndependent(const REMIEvent::detectors_t &detectors)
+{
+  std::set<size_t> used;
+  for (size_t i=0; i<detectors.size();++i)
+  {
+    const cass::REMI::Detector &d = detectors[i];
+    const cass::REMI::Signal *sigs[7] = {&d.mcp(),
+                                         &d.u().one(),&d.u().two(),
+                                         &d.v().one(),&d.v().two(),
+                                         &d.w().one(),&d.w().two()};
+    std::set<size_t> channels;
+    for (size_t j=0; j<7;++j)
+      channels.insert(sigs[j]->chanNbr());
+    for (std::set<size_t>::const_iterator it=channels.begin(); it!=channels.end();++it)
+      if (!used.insert(*it).second)
+        return false;
+  }
+  return true;
+}
+
+void cass::REMI::Analysis::analyzeSegments(WaveformAnalyzer &analyzer, Channel &c, double sampleInterval)const
+{
+  const double vGain  = c.gain();
+  const double sampInt = sampleInterval*1e9;      //s -> ns
+  //the cfd needs the delayed samples and com looks 3 samples back, so the padding has to cover them//
+  const size_t minPadding = static_cast<size_t>(std::max(0.,c.delay()/sampInt)) + 4;
+  c.zeroSuppress(static_cast<int32_t>(c.offset()/vGain),
+                 static_cast<int32_t>(c.threshold()/vGain),
+                 std::max(static_cast<size_t>(_parameter._zeroSuppressionPadding),minPadding));
+
+  //let the analyzer look at one segment after the other and move the peaks it found//
+  //from the segment to the waveform//
+  const int16_t *data      = c.data();
+  const size_t nbrSamples  = c.nbrSamples();
+  const Channel::segments_t &segments = c.segments();
+  for (size_t i=0; i<segments.size();++i)
+  {
+    const Channel::Segment &s = segments[i];
+    const size_t before = c.peaks().size();
+    c.setData(&c.segmentSamples()[s.offset],s.length);
+    analyzer.analyze(c,sampleInterval);
+    const double shift = s.start*sampInt;
+    for (size_t j=before; j<c.peaks().size();++j)
+    {
+      Peak &p = c.peaks()[j];
+      p.time()     += shift;
+      p.cfd()      += shift;
+      p.com()      += shift;
+      p.startpos() += s.start;
+      p.stoppos()  += s.start;
+      p.maxpos()   += s.start;
+    }
+  }
+  c.setData(data,nbrSamples);
+}
+
 void cass::REMI::Analysis::operator()(cass::CASSEvent* cassevent)
 {
+  //only when somebody reads the hits and they are not there yet//
+  if (!cassevent->wanted().has(cass::Products::REMIHits) ||
+      cassevent->produced().has(cass::Products::REMIHits))
+    return;
+
   //get the remievent from the cassevent//
   cass::REMI::REMIEvent& remievent = cassevent->REMIEvent();
 
@@ -224,24 +316,56 @@ void cass::REMI::Analysis::operator()(cass::CASSEvent* cassevent)
     }
 
 
+    //find the analyzers and sorters here, so that the maps are not touched by the threads//
+    const int nbrChannels = remievent.channels().size();
+    std::vector<WaveformAnalyzer*> analyzers(nbrChannels,static_cast<WaveformAnalyzer*>(0));
+    for (int i=0; i<nbrChannels;++i)
+    {
+      cass::REMI::Channel &c = remievent.channels()[i];
+      waveformanalyzers_t::const_iterator it =
+          _waveformanalyzer.find(static_cast<cass::REMI::WaveformAnalyzer::WaveformAnalyzerTypes>(c.type()));
+      if (it != _waveformanalyzer.end())
+        analyzers[i] = it->second;
+      //the peaks are put into the space the channel kept from the previous events//
+      c.peaks().reserve(_parameter._peaksPerChannel);
+    }
+    const int nbrDetectors = remievent.detectors().size();
+    std::vector<DetectorHitSorter*> sorters(nbrDetectors,static_cast<DetectorHitSorter*>(0));
+    for (int i=0; i<nbrDetectors;++i)
+    {
+      dethitsorter_t::const_iterator it =
+          _sorter.find(static_cast<cass::REMI::DetectorHitSorter::SorterTypes>(remievent.detectors()[i].sorterType()));
+      if (it != _sorter.end())
+        sorters[i] = it->second;
+    }
+    const int nbrThreads = _parameter._nbrThreads ? _parameter._nbrThreads : 1;
+
     //find the Signals (peaks) of all waveforms in the channels//
-    for (size_t i=0; i<remievent.channels().size();++i)
+    //every channel only writes to its own peaks, so they can be analyzed at the same time//
+#pragma omp parallel for schedule(dynamic,1) num_threads(nbrThreads) if(nbrThreads > 1)
+    for (int i=0; i<nbrChannels;++i)
     {
-      cass::REMI::WaveformAnalyzer::WaveformAnalyzerTypes type =
-          static_cast<cass::REMI::WaveformAnalyzer::WaveformAnalyzerTypes>(remievent.channels()[i].type());
-      _waveformanalyzer[type]->analyze(remievent.channels()[i], remievent.sampleInterval());
+      cass::REMI::Channel &c = remievent.channels()[i];
+      c.clearSegments();
+      if (!analyzers[i])
+        continue;
+      if (_parameter._zeroSuppression)
+        analyzeSegments(*analyzers[i], c, remievent.sampleInterval());
+      else
+        analyzers[i]->analyze(c, remievent.sampleInterval());
     }
 
     //extract the peaks for the layers//
     //and sort the peaks for detektor hits//
     //fill the results in the Cass Event//
     //this has to be done for each detektor individually//
-    for (size_t i=0; i<remievent.detectors().size();++i)
-    {
-      cass::REMI::DetectorHitSorter::SorterTypes type =
-          static_cast<cass::REMI::DetectorHitSorter::SorterTypes>(remievent.detectors()[i].sorterType());
-      _sorter[type]->sort(remievent, remievent.detectors()[i]);
-    }
+    //the sorters mark the peaks they used, so detectors that share a channel have to be//
+    //sorted one after the other to get the same result every time//
+    const bool parallelSort = nbrThreads > 1 && nbrDetectors > 1 && detectorsIndependent(remievent.detectors());
+#pragma omp parallel for schedule(dynamic,1) num_threads(nbrThreads) if(parallelSort)
+    for (int i=0; i<nbrDetectors;++i)
+      if (sorters[i])
+        sorters[i]->sort(remievent, remievent.detectors()[i]);
 
     //        for (size_t i=0;i<remievent.nbrOfChannels();++i)
     //        {
@@ -258,6 +382,7 @@ void cass::REMI::Analysis::operator()(cass::CASSEvent* cassevent)
     //            }
     //        }
 //    std::cout  << remievent.channels().size()<<std::endl;
+    cassevent->produced().add(cass::Products::REMIHits);
   }
 }
 
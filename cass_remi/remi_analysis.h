@@ -42,6 +42,10 @@ namespace cass
 
       REMIEvent::detectors_t  _detectors;
       chanparameters_t        _channelParameters;     //settings to extract peaks of the channels
+      uint32_t                _nbrThreads;            //how many threads analyze the channels and detectors of one event
+      uint32_t                _peaksPerChannel;       //how many peaks the channels have space for before they need to grow
+      bool                    _zeroSuppression;       //whether only the parts of the waveforms outside the noise are kept and analyzed
+      uint32_t                _zeroSuppressionPadding;//how many samples in the noise are kept on both sides of these parts
     };
 
 
@@ -51,7 +55,7 @@ namespace cass
     {
     public:
       Analysis();
-      ~Analysis()         {}
+      ~Analysis();
       void loadSettings();
       void saveSettings() {_parameter.save();}
       //called for every event//
@@ -61,6 +65,12 @@ namespace cass
       typedef std::map<WaveformAnalyzer::WaveformAnalyzerTypes, WaveformAnalyzer*> waveformanalyzers_t;
       typedef std::map<DetectorHitSorter::SorterTypes, DetectorHitSorter*> dethitsorter_t;
 
+    private:
+      //whether no two detectors share a channel, so that they can be sorted at the same time//
+      static bool detectorsIndependent(const REMIEvent::detectors_t&);
+      //zero suppress the waveform of the channel and find the peaks in every segment//
+      void analyzeSegments(WaveformAnalyzer&, Channel&, double sampleInterval)const;
+
    private:
       waveformanalyzers_t _waveformanalyzer;
       dethitsorter_t      _sorter;
@@ -7,11 +7,50 @@
 #include "pdsdata/acqiris/DataDescV1.hh"
 #include "pdsdata/xtc/Src.hh"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void cass::REMI::ConverterParameter::load()
+{
+  //sync before loading//
+  sync();
+  _swapBytes = value("SwapWaveformBytes",false).toBool();
+}
+
+void cass::REMI::ConverterParameter::save()
+{
+  setValue("SwapWaveformBytes",_swapBytes);
+}
+
+namespace
+{
+  //copy the samples and swap the bytes of each of them//
+  void swapBytes(const int16_t *in, int16_t *out, size_t n)
+  {
+    size_t i=0;
+#ifdef __SSE2__
+    for (; i+8<=n; i+=8)
+    {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in+i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out+i),
+                       _mm_or_si128(_mm_slli_epi16(v,8),_mm_srli_epi16(v,8)));
+    }
+#endif
+    for (; i<n; ++i)
+    {
+      const uint16_t v = static_cast<uint16_t>(in[i]);
+      out[i] = static_cast<int16_t>((v<<8) | (v>>8));
+    }
+  }
+}
+
 cass::REMI::Converter::Converter()
 {
   //this converter should react on acqiris config and waveform//
   _types.push_back(Pds::TypeId::Id_AcqConfig);
   _types.push_back(Pds::TypeId::Id_AcqWaveform);
+  _param.load();
 }
 
 void cass::REMI::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEvent* cassevent)
@@ -39,6 +78,8 @@ void cass::REMI::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEvent* cas
             _storedEvent.detectors().clear();
             //set the status flags//
             _storedEvent.isConfigured() = true;
+            //the events need to get the new configuration//
+            ++_storedEvent.configVersion();
             //extract all infos for the event//
             _storedEvent.sampleInterval() = config.horiz().sampInterval();
             std::cout <<"config:"<<std::endl;
@@ -87,8 +128,10 @@ void cass::REMI::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEvent* cas
         //extract the datadescriptor (waveform etc) from the xtc//
         const Pds::Acqiris::DataDescV1 &datadesc = *reinterpret_cast<const Pds::Acqiris::DataDescV1*>(xtc->payload());
         REMIEvent &remievent = cassevent->REMIEvent();
-        //first copy the stored configuration into the incoming remievent//
-        remievent = _storedEvent;
+        //the configuration only needs to be copied into the event when it changed//
+        //since this event was filled the last time, otherwise it is already there//
+        if (remievent.configVersion() != _storedEvent.configVersion())
+          remievent = _storedEvent;
         //initialize the rest of the values from the datadescriptor//
         //only if it is already configured//
         if (remievent.isConfigured())
@@ -100,20 +143,27 @@ void cass::REMI::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEvent* cas
           for (size_t ic=0;ic<remievent.channels().size();++ic)
           {
             Pds::Acqiris::DataDescV1 &ddesc = *dd;
+            Channel &channel = remievent.channels()[ic];
             //extract the vertical gain, that allows one to convert points from ADC Bytes to Volts (milli Volts)
 	    /* FM: gain no longer available */
 	    //	    remievent.channels()[ic].gain() = ddesc.gain()*1000;
             //extact the horizontal position of the first point with respect to the trigger//
-            remievent.channels()[ic].horpos() = ddesc.timestamp(0).pos();
+            channel.horpos() = ddesc.timestamp(0).pos();
             //extract waveform//
             const short* waveform = ddesc.waveform(config.horiz());
             //we need to shift the pointer so that it looks at the first real point of the waveform//
             waveform += ddesc.indexFirstPoint();
-            //resize the waveform vector to hold all the entries of the waveform//
-            remievent.channels()[ic].waveform().resize(ddesc.nbrSamplesInSeg());
-            //we have to swap the byte order for some reason that still has to be determined//
-            for (size_t iw=0;iw<ddesc.nbrSamplesInSeg();++iw)
-              remievent.channels()[ic].waveform()[iw] = (waveform[iw]&0x00ff<<8) | (waveform[iw]&0xff00>>8);
+            //the samples are analyzed where they are in the datagram, only when the byte//
+            //order has to be swapped they are copied to the buffer of the channel, which//
+            //keeps its size from event to event//
+            if (_param._swapBytes)
+            {
+              channel.waveform().resize(ddesc.nbrSamplesInSeg());
+              swapBytes(waveform,&channel.waveform()[0],ddesc.nbrSamplesInSeg());
+              channel.useWaveform();
+            }
+            else
+              channel.setData(waveform,ddesc.nbrSamplesInSeg());
 
             //change to the next Channel//
             dd = dd->nextChannel(config.horiz());
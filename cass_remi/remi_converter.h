@@ -3,6 +3,7 @@
 
 #include "cass_remi.h"
 #include "conversion_backend.h"
+#include "parameter_backend.h"
 #include "remi_event.h"
 #include <iostream>
 #include "pdsdata/acqiris/ConfigV1.hh"
@@ -11,6 +12,18 @@ namespace cass
 {
     namespace REMI
     {
+        class CASS_REMISHARED_EXPORT ConverterParameter : public cass::ParameterBackend
+        {
+        public:
+            ConverterParameter()    {beginGroup("REMI");beginGroup("Converter");}
+            ~ConverterParameter()   {endGroup();endGroup();}
+            void load();
+            void save();
+
+        public:
+            bool    _swapBytes;     //whether the byte order of the samples has to be swapped
+        };
+
         class CASS_REMISHARED_EXPORT Converter : public cass::ConversionBackend
         {
         public:
@@ -21,6 +34,7 @@ namespace cass
             //store the config internally since its only send once for each run//
             REMIEvent               _storedEvent;
 	    Pds::Acqiris::ConfigV1 config;
+            ConverterParameter      _param;
         };
     }//end namespace remi
 }//end namespace cass
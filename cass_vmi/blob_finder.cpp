@@ -0,0 +1,214 @@
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "blob_finder.h"
+
+
+namespace
+{
+  //the first pixel of the blob, the parents of the pixels are not changed//
+  inline int32_t root(const int32_t *parent, int32_t i)
+  {
+    while (parent[i] != i)
+      i = parent[i];
+    return i;
+  }
+
+  //the first pixel of the blob, the path to it is shortened on the way//
+  inline int32_t compress(int32_t *parent, int32_t i)
+  {
+    while (parent[i] != i)
+    {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  }
+
+  //join the blobs of the two pixels, the first pixel in the frame stays the root//
+  inline void unite(int32_t *parent, int32_t a, int32_t b)
+  {
+    a = compress(parent,a);
+    b = compress(parent,b);
+    if (a < b)
+      parent[b] = a;
+    else if (b < a)
+      parent[a] = b;
+  }
+
+  //the index of the first pixel from i on that is above threshold, n if there is none//
+  inline size_t nextAbove(const uint16_t *row, size_t i, size_t n, uint16_t threshold)
+  {
+#ifdef __SSE2__
+    //the unsigned pixels compare like signed values after flipping the highest bit//
+    const __m128i bias   = _mm_set1_epi16(static_cast<short>(0x8000));
+    const __m128i thresh = _mm_set1_epi16(static_cast<short>(threshold^0x8000));
+    for (; i+8<=n; i+=8)
+    {
+      const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row+i)),bias);
+      if (_mm_movemask_epi8(_mm_cmpgt_epi16(v,thresh)))
+        break;
+    }
+#endif
+    for (; i<n; ++i)
+      if (row[i] > threshold)
+        return i;
+    return n;
+  }
+}
+
+void cass::VMI::BlobFinder::add(Blob &blob, int32_t pixel, uint16_t value, size_t columns)
+{
+  blob.integral += value;
+  blob.sumX     += static_cast<uint64_t>(value) * (pixel % columns);
+  blob.sumY     += static_cast<uint64_t>(value) * (pixel / columns);
+  ++blob.size;
+}
+
+void cass::VMI::BlobFinder::label(const uint16_t *frame, size_t columns, uint16_t threshold, Stripe &s)
+{
+  int32_t *parent = &_parent[0];
+  s.pixels.clear();
+  for (size_t y=s.firstRow; y<s.lastRow; ++y)
+  {
+    const uint16_t *row = frame + y*columns;
+    const uint16_t *up  = row - columns;
+    const int32_t   off = y*columns;
+    for (size_t x=nextAbove(row,0,columns,threshold); x<columns; x=nextAbove(row,x+1,columns,threshold))
+    {
+      const int32_t i = off + x;
+      parent[i] = i;
+      s.pixels.push_back(i);
+      //join with the neighbours that were already visited, the row above belongs//
+      //to the previous stripe for the first row and is joined later//
+      if (x > 0 && row[x-1] > threshold)
+        unite(parent,i,i-1);
+      if (y == s.firstRow)
+        continue;
+      if (x > 0 && up[x-1] > threshold)
+        unite(parent,i,i-columns-1);
+      if (up[x] > threshold)
+        unite(parent,i,i-columns);
+      if (x+1 < columns && up[x+1] > threshold)
+        unite(parent,i,i-columns+1);
+    }
+  }
+}
+
+void cass::VMI::BlobFinder::sum(const uint16_t *frame, size_t columns, Stripe &s)
+{
+  //the first pixel of a blob is its root and is visited before all other pixels of it//
+  const int32_t first = s.firstRow*columns;
+  const int32_t *parent = &_parent[0];
+  s.blobs.clear();
+  s.foreign.clear();
+  for (size_t j=0; j<s.pixels.size(); ++j)
+  {
+    const int32_t i = s.pixels[j];
+    const int32_t r = root(parent,i);
+    if (r < first)
+    {
+      s.foreign.push_back(i);
+      continue;
+    }
+    if (r == i)
+    {
+      _blob[i] = s.blobs.size();
+      const Blob empty = {0,0,0,0};
+      s.blobs.push_back(empty);
+    }
+    add(s.blobs[_blob[r]],i,frame[i],columns);
+  }
+}
+
+void cass::VMI::BlobFinder::operator()(const uint16_t *frame, size_t columns, size_t rows,
+                                       uint16_t threshold, uint32_t minSize, uint32_t maxSize,
+                                       uint32_t threads, VMIEvent::centroids_t &centroids)
+{
+  centroids.clear();
+  if (!columns || !rows)
+    return;
+  const int nbrThreads = threads ? threads : 1;
+  _parent.resize(columns*rows);
+  _blob.resize(columns*rows);
+
+  //cut the frame into more stripes than threads, so that frames with the hits in a few//
+  //places are still spread over the threads//
+  const size_t nbrStripes = std::min(rows,static_cast<size_t>(nbrThreads > 1 ? 4*nbrThreads : 1));
+  const size_t stripeRows = (rows + nbrStripes - 1) / nbrStripes;
+  _stripes.resize(nbrStripes);
+  for (size_t i=0; i<nbrStripes; ++i)
+  {
+    _stripes[i].firstRow = std::min(rows,i*stripeRows);
+    _stripes[i].lastRow  = std::min(rows,(i+1)*stripeRows);
+  }
+  const int nbr = nbrStripes;
+
+  //label every stripe on its own//
+#pragma omp parallel for schedule(dynamic,1) num_threads(nbrThreads) if(nbrThreads > 1)
+  for (int i=0; i<nbr; ++i)
+    label(frame,columns,threshold,_stripes[i]);
+
+  //join the blobs that cross the border to the previous stripe//
+  int32_t *parent = &_parent[0];
+  for (size_t t=1; t<nbrStripes; ++t)
+  {
+    const Stripe &s = _stripes[t];
+    const int32_t end = (s.firstRow+1)*columns;
+    for (size_t j=0; j<s.pixels.size() && s.pixels[j] < end; ++j)
+    {
+      const int32_t i = s.pixels[j];
+      const size_t  x = i % columns;
+      const uint16_t *up = frame + i - columns;
+      if (x > 0 && up[-1] > threshold)
+        unite(parent,i,i-columns-1);
+      if (up[0] > threshold)
+        unite(parent,i,i-columns);
+      if (x+1 < columns && up[1] > threshold)
+        unite(parent,i,i-columns+1);
+    }
+  }
+
+  //sum up the blobs in every stripe, the ones that started in a previous stripe are added later//
+#pragma omp parallel for schedule(dynamic,1) num_threads(nbrThreads) if(nbrThreads > 1)
+  for (int i=0; i<nbr; ++i)
+    sum(frame,columns,_stripes[i]);
+  for (size_t t=1; t<nbrStripes; ++t)
+  {
+    const Stripe &s = _stripes[t];
+    for (size_t j=0; j<s.foreign.size(); ++j)
+    {
+      const int32_t i = s.foreign[j];
+      const int32_t r = root(parent,i);
+      add(_stripes[(r/columns)/stripeRows].blobs[_blob[r]],i,frame[i],columns);
+    }
+  }
+
+  //the centroids are ordered like the first pixels of the blobs in the frame//
+  for (size_t t=0; t<nbrStripes; ++t)
+  {
+    const std::vector<Blob> &blobs = _stripes[t].blobs;
+    for (size_t j=0; j<blobs.size(); ++j)
+    {
+      const Blob &b = blobs[j];
+      if (b.size < minSize || b.size > maxSize)
+        continue;
+      centroids.push_back(Centroid(static_cast<float>(static_cast<double>(b.sumX)/b.integral),
+                                   static_cast<float>(static_cast<double>(b.sumY)/b.integral),
+                                   static_cast<float>(b.integral),
+                                   b.size));
+    }
+  }
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,74 @@
+#ifndef VMIBLOBFINDER_H
+#define VMIBLOBFINDER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "cass_vmi.h"
+#include "vmi_event.h"
+
+namespace cass
+{
+    namespace VMI
+    {
+        //finds the blobs of 8-connected pixels above the threshold in a frame and calculates//
+        //their intensity weighted centers. The frame is cut into stripes of rows that are//
+        //labeled in parallel, blobs that cross the border of a stripe are joined afterwards.//
+        //All buffers are kept from one frame to the next//
+        class CASS_VMISHARED_EXPORT BlobFinder
+        {
+        public:
+            BlobFinder()    {}
+            ~BlobFinder()   {}
+
+            //find the blobs of pixels above threshold and put the ones whose size is within//
+            //[minSize,maxSize] into centroids//
+            void operator()(const uint16_t *frame, size_t columns, size_t rows,
+                            uint16_t threshold, uint32_t minSize, uint32_t maxSize,
+                            uint32_t nbrThreads, VMIEvent::centroids_t &centroids);
+
+        private:
+            //the sums of a blob//
+            struct Blob
+            {
+                uint64_t integral;      //the sum of the pixel values
+                uint64_t sumX;          //the sum of the pixel values times their column
+                uint64_t sumY;          //the sum of the pixel values times their row
+                uint32_t size;          //the number of pixels
+            };
+
+            //the things every stripe works with//
+            struct Stripe
+            {
+                size_t               firstRow;
+                size_t               lastRow;        //one after the last row
+                std::vector<int32_t> pixels;         //the pixels above threshold
+                std::vector<int32_t> foreign;        //the pixels whose blob starts in a previous stripe
+                std::vector<Blob>    blobs;          //the blobs that start in this stripe
+            };
+
+        private:
+            //label the pixels of a stripe and collect the blobs that start in it//
+            void label(const uint16_t *frame, size_t columns, uint16_t threshold, Stripe&);
+            void sum(const uint16_t *frame, size_t columns, Stripe&);
+            void add(Blob&, int32_t pixel, uint16_t value, size_t columns);
+
+        private:
+            std::vector<int32_t>  _parent;     //the pixel a pixel above threshold is joined to
+            std::vector<int32_t>  _blob;       //for the first pixel of a blob: the blob in its stripe
+            std::vector<Stripe>   _stripes;
+        };
+    }//end namespace vmi
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -13,6 +13,9 @@ OBJECTS_DIR = ./obj
 
 
 SOURCES += vmi_analysis.cpp \
+           blob_finder.cpp \
+           hit_accumulator.cpp \
+           pbasex.cpp \
            vmi_converter.cpp \
            ./classes/event/vmi_event.cpp \
 
@@ -20,6 +23,9 @@ HEADERS += ../cass/analysis_backend.h \
            ../cass/parameter_backend.h \
            ../cass/conversion_backend.h \
            vmi_analysis.h \
+           blob_finder.h \
+           hit_accumulator.h \
+           pbasex.h \
            vmi_converter.h \
            cass_vmi.h \
            ./classes/event/vmi_event.h \
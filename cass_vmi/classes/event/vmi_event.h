@@ -29,6 +29,19 @@ namespace cass
    };
 
 
+    class Centroid
+    {
+    public:
+      Centroid(float X, float Y, float Integral, uint32_t Size):x(X),y(Y),integral(Integral),size(Size){}
+      Centroid() {}
+      ~Centroid() {}
+      float    x;                 //intensity weighted column of the blob
+      float    y;                 //intensity weighted row of the blob
+      float    integral;          //sum of the pixel values of the blob
+      uint32_t size;              //number of pixels of the blob
+    };
+
+
     class VMIEvent
     {
     public:
@@ -46,6 +59,7 @@ namespace cass
     public:
       typedef std::vector<uint16_t> frame_t;
       typedef std::vector<Coordinate> coordinates_t;
+      typedef std::vector<Centroid> centroids_t;
 
     public:
       bool            &isFilled()              {return _isFilled;}
@@ -72,6 +86,12 @@ namespace cass
       frame_t         &frame()                 {return _frame;}
       frame_t         &cutFrame()              {return _cutframe;}
       coordinates_t   &coordinatesOfImpact()   {return _coordinatesOfImpact;}
+      const centroids_t &centroids()const      {return _centroids;}
+      centroids_t     &centroids()             {return _centroids;}
+      const std::vector<float> &radialDistribution()const {return _radialDistribution;}
+      std::vector<float> &radialDistribution() {return _radialDistribution;}
+      const std::vector<float> &anisotropy()const {return _anisotropy;}
+      std::vector<float> &anisotropy()         {return _anisotropy;}
 
    private:
       bool             _isFilled;              //flag to tell whether this event has been filled
@@ -89,6 +109,9 @@ namespace cass
       uint32_t        _integral;               //the sum of all pixelvalues
       uint16_t        _maxPixelValue;          //the highest pixelvalue
       coordinates_t   _coordinatesOfImpact;    //locations where something hit the detector are stored in this vector
+      centroids_t     _centroids;              //sub pixel locations of the hits, the centers of the blobs above threshold
+      std::vector<float> _radialDistribution;  //the latest inversion of the accumulated hits, r^2 weighted
+      std::vector<float> _anisotropy;          //the beta_l(r) of the latest inversion, l=2,4,.. one after the other
       frame_t         _cutframe;               //new frame where only mcp is drawn (give maximum radius)
     };
   }//end namespace vmi
@@ -0,0 +1,79 @@
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "hit_accumulator.h"
+
+
+void cass::VMI::HitAccumulator::configure(size_t columns, size_t rows, uint32_t binsPerPixel, uint32_t nbrThreads)
+{
+  binsPerPixel = std::max(binsPerPixel,1u);
+  nbrThreads   = std::max(nbrThreads,1u);
+  if (columns == _columns && rows == _rows && binsPerPixel == _binsPerPixel && nbrThreads == _partials.size())
+    return;
+  _columns      = columns;
+  _rows         = rows;
+  _binsPerPixel = binsPerPixel;
+  _partials.resize(nbrThreads);
+  clear();
+}
+
+void cass::VMI::HitAccumulator::clear()
+{
+  const size_t size = columns()*rows();
+  _image.assign(size,0);
+  for (size_t i=0; i<_partials.size(); ++i)
+    _partials[i].assign(size,0);
+  _nbrHits = 0;
+}
+
+void cass::VMI::HitAccumulator::add(const VMIEvent::centroids_t &centroids, uint32_t nbrThreads)
+{
+  const int nbrCentroids = centroids.size();
+  const float  scale     = _binsPerPixel;
+  const size_t width     = columns();
+  const size_t height    = rows();
+  nbrThreads = std::min<uint32_t>(std::max(nbrThreads,1u),_partials.size());
+  //only frames with many hits are worth to be split among the threads//
+#pragma omp parallel num_threads(nbrThreads) if(nbrThreads > 1 && nbrCentroids > 1024)
+  {
+#ifdef _OPENMP
+    image_t &partial = _partials[omp_get_thread_num()];
+#else
+    image_t &partial = _partials[0];
+#endif
+#pragma omp for schedule(static)
+    for (int i=0; i<nbrCentroids; ++i)
+    {
+      //the center of a pixel is at +0.5, its bins start at its left edge//
+      const float x = (centroids[i].x + 0.5f) * scale;
+      const float y = (centroids[i].y + 0.5f) * scale;
+      if (x < 0 || y < 0 || x >= width || y >= height)
+        continue;
+      ++partial[static_cast<size_t>(y)*width + static_cast<size_t>(x)];
+    }
+  }
+  _nbrHits += nbrCentroids;
+}
+
+void cass::VMI::HitAccumulator::merge()
+{
+  for (size_t p=0; p<_partials.size(); ++p)
+  {
+    image_t &partial = _partials[p];
+    for (size_t i=0; i<partial.size(); ++i)
+      _image[i] += partial[i];
+    std::fill(partial.begin(),partial.end(),0);
+  }
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,64 @@
+#ifndef VMIHITACCUMULATOR_H
+#define VMIHITACCUMULATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "cass_vmi.h"
+#include "vmi_event.h"
+
+namespace cass
+{
+    namespace VMI
+    {
+        //sums the centroids of the hits of a run into an image that is finer than the frame.//
+        //Every thread adds to its own partial image, the partial images are added to the//
+        //image when merge() is called//
+        class CASS_VMISHARED_EXPORT HitAccumulator
+        {
+        public:
+            typedef std::vector<uint32_t> image_t;
+
+        public:
+            HitAccumulator():_columns(0),_rows(0),_binsPerPixel(0),_nbrHits(0)   {}
+            ~HitAccumulator()   {}
+
+            //prepare for frames of the given size, every pixel is split into//
+            //binsPerPixel x binsPerPixel bins. Starts over when anything changed//
+            void configure(size_t columns, size_t rows, uint32_t binsPerPixel, uint32_t nbrThreads);
+            //add the centroids of one frame, using up to nbrThreads threads//
+            void add(const VMIEvent::centroids_t&, uint32_t nbrThreads);
+            //add the partial images to the image//
+            void merge();
+            //forget all hits//
+            void clear();
+
+        public:
+            const image_t   &image()const           {return _image;}
+            size_t           columns()const         {return _columns*_binsPerPixel;}
+            size_t           rows()const            {return _rows*_binsPerPixel;}
+            uint32_t         binsPerPixel()const    {return _binsPerPixel;}
+            uint64_t         nbrHits()const         {return _nbrHits;}
+
+        private:
+            size_t               _columns;          //the size of the frames in pixels
+            size_t               _rows;
+            uint32_t             _binsPerPixel;
+            uint64_t             _nbrHits;          //the hits in the image and the partial images
+            image_t              _image;            //the merged image
+            std::vector<image_t> _partials;         //the images of the threads since the last merge
+        };
+    }//end namespace vmi
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "pbasex.h"
+
+
+namespace
+{
+  //the coefficients of the legendre polynomial of order l, P_l(x) = sum_n c[n] x^n//
+  std::vector<double> legendre(uint32_t l)
+  {
+    std::vector<double> previous(l+1,0), current(l+1,0);
+    current[0] = 1;
+    for (uint32_t n=0; n<l; ++n)
+    {
+      //(n+1) P_n+1 = (2n+1) x P_n - n P_n-1//
+      std::vector<double> next(l+1,0);
+      for (uint32_t i=0; i<l; ++i)
+        next[i+1] += (2.*n+1.) * current[i] / (n+1.);
+      for (uint32_t i=0; i<=l; ++i)
+        next[i] -= n * previous[i] / (n+1.);
+      previous.swap(current);
+      current.swap(next);
+    }
+    return current;
+  }
+
+  //solve A x = b for the cholesky factor L of A (A = L L^T), L is stored in the lower triangle//
+  void choleskySolve(const std::vector<double> &L, size_t n, std::vector<double> &x)
+  {
+    for (size_t i=0; i<n; ++i)
+    {
+      double sum = x[i];
+      for (size_t k=0; k<i; ++k)
+        sum -= L[i*n+k]*x[k];
+      x[i] = sum / L[i*n+i];
+    }
+    for (size_t i=n; i-- > 0;)
+    {
+      double sum = x[i];
+      for (size_t k=i+1; k<n; ++k)
+        sum -= L[k*n+i]*x[k];
+      x[i] = sum / L[i*n+i];
+    }
+  }
+}
+
+bool cass::VMI::PBasex::Geometry::operator==(const Geometry &rhs)const
+{
+  return radialBins == rhs.radialBins && angularBins == rhs.angularBins &&
+         radialBasis == rhs.radialBasis && maxOrder == rhs.maxOrder &&
+         radius == rhs.radius && regularization == rhs.regularization;
+}
+
+bool cass::VMI::PBasex::setup(const Geometry &geometry, const std::string &cacheDirectory)
+{
+  //only even orders are used, an odd maximum gives the same basis//
+  Geometry g(geometry);
+  g.maxOrder &= ~1u;
+  if (!_solution.empty() && _geometry == g)
+    return true;
+  if (!g.radialBins || !g.angularBins || !g.radialBasis || !(g.radius > 0))
+  {
+    std::cout << "PBasex: the geometry of the inversion is empty"<<std::endl;
+    _solution.clear();
+    return false;
+  }
+  _geometry = g;
+  //the polar bins have to be made for the new geometry//
+  _columns = 0;
+  char name[256];
+  sprintf(name,"/pbasex_%u_%u_%u_%u_%g_%g.bin",_geometry.radialBins,_geometry.angularBins,
+          _geometry.radialBasis,_geometry.maxOrder,_geometry.radius,_geometry.regularization);
+  const std::string filename = cacheDirectory + name;
+  if (load(filename))
+    return true;
+  std::cout << "PBasex: calculating the basis for \""<<filename<<"\""<<std::endl;
+  calculate();
+  if (!save(filename))
+    std::cout << "PBasex: could not write \""<<filename<<"\""<<std::endl;
+  return true;
+}
+
+void cass::VMI::PBasex::calculate()
+{
+  const size_t nr       = _geometry.radialBins;
+  const size_t na       = _geometry.angularBins;
+  const size_t nk       = _geometry.radialBasis;
+  const size_t nl       = nbrOrders();
+  const size_t nbrRows  = nr*na;
+  const size_t nbrBasis = nk*nl;
+  const double dr       = _geometry.radius / nr;
+  const double sigma    = _geometry.radius / nk;
+  const double pi       = 3.14159265358979323846;
+
+  //the projection of a basis function is//
+  //  G_kl(R,alpha) = 2 int_0^inf exp(-(r-r_k)^2/sigma^2) P_l(cos(alpha) R/r) dy  with r^2 = R^2+y^2//
+  //expanding P_l in powers of its argument leaves radial integrals of (R/r)^n for the even n//
+  std::vector<std::vector<double> > poly(nl);
+  for (size_t l=0; l<nl; ++l)
+    poly[l] = legendre(2*l);
+  //radial[(i*nk + k)*nl + n/2]//
+  std::vector<double> radial(nr*nk*nl,0);
+  for (size_t i=0; i<nr; ++i)
+  {
+    const double R = (i+0.5)*dr;
+    for (size_t k=0; k<nk; ++k)
+    {
+      //only the part of the line of sight within 5 sigma of r_k contributes//
+      const double rk   = k*sigma;
+      const double rMin = rk - 5*sigma;
+      const double rMax = rk + 5*sigma;
+      if (rMax <= R)
+        continue;
+      const double yMin = rMin > R ? sqrt(rMin*rMin - R*R) : 0;
+      const double yMax = sqrt(rMax*rMax - R*R);
+      //simpson's rule with a step of at most sigma/8//
+      size_t steps = std::max<size_t>(16,static_cast<size_t>(ceil((yMax-yMin)/(sigma/8))));
+      steps += steps & 1;
+      const double h = (yMax-yMin)/steps;
+      double *sums = &radial[(i*nk + k)*nl];
+      for (size_t s=0; s<=steps; ++s)
+      {
+        const double y = yMin + s*h;
+        const double r = sqrt(R*R + y*y);
+        const double weight = (s == 0 || s == steps) ? 1 : (s & 1) ? 4 : 2;
+        const double g = weight * exp(-(r-rk)*(r-rk)/(sigma*sigma));
+        const double v2 = (R/r)*(R/r);
+        double vn = 1;
+        for (size_t n=0; n<nl; ++n, vn*=v2)
+          sums[n] += g*vn;
+      }
+      for (size_t n=0; n<nl; ++n)
+        sums[n] *= 2*h/3;
+    }
+  }
+
+  //the projections at the centers of the polar bins, G[row*nbrBasis + k*nl + l]//
+  std::vector<double> G(nbrRows*nbrBasis,0);
+  for (size_t j=0; j<na; ++j)
+  {
+    const double c2 = pow(cos((j+0.5)*2*pi/na),2);
+    for (size_t i=0; i<nr; ++i)
+    {
+      double *row = &G[(i*na + j)*nbrBasis];
+      for (size_t k=0; k<nk; ++k)
+      {
+        const double *sums = &radial[(i*nk + k)*nl];
+        for (size_t l=0; l<nl; ++l)
+        {
+          double value = 0, cn = 1;
+          for (size_t n=0; n<=l; ++n, cn*=c2)
+            value += poly[l][2*n]*cn*sums[n];
+          row[k*nl + l] = value;
+        }
+      }
+    }
+  }
+
+  //the regularized normal equations (G^T G + lambda) c = G^T p//
+  std::vector<double> A(nbrBasis*nbrBasis,0);
+  for (size_t p=0; p<nbrRows; ++p)
+  {
+    const double *row = &G[p*nbrBasis];
+    for (size_t a=0; a<nbrBasis; ++a)
+      if (row[a])
+        for (size_t b=0; b<=a; ++b)
+          A[a*nbrBasis + b] += row[a]*row[b];
+  }
+  double trace = 0;
+  for (size_t a=0; a<nbrBasis; ++a)
+    trace += A[a*nbrBasis + a];
+  const double lambda = std::max(_geometry.regularization*trace/nbrBasis,1e-12);
+  for (size_t a=0; a<nbrBasis; ++a)
+    A[a*nbrBasis + a] += lambda;
+  //cholesky factorization in place, only the lower triangle is used//
+  for (size_t j=0; j<nbrBasis; ++j)
+  {
+    double d = A[j*nbrBasis + j];
+    for (size_t k=0; k<j; ++k)
+      d -= A[j*nbrBasis + k]*A[j*nbrBasis + k];
+    A[j*nbrBasis + j] = sqrt(std::max(d,lambda));
+    for (size_t i=j+1; i<nbrBasis; ++i)
+    {
+      double s = A[i*nbrBasis + j];
+      for (size_t k=0; k<j; ++k)
+        s -= A[i*nbrBasis + k]*A[j*nbrBasis + k];
+      A[i*nbrBasis + j] = s / A[j*nbrBasis + j];
+    }
+  }
+  //the solution matrix (G^T G + lambda)^-1 G^T, one column for every polar bin//
+  _solution.assign(nbrBasis*nbrRows,0);
+  std::vector<double> x(nbrBasis);
+  for (size_t p=0; p<nbrRows; ++p)
+  {
+    std::copy(&G[p*nbrBasis],&G[p*nbrBasis]+nbrBasis,x.begin());
+    choleskySolve(A,nbrBasis,x);
+    for (size_t a=0; a<nbrBasis; ++a)
+      _solution[a*nbrRows + p] = x[a];
+  }
+}
+
+//the file starts with "CASSPBX1", then uint32 radialBins, angularBins, radialBasis, maxOrder,//
+//float radius, regularization, followed by the solution matrix as floats//
+bool cass::VMI::PBasex::load(const std::string &filename)
+{
+  FILE *fp = fopen(filename.c_str(),"rb");
+  if (!fp)
+    return false;
+  char magic[8];
+  Geometry g;
+  bool ok = fread(magic,1,8,fp) == 8 && !strncmp(magic,"CASSPBX1",8) &&
+            fread(&g.radialBins,sizeof(g.radialBins),1,fp) == 1 &&
+            fread(&g.angularBins,sizeof(g.angularBins),1,fp) == 1 &&
+            fread(&g.radialBasis,sizeof(g.radialBasis),1,fp) == 1 &&
+            fread(&g.maxOrder,sizeof(g.maxOrder),1,fp) == 1 &&
+            fread(&g.radius,sizeof(g.radius),1,fp) == 1 &&
+            fread(&g.regularization,sizeof(g.regularization),1,fp) == 1 &&
+            g == _geometry;
+  if (ok)
+  {
+    _solution.resize(static_cast<size_t>(_geometry.radialBasis)*nbrOrders()*
+                     _geometry.radialBins*_geometry.angularBins);
+    ok = fread(&_solution[0],sizeof(float),_solution.size(),fp) == _solution.size();
+  }
+  fclose(fp);
+  if (!ok)
+  {
+    std::cout << "PBasex: \""<<filename<<"\" does not contain the basis, it is recalculated"<<std::endl;
+    _solution.clear();
+  }
+  return ok;
+}
+
+bool cass::VMI::PBasex::save(const std::string &filename)const
+{
+  //write to a temporary file first, so that nobody reads a half written basis//
+  const std::string tmpname = filename + ".tmp";
+  FILE *fp = fopen(tmpname.c_str(),"wb");
+  if (!fp)
+    return false;
+  fwrite("CASSPBX1",1,8,fp);
+  fwrite(&_geometry.radialBins,sizeof(_geometry.radialBins),1,fp);
+  fwrite(&_geometry.angularBins,sizeof(_geometry.angularBins),1,fp);
+  fwrite(&_geometry.radialBasis,sizeof(_geometry.radialBasis),1,fp);
+  fwrite(&_geometry.maxOrder,sizeof(_geometry.maxOrder),1,fp);
+  fwrite(&_geometry.radius,sizeof(_geometry.radius),1,fp);
+  fwrite(&_geometry.regularization,sizeof(_geometry.regularization),1,fp);
+  const bool ok = fwrite(&_solution[0],sizeof(float),_solution.size(),fp) == _solution.size();
+  fclose(fp);
+  return ok && !rename(tmpname.c_str(),filename.c_str());
+}
+
+void cass::VMI::PBasex::updatePolarBins(size_t columns, size_t rows, double centerX, double centerY, double scale)
+{
+  if (columns == _columns && rows == _rows && centerX == _centerX && centerY == _centerY && scale == _scale)
+    return;
+  _columns = columns;
+  _rows    = rows;
+  _centerX = centerX;
+  _centerY = centerY;
+  _scale   = scale;
+  const size_t nr = _geometry.radialBins;
+  const size_t na = _geometry.angularBins;
+  const double pi = 3.14159265358979323846;
+  _polarBin.assign(columns*rows,-1);
+  _polarNorm.assign(nr*na,0);
+  for (size_t y=0; y<rows; ++y)
+  {
+    //the center of a bin in frame pixels, the center of pixel 0 is at 0//
+    const double dy = (y+0.5)/scale - 0.5 - centerY;
+    for (size_t x=0; x<columns; ++x)
+    {
+      const double dx = (x+0.5)/scale - 0.5 - centerX;
+      const double R  = sqrt(dx*dx + dy*dy);
+      if (R >= _geometry.radius)
+        continue;
+      //the angle to the polarization axis, which points along the columns//
+      double alpha = atan2(dx,dy);
+      if (alpha < 0)
+        alpha += 2*pi;
+      const size_t i = std::min(nr-1,static_cast<size_t>(R/_geometry.radius*nr));
+      const size_t j = std::min(na-1,static_cast<size_t>(alpha/(2*pi)*na));
+      _polarBin[y*columns + x] = i*na + j;
+      _polarNorm[i*na + j] += 1;
+    }
+  }
+  for (size_t p=0; p<_polarNorm.size(); ++p)
+    _polarNorm[p] = _polarNorm[p] ? 1/_polarNorm[p] : 0;
+}
+
+void cass::VMI::PBasex::invert(const std::vector<uint32_t> &image, size_t columns, size_t rows,
+                               double centerX, double centerY, double scale)
+{
+  if (_solution.empty() || image.size() != columns*rows)
+    return;
+  updatePolarBins(columns,rows,centerX,centerY,scale);
+  const size_t nr       = _geometry.radialBins;
+  const size_t na       = _geometry.angularBins;
+  const size_t nk       = _geometry.radialBasis;
+  const size_t nl       = nbrOrders();
+  const size_t nbrRows  = nr*na;
+  const size_t nbrBasis = nk*nl;
+
+  //the mean counts of the image bins in every polar bin//
+  _polar.assign(nbrRows,0);
+  for (size_t b=0; b<image.size(); ++b)
+    if (_polarBin[b] >= 0)
+      _polar[_polarBin[b]] += image[b];
+  for (size_t i=0; i<nr; ++i)
+  {
+    //polar bins close to the center may not contain any image bin, they get the mean of their ring//
+    float *ring = &_polar[i*na];
+    const float *norm = &_polarNorm[i*na];
+    double sum = 0;
+    size_t filled = 0;
+    for (size_t j=0; j<na; ++j)
+      if (norm[j])
+      {
+        ring[j] *= norm[j];
+        sum += ring[j];
+        ++filled;
+      }
+    for (size_t j=0; j<na; ++j)
+      if (!norm[j])
+        ring[j] = filled ? sum/filled : 0;
+  }
+
+  //the coefficients of the basis functions//
+  _coefficients.assign(nbrBasis,0);
+  for (size_t a=0; a<nbrBasis; ++a)
+  {
+    const float *row = &_solution[a*nbrRows];
+    double sum = 0;
+    for (size_t p=0; p<nbrRows; ++p)
+      sum += row[p]*_polar[p];
+    _coefficients[a] = sum;
+  }
+
+  //the distributions at the centers of the radial bins//
+  const double dr    = _geometry.radius / nr;
+  const double sigma = _geometry.radius / nk;
+  _radial.assign(nr,0);
+  _anisotropy.assign(nr*(nl-1),0);
+  std::vector<double> F(nl);
+  for (size_t i=0; i<nr; ++i)
+  {
+    const double r = (i+0.5)*dr;
+    std::fill(F.begin(),F.end(),0);
+    for (size_t k=0; k<nk; ++k)
+    {
+      const double d = (r - k*sigma)/sigma;
+      if (d*d > 25)
+        continue;
+      const double g = exp(-d*d);
+      for (size_t l=0; l<nl; ++l)
+        F[l] += _coefficients[k*nl + l]*g;
+    }
+    _radial[i] = F[0]*r*r;
+    for (size_t l=1; l<nl; ++l)
+      _anisotropy[(l-1)*nr + i] = F[0] ? F[l]/F[0] : 0;
+  }
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,98 @@
+#ifndef VMIPBASEX_H
+#define VMIPBASEX_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "cass_vmi.h"
+
+namespace cass
+{
+    namespace VMI
+    {
+        //inverts a velocity map image with the pBasex method: the image is binned in polar//
+        //coordinates and fitted with the projections of the 3d basis functions//
+        //exp(-(r-r_k)^2/sigma^2) P_l(cos theta) for even l, with the polarization along the//
+        //columns of the frame. The least squares solution is a fixed matrix for a given//
+        //geometry, it is calculated once and cached on disk, so that an inversion is just a//
+        //matrix vector product//
+        class CASS_VMISHARED_EXPORT PBasex
+        {
+        public:
+            //what the basis depends on//
+            struct Geometry
+            {
+                uint32_t radialBins;        //the number of radial bins of the polar image
+                uint32_t angularBins;       //the number of angular bins of the polar image
+                uint32_t radialBasis;       //the number of radial basis functions
+                uint32_t maxOrder;          //the highest legendre order, only even orders are used
+                float    radius;            //the radius (in pixels) that is inverted
+                float    regularization;    //the tikhonov factor relative to the mean of the diagonal
+                bool operator==(const Geometry&)const;
+            };
+
+        public:
+            PBasex():_columns(0),_rows(0),_centerX(0),_centerY(0),_scale(0)   {_geometry.radialBins = 0;}
+            ~PBasex()   {}
+
+            //make the solution matrix for the geometry available, it is read from the cache//
+            //directory when it was calculated before and written there otherwise//
+            bool setup(const Geometry&, const std::string &cacheDirectory);
+            //invert the image of columns x rows bins that has scale x scale bins per pixel of the//
+            //frame, like the image of the HitAccumulator. The center is in frame pixels//
+            void invert(const std::vector<uint32_t> &image, size_t columns, size_t rows,
+                        double centerX, double centerY, double scale);
+            //forget the result of the last inversion//
+            void clear()    {_radial.clear(); _anisotropy.clear();}
+
+        public:
+            //the result of the last inversion at the centers of the radial bins//
+            //the radial distribution is weighted with r^2//
+            const std::vector<float> &radialDistribution()const  {return _radial;}
+            //beta_l(r) for l=2,4,.. one radial distribution after the other//
+            const std::vector<float> &anisotropy()const          {return _anisotropy;}
+            const Geometry           &geometry()const            {return _geometry;}
+
+        private:
+            uint32_t nbrOrders()const   {return _geometry.maxOrder/2 + 1;}
+            //calculate the solution matrix//
+            void calculate();
+            bool load(const std::string &filename);
+            bool save(const std::string &filename)const;
+            //assign the bins of the image to the polar bins//
+            void updatePolarBins(size_t columns, size_t rows, double centerX, double centerY, double scale);
+
+        private:
+            Geometry             _geometry;
+            //the coefficients are the product of _solution and the polar image//
+            //_solution has a row of radialBins*angularBins for every basis function//
+            std::vector<float>   _solution;
+            //the polar bin of every bin of the image, -1 for the ones outside the radius//
+            std::vector<int32_t> _polarBin;
+            std::vector<float>   _polarNorm;         //1 over the number of image bins in a polar bin
+            size_t               _columns;           //the image the polar bins were made for
+            size_t               _rows;
+            double               _centerX;
+            double               _centerY;
+            double               _scale;
+            //the buffers of an inversion//
+            std::vector<float>   _polar;
+            std::vector<double>  _coefficients;
+            std::vector<float>   _radial;
+            std::vector<float>   _anisotropy;
+        };
+    }//end namespace vmi
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -7,6 +7,12 @@
  * filled with live by lmf
  */
 
+#include <algorithm>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "vmi_analysis.h"
 #include "cass_event.h"
 #include "vmi_event.h"
@@ -20,6 +26,21 @@ void cass::VMI::Parameter::load()
   _centerOfMcp  = value("CenterOfMcp",QPoint(200, 200)).toPoint();
   _maxMcpRadius = value("MaxMcpRadius",200).toUInt();
   _rebinfactor  = value("RebinFactor",4).toUInt();
+  _findBlobs    = value("FindBlobs",false).toBool();
+  _minBlobSize  = value("MinBlobSize",1).toUInt();
+  _maxBlobSize  = value("MaxBlobSize",1000).toUInt();
+  _nbrCentroidThreads = value("NbrCentroidThreads",1).toUInt();
+  _accumulate   = value("AccumulateHits",false).toBool();
+  _binsPerPixel = value("AccumulatorBinsPerPixel",4).toUInt();
+  _mergeInterval     = value("AccumulatorMergeInterval",100).toUInt();
+  _inversionInterval = value("InversionInterval",1000).toUInt();
+  _inversion.radialBins     = value("InversionRadialBins",128).toUInt();
+  _inversion.angularBins    = value("InversionAngularBins",64).toUInt();
+  _inversion.radialBasis    = value("InversionRadialBasis",64).toUInt();
+  _inversion.maxOrder       = value("InversionMaxLegendreOrder",4).toUInt();
+  _inversion.radius         = _maxMcpRadius;
+  _inversion.regularization = value("InversionRegularization",1e-4).toDouble();
+  _basisCache   = value("BasisCacheDirectory",".").toString().toStdString();
 }
 
 void cass::VMI::Parameter::save()
@@ -28,6 +49,20 @@ void cass::VMI::Parameter::save()
   setValue("CenterOfMcp",_centerOfMcp);
   setValue("MaxMcpRadius",_maxMcpRadius);
   setValue("RebinFactor",_rebinfactor);
+  setValue("FindBlobs",_findBlobs);
+  setValue("MinBlobSize",_minBlobSize);
+  setValue("MaxBlobSize",_maxBlobSize);
+  setValue("NbrCentroidThreads",_nbrCentroidThreads);
+  setValue("AccumulateHits",_accumulate);
+  setValue("AccumulatorBinsPerPixel",_binsPerPixel);
+  setValue("AccumulatorMergeInterval",_mergeInterval);
+  setValue("InversionInterval",_inversionInterval);
+  setValue("InversionRadialBins",_inversion.radialBins);
+  setValue("InversionAngularBins",_inversion.angularBins);
+  setValue("InversionRadialBasis",_inversion.radialBasis);
+  setValue("InversionMaxLegendreOrder",_inversion.maxOrder);
+  setValue("InversionRegularization",_inversion.regularization);
+  setValue("BasisCacheDirectory",_basisCache.c_str());
 }
 
 
@@ -36,8 +71,172 @@ void cass::VMI::Parameter::save()
 
 
 
+namespace
+{
+#ifdef __SSE2__
+  //sse2 can only compare signed values, the unsigned pixels compare the same//
+  //way as signed values after their highest bit has been flipped//
+  inline __m128i loadBiased(const uint16_t *p)
+  {
+    return _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                         _mm_set1_epi16(static_cast<short>(0x8000)));
+  }
+#endif
+
+  //add the pixels of a row to the integral and return the highest of them//
+  uint16_t sumAndMax(const uint16_t *row, size_t n, uint32_t &integral)
+  {
+    size_t i=0;
+    uint16_t maximum=0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    __m128i max = _mm_set1_epi16(static_cast<short>(0x8000));
+    for (; i+8<=n; i+=8)
+    {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row+i));
+      sum = _mm_add_epi32(sum,_mm_add_epi32(_mm_unpacklo_epi16(v,zero),_mm_unpackhi_epi16(v,zero)));
+      max = _mm_max_epi16(max,_mm_xor_si128(v,_mm_set1_epi16(static_cast<short>(0x8000))));
+    }
+    uint32_t sums[4];
+    uint16_t maxs[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums),sum);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs),max);
+    integral += sums[0] + sums[1] + sums[2] + sums[3];
+    for (size_t k=0; k<8; ++k)
+      maximum = std::max(maximum,static_cast<uint16_t>(maxs[k]^0x8000));
+#endif
+    for (; i<n; ++i)
+    {
+      integral += row[i];
+      maximum   = std::max(maximum,row[i]);
+    }
+    return maximum;
+  }
+
+  //whether the pixel at x in the middle row is higher than its 8 neighbours//
+  inline bool isLocalMaximum(const uint16_t *up, const uint16_t *mid, const uint16_t *down, size_t x)
+  {
+    const uint16_t pixel = mid[x];
+    return up[x-1]   < pixel && up[x]   < pixel && up[x+1]   < pixel &&
+           mid[x-1]  < pixel &&                    mid[x+1]  < pixel &&
+           down[x-1] < pixel && down[x] < pixel && down[x+1] < pixel;
+  }
+
+  //add the local maxima above threshold of row y to the impacts, the row must not be//
+  //the first or last of the frame, the first and last column are never looked at//
+  void localMaxima(const uint16_t *frame, size_t columns, size_t y, uint16_t threshold,
+                   cass::VMI::VMIEvent::coordinates_t &impacts)
+  {
+    const uint16_t *mid  = frame + y*columns;
+    const uint16_t *up   = mid - columns;
+    const uint16_t *down = mid + columns;
+    size_t x=1;
+#ifdef __SSE2__
+    //look at 8 pixels at once, most of them are below the threshold//
+    const __m128i thresh = _mm_set1_epi16(static_cast<short>(threshold^0x8000));
+    for (; x+9<=columns; x+=8)
+    {
+      const __m128i pixel = loadBiased(mid+x);
+      const __m128i above = _mm_cmpgt_epi16(pixel,thresh);
+      if (!_mm_movemask_epi8(above))
+        continue;
+      __m128i neighbours = _mm_max_epi16(loadBiased(up+x-1),loadBiased(up+x));
+      neighbours = _mm_max_epi16(neighbours,loadBiased(up+x+1));
+      neighbours = _mm_max_epi16(neighbours,loadBiased(mid+x-1));
+      neighbours = _mm_max_epi16(neighbours,loadBiased(mid+x+1));
+      neighbours = _mm_max_epi16(neighbours,loadBiased(down+x-1));
+      neighbours = _mm_max_epi16(neighbours,loadBiased(down+x));
+      neighbours = _mm_max_epi16(neighbours,loadBiased(down+x+1));
+      const int hits = _mm_movemask_epi8(_mm_and_si128(above,_mm_cmpgt_epi16(pixel,neighbours)));
+      for (size_t k=0; hits && k<8; ++k)
+        if (hits & (1<<(2*k)))
+          impacts.push_back(cass::VMI::Coordinate(x+k,y));
+    }
+#endif
+    for (; x+1<columns; ++x)
+      if (mid[x] > threshold && isLocalMaximum(up,mid,down,x))
+        impacts.push_back(cass::VMI::Coordinate(x,y));
+  }
+
+  //the run of the xtc file, e.g. e12-r0034 for /data/e12-r0034-s00-c00.xtc//
+  std::string runName(const char *filename)
+  {
+    std::string base(filename ? filename : "");
+    const size_t slash = base.rfind('/');
+    if (slash != std::string::npos)
+      base = base.substr(slash+1);
+    base = base.substr(0,base.find('.'));
+    const size_t stream = base.find("-s");
+    return (stream != std::string::npos && stream > 0) ? base.substr(0,stream) : base;
+  }
+}
+
+bool cass::VMI::Analysis::startRun(const std::string &run)
+{
+  if (run == _run)
+    return true;
+  //the late events of a run that is done are not added to the next one//
+  if (_finishedRuns.count(run))
+    return false;
+  if (!_run.empty())
+    _finishedRuns.insert(_run);
+  _run = run;
+  _accumulator.clear();
+  _pbasex.clear();
+  _nbrAccumulated = 0;
+  return true;
+}
+
+void cass::VMI::Analysis::updateRoi(size_t columns, size_t rows)
+{
+  if (_roiColumns == columns && _roiBegin.size() == rows &&
+      _roiCenter == _param._centerOfMcp && _roiRadius == _param._maxMcpRadius)
+    return;
+  _roiColumns = columns;
+  _roiCenter  = _param._centerOfMcp;
+  _roiRadius  = _param._maxMcpRadius;
+  _roiBegin.assign(rows,0);
+  _roiEnd.assign(rows,0);
+  //a pixel is inside when its distance to the center is smaller than the radius//
+  const int64_t radius2 = static_cast<int64_t>(_roiRadius)*_roiRadius;
+  for (size_t y=0; y<rows; ++y)
+  {
+    const int64_t dy = static_cast<int64_t>(y) - _roiCenter.y();
+    const int64_t left = radius2 - dy*dy;
+    if (left <= 0)
+      continue;
+    //the largest dx with dx*dx < left//
+    int64_t dx = static_cast<int64_t>(sqrt(static_cast<double>(left)));
+    while (dx*dx >= left)
+      --dx;
+    while ((dx+1)*(dx+1) < left)
+      ++dx;
+    const int64_t begin = std::max<int64_t>(0,_roiCenter.x()-dx);
+    const int64_t end   = std::min<int64_t>(columns,_roiCenter.x()+dx+1);
+    if (begin < end)
+    {
+      _roiBegin[y] = begin;
+      _roiEnd[y]   = end;
+    }
+  }
+}
+
+void cass::VMI::Analysis::require(cass::Products &products)const
+{
+  //the summed up hits need the hits of every event//
+  if (_param._accumulate)
+    products.add(cass::Products::VMIHits);
+}
+
 void cass::VMI::Analysis::operator()(cass::CASSEvent *cassevent)
 {
+  //only when somebody reads the impacts and they are not there yet//
+  if (!cassevent->wanted().has(cass::Products::VMIHits) ||
+      cassevent->produced().has(cass::Products::VMIHits))
+    return;
+  cassevent->produced().add(cass::Products::VMIHits);
+
   cass::VMI::VMIEvent& vmievent = cassevent->VMIEvent();
 
   //clear the vector of impacts//
@@ -46,90 +245,88 @@ void cass::VMI::Analysis::operator()(cass::CASSEvent *cassevent)
   //initialize the start values for integral and max pixel value//
   uint16_t maxpixelvalue                     = 0;
   uint32_t integral                          = 0;
-  uint16_t framewidth                        = vmievent.columns();
-  uint16_t frameheight                       = vmievent.rows();
+  const size_t framewidth                    = vmievent.columns();
   const cass::VMI::VMIEvent::frame_t& frame  = vmievent.frame();
+  //only whole rows are looked at//
+  const size_t frameheight                   = framewidth ? frame.size() / framewidth : 0;
+
+  //the cutframe gets all its pixels written below//
+  vmievent.cutFrame().resize(frame.size());
+  updateRoi(framewidth,frameheight);
 
-  //go through all pixels of the frame//
-  for (size_t i=0; i<frame.size(); ++i)
+  //go through the frame row by row, so that the rows needed for the local maxima//
+  //are still in the cache//
+  for (size_t y=0; y<frameheight; ++y)
   {
-    //extract the value and coordinate from the frame//
-    uint16_t pixel          = frame[i];
-    uint16_t xcoordinate    = i % framewidth;
-    uint16_t ycoordinate    = i / framewidth;
-
-    //calc integral//
-    integral += pixel;
-
-    //check whether pixel is outside of maximum radius//
-    //if not then add pixel to cutframe//
-    uint16_t corX = xcoordinate - _param._centerOfMcp.x();
-    uint16_t corY = ycoordinate - _param._centerOfMcp.y();
-    if (corX*corX + corY*corY < _param._maxMcpRadius*_param._maxMcpRadius)
-    {
-      vmievent.cutFrame()[i] = pixel;
-    }
+    const uint16_t *row = &frame[y*framewidth];
+
+    //calc integral and get the maximum pixel value//
+    maxpixelvalue = std::max(maxpixelvalue,sumAndMax(row,framewidth,integral));
 
-    //check whether pixel is a local maximum//
-    //if so add its coordinates to the coordinates of impact map//
-    //check wether pixel is above threshold
-    if (pixel > _param._threshold)
-      //check wether point is at an edge
-      if (ycoordinate > 0 &&
-          ycoordinate < frameheight-1 &&
-          xcoordinate > 0 &&
-          xcoordinate < framewidth+1)
-      // Check all surrounding pixels
-      if (frame[i-framewidth-1] < pixel && //upper left
-          frame[i-framewidth]   < pixel && //upper middle
-          frame[i-framewidth+1] < pixel && //upper right
-          frame[i-1]            < pixel && //left
-          frame[i+1]            < pixel && //right
-          frame[i+framewidth-1] < pixel && //lower left
-          frame[i+framewidth]   < pixel && //lower middle
-          frame[i+framewidth+1] < pixel)   //lower right
-      {
-        vmievent.coordinatesOfImpact().push_back(Coordinate(xcoordinate,ycoordinate));
-      }
-
-    //get the maximum pixel value//
-    if (maxpixelvalue < pixel)
-      maxpixelvalue = pixel;
+    //copy the pixels inside the maximum radius to the cutframe, the others are 0//
+    uint16_t *cut = &vmievent.cutFrame()[y*framewidth];
+    const size_t begin = _roiBegin[y];
+    const size_t end   = _roiEnd[y];
+    std::fill(cut,cut+begin,0);
+    std::copy(row+begin,row+end,cut+begin);
+    std::fill(cut+end,cut+framewidth,0);
+
+    //add the pixels above threshold that are local maxima to the coordinates of impact//
+    //pixels at the edge of the frame have not all neighbours and are skipped//
+    if (y > 0 && y+1 < frameheight)
+      localMaxima(&frame[0],framewidth,y,_param._threshold,vmievent.coordinatesOfImpact());
   }
   //write the found integral and maximum Pixel value to the event//
   vmievent.integral()     = integral;
   vmievent.maxPixelValue()= maxpixelvalue;
 
+  //find the sub pixel positions of the hits, before the frame gets rebinned//
+  if (_param._findBlobs && frameheight)
+    _blobFinder(&frame[0],framewidth,frameheight,_param._threshold,_param._minBlobSize,
+                _param._maxBlobSize,_param._nbrCentroidThreads,vmievent.centroids());
+  else
+    vmievent.centroids().clear();
+
+  //sum up the hits of the run, the image is inverted every inversionInterval frames//
+  if (_param._accumulate && startRun(runName(cassevent->filename())))
+  {
+    _accumulator.configure(framewidth,frameheight,_param._binsPerPixel,_param._nbrCentroidThreads);
+    _accumulator.add(vmievent.centroids(),_param._nbrCentroidThreads);
+    ++_nbrAccumulated;
+    const bool invert = _param._inversionInterval && !(_nbrAccumulated % _param._inversionInterval);
+    if (invert || (_param._mergeInterval && !(_nbrAccumulated % _param._mergeInterval)))
+      _accumulator.merge();
+    if (invert && _pbasex.setup(_param._inversion,_param._basisCache))
+      _pbasex.invert(_accumulator.image(),_accumulator.columns(),_accumulator.rows(),
+                     _param._centerOfMcp.x(),_param._centerOfMcp.y(),_accumulator.binsPerPixel());
+    vmievent.radialDistribution() = _pbasex.radialDistribution();
+    vmievent.anisotropy()         = _pbasex.anisotropy();
+  }
+
   //rebinning the frame//
   //rebin image frame//
-  if (_param._rebinfactor != 1)
+  const size_t rebin = _param._rebinfactor;
+  if (rebin > 1)
   {
-    //get the new dimensions//
-    const size_t newRows = framewidth  / _param._rebinfactor;
-    const size_t newCols = frameheight / _param._rebinfactor;
+    //get the new dimensions, pixels that do not fill a whole bin are dropped//
+    const size_t newRows = frameheight / rebin;
+    const size_t newCols = framewidth  / rebin;
     //set the new dimensions in the detector//
     vmievent.rows()    = newRows;
     vmievent.columns() = newCols;
     //resize the temporary container to fit the rebinned image
     //initialize it with 0
     _tmp.assign(newRows * newCols,0);
-    //rebin the frame//
-    for (size_t iIdx=0; iIdx<frame.size() ;++iIdx)
+    //rebin the frame row by row//
+    for (size_t row=0; row<newRows*rebin; ++row)
     {
-      //calculate the row and column of the current Index//
-      const size_t row = iIdx / framewidth;
-      const size_t col = iIdx % framewidth;
-      //calculate the index of the rebinned frame//
-      const size_t newRow = row / _param._rebinfactor;
-      const size_t newCol = col / _param._rebinfactor;
-      //calculate the index in the rebinned frame//
-      //that newRow and newCol belongs to//
-      const size_t newIndex = newRow*newCols + newCol;
-      //add this index value to the newIndex value//
-      _tmp[newIndex] += frame[iIdx];
+      const uint16_t *src = &frame[row*framewidth];
+      uint16_t       *dst = newCols ? &_tmp[(row/rebin)*newCols] : 0;
+      for (size_t newCol=0; newCol<newCols; ++newCol, src+=rebin)
+        for (size_t i=0; i<rebin; ++i)
+          dst[newCol] += src[i];
     }
     //copy the temporary frame to the right place
     vmievent.frame().assign(_tmp.begin(), _tmp.end());
-
   }
 }
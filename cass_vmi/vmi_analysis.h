@@ -11,11 +11,16 @@
 #define VMIANALYSIS_H
 
 #include <QtCore/QPoint>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "cass_vmi.h"
 #include "analysis_backend.h"
 #include "parameter_backend.h"
+#include "blob_finder.h"
+#include "hit_accumulator.h"
+#include "pbasex.h"
 
 namespace cass
 {
@@ -36,24 +41,58 @@ namespace cass
             QPoint     _centerOfMcp;
             uint16_t   _maxMcpRadius;
             uint32_t   _rebinfactor;
+            bool       _findBlobs;          //whether the centroids of the blobs above threshold are calculated
+            uint32_t   _minBlobSize;        //the smallest blob (in pixels) that is a hit
+            uint32_t   _maxBlobSize;        //the largest blob (in pixels) that is a hit
+            uint32_t   _nbrCentroidThreads; //how many threads look for the blobs of one frame
+            bool       _accumulate;         //whether the centroids of the run are summed up and inverted
+            uint32_t   _binsPerPixel;       //the accumulated image has binsPerPixel x binsPerPixel bins per pixel
+            uint32_t   _mergeInterval;      //after how many frames the images of the threads are merged
+            uint32_t   _inversionInterval;  //after how many frames the accumulated image is inverted
+            PBasex::Geometry _inversion;    //the polar grid and basis of the inversion
+            std::string _basisCache;        //the directory the basis of the inversion is cached in
         };
 
 
         class CASS_VMISHARED_EXPORT Analysis : public cass::AnalysisBackend
         {
         public:
-            Analysis()            {loadSettings();}
+            Analysis():_nbrAccumulated(0),_roiColumns(0),_roiRadius(0)   {loadSettings();}
             ~Analysis()           {}
             void loadSettings()   {_param.load();}
             void saveSettings()   {_param.save();}
 
             //called for every event//
             void operator()(CASSEvent*);
+            void require(Products&)const;
+
+        private:
+            //build the circle of the mcp for a frame of the given size, unless it is there already//
+            void updateRoi(size_t columns, size_t rows);
+            //start over with the sum when the event belongs to a new run, false when it//
+            //belongs to a run that was summed up before//
+            bool startRun(const std::string &run);
 
         private:
             Parameter  _param;
             //temporary frame for rebinning
             std::vector<uint16_t> _tmp;
+            //finds the centroids of the hits//
+            BlobFinder _blobFinder;
+            //sums up the centroids and inverts them every now and then//
+            HitAccumulator _accumulator;
+            PBasex     _pbasex;
+            uint64_t   _nbrAccumulated;
+            //the run that is summed up and the ones that were summed up before//
+            std::string           _run;
+            std::set<std::string> _finishedRuns;
+            //the pixels of a row that are inside the mcp are [_roiBegin[row],_roiEnd[row])//
+            std::vector<uint32_t> _roiBegin;
+            std::vector<uint32_t> _roiEnd;
+            //the frame size, center and radius the circle was built for//
+            size_t     _roiColumns;
+            QPoint     _roiCenter;
+            uint16_t   _roiRadius;
         };
     }//end namespace vmi
 }//end namespace cass
@@ -16,6 +16,11 @@ cass::VMI::Converter::Converter()
 
 void cass::VMI::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEvent* cassevent)
 {
+    //the frame is only copied when somebody reads the impacts//
+    if (!cassevent->wanted().has(cass::Products::VMIHits) ||
+        cassevent->produced().has(cass::Products::VMIHits))
+        return;
+
     const Pds::Camera::FrameV1 &frame = *reinterpret_cast<const Pds::Camera::FrameV1*>(xtc->payload());
     VMIEvent &vmievent = cassevent->VMIEvent();
 
@@ -27,7 +32,7 @@ void cass::VMI::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEvent* cass
     vmievent.bitsPerPixel()     = frame.depth();
     vmievent.offset()           = frame.offset();
 
-    //copy the frame data to this event ... initalize the size of the cutevent//
+    //copy the frame data to this event//
     const uint16_t* framedata = reinterpret_cast<const uint16_t*>(frame.data());
     vmievent.frame().assign(framedata, framedata + (frame.width()*frame.height()));
 
@@ -35,6 +40,5 @@ void cass::VMI::Converter::operator()(const Pds::Xtc* xtc, cass::CASSEvent* cass
     //for(size_t i=0;i<15;i++) std::cout<<i<< std::hex<<": 0x"<<framedata[i] << std::dec<<std::endl;
     //std::cout<<std::endl;
 
-    //make the cutframe as big as the vmievent, but fill with 0//
-    vmievent.cutFrame().assign(vmievent.frame().size(),0);
+    //the cutframe is filled by the analysis//
 }
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Runs cass from the file input over the worker to the outputs on a synthetic run and reports
+# the throughput, the statistics of every stage and the peak memory.
+# The arguments are options for xtcgen, the file it writes is named here. The options for cass
+# are taken from CASS_OPTIONS and everything is written to BENCHMARK_DIR (default
+# /tmp/cass_benchmark).
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+work=${BENCHMARK_DIR:-/tmp/cass_benchmark}
+mkdir -p "$work" && cd "$work" || exit 1
+xtc="$work/e00-r0001-s00-c00.xtc"
+rm -f ./*.h5 stats.txt "$xtc"
+
+"$top/cass_xtcgen/xtcgen" "$@" "$xtc" || exit 1
+if [ ! -f "$xtc" ]; then
+  echo "xtcgen did not write $xtc, only pass options to it"
+  exit 1
+fi
+echo "$xtc" > filesToProcess.txt
+
+echo "running cass $CASS_OPTIONS in $work"
+"$top/cass/cass" -r stats.txt $CASS_OPTIONS > cass.log 2>&1
+status=$?
+if [ $status -ne 0 ] || [ ! -f stats.txt ]; then
+  echo "cass failed with $status, see $work/cass.log"
+  exit 1
+fi
+
+cat stats.txt
+awk '$1 == "event"              {events = $2; mb = $4}
+     $1 == "process.elapsed[s]" {elapsed = $2}
+     $1 == "process.maxrss[MB]" {rss = $2}
+     END {
+       if (elapsed > 0)
+         printf("\n%d events in %.2f s: %.1f events/s, %.1f MB/s, peak RSS %.1f MB\n",
+                events, elapsed, events/elapsed, mb/elapsed, rss)
+     }' stats.txt
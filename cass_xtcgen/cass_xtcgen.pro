@@ -0,0 +1,28 @@
+CONFIG += console
+CONFIG -= app_bundle
+QT -= core gui
+TEMPLATE = app
+TARGET = xtcgen
+VERSION = 0.0.1
+
+
+SOURCES += xtcgen.cpp \
+           xtc_generator.cpp \
+
+HEADERS += xtc_generator.h \
+
+INCLUDEPATH += ../LCLS \
+               $$(LCLSSYSINCLUDE) \
+
+unix{
+QMAKE_LFLAGS += -Wl,-rpath,$$(LCLSSYSLIB)
+LIBS += -L$$(LCLSSYSLIB) -lacqdata -lxtcdata -lcamdata -lpnccddata
+}
+
+
+
+
+INSTALLBASE    = /usr/local/cass
+bin.path       = $$INSTALLBASE/bin
+bin.files      = xtcgen benchmark.sh
+INSTALLS      += bin
@@ -0,0 +1,425 @@
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <string.h>
+
+#include "xtc_generator.h"
+#include "pdsdata/xtc/Dgram.hh"
+#include "pdsdata/xtc/DetInfo.hh"
+#include "pdsdata/xtc/BldInfo.hh"
+#include "pdsdata/xtc/ProcInfo.hh"
+#include "pdsdata/xtc/TransitionId.hh"
+#include "pdsdata/pnCCD/ConfigV1.hh"
+#include "pdsdata/pnCCD/FrameV1.hh"
+#include "pdsdata/acqiris/ConfigV1.hh"
+#include "pdsdata/acqiris/DataDescV1.hh"
+#include "pdsdata/camera/FrameV1.hh"
+#include "pdsdata/bld/bldData.hh"
+#include "pdsdata/epics/EpicsPvData.hh"
+
+
+namespace
+{
+  //the private layout of the pdsdata classes that have no constructor, the DAQ fills them//
+  //from the hardware//
+  struct PnCCDFrameHeader
+  {
+    uint32_t specialWord;
+    uint32_t frameNumber;
+    uint32_t timeStampHi;
+    uint32_t timeStampLo;
+  };
+  struct AcqirisTimestamp
+  {
+    double   horPos;
+    uint32_t timeStampLo;
+    uint32_t timeStampHi;
+  };
+  struct AcqirisDataDesc
+  {
+    uint32_t returnedSamplesPerSeg;
+    uint32_t indexFirstPoint;
+    double   sampTime;
+    double   vGain;
+    double   vOffset;
+    uint32_t returnedSegments;
+    uint32_t nbrAvgWforms;
+    uint32_t actualTriggersInAcqLo;
+    uint32_t actualTriggersInAcqHi;
+    uint32_t actualDataSize;
+    uint32_t reserved2;
+    double   reserved3;
+  };
+  //fails to compile when the layouts differ//
+  typedef char checkPnCCDFrame[sizeof(PnCCDFrameHeader) == sizeof(Pds::PNCCD::FrameV1) ? 1 : -1];
+  typedef char checkTimestamp[sizeof(AcqirisTimestamp) == sizeof(Pds::Acqiris::TimestampV1) ? 1 : -1];
+  typedef char checkDataDesc[sizeof(AcqirisDataDesc) == sizeof(Pds::Acqiris::DataDescV1) ? 1 : -1];
+
+  //the pnCCD sends its frame in 4 segments of 512x512 pixels//
+  const uint32_t PnCCDLinks       = 4;
+  const uint32_t PnCCDLinkPixels  = 512*512;
+  const uint32_t PnCCDLinkSize    = sizeof(Pds::PNCCD::FrameV1) + PnCCDLinkPixels*sizeof(uint16_t);
+  //seconds between 1970 and 1990, where the epics time starts//
+  const uint32_t EpicsEpoch       = 631152000;
+
+  //append an xtc without payload to the container//
+  Pds::Xtc &append(Pds::Xtc &container, const Pds::TypeId &type, const Pds::Src &src)
+  {
+    return *new (&container) Pds::Xtc(type,src);
+  }
+
+  //reserve the payload of the last xtc in the container//
+  char *reserve(Pds::Xtc &container, Pds::Xtc &xtc, uint32_t size)
+  {
+    container.alloc(size);
+    return static_cast<char*>(xtc.alloc(size));
+  }
+
+  //the container of one source in the datagram, it has to be closed before the next one//
+  Pds::Xtc &open(Pds::Xtc &root, uint32_t processId)
+  {
+    return append(root,Pds::TypeId(Pds::TypeId::Id_Xtc,1),Pds::ProcInfo(Pds::Level::Segment,processId,0));
+  }
+  void close(Pds::Xtc &root, Pds::Xtc &container)
+  {
+    root.alloc(container.sizeofPayload());
+  }
+}
+
+
+cass::XtcGenerator::Parameter::Parameter()
+  :nbrEvents(100),
+   seed(1),
+   startTime(1262304000),
+   nbrPnCCDs(2),
+   photonDensity(0.01),
+   nbrChannels(8),
+   nbrSamples(20000),
+   sampleInterval(1e-9),
+   peakDensity(5),
+   cameraColumns(640),
+   cameraRows(480),
+   nbrSpots(200),
+   beta2(1.5),
+   nbrPvs(16),
+   epicsPeriod(120)
+{
+}
+
+cass::XtcGenerator::XtcGenerator(const Parameter &param)
+  :_param(param),
+   _random(param.seed),
+   _noise(1<<16)
+{
+  _param.nbrChannels = std::min<uint32_t>(_param.nbrChannels,Pds::Acqiris::ConfigV1::MaxChan);
+  //the noise values, 8 fractional bits//
+  for (size_t i=0; i<_noise.size(); ++i)
+    _noise[i] = static_cast<int16_t>(std::max(-32767.,std::min(32767.,floor(_random.gaussian()*256 + 0.5))));
+
+  //the largest datagram, every source has its container//
+  const size_t header = sizeof(Pds::Xtc);
+  Pds::Acqiris::HorizV1 horiz(_param.sampleInterval,0,_param.nbrSamples,1);
+  size_t size = sizeof(Pds::Dgram) + 5*header;
+  size += _param.nbrPnCCDs * (header + std::max<size_t>(sizeof(Pds::PNCCD::ConfigV1),PnCCDLinks*PnCCDLinkSize));
+  size += header + std::max<size_t>(sizeof(Pds::Acqiris::ConfigV1),
+                                    _param.nbrChannels*Pds::Acqiris::DataDescV1::totalSize(horiz));
+  size += header + sizeof(Pds::Camera::FrameV1) + _param.cameraColumns*_param.cameraRows*sizeof(uint16_t);
+  size += 3*header + sizeof(Pds::BldDataEBeam) + sizeof(Pds::BldDataFEEGasDetEnergy) + sizeof(Pds::BldDataPhaseCavity);
+  size += _param.nbrPvs * (header + sizeof(Pds::EpicsPvCtrl<DBR_DOUBLE>));
+  _buffer.resize(size);
+}
+
+Pds::Xtc &cass::XtcGenerator::beginDatagram(int transition, uint32_t event)
+{
+  //the events come at 120 Hz, the fiducials count with 360 Hz//
+  Pds::Dgram &dg = *reinterpret_cast<Pds::Dgram*>(&_buffer[0]);
+  const Pds::ClockTime clock(_param.startTime + event/120, (event%120)*(1000000000/120));
+  const Pds::TimeStamp stamp(0,(3*event) % Pds::TimeStamp::MaxFiducials,0);
+  dg.seq = Pds::Sequence(Pds::Sequence::Event,static_cast<Pds::TransitionId::Value>(transition),clock,stamp);
+  dg.env = Pds::Env(0);
+  new (reinterpret_cast<char*>(&dg.xtc)) Pds::Xtc(Pds::TypeId(Pds::TypeId::Id_Xtc,1),
+                                                   Pds::ProcInfo(Pds::Level::Event,0,0));
+  return dg.xtc;
+}
+
+bool cass::XtcGenerator::flush(FILE *fp)
+{
+  const Pds::Dgram &dg = *reinterpret_cast<const Pds::Dgram*>(&_buffer[0]);
+  const size_t size = sizeof(dg) + dg.xtc.sizeofPayload();
+  return fwrite(&_buffer[0],1,size,fp) == size;
+}
+
+uint64_t cass::XtcGenerator::write(const std::string &filename)
+{
+  FILE *fp = fopen(filename.c_str(),"wb");
+  if (!fp)
+  {
+    std::cout << "XtcGenerator: could not create \""<<filename<<"\""<<std::endl;
+    return 0;
+  }
+  //cass reads every datagram into a buffer of 16 MB//
+  if (_buffer.size() > 0x1000000)
+    std::cout << "XtcGenerator: the datagrams may be larger than cass can read"<<std::endl;
+  std::vector<char> filebuffer(1<<24);
+  setvbuf(fp,&filebuffer[0],_IOFBF,filebuffer.size());
+  configure(beginDatagram(Pds::TransitionId::Configure,0));
+  bool ok = flush(fp);
+  for (uint32_t i=0; ok && i<_param.nbrEvents; ++i)
+  {
+    event(beginDatagram(Pds::TransitionId::L1Accept,i),i);
+    ok = flush(fp);
+  }
+  const uint64_t bytes = ftell(fp);
+  if (fclose(fp) || !ok)
+  {
+    std::cout << "XtcGenerator: error when writing \""<<filename<<"\""<<std::endl;
+    return 0;
+  }
+  return bytes;
+}
+
+void cass::XtcGenerator::configure(Pds::Xtc &root)
+{
+  if (_param.nbrPnCCDs)
+  {
+    Pds::Xtc &segment = open(root,1);
+    for (uint32_t det=0; det<_param.nbrPnCCDs; ++det)
+    {
+      Pds::Xtc &xtc = append(segment,Pds::TypeId(Pds::TypeId::Id_pnCCDconfig,Pds::PNCCD::ConfigV1::Version),
+                             Pds::DetInfo(0,Pds::DetInfo::Camp,0,Pds::DetInfo::pnCCD,det));
+      new (reserve(segment,xtc,sizeof(Pds::PNCCD::ConfigV1))) Pds::PNCCD::ConfigV1(PnCCDLinks,PnCCDLinkSize);
+    }
+    close(root,segment);
+  }
+  if (_param.nbrChannels)
+  {
+    Pds::Xtc &segment = open(root,2);
+    Pds::Xtc &xtc = append(segment,Pds::Acqiris::ConfigV1::typeId(),
+                           Pds::DetInfo(0,Pds::DetInfo::Camp,0,Pds::DetInfo::Acqiris,0));
+    Pds::Acqiris::VertV1 vert[Pds::Acqiris::ConfigV1::MaxChan];
+    for (uint32_t i=0; i<Pds::Acqiris::ConfigV1::MaxChan; ++i)
+      vert[i] = Pds::Acqiris::VertV1(0.5,0,Pds::Acqiris::VertV1::DC50ohm,Pds::Acqiris::VertV1::None);
+    const Pds::Acqiris::HorizV1 horiz(_param.sampleInterval,0,_param.nbrSamples,1);
+    const Pds::Acqiris::TrigV1 trig(Pds::Acqiris::TrigV1::DC50ohm,static_cast<uint32_t>(Pds::Acqiris::TrigV1::External),
+                                    Pds::Acqiris::TrigV1::Positive,0.5);
+    new (reserve(segment,xtc,sizeof(Pds::Acqiris::ConfigV1)))
+        Pds::Acqiris::ConfigV1(1,(1u<<_param.nbrChannels)-1,1,trig,horiz,vert);
+    close(root,segment);
+  }
+  addEpics(root,true,0);
+}
+
+void cass::XtcGenerator::event(Pds::Xtc &root, uint32_t event)
+{
+  if (_param.nbrPnCCDs)
+    addPnCCDFrames(root);
+  if (_param.nbrChannels)
+    addWaveforms(root);
+  if (_param.cameraColumns && _param.cameraRows)
+    addCameraFrame(root);
+  addBeamlineData(root,event);
+  if (_param.epicsPeriod && event % _param.epicsPeriod == 0)
+    addEpics(root,false,event);
+}
+
+void cass::XtcGenerator::addPnCCDFrames(Pds::Xtc &root)
+{
+  Pds::Xtc &segment = open(root,1);
+  for (uint32_t det=0; det<_param.nbrPnCCDs; ++det)
+  {
+    Pds::Xtc &xtc = append(segment,Pds::TypeId(Pds::TypeId::Id_pnCCDframe,Pds::PNCCD::FrameV1::Version),
+                           Pds::DetInfo(0,Pds::DetInfo::Camp,0,Pds::DetInfo::pnCCD,det));
+    char *payload = reserve(segment,xtc,PnCCDLinks*PnCCDLinkSize);
+    for (uint32_t link=0; link<PnCCDLinks; ++link)
+    {
+      PnCCDFrameHeader &header = *reinterpret_cast<PnCCDFrameHeader*>(payload + link*PnCCDLinkSize);
+      header.specialWord = 0;
+      header.frameNumber = 0;
+      header.timeStampHi = 0;
+      header.timeStampLo = 0;
+      uint16_t *pixels = reinterpret_cast<uint16_t*>(&header+1);
+      //an offset of 1000 ADU with a noise of 4 ADU, one random number is good for 4 pixels//
+      for (uint32_t i=0; i<PnCCDLinkPixels; i+=4)
+      {
+        const uint64_t r = _random.next();
+        for (uint32_t j=0; j<4; ++j)
+          pixels[i+j] = 1000 + ((4*_noise[(r>>(16*j)) & 0xffff]) >> 8);
+      }
+      //the photons, each with an energy of about 200 ADU//
+      const uint32_t nbrPhotons = _random.poisson(_param.photonDensity*PnCCDLinkPixels);
+      for (uint32_t i=0; i<nbrPhotons; ++i)
+      {
+        uint16_t &pixel = pixels[_random.next() % PnCCDLinkPixels];
+        pixel = std::min(65535.,pixel + 200 + 10*_random.gaussian());
+      }
+    }
+  }
+  close(root,segment);
+}
+
+void cass::XtcGenerator::addWaveforms(Pds::Xtc &root)
+{
+  Pds::Xtc &segment = open(root,2);
+  Pds::Xtc &xtc = append(segment,Pds::TypeId(Pds::TypeId::Id_AcqWaveform,1),
+                         Pds::DetInfo(0,Pds::DetInfo::Camp,0,Pds::DetInfo::Acqiris,0));
+  const Pds::Acqiris::HorizV1 horiz(_param.sampleInterval,0,_param.nbrSamples,1);
+  const uint32_t channelSize = Pds::Acqiris::DataDescV1::totalSize(horiz);
+  char *payload = reserve(segment,xtc,_param.nbrChannels*channelSize);
+  memset(payload,0,_param.nbrChannels*channelSize);
+  for (uint32_t ch=0; ch<_param.nbrChannels; ++ch)
+  {
+    AcqirisDataDesc &desc = *reinterpret_cast<AcqirisDataDesc*>(payload + ch*channelSize);
+    desc.returnedSamplesPerSeg = _param.nbrSamples;
+    desc.sampTime              = _param.sampleInterval;
+    desc.vGain                 = 0.5/1024;
+    desc.returnedSegments      = 1;
+    desc.nbrAvgWforms          = 1;
+    desc.actualDataSize        = _param.nbrSamples;
+    AcqirisTimestamp &timestamp = *reinterpret_cast<AcqirisTimestamp*>(&desc+1);
+    timestamp.horPos = 0;
+    //the 10 bit values of the digitizer are in the upper bits of the samples//
+    int16_t *samples = reinterpret_cast<int16_t*>(&timestamp+1);
+    std::vector<float> waveform(_param.nbrSamples);
+    for (uint32_t i=0; i<_param.nbrSamples; ++i)
+      waveform[i] = 2*_random.gaussian();
+    //negative pulses with a width of about 2 ns//
+    const double sigma = std::max(0.5,0.85e-9/_param.sampleInterval);
+    const int reach = static_cast<int>(ceil(4*sigma));
+    const uint32_t nbrPulses = _random.poisson(_param.peakDensity*_param.nbrSamples/1000.);
+    for (uint32_t p=0; p<nbrPulses; ++p)
+    {
+      const double position  = _random.uniform()*_param.nbrSamples;
+      const double amplitude = 100 + 300*_random.uniform();
+      const int center = static_cast<int>(position);
+      for (int i=std::max(0,center-reach); i<std::min<int>(_param.nbrSamples,center+reach+1); ++i)
+        waveform[i] -= amplitude*exp(-0.5*(i-position)*(i-position)/(sigma*sigma));
+    }
+    for (uint32_t i=0; i<_param.nbrSamples; ++i)
+    {
+      const int adc = std::max(-512,std::min(511,static_cast<int>(floor(waveform[i]+0.5))));
+      samples[i] = static_cast<int16_t>(adc << Pds::Acqiris::DataDescV1::BitShift);
+    }
+  }
+  close(root,segment);
+}
+
+void cass::XtcGenerator::addCameraFrame(Pds::Xtc &root)
+{
+  Pds::Xtc &segment = open(root,3);
+  Pds::Xtc &xtc = append(segment,Pds::TypeId(Pds::TypeId::Id_Frame,Pds::Camera::FrameV1::Version),
+                         Pds::DetInfo(0,Pds::DetInfo::AmoVmi,0,Pds::DetInfo::TM6740,0));
+  const uint32_t columns = _param.cameraColumns;
+  const uint32_t rows    = _param.cameraRows;
+  char *payload = reserve(segment,xtc,sizeof(Pds::Camera::FrameV1)+columns*rows*sizeof(uint16_t));
+  new (payload) Pds::Camera::FrameV1(columns,rows,12,32);
+  uint16_t *pixels = reinterpret_cast<uint16_t*>(payload + sizeof(Pds::Camera::FrameV1));
+  for (uint32_t i=0; i<columns*rows; ++i)
+    pixels[i] = 32 + ((2*_noise[_random.next() & 0xffff]) >> 8);
+  //the hits are on a ring around the center, the angle to the vertical polarisation is//
+  //distributed like 1 + beta2 P2(cos theta)//
+  const double radius = 0.25*std::min(columns,rows);
+  const double maxWeight = 1 + std::max(_param.beta2,-0.5*_param.beta2);
+  const uint32_t nbrSpots = _random.poisson(_param.nbrSpots);
+  for (uint32_t s=0; s<nbrSpots; ++s)
+  {
+    double theta, weight;
+    do
+    {
+      theta = 2*M_PI*_random.uniform();
+      const double c = cos(theta);
+      weight = 1 + _param.beta2*0.5*(3*c*c-1);
+    } while (_random.uniform()*maxWeight > weight);
+    const double r = radius + 3*_random.gaussian();
+    const double x = 0.5*columns + r*sin(theta);
+    const double y = 0.5*rows    + r*cos(theta);
+    const double amplitude = 200 + 600*_random.uniform();
+    for (int iy=static_cast<int>(y)-2; iy<=static_cast<int>(y)+2; ++iy)
+      for (int ix=static_cast<int>(x)-2; ix<=static_cast<int>(x)+2; ++ix)
+      {
+        if (ix < 0 || iy < 0 || ix >= static_cast<int>(columns) || iy >= static_cast<int>(rows))
+          continue;
+        const double d2 = (ix-x)*(ix-x) + (iy-y)*(iy-y);
+        uint16_t &pixel = pixels[iy*columns+ix];
+        pixel = std::min(4095.,pixel + amplitude*exp(-d2/(2*1.2*1.2)));
+      }
+  }
+  close(root,segment);
+}
+
+void cass::XtcGenerator::addBeamlineData(Pds::Xtc &root, uint32_t event)
+{
+  Pds::Xtc &segment = open(root,4);
+  Pds::Xtc &beamXtc = append(segment,Pds::TypeId(Pds::TypeId::Id_EBeam,Pds::BldDataEBeam::version),
+                             Pds::BldInfo(0,Pds::BldInfo::EBeam));
+  Pds::BldDataEBeam &beam = *reinterpret_cast<Pds::BldDataEBeam*>(reserve(segment,beamXtc,sizeof(Pds::BldDataEBeam)));
+  beam.uDamageMask     = 0;
+  beam.fEbeamCharge    = 0.25 + 0.005*_random.gaussian();
+  beam.fEbeamL3Energy  = 13600 + 10*_random.gaussian();
+  beam.fEbeamLTUPosX   = 0.01*_random.gaussian();
+  beam.fEbeamLTUPosY   = 0.01*_random.gaussian();
+  beam.fEbeamLTUAngX   = 0.001*_random.gaussian();
+  beam.fEbeamLTUAngY   = 0.001*_random.gaussian();
+  beam.fEbeamPkCurrBC2 = 3000 + 100*_random.gaussian();
+
+  Pds::Xtc &gasXtc = append(segment,Pds::TypeId(Pds::TypeId::Id_FEEGasDetEnergy,0),
+                            Pds::BldInfo(0,Pds::BldInfo::FEEGasDetEnergy));
+  Pds::BldDataFEEGasDetEnergy &gas =
+      *reinterpret_cast<Pds::BldDataFEEGasDetEnergy*>(reserve(segment,gasXtc,sizeof(Pds::BldDataFEEGasDetEnergy)));
+  const double pulseEnergy = std::max(0.,2 + 0.3*_random.gaussian());
+  gas.f_11_ENRC = pulseEnergy + 0.05*_random.gaussian();
+  gas.f_12_ENRC = pulseEnergy + 0.05*_random.gaussian();
+  gas.f_21_ENRC = pulseEnergy + 0.05*_random.gaussian();
+  gas.f_22_ENRC = pulseEnergy + 0.05*_random.gaussian();
+
+  Pds::Xtc &cavityXtc = append(segment,Pds::TypeId(Pds::TypeId::Id_PhaseCavity,0),
+                               Pds::BldInfo(0,Pds::BldInfo::PhaseCavity));
+  Pds::BldDataPhaseCavity &cavity =
+      *reinterpret_cast<Pds::BldDataPhaseCavity*>(reserve(segment,cavityXtc,sizeof(Pds::BldDataPhaseCavity)));
+  cavity.fFitTime1 = 0.1*sin(event*0.01) + 0.02*_random.gaussian();
+  cavity.fFitTime2 = cavity.fFitTime1 + 0.01*_random.gaussian();
+  cavity.fCharge1  = 100 + _random.gaussian();
+  cavity.fCharge2  = 100 + _random.gaussian();
+  close(root,segment);
+}
+
+void cass::XtcGenerator::addEpics(Pds::Xtc &root, bool ctrl, uint32_t event)
+{
+  if (!_param.nbrPvs)
+    return;
+  Pds::Xtc &segment = open(root,5);
+  const Pds::DetInfo src(0,Pds::DetInfo::EpicsArch,0,Pds::DetInfo::NoDevice,0);
+  for (uint32_t pv=0; pv<_param.nbrPvs; ++pv)
+  {
+    Pds::Xtc &xtc = append(segment,Pds::TypeId(Pds::TypeId::Id_Epics,1),src);
+    //the variables drift slowly//
+    const double value = pv + 0.001*event + 0.01*_random.gaussian();
+    if (ctrl)
+    {
+      Pds::EpicsDbrTools::DbrTypeFromInt<DBR_CTRL_DOUBLE>::TDbr data;
+      memset(&data,0,sizeof(data));
+      data.value = value;
+      char name[64];
+      snprintf(name,sizeof(name),"CASS:SYNTH:PV%02u",pv);
+      new (reserve(segment,xtc,sizeof(Pds::EpicsPvCtrl<DBR_DOUBLE>))) Pds::EpicsPvCtrl<DBR_DOUBLE>(pv,1,name,&data);
+    }
+    else
+    {
+      Pds::EpicsDbrTools::DbrTypeFromInt<DBR_TIME_DOUBLE>::TDbr data;
+      memset(&data,0,sizeof(data));
+      data.stamp.secPastEpoch = _param.startTime + event/120 - EpicsEpoch;
+      data.value = value;
+      new (reserve(segment,xtc,sizeof(Pds::EpicsPvTime<DBR_DOUBLE>))) Pds::EpicsPvTime<DBR_DOUBLE>(pv,1,&data);
+    }
+  }
+  close(root,segment);
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
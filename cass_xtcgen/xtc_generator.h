@@ -0,0 +1,124 @@
+#ifndef CASS_XTCGENERATOR_H
+#define CASS_XTCGENERATOR_H
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Pds
+{
+  class Xtc;
+}
+
+namespace cass
+{
+  //writes a synthetic xtc stream like the DAQ does: a Configure transition followed by//
+  //L1Accept datagrams. Every datagram contains one container per source with the data of//
+  //the pnCCDs (ConfigV1/FrameV1 segments), the Acqiris (ConfigV1/DataDescV1 waveforms with//
+  //pulses), the VMI camera (Camera::FrameV1 with spots on a ring), the beamline data and//
+  //the EPICS variables (ctrl in the Configure, time every epicsPeriod events). The same//
+  //parameters always give the same stream//
+  class XtcGenerator
+  {
+  public:
+    struct Parameter
+    {
+      Parameter();
+      uint32_t  nbrEvents;
+      uint32_t  seed;
+      uint32_t  startTime;          //seconds since 1970 of the first event
+      uint32_t  nbrPnCCDs;          //the pnCCDs, 1024x1024 pixels in 4 segments each
+      double    photonDensity;      //the fraction of pnCCD pixels that are hit by a photon
+      uint32_t  nbrChannels;        //the acqiris channels, 0 for no acqiris
+      uint32_t  nbrSamples;         //the samples per waveform
+      double    sampleInterval;     //in s
+      double    peakDensity;        //the mean number of pulses per 1000 samples
+      uint32_t  cameraColumns;      //the size of the vmi camera frame, 0 for no camera
+      uint32_t  cameraRows;
+      uint32_t  nbrSpots;           //the mean number of hits per camera frame
+      double    beta2;              //the anisotropy of the angular distribution of the hits
+      uint32_t  nbrPvs;             //the epics variables
+      uint32_t  epicsPeriod;        //the events between two epics updates
+    };
+
+  public:
+    explicit XtcGenerator(const Parameter&);
+    ~XtcGenerator()     {}
+
+    //write the whole stream to the file, returns the number of bytes written or 0//
+    uint64_t write(const std::string &filename);
+
+  private:
+    //start a datagram of the given transition in the buffer//
+    Pds::Xtc &beginDatagram(int transition, uint32_t event);
+    void configure(Pds::Xtc &root);
+    void event(Pds::Xtc &root, uint32_t event);
+    void addPnCCDFrames(Pds::Xtc &parent);
+    void addWaveforms(Pds::Xtc &parent);
+    void addCameraFrame(Pds::Xtc &parent);
+    void addBeamlineData(Pds::Xtc &parent, uint32_t event);
+    void addEpics(Pds::Xtc &parent, bool ctrl, uint32_t event);
+    //write the datagram in the buffer to the file//
+    bool flush(FILE*);
+
+  public:
+    //the random numbers of the generator, xorshift64*. Header only, so that other tools can//
+    //make the same canned data without the pdsdata libraries//
+    class Random
+    {
+    public:
+      explicit Random(uint64_t seed):_state(seed ? seed : 0x9e3779b97f4a7c15ULL)    {}
+      uint64_t next()
+      {
+        _state ^= _state >> 12;
+        _state ^= _state << 25;
+        _state ^= _state >> 27;
+        return _state * 2685821657736338717ULL;
+      }
+      //uniform in [0,1)//
+      double uniform()          {return (next()>>11) * (1./9007199254740992.);}
+      //Box-Muller, one of the two values is thrown away//
+      double gaussian()
+      {
+        const double u1 = 1. - uniform();
+        const double u2 = uniform();
+        return sqrt(-2.*log(u1)) * cos(2.*M_PI*u2);
+      }
+      uint32_t poisson(double mean)
+      {
+        if (mean <= 0)
+          return 0;
+        if (mean > 30)
+          return static_cast<uint32_t>(std::max(0.,floor(mean + sqrt(mean)*gaussian() + 0.5)));
+        const double limit = exp(-mean);
+        uint32_t n = 0;
+        for (double p = uniform(); p > limit; p *= uniform())
+          ++n;
+        return n;
+      }
+    private:
+      uint64_t _state;
+    };
+
+  private:
+    Parameter           _param;
+    Random              _random;
+    std::vector<char>   _buffer;        //the datagram that is assembled
+    std::vector<int16_t> _noise;        //gaussian random numbers of sigma 256 to draw the noise from
+  };
+}//end namespace cass
+
+#endif
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End:
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "xtc_generator.h"
+
+
+namespace
+{
+  const char help_text[] =
+    "usage: xtcgen [options] [outputfile]\n\
+    Writes a synthetic xtc file, by default e00-r<run>-s00-c00.xtc\n\
+    \n\
+    -n: Number of L1Accept events (default 100)\n\
+    -r: Run number used for the default file name (default 1)\n\
+    -s: Seed of the random numbers (default 1)\n\
+    -p: Number of pnCCDs (default 2)\n\
+    -d: Fraction of the pnCCD pixels that are hit by a photon (default 0.01)\n\
+    -c: Number of Acqiris channels, 0 for none (default 8)\n\
+    -l: Samples per waveform (default 20000)\n\
+    -k: Mean number of pulses per 1000 samples (default 5)\n\
+    -w: Width of the VMI camera frame, 0 for none (default 640)\n\
+    -H: Height of the VMI camera frame (default 480)\n\
+    -m: Mean number of hits per camera frame (default 200)\n\
+    -b: Anisotropy beta2 of the hits (default 1.5)\n\
+    -e: Number of EPICS variables (default 16)\n\
+    -E: Events between two EPICS updates (default 120)\n\
+    -h: print this text\n\
+";
+}
+
+int main(int argc, char **argv)
+{
+  cass::XtcGenerator::Parameter param;
+  int run = 1;
+  int c;
+  while ((c = getopt(argc,argv,"n:r:s:p:d:c:l:k:w:H:m:b:e:E:h")) != -1)
+  {
+    switch(c)
+    {
+    case 'n': param.nbrEvents     = atoi(optarg); break;
+    case 'r': run                 = atoi(optarg); break;
+    case 's': param.seed          = atoi(optarg); break;
+    case 'p': param.nbrPnCCDs     = atoi(optarg); break;
+    case 'd': param.photonDensity = atof(optarg); break;
+    case 'c': param.nbrChannels   = atoi(optarg); break;
+    case 'l': param.nbrSamples    = atoi(optarg); break;
+    case 'k': param.peakDensity   = atof(optarg); break;
+    case 'w': param.cameraColumns = atoi(optarg); break;
+    case 'H': param.cameraRows    = atoi(optarg); break;
+    case 'm': param.nbrSpots      = atoi(optarg); break;
+    case 'b': param.beta2         = atof(optarg); break;
+    case 'e': param.nbrPvs        = atoi(optarg); break;
+    case 'E': param.epicsPeriod   = atoi(optarg); break;
+    case 'h':
+      printf("%s",help_text);
+      return 0;
+    default:
+      printf("%s",help_text);
+      return 1;
+    }
+  }
+  //the run is taken from the name like the daq names its files//
+  char filename[1024];
+  if (optind < argc)
+    snprintf(filename,sizeof(filename),"%s",argv[optind]);
+  else
+    snprintf(filename,sizeof(filename),"e00-r%04d-s00-c00.xtc",run);
+
+  cass::XtcGenerator generator(param);
+  const uint64_t bytes = generator.write(filename);
+  if (!bytes)
+    return 1;
+  std::cout << "xtcgen: wrote "<<param.nbrEvents<<" events, "<<bytes/1e6<<" MB to \""<<filename<<"\""<<std::endl;
+  return 0;
+}
+
+
+
+// Local Variables:
+// coding: utf-8
+// mode: C++
+// c-file-offsets: ((c . 0) (innamespace . 0))
+// c-file-style: "Stroustrup"
+// fill-column: 100
+// End: